@@ -0,0 +1,30 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <string>
+#include <cstdint>
+
+using json = nlohmann::json;
+
+// Codificación binaria compacta de los mensajes del juego, alternativa al JSON
+// de texto. Los clientes la piden con Sec-WebSocket-Protocol: sd-binary.v1 y
+// sus mensajes viajan como frames binarios; el resto sigue usando JSON.
+//
+// Un mensaje es un objeto con campos etiquetados:
+//   objeto = varint(nº campos) + campo*
+//   campo  = varint(clave) + valor      (clave 0 = nombre literal: varint(len) + bytes)
+//   valor  = 1 byte de tipo + datos     (enteros en varint, negativos como -(v+1))
+// Las claves y los strings frecuentes ("type", "gameState", ...) van como
+// índices de tablas fijas. Las tablas solo se amplían al final: cambiar el
+// orden rompe a los clientes de la misma versión.
+class BinaryProtocol {
+public:
+    // Nombre del subprotocolo WebSocket
+    static const char* const SUBPROTOCOL;
+
+    // Codificar un mensaje (objeto JSON) en binario
+    static std::string encode(const json& message);
+
+    // Decodificar un mensaje binario; lanza std::runtime_error si está mal formado
+    static json decode(const std::string& payload);
+};
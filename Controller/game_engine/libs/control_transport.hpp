@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <memory>
+
+// Headers específicos según el sistema operativo
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    #define SOCKET int
+    #define INVALID_SOCKET -1
+    #define SOCKET_ERROR -1
+    #define closesocket close
+#endif
+
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Canal de control entre procesos (matchmaking <-> motor, motor <-> motor):
+// una petición JSON y su respuesta. La simulación (Controller/simulation)
+// sustituye los sockets por una red en memoria
+class ControlTransport {
+public:
+    virtual ~ControlTransport() {}
+
+    // Enviar una petición a host:port y esperar la respuesta. Lanza
+    // std::runtime_error si no se pudo entregar o no hubo respuesta válida
+    virtual json request(const std::string& host, int port, const json& body) = 0;
+};
+
+// Autenticación del canal de control con el secreto compartido CONTROL_SECRET
+// (mismo valor en el matchmaking y en todos los procesos del motor). Quien
+// envía añade {"auth": {"ts", "mac"}}, con mac = HMAC-SHA256 en hex de
+// "<ts>.<petición sin auth>" (JSON compacto con las claves ordenadas). Quien
+// recibe rechaza firmas inválidas o con ts a más de CONTROL_AUTH_WINDOW_S
+// segundos de su reloj. Sin secreto configurado no se firma ni se exige firma
+class ControlAuth {
+public:
+    static bool enabled();
+
+    // Añadir la firma a una petición saliente (sin secreto la deja igual)
+    static void sign(json& request);
+
+    // Petición con firma válida (siempre true sin secreto); si no, el motivo
+    static bool verify(const json& request, std::string& error);
+};
+
+// Una conexión TCP por petición. El servicio de matchmaking solo acepta
+// HTTP; el canal de control del motor recibe el JSON sin cabeceras
+class TcpControlTransport : public ControlTransport {
+public:
+    enum Framing { RAW_JSON, HTTP };
+
+    explicit TcpControlTransport(Framing framing) : framing(framing) {}
+
+    json request(const std::string& host, int port, const json& body) override;
+
+    // Leer un mensaje JSON completo (puede llegar en varios segmentos TCP).
+    // Devuelve lo recibido aunque el otro extremo cierre antes
+    static std::string receiveJson(SOCKET sock);
+
+    static bool sendAll(SOCKET sock, const std::string& data);
+
+private:
+    Framing framing;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <websocketpp/server.hpp>
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include "game_session.hpp"
+
+using json = nlohmann::json;
+using websocketpp::connection_hdl;
+
+// Gateway WebSocket: un único puerto para todas las partidas. Cada conexión
+// se asocia a la GameSession de su partida según el matchId del "identify".
+class GameGateway {
+public:
+    // Singleton pattern
+    static GameGateway& getInstance() {
+        static GameGateway instance;
+        return instance;
+    }
+
+    // Inicializar el servidor
+    void initialize();
+
+    // Inicializar sin servidor WebSocket: las conexiones llegan por el
+    // transporte dado (la simulación en memoria) y run() no escucha
+    void initialize(std::shared_ptr<GameTransport> transport);
+    
+    // Escuchar en el puerto y atender con numThreads hilos (bloquea hasta stop()).
+    // Con el IoContextPool activo solo empieza a escuchar y retorna
+    void run(uint16_t port, int numThreads);
+    
+    // Detener el gateway
+    void stop();
+    
+    // Registrar la sesión de una partida nueva
+    std::shared_ptr<GameSession> createSession(int matchId, const std::vector<std::string>& allowedIps);
+    
+    // Eliminar la sesión de una partida terminada y cerrar sus conexiones
+    void removeSession(int matchId);
+
+    // Sesión de una partida (nullptr si no está alojada aquí)
+    std::shared_ptr<GameSession> getSession(int matchId);
+    
+    // Número de partidas alojadas
+    size_t getSessionCount();
+
+    // Conexiones asociadas a alguna sesión
+    size_t getConnectionCount();
+
+    // Colas de salida de todas las conexiones del gateway
+    json getQueueStats();
+
+    // Entrada de eventos del transporte: mensaje recibido y conexión cerrada
+    void onTransportMessage(connection_hdl hdl, const std::string& payload, bool binary);
+    void onTransportClose(connection_hdl hdl);
+
+private:
+    GameGateway();
+    ~GameGateway();
+
+    // Disallow copying
+    GameGateway(const GameGateway&) = delete;
+    GameGateway& operator=(const GameGateway&) = delete;
+
+    // Callbacks para eventos WebSocket
+    void onClose(connection_hdl hdl);
+    void onMessage(connection_hdl hdl, GameSession::WebSocketServer::message_ptr msg);
+
+    // Servidor WebSocket compartido
+    GameSession::WebSocketServer server;
+
+    // Conexiones que usan las sesiones (las del servidor salvo en simulación)
+    std::shared_ptr<GameTransport> transport;
+    
+    // matchId -> sesión
+    std::unordered_map<int, std::shared_ptr<GameSession>> sessions;
+    
+    // Conexión -> sesión a la que se unió con "identify"
+    std::unordered_map<connection_hdl, std::shared_ptr<GameSession>, GameConnectionHasher, GameConnectionEqual> connectionSessions;
+    
+    // Mutex para proteger los mapas
+    std::mutex mutex;
+    
+    // Hilos que ejecutan el bucle de eventos
+    std::vector<std::thread> workers;
+    
+    // Usa el io_service compartido en vez de uno propio
+    bool sharedIo;
+
+    // Las conexiones llegan por un transporte externo, no por el servidor
+    bool externalTransport;
+    
+    std::atomic<bool> running;
+};
@@ -0,0 +1,313 @@
+#pragma once
+
+#include <websocketpp/server.hpp>
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <deque>
+#include <chrono>
+#include <atomic>
+#include "latency_metrics.hpp"
+#include "game_transport.hpp"
+
+using json = nlohmann::json;
+using websocketpp::connection_hdl;
+
+// Definir hash personalizado para connection_hdl
+struct GameConnectionHasher {
+    std::size_t operator()(connection_hdl const& hdl) const {
+        return std::hash<void*>()(hdl.lock().get());
+    }
+};
+
+// Definir comparador personalizado para connection_hdl
+struct GameConnectionEqual {
+    bool operator()(connection_hdl const& lhs, connection_hdl const& rhs) const {
+        return lhs.lock().get() == rhs.lock().get();
+    }
+};
+
+// Estado de conexión de una partida, independiente del servidor que la aloja.
+// Lo usa tanto GameWebSocketServer (un servidor por partida) como GameGateway
+// (un único servidor que enruta por matchId); las conexiones se manejan a
+// través de su GameTransport.
+class GameSession : public std::enable_shared_from_this<GameSession> {
+public:
+    // Tipo de servidor WebSocket
+    typedef websocketpp::server<websocketpp::config::asio> WebSocketServer;
+
+    // El transporte debe tener su asio inicializado (el strand usa su io_service)
+    GameSession(int matchId, const std::vector<std::string>& allowedIps, GameTransport& transport);
+
+    // Ejecutar un handler en el strand de la partida (handlers serializados
+    // aunque varios hilos ejecuten el io_service)
+    void post(std::function<void()> handler);
+
+    // Handshake: aceptar el subprotocolo binario si el cliente lo pide
+    // (validate handler de los servidores; siempre acepta la conexión)
+    static bool negotiateProtocol(WebSocketServer& server, connection_hdl hdl);
+
+    // Decodificar un mensaje recibido: frame binario o JSON de texto
+    static json parseMessage(WebSocketServer::message_ptr msg);
+    static json parsePayload(const std::string& payload, bool binary);
+
+    // Enviar un mensaje a una conexión en la codificación que negoció
+    static void send(GameTransport& transport, connection_hdl hdl, const json& message);
+
+    // Mensaje ya serializado, compartido (sin copias) entre destinatarios
+    typedef std::shared_ptr<const std::string> Frame;
+
+    // Verificar que la IP remota de la conexión pueda unirse a la partida
+    // (con tickets firmados no se mira la IP: ver isPlayerAuthorized)
+    bool isConnectionAllowed(connection_hdl hdl);
+
+    // Procesar un mensaje ya parseado de un cliente (trace: marcas de
+    // recepción y parseo, se sigue si el mensaje es una acción)
+    void handleMessage(connection_hdl hdl, const json& data, const LatencyTrace& trace = LatencyTrace());
+
+    // Procesar el cierre de una conexión de esta partida
+    void handleClose(connection_hdl hdl);
+
+    // Heartbeats (HeartbeatMonitor): ping a una conexión y conexión que dejó
+    // de responder, que se da por cerrada sin esperar a TCP
+    void sendPing(connection_hdl hdl, const std::string& payload);
+    void onHeartbeatTimeout(connection_hdl hdl);
+
+    // Enviar mensaje a un cliente específico (por su cola de salida)
+    void sendMessage(int playerId, const json& message);
+
+    // Enviar el mismo mensaje a todos los clientes de la partida (menos
+    // exceptPlayerId). Se serializa una sola vez por codificación y todos los
+    // destinatarios comparten el buffer
+    void broadcast(const json& message, int exceptPlayerId = -1);
+
+    // Cerrar todas las conexiones de la partida
+    void closeAll(const std::string& reason);
+
+    // Profundidad de la cola de salida de cada conexión de la partida
+    json getQueueStats();
+
+    // Conexiones cerradas por quedarse atrás (total del proceso)
+    static uint64_t getEvictionCount();
+
+    // Se aceptan espectadores (MAX_SPECTATORS > 0): las conexiones de IPs que
+    // no son de jugadores solo pueden mirar
+    static bool spectatorsEnabled();
+
+    // Mensaje del flujo público de la partida; snapshot = estado completo que
+    // reciben los espectadores que se acaban de unir
+    void publishToSpectators(const json& message, bool snapshot);
+
+    // Migración a otro proceso: las acciones de los jugadores se retienen en
+    // vez de llegar a la partida (releaseAfterMs > 0: se liberan solas si no
+    // llega releaseActions). Sin plazo (origen) la partida sale de su hilo:
+    // también se retienen las peticiones de estado y los avisos de conexión
+    void holdActions(long releaseAfterMs = 0);
+
+    // Origen: acciones retenidas como [playerId, mensaje], para reenviarlas al
+    // destino (se siguen reteniendo las que lleguen después)
+    json takeHeldActions();
+
+    // Enviar a la partida primero las peticiones retenidas, después las
+    // acciones reenviadas por el origen y luego las retenidas aquí, y dejar
+    // de retener
+    void releaseActions(const json& forwarded);
+
+    // Origen: avisar a cada cliente del servidor nuevo (los jugadores con su
+    // token). Los mensajes que lleguen después reciben el mismo aviso
+    void redirect(const std::string& serverIp, int serverPort, const json& tokens);
+
+    // Destino: token que cada jugador debe presentar en su "identify"
+    void setReconnectTokens(const std::unordered_map<int, std::string>& tokens);
+
+    const std::vector<std::string>& getAllowedIps() const { return allowedIps; }
+
+    // Get match ID
+    int getMatchId() const { return matchId; }
+
+private:
+    void handleIdentify(connection_hdl hdl, const json& data);
+    void handlePlayerMessage(connection_hdl hdl, const json& data);
+    void handleAction(connection_hdl hdl, const json& data, const LatencyTrace& trace);
+    void handleStateSync(connection_hdl hdl, const json& data);
+    void handleSpectate(connection_hdl hdl);
+
+    // Pedir el estado completo para los espectadores (reintenta si el hilo
+    // de la partida tiene el buzón lleno)
+    void requestSpectatorSnapshot();
+
+    // Asociar la conexión al jugador, con cola de salida y heartbeat nuevos
+    // (solo jugadores ya verificados como miembros de la partida)
+    void registerPlayer(connection_hdl hdl, int playerId);
+
+    // Registrar la salida del motor de reglas hacia esta sesión
+    void attachOutput();
+
+    // Aviso de migración para una conexión (null si la partida no migró)
+    json migrationMessage(int playerId);
+
+    // playerId identificado en la conexión (-1 si aún no se identificó)
+    int findPlayer(connection_hdl hdl);
+
+    // playerId de un mensaje (-1 si falta o no es un entero no negativo).
+    // Los mensajes son const: operator[] con una clave que no existe aborta
+    // el proceso (assert de nlohmann) en vez de lanzar
+    static int readPlayerId(const json& data);
+
+    // Verificar si una IP está permitida
+    bool isIpAllowed(const std::string& ip);
+
+    // El playerId del mensaje puede usarse en esta conexión: su IP está
+    // permitida y, con MATCH_TICKET_SECRET, trae un ticket válido para él
+    bool isPlayerAuthorized(connection_hdl hdl, const json& data);
+
+    // Mensaje pendiente de entregar a websocketpp
+    struct OutboundMessage {
+        Frame payload;
+        websocketpp::frame::opcode::value opcode;
+        bool state;  // gameState/stateDelta: uno nuevo reemplaza al pendiente
+        std::shared_ptr<LatencyTrace> trace;  // Acción del rival que se completa al enviarlo
+    };
+
+    // Cola de salida de una conexión. websocketpp recibe como mucho una
+    // ventana de bytes; el resto espera aquí, donde los estados se combinan
+    struct SendQueue {
+        connection_hdl hdl;
+        bool binary = false;
+        std::deque<OutboundMessage> pending;
+        size_t pendingBytes = 0;
+        size_t bufferedBytes = 0;   // Último valor leído de websocketpp
+        uint64_t coalesced = 0;
+        bool overLimit = false;
+        std::chrono::steady_clock::time_point overLimitSince;
+        uint32_t heartbeatId = 0;   // Id en HeartbeatMonitor (0 = sin vigilancia)
+        bool sending = false;       // Un hilo entrega un lote (conserva el orden)
+    };
+
+    // Mensajes sacados de una cola para entregarlos a websocketpp sin el mutex
+    struct SendBatch {
+        int playerId = -1;
+        connection_hdl hdl;
+        std::vector<OutboundMessage> messages;
+    };
+
+    // Encolar un mensaje ya serializado para un jugador
+    void enqueueFrame(int playerId, const Frame& payload, bool binary, bool state,
+                      std::shared_ptr<LatencyTrace> trace = nullptr);
+
+    // Con el mutex tomado: pasar a batch lo que quepa en la ventana (si otro
+    // hilo no está entregando ya esta cola) y aplicar el límite de bytes.
+    // Devuelve false si hay que cerrar la conexión
+    bool flushQueue(int playerId, SendQueue& queue, SendBatch& batch);
+
+    // Sin el mutex: entregar el lote y los que se encolen mientras tanto
+    void deliver(SendBatch batch);
+
+    // Reintentar el envío de las colas con pendientes (timer del servidor)
+    void flushAll();
+    void scheduleFlush();
+
+    // Espectador: solo lectura, sin cola propia (si se queda atrás se le cierra)
+    struct Spectator {
+        connection_hdl hdl;
+        bool binary;
+    };
+
+    // Rama del árbol de reparto: sus espectadores solo se tocan en su strand,
+    // así cada grupo conserva el orden y los grupos envían en paralelo en los
+    // hilos del io_service
+    struct SpectatorGroup {
+        explicit SpectatorGroup(websocketpp::lib::asio::io_service& io) : strand(io) {}
+        websocketpp::lib::asio::io_service::strand strand;
+        std::vector<Spectator> pending;  // Esperan el snapshot
+        std::vector<Spectator> active;
+        size_t size = 0;  // Se actualiza con spectatorMutex (decide si se le envía)
+    };
+
+    // Mensaje del flujo público ya codificado, retenido hasta releaseAt.
+    // Con closeReason no se envía nada: se cierra a los espectadores detrás
+    // de lo anterior del flujo
+    struct SpectatorFrame {
+        std::chrono::steady_clock::time_point releaseAt;
+        Frame text;
+        Frame binary;
+        bool snapshot = false;
+        std::string closeReason;
+    };
+
+    // Encolar un mensaje en el flujo, con el retardo de SPECTATOR_DELAY_MS
+    // (spectatorMutex tomado)
+    void queueSpectatorFrame(SpectatorFrame frame);
+
+    // Entregar un mensaje a todos los grupos (spectatorMutex tomado)
+    void dispatchToSpectators(const SpectatorFrame& frame);
+    void releaseSpectatorFrames();
+
+    // En el strand del grupo
+    void deliverToGroup(SpectatorGroup& group, const SpectatorFrame& frame);
+
+    // Cierre de una conexión de espectador
+    void removeSpectator(connection_hdl hdl);
+
+    struct SpectatorEntry {
+        size_t group;
+        bool binary;
+    };
+
+    // Conexiones de esta partida (las del servidor que la aloja)
+    GameTransport& transport;
+
+    // Serializa los handlers de esta partida
+    websocketpp::lib::asio::io_service::strand strand;
+
+    // ID de la partida
+    int matchId;
+
+    // IPs permitidas para conexión
+    std::vector<std::string> allowedIps;
+
+    // Mapeo de playerId a connection_handle
+    std::unordered_map<int, connection_hdl> playerConnections;
+
+    // Mapeo de connection_handle a playerId
+    std::unordered_map<connection_hdl, int, GameConnectionHasher, GameConnectionEqual> connectionPlayers;
+
+    // Cola de salida de cada jugador conectado
+    std::unordered_map<int, SendQueue> sendQueues;
+    bool flushScheduled = false;
+
+    // Migración: acciones retenidas, aviso del servidor nuevo y tokens de
+    // reconexión (holdMutex; el GameThread nunca lo toma)
+    std::mutex holdMutex;
+    bool holding = false;
+    std::vector<std::pair<int, json>> heldActions;
+    bool holdingRequests = false;
+    std::vector<std::function<void()>> heldRequests;
+
+    // Pedir algo al hilo de la partida, o retenerlo mientras sale de él (una
+    // petición encolada detrás de detachMatch se perdería en ese hilo)
+    void submitOrHold(std::function<void()> request);
+    json migration;
+    json migrationTokens;
+    std::atomic<bool> migrated{false};
+    std::unordered_map<int, std::string> reconnectTokens;
+
+    // Espectadores: conexión -> grupo, y el flujo público con su retardo
+    std::mutex spectatorMutex;
+    std::unordered_map<connection_hdl, SpectatorEntry, GameConnectionHasher, GameConnectionEqual> spectatorGroupOf;
+    std::vector<std::unique_ptr<SpectatorGroup>> spectatorGroups;
+    size_t nextSpectatorGroup = 0;
+    size_t textSpectators = 0;
+    size_t binarySpectators = 0;
+    bool spectatorSnapshotRequested = false;
+    std::deque<SpectatorFrame> delayedSpectatorFrames;
+    bool spectatorTimerScheduled = false;
+
+    // Mutex para proteger los mapas
+    std::mutex mutex;
+};
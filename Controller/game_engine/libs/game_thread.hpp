@@ -3,54 +3,149 @@
 #include <iostream>
 #include <memory>
 #include <thread>
-#include <mutex>
 #include <atomic>
 #include <vector>
 #include <unordered_map>
-#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include "match.hpp"
+#include "mpsc_queue.hpp"
+#include "wakeup_event.hpp"
+#include "timer_wheel.hpp"
+#include "latency_metrics.hpp"
 
-class GameThread {
+class GameThread : public MatchScheduler {
 public:
     GameThread(int threadId);
     ~GameThread();
 
-    // Add a match to this thread
-    void addMatch(int matchId, int player1Id, int player2Id);
+    // Add a match to this thread (the Orchestrator owns the Match instance)
+    void addMatch(std::shared_ptr<Match> match);
     
     // Handle player disconnection
     void handlePlayerDisconnect(int matchId, int playerId);
     
     // Handle player reconnection
     void handlePlayerReconnect(int matchId, int playerId);
+
+    // Aplicar una acción de juego en la partida. Devuelve false si el buzón
+    // está lleno: la acción se descarta (las peticiones de los jugadores son
+    // lo único que se rechaza por contrapresión)
+    bool handlePlayerAction(int matchId, int playerId, const MatchEngine::Action& gameAction,
+                            const LatencyTrace& trace = LatencyTrace());
+
+    // Enviar el estado actual de la partida a un jugador (lastSeq > 0: solo
+    // los eventos posteriores a lastSeq y el estado como delta si es posible).
+    // false si el buzón está lleno, como handlePlayerAction
+    bool handleStateRequest(int matchId, int playerId, uint64_t lastSeq = 0);
+
+    int getThreadId() const { return threadId; }
     
     // Get number of active matches
     int getActiveMatchCount() const;
+
+    // Reparto de carga: el hilo destino se prepara para recibir la partida
+    // (guarda las acciones que lleguen antes que ella). Solo desde su worker
+    // (Orchestrator::rebalance): se aplica en el momento, sin pasar por el buzón ...
+    void expectMatch(int matchId);
+
+    // ... y el hilo origen la suelta y se la entrega al destino
+    void releaseMatch(int matchId, std::shared_ptr<GameThread> target);
+
+    // Migración a otro proceso: soltar la partida sin terminarla. callback
+    // recibe la partida (nullptr si ya no está en el hilo) desde el worker
+    void detachMatch(int matchId, std::function<void(std::shared_ptr<Match>)> callback);
+
+    // MatchScheduler: solo lo llaman las partidas de este hilo, desde el worker
+    void scheduleTimer(int matchId, std::chrono::steady_clock::time_point deadline) override;
     
     // Stop the thread
     void stop();
 
 private:
+    // Pending action
+    struct Action {
+        enum Type {
+            ADD_MATCH, DISCONNECT_PLAYER, RECONNECT_PLAYER,
+            PLAYER_ACTION, SEND_STATE,
+            RELEASE_MATCH, ADOPT_MATCH, DETACH_MATCH
+        } type;
+        int matchId;
+        int player1Id;
+        int player2Id;
+        int playerId;  // For disconnect/reconnect actions
+        std::shared_ptr<Match> match;  // For ADD_MATCH / ADOPT_MATCH
+        std::shared_ptr<GameThread> target;  // For RELEASE_MATCH
+        MatchEngine::Action gameAction;  // For PLAYER_ACTION
+        uint64_t lastSeq;  // For SEND_STATE: último evento que vio el cliente
+        std::function<void(std::shared_ptr<Match>)> detached;  // For DETACH_MATCH
+        LatencyTrace trace;  // For PLAYER_ACTION
+    };
+
     // Thread function
     void threadLoop();
 
+    // Encolar un mensaje de control (alta, baja, traspaso de partidas,
+    // conexión de jugadores). Nunca bloquea: con el buzón lleno va a la cola
+    // de desborde. Se llama con el lock del orquestador o de un shard tomado,
+    // que el worker puede estar esperando
+    void enqueue(Action&& action);
+
+    // Encolar una petición de un jugador; false si no cabe
+    bool offer(Action&& action);
+
+    // Despertar al worker solo si está dormido
+    void notifyWorker();
+
+    // Pasar a actions el desborde (con el buzón ya vacío)
+    void takeOverflow(std::vector<Action>& actions);
+
+    // Ejecutar una acción en el hilo de la partida
+    void processAction(Action& action);
+
+    // Actualizar el coste medido de cada partida (una vez por segundo)
+    void sampleCosts();
+
+    // Ejecutar en lote los plazos vencidos de las partidas
+    void runTimers(std::chrono::steady_clock::time_point now);
+
+    // Quitar una partida terminada y avisar al orquestador
+    // (que libera el servidor de juego y avisa al matchmaking)
+    void finishMatch(std::unordered_map<int, std::shared_ptr<Match>>::iterator it);
+
+    // Fijar el worker a un núcleo (PIN_GAME_THREADS)
+    void pinToCore();
+
     int threadId;
     std::thread worker;
-    std::mutex mutex;
-    std::condition_variable cv;
     
     // Map of matchId -> Match
     std::unordered_map<int, std::shared_ptr<Match>> matches;
+    std::atomic<int> activeMatchCount;
+
+    // Partidas en camino desde otro hilo y sus acciones recibidas antes que ellas
+    std::unordered_map<int, std::vector<Action>> pendingAdoption;
     
-    // Queue of pending actions
-    struct Action {
-        enum Type { ADD_MATCH, DISCONNECT_PLAYER, RECONNECT_PLAYER } type;
-        int matchId;
-        int player1Id;
-        int player2Id;
-        int playerId;  // For disconnect/reconnect actions
-    };
-    std::vector<Action> pendingActions;
+    // Plazos de turno y de desconexión de todas las partidas del hilo
+    TimerWheel timers;
+    std::vector<int> expiredTimers;
+
+    // Buzón de acciones pendientes (varios productores, el worker consume)
+    MpscQueue<Action> mailbox;
+
+    // Mensajes de control que no cupieron en el buzón, en orden. Mientras
+    // haya alguno, todo lo nuevo va detrás (o se rechaza, si es de un
+    // jugador) para no adelantarlos; el worker los toma al vaciar el buzón
+    std::mutex overflowMutex;
+    std::vector<Action> overflow;
+    std::atomic<bool> overflowing;
+
+    // Acciones máximas procesadas por vuelta del bucle
+    size_t batchSize;
+
+    // El worker está (o va a estar) bloqueado esperando acciones
+    std::atomic<bool> idle;
+    WakeupEvent wakeup;
     
     // Thread state
     std::atomic<bool> running;
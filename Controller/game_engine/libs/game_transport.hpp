@@ -0,0 +1,73 @@
+#pragma once
+
+#include <websocketpp/server.hpp>
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <string>
+#include <functional>
+
+using websocketpp::connection_hdl;
+
+// Conexiones de clientes tal como las usan GameSession y GameGateway:
+// enviar, cerrar, consultar la conexión y programar timers sobre el bucle
+// de eventos, sin depender del servidor concreto. WebSocketTransport va
+// sobre websocketpp; la simulación (Controller/simulation) entrega los
+// mensajes en memoria
+class GameTransport {
+public:
+    typedef std::function<void(const websocketpp::lib::error_code&)> TimerHandler;
+
+    virtual ~GameTransport() {}
+
+    // Bucle de eventos donde corren los strands de las partidas
+    virtual websocketpp::lib::asio::io_service& getIoService() = 0;
+
+    virtual void send(connection_hdl hdl, const std::string& payload,
+                      websocketpp::frame::opcode::value opcode, websocketpp::lib::error_code& ec) = 0;
+
+    virtual void close(connection_hdl hdl, websocketpp::close::status::value code,
+                       const std::string& reason, websocketpp::lib::error_code& ec) = 0;
+
+    // Frame de control ping; el pong llega a HeartbeatMonitor::onPong
+    virtual void ping(connection_hdl hdl, const std::string& payload, websocketpp::lib::error_code& ec) = 0;
+
+    // Bytes ya entregados al transporte que aún no salieron. Lanza si la
+    // conexión ya no existe
+    virtual size_t getBufferedAmount(connection_hdl hdl) = 0;
+
+    // "ip:puerto" del cliente
+    virtual std::string getRemoteEndpoint(connection_hdl hdl) = 0;
+
+    // La conexión negoció el subprotocolo binario
+    virtual bool isBinary(connection_hdl hdl) = 0;
+
+    virtual void setTimer(long ms, TimerHandler handler) = 0;
+
+    // Como los anteriores, pero lanzan std::runtime_error si fallan
+    void send(connection_hdl hdl, const std::string& payload, websocketpp::frame::opcode::value opcode);
+    void close(connection_hdl hdl, websocketpp::close::status::value code, const std::string& reason);
+};
+
+// Conexiones de un servidor websocketpp (gateway o servidor por partida)
+class WebSocketTransport : public GameTransport {
+public:
+    typedef websocketpp::server<websocketpp::config::asio> WebSocketServer;
+
+    explicit WebSocketTransport(WebSocketServer& server) : server(server) {}
+
+    using GameTransport::send;
+    using GameTransport::close;
+
+    websocketpp::lib::asio::io_service& getIoService() override;
+    void send(connection_hdl hdl, const std::string& payload,
+              websocketpp::frame::opcode::value opcode, websocketpp::lib::error_code& ec) override;
+    void close(connection_hdl hdl, websocketpp::close::status::value code,
+               const std::string& reason, websocketpp::lib::error_code& ec) override;
+    void ping(connection_hdl hdl, const std::string& payload, websocketpp::lib::error_code& ec) override;
+    size_t getBufferedAmount(connection_hdl hdl) override;
+    std::string getRemoteEndpoint(connection_hdl hdl) override;
+    bool isBinary(connection_hdl hdl) override;
+    void setTimer(long ms, TimerHandler handler) override;
+
+private:
+    WebSocketServer& server;
+};
@@ -4,77 +4,92 @@
 #include <websocketpp/config/asio_no_tls.hpp>
 #include <nlohmann/json.hpp>
 #include <string>
-#include <unordered_map>
-#include <mutex>
 #include <functional>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
+#include "game_session.hpp"
 
 using json = nlohmann::json;
 using websocketpp::connection_hdl;
 
-// Definir hash personalizado para connection_hdl
-struct GameConnectionHasher {
-    std::size_t operator()(connection_hdl const& hdl) const {
-        return std::hash<void*>()(hdl.lock().get());
-    }
-};
-
-// Definir comparador personalizado para connection_hdl
-struct GameConnectionEqual {
-    bool operator()(connection_hdl const& lhs, connection_hdl const& rhs) const {
-        return lhs.lock().get() == rhs.lock().get();
-    }
-};
-
 // Servidor WebSocket específico para una partida
 class GameWebSocketServer {
 public:
     GameWebSocketServer(int matchId, const std::vector<std::string>& allowedIps);
+    
+    // Servidor en espera (standby): escucha sin partida hasta bindMatch()
+    GameWebSocketServer();
     ~GameWebSocketServer();
+    
+    // Asignar la partida a un servidor en espera ya inicializado y escuchando
+    void bindMatch(int matchId, const std::vector<std::string>& allowedIps);
 
     // Inicializar el servidor
     void initialize();
     
-    // Iniciar el servidor en un puerto específico
-    void run(uint16_t port);
+    // Escuchar en un puerto específico (ec = address_in_use si otro proceso lo ocupa)
+    bool listen(uint16_t port, websocketpp::lib::error_code& ec);
+    
+    // Ejecutar el bucle de eventos propio (no hace nada con el IoContextPool activo)
+    void run();
     
     // Detener el servidor
     void stop();
     
+    // Sin conexiones abiertas (se puede destruir sin handlers pendientes)
+    bool isIdle();
+    
+    // Destruir el servidor desde el strand de su partida, después de los
+    // handlers que aún estén encolados
+    static void retire(std::shared_ptr<GameWebSocketServer> server);
+    
     // Enviar mensaje a un cliente específico
     void sendMessage(int playerId, const json& message);
 
+    // Enviar un mensaje a todos los clientes de la partida (se serializa una vez)
+    void broadcast(const json& message);
+
+    // Colas de salida de las conexiones de la partida
+    json getQueueStats();
+
+    // Sesión actual (vacía mientras el servidor está en espera)
+    std::shared_ptr<GameSession> getSession() const;
+
 private:
     // Callbacks para eventos WebSocket
     void onOpen(connection_hdl hdl);
     void onClose(connection_hdl hdl);
     void onMessage(connection_hdl hdl, websocketpp::server<websocketpp::config::asio>::message_ptr msg);
 
-    // Verificar si una IP está permitida
-    bool isIpAllowed(const std::string& ip);
-
     // Tipo de servidor WebSocket
-    typedef websocketpp::server<websocketpp::config::asio> WebSocketServer;
+    typedef GameSession::WebSocketServer WebSocketServer;
     
     // Servidor WebSocket
     WebSocketServer server;
     
+    // Conexiones del servidor, para la sesión
+    WebSocketTransport transport;
+    
     // ID de la partida
     int matchId;
     
     // IPs permitidas para conexión
     std::vector<std::string> allowedIps;
     
-    // Mapeo de playerId a connection_handle
-    std::unordered_map<int, connection_hdl> playerConnections;
+    // Lógica de la partida (conexiones de jugadores y mensajes).
+    // Se publica con atomic_store porque bindMatch() corre fuera de los hilos de IO
+    std::shared_ptr<GameSession> session;
     
-    // Mapeo de connection_handle a playerId
-    std::unordered_map<connection_hdl, int, GameConnectionHasher, GameConnectionEqual> connectionPlayers;
+    // Usa el io_service compartido en vez de uno propio
+    bool sharedIo;
     
-    // Mutex para proteger los mapas
-    std::mutex mutex;
+    // Conexiones abiertas, para cerrarlas al detener el servidor
+    std::unordered_set<connection_hdl, GameConnectionHasher, GameConnectionEqual> openConnections;
+    std::mutex connectionsMutex;
     
-    // Estado del servidor
-    bool running;
+    // Estado del servidor (stop() se llama desde el hilo de limpieza)
+    std::atomic<bool> running;
 };
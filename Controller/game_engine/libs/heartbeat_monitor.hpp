@@ -0,0 +1,114 @@
+#pragma once
+
+#include "timer_wheel.hpp"
+#include "wakeup_event.hpp"
+#include "latency_metrics.hpp"
+#include <websocketpp/server.hpp>
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using websocketpp::connection_hdl;
+
+class GameSession;
+
+// Ping/pong de WebSocket con los jugadores para detectar conexiones muertas
+// (p. ej. móviles medio abiertos) sin esperar a que TCP cierre el socket.
+// Un solo hilo y una TimerWheel para todas las conexiones: no hay un timer
+// por conexión. El plazo para el pong se adapta al RTT medido (srtt +
+// 4·rttvar, como el RTO de TCP) y el intervalo entre pings a ese plazo, sin
+// pasar de HEARTBEAT_INTERVAL_MS. Sin pong tras MAX_MISSED plazos seguidos
+// (el segundo el doble de largo) la sesión da al jugador por desconectado.
+class HeartbeatMonitor {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // Singleton pattern
+    static HeartbeatMonitor& getInstance() {
+        static HeartbeatMonitor instance;
+        return instance;
+    }
+
+    // Arrancar el hilo (no hace nada con HEARTBEAT_INTERVAL_MS=0)
+    void start();
+    void stop();
+
+    // Vigilar la conexión de un jugador; devuelve su id (0 = sin vigilancia)
+    uint32_t watch(std::weak_ptr<GameSession> session, connection_hdl hdl);
+    void unwatch(uint32_t id);
+
+    // Pong recibido por cualquier servidor (el payload identifica la conexión)
+    void onPong(const std::string& payload);
+
+    // RTT suavizado de una conexión en ms (-1 sin medidas)
+    double getRttMs(uint32_t id);
+
+    // Conexiones vigiladas ahora mismo
+    size_t getWatchedCount();
+
+    // Histogramas de RTT y de detección y contadores, formato Prometheus
+    void appendPrometheus(std::string& out);
+
+private:
+    HeartbeatMonitor();
+    ~HeartbeatMonitor();
+
+    // Disallow copying
+    HeartbeatMonitor(const HeartbeatMonitor&) = delete;
+    HeartbeatMonitor& operator=(const HeartbeatMonitor&) = delete;
+
+    struct Peer {
+        std::weak_ptr<GameSession> session;
+        connection_hdl hdl;
+        uint32_t seq = 0;
+        bool awaitingPong = false;
+        int missed = 0;
+        Clock::time_point due;          // Próximo ping o plazo del pong pendiente
+        Clock::time_point pingSentAt;
+        Clock::time_point lastSeen;     // Último pong (o alta)
+        double srttUs = 0;              // 0 = sin medidas
+        double rttvarUs = 0;
+    };
+
+    // Tarea del hilo fuera del mutex: enviar un ping o avisar a la sesión
+    struct Task {
+        std::weak_ptr<GameSession> session;
+        connection_hdl hdl;
+        std::string ping;   // Vacío = conexión muerta
+    };
+
+    void run();
+
+    // Con el mutex tomado
+    void expire(Clock::time_point now, std::vector<Task>& tasks);
+    void schedule(uint32_t id, Peer& peer, Clock::time_point due);
+    std::chrono::milliseconds timeoutOf(const Peer& peer) const;
+    std::chrono::milliseconds intervalOf(const Peer& peer) const;
+
+    std::chrono::milliseconds maxInterval;
+    std::chrono::milliseconds minTimeout;
+    std::chrono::milliseconds maxTimeout;
+
+    std::mutex mutex;
+    TimerWheel wheel;
+    std::unordered_map<uint32_t, Peer> peers;
+    uint32_t nextId = 1;
+    std::vector<int> expired;
+    Clock::time_point wakeAt;   // Hasta cuándo duerme el hilo
+
+    WakeupEvent wakeup;
+    std::thread worker;
+    std::atomic<bool> running;
+
+    LatencyHistogram rtt;
+    LatencyHistogram detection;   // Último signo de vida -> desconexión declarada
+    std::atomic<uint64_t> pingsSent;
+    std::atomic<uint64_t> deadPeers;
+};
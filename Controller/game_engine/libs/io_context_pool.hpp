@@ -0,0 +1,52 @@
+#pragma once
+
+#include <websocketpp/server.hpp>
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+// Bucle de eventos asio compartido por todos los servidores WebSocket de
+// partidas, ejecutado por un número fijo de hilos. Cada partida serializa sus
+// handlers con su propio strand (ver GameSession).
+class IoContextPool {
+public:
+    typedef websocketpp::lib::asio::io_service IoService;
+
+    // Singleton pattern
+    static IoContextPool& getInstance() {
+        static IoContextPool instance;
+        return instance;
+    }
+
+    // Arrancar numThreads hilos sobre el io_service compartido
+    void start(int numThreads);
+    
+    // Detener el io_service y esperar a los hilos
+    void stop();
+    
+    // ¿Están los servidores usando el pool compartido?
+    bool isRunning() const { return running; }
+    
+    IoService& getIoService() { return ioService; }
+    
+    int getThreadCount() const { return static_cast<int>(workers.size()); }
+
+private:
+    IoContextPool() = default;
+    ~IoContextPool();
+
+    // Disallow copying
+    IoContextPool(const IoContextPool&) = delete;
+    IoContextPool& operator=(const IoContextPool&) = delete;
+
+    IoService ioService;
+    
+    // Mantiene run() activo aunque no haya servidores escuchando
+    std::unique_ptr<IoService::work> work;
+    
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    bool running = false;
+};
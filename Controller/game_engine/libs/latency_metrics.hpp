@@ -0,0 +1,142 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+
+using json = nlohmann::json;
+
+// Marcas de tiempo de una acción de jugador, desde que llega por el WebSocket
+// hasta que el mensaje para el rival se entrega a websocketpp. Viaja por
+// valor con la acción (sesión -> Orchestrator -> buzón del GameThread) y la
+// partida la ve como la traza "actual" del hilo mientras la aplica.
+struct LatencyTrace {
+    enum Stage : uint8_t {
+        RECEIVED,    // onMessage del servidor WebSocket
+        PARSED,      // JSON o binario decodificado
+        LOOKED_UP,   // Orchestrator encontró el hilo dueño (incluye la espera en el strand)
+        ENQUEUED,    // Entró en el buzón del GameThread (tras esperar si estaba lleno)
+        DEQUEUED,    // El worker la sacó del buzón
+        APPLIED,     // El motor de reglas la aplicó
+        SERIALIZED,  // Mensaje para el rival codificado
+        SENT,        // Mensaje para el rival entregado a websocketpp
+        STAGE_COUNT
+    };
+
+    int64_t stamps[STAGE_COUNT] = {};  // steady_clock en ns (0 = sin marca)
+    int matchId = 0;
+    int playerId = 0;
+    uint8_t recorded = RECEIVED;  // Última etapa ya sumada a los histogramas
+
+    // Solo se trazan las acciones que empezaron en onMessage (no las
+    // retenidas por una migración ni las reenviadas por otro proceso)
+    bool active() const { return stamps[RECEIVED] != 0; }
+
+    void stamp(Stage stage) { stamps[stage] = now(); }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Traza de la acción que está aplicando el hilo actual (nullptr si ninguna)
+    static LatencyTrace*& current() {
+        static thread_local LatencyTrace* trace = nullptr;
+        return trace;
+    }
+
+    // Publica una traza como la actual mientras dure el scope
+    struct Scope {
+        explicit Scope(LatencyTrace& trace) { current() = &trace; }
+        ~Scope() { current() = nullptr; }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+};
+
+// Histograma de latencias con buckets en potencias de dos de microsegundo
+// (1 µs .. ~33 s). Solo contadores atómicos: lo actualizan varios hilos a la vez
+class LatencyHistogram {
+public:
+    static const size_t BUCKETS = 26;  // + un bucket final sin límite
+
+    LatencyHistogram();
+
+    void record(int64_t nanoseconds);
+
+    // Límite superior del bucket i en microsegundos
+    static uint64_t bucketBoundUs(size_t i) { return uint64_t(1) << i; }
+
+    uint64_t getCount() const { return count.load(std::memory_order_relaxed); }
+
+    // Percentil aproximado (límite superior del bucket) en microsegundos
+    double percentileUs(double quantile) const;
+
+    // Formato de texto de Prometheus: buckets acumulados, _sum y _count
+    void appendPrometheus(std::string& out, const std::string& name, const std::string& labels) const;
+
+private:
+    std::atomic<uint64_t> buckets[BUCKETS + 1];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sumNs;
+};
+
+// Histogramas por etapa de todas las acciones del proceso y una muestra de
+// trazas completas recientes (TRACE_SAMPLE_RATE: 1 de cada N, 0 = ninguna;
+// TRACE_BUFFER: cuántas se guardan)
+class LatencyMetrics {
+public:
+    // Singleton pattern
+    static LatencyMetrics& getInstance() {
+        static LatencyMetrics instance;
+        return instance;
+    }
+
+    // Marcar el fin de stage y sumar a los histogramas las etapas que
+    // terminaron desde la última vez (ENQUEUED solo se marca: se suma al sacarla)
+    void record(LatencyTrace& trace, LatencyTrace::Stage stage);
+
+    // Sobre la traza actual del hilo, si hay
+    static void recordCurrent(LatencyTrace::Stage stage) {
+        if (LatencyTrace* trace = LatencyTrace::current()) {
+            getInstance().record(*trace, stage);
+        }
+    }
+
+    // El rival ya tiene el mensaje: etapa de envío, total y muestreo
+    void complete(LatencyTrace& trace);
+
+    // Histogramas en formato de texto de Prometheus
+    void appendPrometheus(std::string& out) const;
+
+    // Trazas muestreadas más recientes (la última al final) y percentiles
+    json getSampledTraces();
+    json getSummary() const;
+
+private:
+    LatencyMetrics();
+    ~LatencyMetrics() = default;
+
+    // Disallow copying
+    LatencyMetrics(const LatencyMetrics&) = delete;
+    LatencyMetrics& operator=(const LatencyMetrics&) = delete;
+
+    // Nombre de la etapa que termina en stage ("parse", "lookup"...)
+    static const char* stageName(size_t stage);
+
+    // stages[i]: etapa que termina en la marca i (stages[0] no se usa)
+    LatencyHistogram stages[LatencyTrace::STAGE_COUNT];
+    LatencyHistogram total;
+
+    uint64_t sampleRate;
+    size_t bufferSize;
+    std::atomic<uint64_t> completed;
+
+    std::mutex tracesMutex;
+    std::deque<json> sampledTraces;
+};
@@ -4,16 +4,59 @@
 #include <mutex>
 #include <utility>
 #include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <string>
+#include <functional>
+#include <chrono>
+#include <deque>
+#include <nlohmann/json.hpp>
+#include "src/game/MatchEngine.hpp"
+
+using json = nlohmann::json;
 
 enum class ConnectionStatus {
     CONNECTED,
     DISCONNECTED
 };
 
+// Plazos de una partida (turno, gracia de desconexión). Lo implementa el
+// GameThread dueño con su rueda de temporizadores
+class MatchScheduler {
+public:
+    virtual ~MatchScheduler() = default;
+    virtual void scheduleTimer(int matchId, std::chrono::steady_clock::time_point deadline) = 0;
+};
+
+// Coste total (ns de CPU por segundo) de las partidas cargadas a un hilo.
+// Cada partida suma aquí lo que cambia su coste, así que la carga de un hilo
+// se lee sin recorrer sus partidas
+struct CostAccount {
+    std::atomic<uint64_t> total{0};
+};
+
 // Represents a single match between two players
 class Match {
 public:
-    Match(int matchId, int player1Id, int player2Id);
+    // Destino de la salida para los mensajes iguales para todos los jugadores
+    // (la sesión los serializa una sola vez)
+    static const int ALL_PLAYERS = -1;
+
+    // Destino del flujo público para espectadores (sin manos). sendState con
+    // este destino envía el estado completo y activa los deltas públicos
+    static const int SPECTATORS = -2;
+
+    // barajasIds: índice de mazo de cada jugador (en decks.json), en orden
+    Match(int matchId, int player1Id, int player2Id, const std::vector<int>& barajasIds = {});
+
+    // Reconstruir una partida exportada por otro proceso (migración). Lanza
+    // std::runtime_error si el estado reconstruido no coincide con el exportado
+    explicit Match(const json& exported);
+
+    // Estado completo para migrar la partida a otro proceso (mismo decks.json).
+    // Solo con la partida fuera de todo GameThread (Orchestrator::detachMatch)
+    json exportState() const;
     
     // Handle player disconnection
     bool handleDisconnect(int playerId);
@@ -21,8 +64,39 @@ public:
     // Handle player reconnection
     bool reconnectPlayer(int playerId);
     
-    // Handle player action
-    void handleAction(int playerId, const std::string& action);
+    // Decodificar el mensaje "action" de un cliente (no toca el estado de la
+    // partida, se puede llamar desde cualquier hilo)
+    static bool decodeAction(const json& data, MatchEngine::Action& action, std::string& error);
+
+    // Aplicar una acción con el motor de reglas y enviar el resultado a ambos
+    // jugadores. Solo la llama el GameThread dueño. Devuelve true si la partida terminó
+    bool applyAction(int playerId, const MatchEngine::Action& action);
+
+    // Enviar el estado actual completo a un jugador (GameThread dueño). Es
+    // también la resincronización: los deltas siguientes parten de este estado
+    void sendState(int playerId);
+
+    // Un jugador que se reconecta con el último evento que vio (lastSeq):
+    // recibe solo los eventos posteriores y el estado como delta, o el estado
+    // completo si ya no están en el buffer (GameThread dueño)
+    void resumePlayer(int playerId, uint64_t lastSeq);
+
+    // El cliente confirma que aplicó la versión de estado indicada; los
+    // siguientes envíos son deltas contra ella. Se puede llamar desde
+    // cualquier hilo (la versión se valida al usarla)
+    void ackState(int playerId, uint64_t version);
+
+    // Salida hacia los jugadores (playerId o ALL_PLAYERS); la registra la
+    // sesión WebSocket de la partida
+    void setOutput(std::function<void(int playerId, const json& message)> output);
+
+    // El GameThread dueño se registra al recibir la partida (y la suelta con
+    // nullptr al entregarla a otro hilo); se vuelven a programar los plazos vigentes
+    void attachScheduler(MatchScheduler* scheduler);
+
+    // Procesar los plazos vencidos (turno agotado, jugador que no volvió).
+    // Solo la llama el GameThread dueño. Devuelve true si la partida terminó
+    bool onTimer(std::chrono::steady_clock::time_point now);
     
     // Check if match is active
     bool isActive() const;
@@ -33,7 +107,46 @@ public:
     // Get player IDs
     std::pair<int, int> getPlayerIds() const;
 
+    // Coste medido de la partida, en ns de CPU por segundo (media móvil).
+    // addBusyTime y sampleCost solo los llama el GameThread dueño
+    void addBusyTime(uint64_t ns);
+    void sampleCost();
+    uint64_t getCost() const;
+    void setCost(uint64_t cost);
+    
+    // Cargar el coste de la partida a otro agregado (nullptr = a ninguno,
+    // al terminar o salir del proceso). Lo llama el orquestador con su lock
+    void chargeTo(std::shared_ptr<CostAccount> account);
+
 private:
+    // Estado de juego para un jugador (la mano del rival no se envía)
+    json stateMessage(int playerId, const MatchEngine::Snapshot& snapshot, uint64_t version) const;
+
+    // Cambios del estado de un jugador entre dos versiones
+    json deltaMessage(int playerId, const MatchEngine::Snapshot& base, uint64_t baseVersion,
+                      const MatchEngine::Snapshot& current, uint64_t version) const;
+
+    void send(int playerId, const json& message);
+    int seatToPlayer(uint32_t seat) const { return seat == 0 ? player1Id : player2Id; }
+    uint32_t playerToSeat(int playerId) const { return playerId == player1Id ? 0 : 1; }
+
+    // Registrar una nueva versión del estado y enviarla a ambos jugadores
+    void broadcastState(const MatchEngine::Snapshot& snapshot);
+
+    // Enviar el estado actual a un jugador: delta contra la versión que
+    // confirmó, o el estado completo si ya no está guardada
+    void sendStateUpdate(int playerId);
+
+    // Numerar un evento de la partida, guardarlo para reconexiones y enviarlo a ambos
+    void publishEvent(json event);
+
+    // Terminar la partida avisando a ambos (winnerId -1: empate)
+    void endGame(int winnerId, const std::string& reason);
+
+    // Programar el plazo del turno en curso si cambió de turno
+    void updateTurnTimer(const MatchEngine::Snapshot& snapshot);
+    void scheduleTimer(std::chrono::steady_clock::time_point deadline);
+
     int matchId;
     int player1Id;
     int player2Id;
@@ -41,4 +154,42 @@ private:
     std::atomic<ConnectionStatus> player2Status;
     std::atomic<bool> active;
     std::mutex mutex;
+
+    // Estado autoritativo del juego (solo lo toca el GameThread dueño)
+    std::unique_ptr<MatchEngine> engine;
+    std::function<void(int, const json&)> output;
+
+    // Versiones recientes del estado (base de los deltas) y la última
+    // versión confirmada por cada jugador (0 = ninguna: estado completo)
+    std::deque<std::pair<uint64_t, MatchEngine::Snapshot>> stateHistory;
+    uint64_t stateVersion = 0;
+    std::atomic<uint64_t> ackedVersion[2];
+
+    // Últimos eventos enviados a ambos jugadores (con su "seq") para reenviar
+    // a quien se reconecta
+    std::deque<json> recentEvents;
+    uint64_t eventSeq = 0;
+
+    // Hay espectadores: cada cambio de estado genera también el delta público
+    bool spectated = false;
+
+    // Plazos (time_point::max() = sin plazo); solo los toca el GameThread dueño
+    MatchScheduler* scheduler = nullptr;
+    std::chrono::steady_clock::time_point turnDeadline;
+    std::chrono::steady_clock::time_point disconnectDeadline[2];
+    uint32_t turnSeat = 0;
+    uint32_t turnNumber = 0;
+    int missedTurns[2] = {0, 0};
+
+    // Tiempo de proceso acumulado desde la última muestra
+    uint64_t busyNs = 0;
+    std::atomic<uint64_t> cost;
+    
+    // Agregado al que se carga el coste; costMutex ordena los cambios de
+    // coste (GameThread) con los traspasos de agregado (orquestador)
+    std::shared_ptr<CostAccount> costAccount;
+    std::mutex costMutex;
+    
+    // Cambiar el coste y trasladar la diferencia al agregado (con costMutex)
+    void updateCost(uint64_t newCost);
 };
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <unordered_map>
+#include <shared_mutex>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <cstddef>
+
+class Match;
+class GameThread;
+
+// Mapa matchId -> (Match, GameThread dueño) repartido en shards, cada uno con
+// su propio shared_mutex. Las búsquedas y el envío de acciones a la partida
+// (el camino de cada mensaje WebSocket) solo toman en modo lectura el lock del
+// shard que les toca, así que no compiten entre sí ni con la creación/fin de
+// partidas de otros shards.
+class MatchDirectory {
+public:
+    struct Entry {
+        std::shared_ptr<Match> match;
+        std::shared_ptr<GameThread> thread;
+    };
+
+    MatchDirectory() : count(0) {}
+
+    // Devuelve nullptr si no existe
+    std::shared_ptr<Match> find(int matchId) const;
+
+    // Ejecutar callback con la entrada bajo el lock de lectura del shard: el
+    // hilo dueño no cambia mientras tanto. Devuelve false si no existe
+    bool visit(int matchId, const std::function<void(const Entry&)>& callback) const;
+
+    // Devuelve false si el matchId ya estaba registrado
+    bool insert(int matchId, std::shared_ptr<Match> match, std::shared_ptr<GameThread> thread);
+
+    // Cambiar el hilo dueño. callback recibe la entrada anterior y se ejecuta
+    // bajo el lock de escritura, antes de que nadie vea al dueño nuevo
+    bool reassign(int matchId, std::shared_ptr<GameThread> thread,
+                  const std::function<void(const Entry&)>& callback);
+
+    // Devuelve la partida eliminada (nullptr si no existía)
+    std::shared_ptr<Match> erase(int matchId);
+
+    bool contains(int matchId) const;
+
+    size_t size() const { return count.load(); }
+
+    void clear();
+
+    // Recorre todas las partidas, un shard a la vez (no es una foto atómica)
+    void forEach(const std::function<void(int, const Entry&)>& callback) const;
+
+private:
+    static const size_t SHARD_COUNT = 64;
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<int, Entry> entries;
+    };
+
+    Shard& shardFor(int matchId) {
+        return shards[static_cast<unsigned int>(matchId) % SHARD_COUNT];
+    }
+    const Shard& shardFor(int matchId) const {
+        return shards[static_cast<unsigned int>(matchId) % SHARD_COUNT];
+    }
+
+    Shard shards[SHARD_COUNT];
+    std::atomic<size_t> count;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+// Ticket de entrada a una partida firmado por el matchmaking:
+//   <matchId>.<playerId>.<vence (epoch, s)>.<HMAC-SHA256 en hex>
+// La firma cubre los tres primeros campos con el secreto compartido
+// MATCH_TICKET_SECRET. El motor valida al jugador con un HMAC, sin mirar su
+// IP ni el estado de la partida, así que funciona con jugadores detrás del
+// mismo NAT. Sin secreto configurado no se emiten ni se exigen tickets
+class MatchTicket {
+public:
+    // Hay secreto configurado (MATCH_TICKET_SECRET)
+    static bool enabled();
+
+    // Ticket para un jugador; vence MATCH_TICKET_TTL_SECONDS después
+    static std::string issue(int matchId, int playerId);
+
+    // Firma válida, para esta partida y jugador, y sin vencer
+    static bool verify(const std::string& ticket, int matchId, int playerId);
+
+    // HMAC-SHA256 (RFC 2104) en hex; expuesto para comprobar la implementación
+    static std::string hmacSha256Hex(const std::string& key, const std::string& message);
+};
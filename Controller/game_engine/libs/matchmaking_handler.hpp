@@ -6,6 +6,12 @@
 #include <atomic>
 #include <vector>
 #include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <functional>
 
 // Headers específicos según el sistema operativo
 #ifdef _WIN32
@@ -29,9 +35,14 @@
 #endif
 
 #include <nlohmann/json.hpp>
+#include "port_allocator.hpp"
+#include "control_transport.hpp"
 
 using json = nlohmann::json;
 
+class GameWebSocketServer;
+class GameSession;
+
 // Manejador de comunicación con el servicio de matchmaking
 class MatchmakingHandler {
 public:
@@ -49,6 +60,33 @@ public:
     
     // Detener el handler
     void shutdown();
+    
+    // Partida terminada: libera su servidor y avisa al matchmaking (asíncrono)
+    void onMatchEnded(int matchId);
+    
+    // Puerto del gateway WebSocket compartido (0 = un servidor por partida)
+    int getGatewayPort() const { return gatewayPort; }
+    
+    // Drenado (señal o acción "drain"): se rechazan partidas nuevas, se avisa
+    // al matchmaking de capacidad 0 y las partidas alojadas terminan aquí o,
+    // con destino (targetHost vacío = DRAIN_TARGET_HOST), se migran a él
+    json startDrain(const std::string& targetHost = "", int targetPort = 0);
+    bool isDraining() const { return draining.load(); }
+    
+    // Esperar a que no quede ninguna partida alojada ni aviso de fin pendiente.
+    // false si vence el plazo o abort() devuelve true antes
+    bool waitUntilDrained(std::chrono::steady_clock::time_point deadline, const std::function<bool()>& abort);
+    
+    // Atender una petición del canal de control (matchmaking u otro proceso
+    // del motor), llegue por el socket de run() o por otro transporte
+    json handleControlRequest(const json& request);
+    
+    // Transporte de las peticiones salientes (matchmaking y otros procesos
+    // del motor). Por defecto TCP; la simulación usa uno en memoria
+    void setTransport(std::shared_ptr<ControlTransport> transport);
+    
+    // Partidas alojadas (sesiones del gateway o servidores por partida)
+    size_t getHostedMatchCount();
 
 private:
     // Constructor privado para singleton
@@ -60,16 +98,134 @@ private:
     
     // Procesar requests del matchmaking service
     json processMatchmakingRequest(const json& request);
+
+    // Colas de salida de las conexiones de todas las partidas (acción "stats")
+    json getConnectionStats();
     
     // Crear un nuevo servidor de juego en un puerto específico
     json createGameServer(int matchId, const std::vector<int>& playerIds, const std::vector<std::string>& playerIps,const std::vector<int>& barajasIds);
     
-    // Encontrar un puerto disponible para el nuevo servidor
-    int findAvailablePort();
+    // Alojar una partida: servidor (o sesión del gateway) para sus jugadores.
+    // registerMatch la registra en el orquestador una vez reservado el servidor
+    json hostMatch(int matchId, const std::vector<std::string>& playerIps, const std::function<bool()>& registerMatch);
+    
+    // Sesión WebSocket de una partida alojada aquí (nullptr si no existe)
+    std::shared_ptr<GameSession> findSession(int matchId);
     
-    // Verificar si un puerto está disponible
+    // Migración en vivo. Origen: congelar la partida, enviarla al proceso
+    // destino por su canal de control, redirigir a los clientes y reenviar
+    // las acciones retenidas durante el corte
+    json migrateMatch(int matchId, const std::string& targetHost, int targetPort);
+    
+    // Destino: reconstruir la partida exportada y alojarla, con un token de
+    // reconexión por jugador
+    json importMatch(const json& request);
+    
+    // Destino: aplicar las acciones reenviadas por el origen y las retenidas aquí
+    json commitMigration(int matchId, const json& actions);
+    
+    // Enviar una petición firmada al canal de control de otro proceso y
+    // esperar su respuesta (lanza std::runtime_error si no hay respuesta)
+    json sendControlRequest(const std::string& host, int port, const json& request);
+    
+    // El destino está en MIGRATION_TARGETS (o no hay lista)
+    bool isMigrationTargetAllowed(const std::string& host, int port) const;
+    
+    // Reservar un puerto y dejar el servidor escuchando en él (-1 si no hay puertos)
+    int listenOnAvailablePort(GameWebSocketServer& gameServer);
+    
+    // Verificar si un puerto está disponible (solo como respaldo tras EADDRINUSE)
     bool isPortAvailable(int port);
     
+    // Hilo que libera servidores de partidas terminadas
+    void cleanupLoop();
+    
+    // Detener el servidor de una partida y esperar a su hilo
+    void releaseGameServer(int matchId);
+    
+    // Enviar "matchEnded" al servicio de matchmaking
+    void notifyMatchmakingMatchEnded(int matchId);
+    
+    // Enviar "engineCapacity" al servicio de matchmaking (0 = no crear partidas aquí)
+    void notifyMatchmakingCapacity(int capacity);
+    
+    // Enviar una petición al servicio de matchmaking (HTTP) y esperar su respuesta
+    bool sendToMatchmaking(const json& body);
+    
+    // Hilo del drenado con destino: migra las partidas alojadas una a una
+    void drainLoop(std::string targetHost, int targetPort);
+    
+    // Destruir los servidores detenidos que ya no tienen conexiones
+    void sweepRetiringServers();
+    
+    // Servidor de juego activo y el hilo que ejecuta su bucle de eventos
+    // (sin hilo propio cuando usa el IoContextPool compartido)
+    struct GameServerInstance {
+        std::shared_ptr<GameWebSocketServer> server;
+        std::thread thread;
+        int port;
+    };
+    
+    // Crear un servidor ya escuchando (matchId < 0 = servidor en espera)
+    bool launchGameServer(GameServerInstance& instance, int matchId, const std::vector<std::string>& allowedIps);
+    
+    // Detener un servidor y devolver su puerto
+    void discardGameServer(GameServerInstance& instance);
+    
+    // Tomar un servidor en espera (false si el pool está vacío)
+    bool takeStandbyServer(GameServerInstance& instance);
+    
+    // Hilo que mantiene el pool de servidores en espera lleno
+    void standbyLoop();
+    
+    // Servidor detenido sobre el io_service compartido, esperando a cerrar conexiones
+    struct RetiringServer {
+        std::shared_ptr<GameWebSocketServer> server;
+        std::chrono::steady_clock::time_point stoppedAt;
+    };
+    
+    // matchId -> servidor de juego
+    std::unordered_map<int, GameServerInstance> gameServers;
+    std::vector<RetiringServer> retiringServers;
+    std::mutex serversMutex;
+    
+    // Servidores inicializados y escuchando, listos para asignarse a una partida
+    std::vector<GameServerInstance> standbyServers;
+    int standbyTarget = 0;
+    std::condition_variable standbyCv;
+    std::thread standbyThread;
+    
+    // Partidas terminadas pendientes de liberar (pendingReleases cuenta
+    // también la que se está liberando y avisando al matchmaking)
+    std::queue<int> endedMatches;
+    int pendingReleases = 0;
+    std::condition_variable cleanupCv;
+    std::thread cleanupThread;
+    
+    // Drenado en curso (no se vuelve atrás: el proceso termina al vaciarse)
+    std::atomic<bool> draining{false};
+    std::condition_variable drainCv;
+    std::thread drainThread;
+    
+    // Destino de las partidas al drenar por señal (vacío = esperar a que terminen)
+    std::string drainTargetHost;
+    int drainTargetPort = 0;
+    
+    // Interfaz del canal de control (CONTROL_BIND_IP, por defecto todas)
+    std::string controlBindIp = "0.0.0.0";
+    
+    // Destinos de migración permitidos, "host:puerto" (MIGRATION_TARGETS;
+    // vacío = cualquiera). El destino de drenado siempre está permitido
+    std::vector<std::string> migrationTargets;
+    
+    // Dirección del servicio de matchmaking (canal de control)
+    std::string matchmakingIp = "127.0.0.1";
+    int matchmakingPort = 9001;
+    
+    // Peticiones salientes: al matchmaking (HTTP) y a otros procesos del motor
+    std::shared_ptr<ControlTransport> matchmakingTransport;
+    std::shared_ptr<ControlTransport> engineTransport;
+    
     // Socket del servidor
     SOCKET serverSocket;
     
@@ -77,6 +233,12 @@ private:
     int baseGamePort = 10000;
     int maxGamePort = 11000;
     
+    // Modo gateway: todas las partidas comparten este puerto
+    int gatewayPort = 0;
+    
+    // Puertos libres/ocupados del rango de servidores de juego
+    std::unique_ptr<PortAllocator> portAllocator;
+    
     bool isRunning = false;
     
     // Thread safety
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <websocketpp/server.hpp>
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <string>
+#include <thread>
+#include <atomic>
+
+using websocketpp::connection_hdl;
+
+// Endpoint HTTP de métricas del motor (METRICS_PORT). Solo atiende GET:
+//   /metrics         histogramas de latencia y contadores, formato Prometheus
+//   /metrics/traces  trazas muestreadas recientes y percentiles, JSON
+// Rechaza las conexiones WebSocket.
+class MetricsServer {
+public:
+    // Singleton pattern
+    static MetricsServer& getInstance() {
+        static MetricsServer instance;
+        return instance;
+    }
+
+    // Escuchar en el puerto; sobre el IoContextPool si está activo, si no en
+    // un hilo propio. false si no se pudo abrir el puerto
+    bool start(uint16_t port);
+
+    void stop();
+
+    // Texto de /metrics
+    std::string renderPrometheus();
+
+private:
+    MetricsServer() : sharedIo(false), running(false) {}
+    ~MetricsServer();
+
+    // Disallow copying
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    void onHttp(connection_hdl hdl);
+
+    typedef websocketpp::server<websocketpp::config::asio> HttpServer;
+    HttpServer server;
+    std::thread worker;
+    bool sharedIo;
+    std::atomic<bool> running;
+};
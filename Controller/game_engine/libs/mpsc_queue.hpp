@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// Cola acotada sin locks para muchos productores y un solo consumidor
+// (algoritmo de colas acotadas de D. Vyukov). Cada celda lleva un número de
+// secuencia que indica si está libre para escribir o lista para leer.
+template <typename T>
+class MpscQueue {
+public:
+    // La capacidad se redondea a potencia de 2
+    explicit MpscQueue(size_t requestedCapacity) {
+        size_t capacity = 2;
+        while (capacity < requestedCapacity) {
+            capacity <<= 1;
+        }
+        mask = capacity - 1;
+        buffer.reset(new Cell[capacity]);
+        for (size_t i = 0; i < capacity; i++) {
+            buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos.store(0, std::memory_order_relaxed);
+        dequeuePos = 0;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Encolar (cualquier hilo). Devuelve false si la cola está llena; en ese
+    // caso value no se modifica
+    bool push(T&& value) {
+        Cell* cell;
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &buffer[pos & mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Desencolar (solo el hilo consumidor). Devuelve false si está vacía
+    bool pop(T& value) {
+        Cell* cell = &buffer[dequeuePos & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(dequeuePos + 1) < 0) {
+            return false;
+        }
+        value = std::move(cell->data);
+        cell->data = T();  // Liberar recursos retenidos por la celda
+        cell->sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+        dequeuePos++;
+        return true;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> buffer;
+    size_t mask;
+
+    // Productores y consumidor en líneas de caché distintas
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) size_t dequeuePos;
+};
@@ -11,11 +11,16 @@
 #include <atomic>
 #include <string>
 #include <functional>
+#include <cstdint>
+#include "match_directory.hpp"
+#include "latency_metrics.hpp"
+#include "src/game/MatchEngine.hpp"
 #include <cstdlib> // Para getenv
 
 // Forward declarations
 class Match;
 class GameThread;
+struct CostAccount;
 
 // Orchestrator class - manages player connections and match assignments
 class Orchestrator {
@@ -31,6 +36,9 @@ public:
     
     // Disconnect a player from the system
     void disconnectPlayer(int playerId);
+
+    // Un jugador volvió a conectarse a su partida (cancela su plazo de desconexión)
+    void reconnectPlayer(int matchId, int playerId);
     
     // Initialize the orchestrator
     void initialize();
@@ -41,11 +49,54 @@ public:
     // Match ended notification
     void notifyMatchEnded(int matchId);
     
+    // Callback invoked (outside the orchestrator lock) after a match is removed
+    void setMatchEndedCallback(std::function<void(int)> callback);
+    
     // Get a match by ID
     std::shared_ptr<Match> getMatchById(int matchId);
 
     // Create a match with specific ID (for matchmaking service)
-    bool createMatchWithId(int matchId, int player1Id, int player2Id);
+    bool createMatchWithId(int matchId, int player1Id, int player2Id, const std::vector<int>& barajasIds = {});
+
+    // Resultado de pasar una petición de un jugador al hilo de su partida
+    enum class Submit { QUEUED, MATCH_NOT_FOUND, THREAD_BUSY };
+
+    // Enviar una acción de juego al GameThread dueño de la partida (sin el
+    // lock del orquestador). THREAD_BUSY: su buzón está lleno y la acción se
+    // descarta (el cliente puede reintentarla)
+    Submit submitAction(int matchId, int playerId, const MatchEngine::Action& action,
+                        const LatencyTrace& trace = LatencyTrace());
+
+    // Pedir que se envíe el estado actual de la partida a un jugador
+    // (lastSeq > 0: reconexión, solo lo que ocurrió después de ese evento)
+    Submit requestState(int matchId, int playerId, uint64_t lastSeq = 0);
+
+    // El jugador confirma que aplicó una versión del estado (base de los deltas)
+    bool ackState(int matchId, int playerId, uint64_t version);
+
+    // Migración a otro proceso: sacar la partida de su GameThread y del
+    // directorio sin darla por terminada. nullptr si no existe o ya terminó
+    std::shared_ptr<Match> detachMatch(int matchId);
+
+    // Alojar una partida ya creada (importada de otro proceso o devuelta tras
+    // una migración fallida). false si el matchId ya existe
+    bool attachMatch(std::shared_ptr<Match> match);
+
+    // Partidas alojadas ahora mismo (drenado del proceso)
+    std::vector<int> getMatchIds() const;
+    size_t getMatchCount() const { return matches.size(); }
+
+    // Índices que deben vaciarse con las partidas: jugadores con partida,
+    // partidas cargadas a algún hilo (y su coste total, en ns/s) y partidas
+    // en los propios GameThread
+    size_t getIndexedPlayerCount();
+    size_t getChargedMatchCount();
+    uint64_t getChargedCost();
+    size_t getThreadMatchCount();
+
+    // Llamado periódicamente por cada GameThread: si hay un hilo bastante más
+    // cargado, le pasa a este una de sus partidas
+    void rebalance(int threadId);
 
 private:
     // Constructor is private for singleton
@@ -58,6 +109,8 @@ private:
 
     // Config values (loaded from environment variables)
     int maxMatchesPerThread;
+    int maxThreads;            // Tope de hilos (como mucho hardware_concurrency)
+    uint64_t threadBudgetNs;   // Carga máxima de un hilo para recibir partidas nuevas (ns/s)
     
     // Create a new match between two players
     int createMatch(int player1Id, int player2Id);
@@ -65,11 +118,40 @@ private:
     // Find an available thread or create a new one
     int findAvailableThread();
 
+    // Carga (suma del coste medido de sus partidas) y partidas por hilo,
+    // leídas de los agregados de cada hilo
+    struct ThreadLoad {
+        uint64_t load = 0;
+        int matchCount = 0;
+    };
+    std::unordered_map<int, ThreadLoad> computeThreadLoads();
+    
+    // Partidas cargadas a cada hilo y su coste total. Se actualiza al
+    // registrar, terminar, mover o sacar una partida (requiere el lock).
+    // Se crea junto con el hilo
+    struct ThreadMatches {
+        std::shared_ptr<CostAccount> cost;
+        std::unordered_map<int, std::shared_ptr<Match>> matches;
+    };
+    std::unordered_map<int, ThreadMatches> threadMatches;  // threadId -> partidas
+    
+    // Quitar una partida de su hilo y de su agregado (requiere el lock)
+    void unchargeMatch(int matchId);
+
     // Data structures
     std::vector<int> waitingPlayers;
-    std::unordered_map<int, std::shared_ptr<Match>> matches;  // matchId -> Match
+    MatchDirectory matches;  // matchId -> Match + hilo dueño (lecturas sin el lock del orquestador)
     std::unordered_map<int, std::shared_ptr<GameThread>> threads;  // threadId -> GameThread
     
+    // Índice jugador -> partida (el hilo dueño de cada partida está en matches)
+    std::unordered_map<int, int> playerToMatch;  // playerId -> matchId
+    
+    // Registrar una partida en un hilo y en los índices (requiere el lock)
+    void registerMatch(const std::shared_ptr<Match>& match, int threadId);
+    
+    // Notificación de fin de partida hacia el resto del sistema
+    std::function<void(int)> matchEndedCallback;
+    
     // Thread safety
     std::mutex mutex;
     
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include <functional>
+
+// Asignador de puertos para servidores de partidas: un bitmap con un cursor
+// que recorre las palabras libres, sin syscalls. Los puertos que resultaron
+// ocupados por otro proceso (EADDRINUSE al escuchar) quedan aparte y solo se
+// vuelven a sondear cuando el rango se agota.
+class PortAllocator {
+public:
+    PortAllocator(int basePort, int maxPort);
+
+    // Reservar un puerto (-1 si no hay ninguno libre)
+    int allocate();
+    
+    // Devolver un puerto reservado
+    void release(int port);
+    
+    // El puerto reservado está ocupado fuera del engine (EADDRINUSE)
+    void markInUseExternally(int port);
+    
+    // Sondeo usado como respaldo para los puertos ocupados externamente
+    void setProbe(std::function<bool(int)> probe);
+    
+    int getUsedCount();
+    int getCapacity() const { return maxPort - basePort + 1; }
+
+private:
+    // Buscar un bit libre desde el cursor (requiere el lock)
+    int findFree();
+    
+    void setBit(int index);
+    void clearBit(int index);
+
+    int basePort;
+    int maxPort;
+    
+    // Un bit por puerto: 1 = en uso
+    std::vector<uint64_t> bitmap;
+    
+    // Palabra donde empieza la próxima búsqueda
+    size_t cursor = 0;
+    
+    int used = 0;
+    
+    // Puertos que otro proceso tenía ocupados
+    std::vector<int> externalPorts;
+    std::function<bool(int)> probe;
+    
+    std::mutex mutex;
+};
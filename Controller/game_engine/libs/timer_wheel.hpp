@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Rueda de temporizadores (hashed timing wheel) de un GameThread. Los plazos
+// se agrupan por tick: con miles de partidas por hilo hay como mucho un
+// despertar por tick, no uno por plazo. No hay cancelación: quien recibe un
+// plazo vencido comprueba si sigue vigente (los plazos obsoletos se ignoran).
+class TimerWheel {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    TimerWheel(std::chrono::milliseconds tick, size_t slotCount);
+
+    // Registrar un plazo para una partida
+    void schedule(int matchId, Clock::time_point deadline);
+
+    // Avanzar hasta now y agregar a expired los matchId con plazos vencidos
+    void advance(Clock::time_point now, std::vector<int>& expired);
+
+    // Próximo instante en que advance puede tener trabajo (max() si está vacía)
+    Clock::time_point nextTick() const;
+
+    size_t size() const { return count; }
+
+private:
+    struct Entry {
+        int matchId;
+        uint64_t tick;  // Tick absoluto en que vence
+    };
+
+    uint64_t tickOf(Clock::time_point time) const;
+
+    // Recorrer un slot venciendo las entradas con tick <= limitTick
+    void expireSlot(size_t slot, uint64_t limitTick, std::vector<int>& expired);
+
+    Clock::time_point start;
+    std::chrono::milliseconds tickDuration;
+    std::vector<std::vector<Entry>> slots;
+    uint64_t currentTick;  // Próximo tick por procesar
+    size_t count;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#ifdef __linux__
+    #include <sys/eventfd.h>
+    #include <poll.h>
+    #include <unistd.h>
+#else
+    #include <mutex>
+    #include <condition_variable>
+    #include <chrono>
+#endif
+
+// Señal para despertar a un hilo dormido. En Linux es un eventfd (un
+// contador del kernel, así que no se pierden avisos hechos antes de wait());
+// en otros sistemas se usa una condition_variable con la misma semántica.
+class WakeupEvent {
+public:
+    WakeupEvent();
+    ~WakeupEvent();
+
+    WakeupEvent(const WakeupEvent&) = delete;
+    WakeupEvent& operator=(const WakeupEvent&) = delete;
+
+    // Despertar al hilo que espera (o al próximo wait())
+    void notify();
+
+    // Esperar un notify() o hasta timeoutMs (-1 = sin límite).
+    // Devuelve true si hubo notify()
+    bool wait(int timeoutMs = -1);
+
+private:
+#ifdef __linux__
+    int fd;
+#else
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool signaled = false;
+#endif
+};
@@ -1,14 +1,53 @@
 #include <iostream>
 #include <thread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
 #include "libs/orchestrator.hpp"
+#include "src/game/MatchEngine.hpp"
+#include "src/utils/Log.hpp"
 //#include "libs/websocket_manager.hpp"
 #include "libs/matchmaking_handler.hpp"
+#include "libs/game_gateway.hpp"
+#include "libs/io_context_pool.hpp"
+#include "libs/metrics_server.hpp"
+#include "libs/heartbeat_monitor.hpp"
 #include "src/load_env_file.cpp"
 using namespace std;
 
+// Señales de parada recibidas: la primera drena, la segunda corta ya
+static std::atomic<int> stopSignals(0);
+
+static void onStopSignal(int) {
+    stopSignals++;
+}
+
 int main() {
     loadEnvFile();
-    printf("Starting game orchestrator with WebSocket support\n");
+    LOG_INFO("Starting game orchestrator with WebSocket support");
+    
+    // Bucle de eventos compartido por todos los servidores de partidas.
+    // IO_THREADS=0 vuelve al modelo de un hilo por servidor
+    int ioThreads = std::max(1u, std::thread::hardware_concurrency());
+    const char* ioThreadsEnv = std::getenv("IO_THREADS");
+    if (ioThreadsEnv != nullptr && std::stoi(ioThreadsEnv) >= 0) {
+        ioThreads = std::stoi(ioThreadsEnv);
+    }
+    IoContextPool::getInstance().start(ioThreads);
+
+    // Ping/pong con los jugadores (HEARTBEAT_INTERVAL_MS=0 lo desactiva)
+    HeartbeatMonitor::getInstance().start();
+    
+    // Mazos del motor de reglas (las barajas del matchmaking son índices en este archivo)
+    std::string decksFile = "../../SD_GameEngine-main/decks.json";
+    const char* decksEnv = std::getenv("DECKS_FILE");
+    if (decksEnv != nullptr && decksEnv[0] != '\0') {
+        decksFile = decksEnv;
+    }
+    if (!MatchEngine::loadDecks(decksFile)) {
+        LOG_WARN("Could not load decks from %s", decksFile.c_str());
+    }
     
     // Inicializar el orquestador
     Orchestrator::getInstance().initialize();
@@ -16,6 +55,11 @@ int main() {
     // Inicializar el manejador de matchmaking
     MatchmakingHandler::getInstance().initialize();
     
+    // Al terminar una partida se libera su servidor y se avisa al matchmaking
+    Orchestrator::getInstance().setMatchEndedCallback([](int matchId) {
+        MatchmakingHandler::getInstance().onMatchEnded(matchId);
+    });
+    
     // Inicializar el servidor WebSocket
     //WebSocketManager::getInstance().initialize();
     // Obtener el puerto desde la variable de entorno
@@ -31,30 +75,89 @@ int main() {
         MatchmakingHandler::getInstance().run(serverPort);  // Puerto 9001 para matchmaking);
     });
     
+    // Modo gateway: un único servidor WebSocket para todas las partidas
+    std::thread gatewayThread;
+    int gatewayPort = MatchmakingHandler::getInstance().getGatewayPort();
+    if (gatewayPort > 0) {
+        int gatewayThreads = std::max(1u, std::thread::hardware_concurrency());
+        const char* threadsEnv = std::getenv("GATEWAY_THREADS");
+        if (threadsEnv != nullptr && std::stoi(threadsEnv) > 0) {
+            gatewayThreads = std::stoi(threadsEnv);
+        }
+        GameGateway::getInstance().initialize();
+        gatewayThread = std::thread([gatewayPort, gatewayThreads]() {
+            GameGateway::getInstance().run(gatewayPort, gatewayThreads);
+        });
+    }
+    
+    // Endpoint HTTP /metrics (METRICS_PORT=0 lo desactiva)
+    int metricsPort = 9100;
+    const char* metricsPortEnv = std::getenv("METRICS_PORT");
+    if (metricsPortEnv != nullptr && std::stoi(metricsPortEnv) >= 0) {
+        metricsPort = std::stoi(metricsPortEnv);
+    }
+    if (metricsPort > 0) {
+        MetricsServer::getInstance().start(static_cast<uint16_t>(metricsPort));
+    }
+    
     // Iniciar el servidor WebSocket en un hilo separado
     //std::thread wsThread([serverPort]() {
     //    WebSocketManager::getInstance().run(serverPort);  // Puerto 9002 para WebSocket
     //});
     
-    // Esperar a que el usuario presione una tecla para finalizar
-    printf("Press Enter to stop the server...\n");
-    cin.get();
+    // Plazo máximo del drenado antes de cortar las partidas que queden (0 = sin plazo)
+    int drainTimeoutS = 0;
+    const char* drainTimeoutEnv = std::getenv("DRAIN_TIMEOUT_S");
+    if (drainTimeoutEnv != nullptr && std::stoi(drainTimeoutEnv) > 0) {
+        drainTimeoutS = std::stoi(drainTimeoutEnv);
+    }
+    
+    std::signal(SIGTERM, onStopSignal);
+    std::signal(SIGINT, onStopSignal);
+    
+    // Esperar a una señal (SIGTERM/Ctrl+C) o a la acción "drain" del canal de control
+    LOG_INFO("Send SIGTERM or press Ctrl+C to drain and stop the server...");
+    MatchmakingHandler& handler = MatchmakingHandler::getInstance();
+    while (stopSignals == 0 && !handler.isDraining()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    
+    // Drenar: sin partidas nuevas; las alojadas terminan (o se migran) antes de salir
+    handler.startDrain();
+    auto drainDeadline = drainTimeoutS > 0
+        ? std::chrono::steady_clock::now() + std::chrono::seconds(drainTimeoutS)
+        : std::chrono::steady_clock::time_point::max();
+    bool drained = handler.waitUntilDrained(drainDeadline, []() {
+        return stopSignals >= 2;
+    });
+    if (drained) {
+        LOG_INFO("Drained: no matches left");
+    } else {
+        LOG_WARN("Drain interrupted, stopping remaining matches");
+    }
     
     // Limpiar
     Orchestrator::getInstance().shutdown();
     MatchmakingHandler::getInstance().shutdown();
+    HeartbeatMonitor::getInstance().stop();
+    GameGateway::getInstance().stop();
+    MetricsServer::getInstance().stop();
+    IoContextPool::getInstance().stop();
     //WebSocketManager::getInstance().stop();
     
     // Esperar a que los hilos terminen
     if (mmThread.joinable()) {
         mmThread.join();
     }
+    if (gatewayThread.joinable()) {
+        gatewayThread.join();
+    }
     
     // Esperar a que el hilo de WebSocket termine
     //if (wsThread.joinable()) {
     //    wsThread.join();
     //}
     
-    printf("Server stopped\n");
+    LOG_INFO("Server stopped");
     return 0;
 }
@@ -0,0 +1,298 @@
+#include "../libs/binary_protocol.hpp"
+#include <stdexcept>
+#include <cstring>
+#include <unordered_map>
+
+const char* const BinaryProtocol::SUBPROTOCOL = "sd-binary.v1";
+
+// Tipos de valor (primer byte de cada valor)
+enum ValueType : uint8_t {
+    VALUE_NULL = 0,
+    VALUE_FALSE = 1,
+    VALUE_TRUE = 2,
+    VALUE_UINT = 3,
+    VALUE_NEGINT = 4,
+    VALUE_STRING = 5,
+    VALUE_KNOWN_STRING = 6,
+    VALUE_OBJECT = 7,
+    VALUE_ARRAY = 8,
+    VALUE_DOUBLE = 9
+};
+
+// Claves de campo conocidas; la etiqueta es el índice + 1 (0 = clave literal)
+static const char* const KEYS[] = {
+    "type", "matchId", "playerId", "opponentId", "action",
+    "handIndex", "x", "y", "fromX", "fromY", "targetX", "targetY",
+    "accepted", "error", "message", "content", "fromPlayerId",
+    "winnerId", "reason", "turn", "currentPlayerId", "phase", "gameOver",
+    "you", "opponent", "board", "hand", "handSize",
+    "id", "name", "cost", "attack", "health", "legend",
+    "actionsRemaining", "deckSize", "alive", "ownerId", "card",
+    "version", "baseVersion", "cells", "removed",
+    "seq", "lastSeq", "players", "delayMs",
+    "serverIp", "serverPort", "token", "ticket"
+};
+
+// Strings frecuentes como valor (tipos de mensaje, acciones, motivos)
+static const char* const STRINGS[] = {
+    "identify", "connect", "action", "playerMessage",
+    "playCard", "moveCard", "attack", "endTurn",
+    "matchJoined", "opponentConnected", "opponentAction", "actionResult",
+    "gameState", "gameOver", "turnExpired", "error",
+    "legendDestroyed", "disconnect", "inactivity",
+    "stateDelta", "ackState", "resync", "spectate", "spectating",
+    "migrate"
+};
+
+static const size_t KEY_COUNT = sizeof(KEYS) / sizeof(KEYS[0]);
+static const size_t STRING_COUNT = sizeof(STRINGS) / sizeof(STRINGS[0]);
+
+// Índices inversos para codificar (se construyen una sola vez)
+static const std::unordered_map<std::string, uint64_t>& keyTags() {
+    static const std::unordered_map<std::string, uint64_t> tags = []() {
+        std::unordered_map<std::string, uint64_t> result;
+        for (size_t i = 0; i < KEY_COUNT; i++) {
+            result[KEYS[i]] = i + 1;
+        }
+        return result;
+    }();
+    return tags;
+}
+
+static const std::unordered_map<std::string, uint64_t>& stringTags() {
+    static const std::unordered_map<std::string, uint64_t> tags = []() {
+        std::unordered_map<std::string, uint64_t> result;
+        for (size_t i = 0; i < STRING_COUNT; i++) {
+            result[STRINGS[i]] = i;
+        }
+        return result;
+    }();
+    return tags;
+}
+
+static void writeVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static void writeBytes(std::string& out, const std::string& bytes) {
+    writeVarint(out, bytes.size());
+    out.append(bytes);
+}
+
+static void writeValue(std::string& out, const json& value);
+
+static void writeObject(std::string& out, const json& object) {
+    const auto& tags = keyTags();
+    writeVarint(out, object.size());
+    for (auto it = object.begin(); it != object.end(); ++it) {
+        auto tag = tags.find(it.key());
+        if (tag != tags.end()) {
+            writeVarint(out, tag->second);
+        } else {
+            writeVarint(out, 0);
+            writeBytes(out, it.key());
+        }
+        writeValue(out, it.value());
+    }
+}
+
+static void writeValue(std::string& out, const json& value) {
+    switch (value.type()) {
+        case json::value_t::null:
+            out.push_back(VALUE_NULL);
+            break;
+        case json::value_t::boolean:
+            out.push_back(value.get<bool>() ? VALUE_TRUE : VALUE_FALSE);
+            break;
+        case json::value_t::number_unsigned:
+            out.push_back(VALUE_UINT);
+            writeVarint(out, value.get<uint64_t>());
+            break;
+        case json::value_t::number_integer: {
+            int64_t number = value.get<int64_t>();
+            if (number >= 0) {
+                out.push_back(VALUE_UINT);
+                writeVarint(out, static_cast<uint64_t>(number));
+            } else {
+                out.push_back(VALUE_NEGINT);
+                writeVarint(out, static_cast<uint64_t>(-(number + 1)));
+            }
+            break;
+        }
+        case json::value_t::number_float: {
+            double number = value.get<double>();
+            char bytes[sizeof(double)];
+            std::memcpy(bytes, &number, sizeof(double));
+            out.push_back(VALUE_DOUBLE);
+            out.append(bytes, sizeof(double));
+            break;
+        }
+        case json::value_t::string: {
+            const std::string& text = value.get_ref<const std::string&>();
+            auto tag = stringTags().find(text);
+            if (tag != stringTags().end()) {
+                out.push_back(VALUE_KNOWN_STRING);
+                writeVarint(out, tag->second);
+            } else {
+                out.push_back(VALUE_STRING);
+                writeBytes(out, text);
+            }
+            break;
+        }
+        case json::value_t::object:
+            out.push_back(VALUE_OBJECT);
+            writeObject(out, value);
+            break;
+        case json::value_t::array:
+            out.push_back(VALUE_ARRAY);
+            writeVarint(out, value.size());
+            for (const auto& element : value) {
+                writeValue(out, element);
+            }
+            break;
+        default:
+            throw std::runtime_error("BinaryProtocol: unsupported value type");
+    }
+}
+
+// Lector con verificación de límites sobre el payload recibido
+namespace {
+struct Reader {
+    const std::string& data;
+    size_t pos;
+
+    uint8_t byte() {
+        if (pos >= data.size()) {
+            throw std::runtime_error("BinaryProtocol: truncated message");
+        }
+        return static_cast<uint8_t>(data[pos++]);
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = byte();
+            value |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("BinaryProtocol: varint too long");
+    }
+
+    std::string bytes() {
+        uint64_t length = varint();
+        if (length > data.size() - pos) {
+            throw std::runtime_error("BinaryProtocol: truncated string");
+        }
+        std::string result = data.substr(pos, length);
+        pos += length;
+        return result;
+    }
+};
+}
+
+// Profundidad máxima de anidamiento aceptada (los mensajes del juego usan 4)
+static const int MAX_DEPTH = 16;
+
+static json readValue(Reader& reader, int depth);
+
+static json readObject(Reader& reader, int depth) {
+    json object = json::object();
+    uint64_t fields = reader.varint();
+    for (uint64_t i = 0; i < fields; i++) {
+        uint64_t tag = reader.varint();
+        std::string key;
+        if (tag == 0) {
+            key = reader.bytes();
+        } else if (tag <= KEY_COUNT) {
+            key = KEYS[tag - 1];
+        } else {
+            throw std::runtime_error("BinaryProtocol: unknown field tag");
+        }
+        object[key] = readValue(reader, depth + 1);
+    }
+    return object;
+}
+
+static json readValue(Reader& reader, int depth) {
+    if (depth > MAX_DEPTH) {
+        throw std::runtime_error("BinaryProtocol: message nested too deep");
+    }
+    switch (reader.byte()) {
+        case VALUE_NULL:
+            return nullptr;
+        case VALUE_FALSE:
+            return false;
+        case VALUE_TRUE:
+            return true;
+        case VALUE_UINT: {
+            uint64_t number = reader.varint();
+            // Mismo tipo que produce json::parse para enteros que caben en int64
+            if (number <= static_cast<uint64_t>(INT64_MAX)) {
+                return static_cast<int64_t>(number);
+            }
+            return number;
+        }
+        case VALUE_NEGINT: {
+            uint64_t magnitude = reader.varint();
+            if (magnitude > static_cast<uint64_t>(INT64_MAX)) {
+                throw std::runtime_error("BinaryProtocol: integer out of range");
+            }
+            return -static_cast<int64_t>(magnitude) - 1;
+        }
+        case VALUE_STRING:
+            return reader.bytes();
+        case VALUE_KNOWN_STRING: {
+            uint64_t index = reader.varint();
+            if (index >= STRING_COUNT) {
+                throw std::runtime_error("BinaryProtocol: unknown string tag");
+            }
+            return STRINGS[index];
+        }
+        case VALUE_OBJECT:
+            return readObject(reader, depth);
+        case VALUE_ARRAY: {
+            json array = json::array();
+            uint64_t count = reader.varint();
+            for (uint64_t i = 0; i < count; i++) {
+                array.push_back(readValue(reader, depth + 1));
+            }
+            return array;
+        }
+        case VALUE_DOUBLE: {
+            if (reader.data.size() - reader.pos < sizeof(double)) {
+                throw std::runtime_error("BinaryProtocol: truncated number");
+            }
+            double number;
+            std::memcpy(&number, reader.data.data() + reader.pos, sizeof(double));
+            reader.pos += sizeof(double);
+            return number;
+        }
+        default:
+            throw std::runtime_error("BinaryProtocol: unknown value type");
+    }
+}
+
+std::string BinaryProtocol::encode(const json& message) {
+    if (!message.is_object()) {
+        throw std::runtime_error("BinaryProtocol: message must be an object");
+    }
+    std::string out;
+    out.reserve(64);
+    writeObject(out, message);
+    return out;
+}
+
+json BinaryProtocol::decode(const std::string& payload) {
+    Reader reader{payload, 0};
+    json message = readObject(reader, 0);
+    if (reader.pos != payload.size()) {
+        throw std::runtime_error("BinaryProtocol: trailing bytes");
+    }
+    return message;
+}
@@ -0,0 +1,198 @@
+#include "../libs/control_transport.hpp"
+#include "../libs/match_ticket.hpp"
+#include "src/utils/Log.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+// Tamaño máximo de un mensaje del canal de control (una partida exportada
+// ocupa decenas de KB)
+static const size_t MAX_CONTROL_MESSAGE = 16 * 1024 * 1024;
+
+// Margen por defecto entre el reloj de quien firma y el de quien verifica
+static const long DEFAULT_AUTH_WINDOW_S = 30;
+
+static long readEnvLong(const char* name, long defaultValue) {
+    const char* value = std::getenv(name);
+    if (value == nullptr) {
+        return defaultValue;
+    }
+    try {
+        long parsed = std::stol(value);
+        return parsed > 0 ? parsed : defaultValue;
+    } catch (const std::exception&) {
+        return defaultValue;
+    }
+}
+
+namespace {
+
+struct AuthConfig {
+    std::string secret;
+    long windowSeconds;
+
+    AuthConfig()
+        : secret(std::getenv("CONTROL_SECRET") != nullptr ? std::getenv("CONTROL_SECRET") : ""),
+          windowSeconds(readEnvLong("CONTROL_AUTH_WINDOW_S", DEFAULT_AUTH_WINDOW_S)) {
+        if (!secret.empty() && secret.size() < 32) {
+            LOG_WARN("CONTROL_SECRET is shorter than 32 characters");
+        }
+    }
+};
+
+const AuthConfig& getAuthConfig() {
+    static const AuthConfig config;
+    return config;
+}
+
+std::string signPayload(const AuthConfig& config, long long timestamp, const json& request) {
+    return MatchTicket::hmacSha256Hex(config.secret, std::to_string(timestamp) + "." + request.dump());
+}
+
+// Comparación en tiempo constante: no revela cuántos caracteres coinciden
+bool equalsConstantTime(const std::string& a, const std::string& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    unsigned char diff = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        diff |= static_cast<unsigned char>(a[i] ^ b[i]);
+    }
+    return diff == 0;
+}
+
+} // namespace
+
+bool ControlAuth::enabled() {
+    return !getAuthConfig().secret.empty();
+}
+
+void ControlAuth::sign(json& request) {
+    const AuthConfig& config = getAuthConfig();
+    if (config.secret.empty()) {
+        return;
+    }
+    request.erase("auth");
+    long long timestamp = static_cast<long long>(std::time(nullptr));
+    request["auth"] = {
+        {"ts", timestamp},
+        {"mac", signPayload(config, timestamp, request)}
+    };
+}
+
+bool ControlAuth::verify(const json& request, std::string& error) {
+    const AuthConfig& config = getAuthConfig();
+    if (config.secret.empty()) {
+        return true;
+    }
+
+    auto auth = request.find("auth");
+    if (auth == request.end() || !auth->is_object()) {
+        error = "Missing control signature";
+        return false;
+    }
+    auto timestamp = auth->find("ts");
+    auto mac = auth->find("mac");
+    if (timestamp == auth->end() || !timestamp->is_number_integer() ||
+        mac == auth->end() || !mac->is_string()) {
+        error = "Malformed control signature";
+        return false;
+    }
+
+    long long signedAt = timestamp->get<long long>();
+    long long now = static_cast<long long>(std::time(nullptr));
+    if (signedAt < now - config.windowSeconds || signedAt > now + config.windowSeconds) {
+        error = "Expired control signature";
+        return false;
+    }
+
+    // Se firma la petición sin el campo auth
+    json payload = request;
+    payload.erase("auth");
+    if (!equalsConstantTime(mac->get<std::string>(), signPayload(config, signedAt, payload))) {
+        error = "Invalid control signature";
+        return false;
+    }
+    return true;
+}
+
+std::string TcpControlTransport::receiveJson(SOCKET sock) {
+    std::string data;
+    char buffer[4096];
+    while (data.size() < MAX_CONTROL_MESSAGE) {
+        int bytesReceived = recv(sock, buffer, sizeof(buffer), 0);
+        if (bytesReceived <= 0) {
+            break;
+        }
+        data.append(buffer, bytesReceived);
+        if (json::accept(data)) {
+            break;
+        }
+    }
+    return data;
+}
+
+bool TcpControlTransport::sendAll(SOCKET sock, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int result = send(sock, data.c_str() + sent, static_cast<int>(data.size() - sent), 0);
+        if (result == SOCKET_ERROR || result == 0) {
+            return false;
+        }
+        sent += result;
+    }
+    return true;
+}
+
+json TcpControlTransport::request(const std::string& host, int port, const json& body) {
+    std::string target = host + ":" + std::to_string(port);
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == INVALID_SOCKET) {
+        throw std::runtime_error("Could not create control socket");
+    }
+
+    sockaddr_in serverAddr;
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &serverAddr.sin_addr) != 1 ||
+        connect(sock, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
+        closesocket(sock);
+        throw std::runtime_error("Could not connect to " + target);
+    }
+
+    std::string message = body.dump();
+    if (framing == HTTP) {
+        message = "POST / HTTP/1.1\r\n"
+                  "Host: " + host + "\r\n"
+                  "Content-Type: application/json\r\n"
+                  "Content-Length: " + std::to_string(message.length()) + "\r\n"
+                  "Connection: close\r\n"
+                  "\r\n" + message;
+    }
+    if (!sendAll(sock, message)) {
+        closesocket(sock);
+        throw std::runtime_error("Could not send control request to " + target);
+    }
+
+    // Con HTTP se lee hasta que el servicio cierra y se salta la cabecera
+    std::string response;
+    if (framing == HTTP) {
+        char buffer[4096];
+        int received;
+        while (response.size() < MAX_CONTROL_MESSAGE &&
+               (received = recv(sock, buffer, sizeof(buffer), 0)) > 0) {
+            response.append(buffer, received);
+        }
+        size_t bodyStart = response.find("\r\n\r\n");
+        response = bodyStart == std::string::npos ? "" : response.substr(bodyStart + 4);
+    } else {
+        response = receiveJson(sock);
+    }
+    closesocket(sock);
+
+    if (!json::accept(response)) {
+        throw std::runtime_error("Invalid response from " + target);
+    }
+    return json::parse(response);
+}
@@ -0,0 +1,266 @@
+#include "../libs/game_gateway.hpp"
+#include "../libs/io_context_pool.hpp"
+#include "../libs/heartbeat_monitor.hpp"
+#include "src/utils/Log.hpp"
+#include <iostream>
+#include <functional>
+
+GameGateway::GameGateway() : sharedIo(false), externalTransport(false), running(false) {
+    LOG_INFO("GameGateway created");
+}
+
+GameGateway::~GameGateway() {
+    stop();
+}
+
+void GameGateway::initialize() {
+    // Configurar el servidor WebSocket, sobre el io_service compartido si existe
+    IoContextPool& pool = IoContextPool::getInstance();
+    sharedIo = pool.isRunning();
+    if (sharedIo) {
+        server.init_asio(&pool.getIoService());
+    } else {
+        server.init_asio();
+    }
+    
+    // Registrar callbacks
+    server.set_close_handler(std::bind(&GameGateway::onClose, this, std::placeholders::_1));
+    server.set_validate_handler([this](connection_hdl hdl) {
+        return GameSession::negotiateProtocol(server, hdl);
+    });
+    server.set_message_handler(std::bind(
+        &GameGateway::onMessage, this,
+        std::placeholders::_1, std::placeholders::_2
+    ));
+    server.set_pong_handler([](connection_hdl, std::string payload) {
+        HeartbeatMonitor::getInstance().onPong(payload);
+    });
+
+    // Desactivar logs para producción
+    server.clear_access_channels(websocketpp::log::alevel::all);
+    server.set_reuse_addr(true);
+
+    transport = std::make_shared<WebSocketTransport>(server);
+    
+    LOG_INFO("Game gateway initialized");
+}
+
+void GameGateway::initialize(std::shared_ptr<GameTransport> transport) {
+    this->transport = transport;
+    sharedIo = true;
+    externalTransport = true;
+    LOG_INFO("Game gateway initialized on custom transport");
+}
+
+void GameGateway::run(uint16_t port, int numThreads) {
+    if (running) return;
+    
+    // Sin servidor propio no hay nada que escuchar
+    if (externalTransport) {
+        running = true;
+        return;
+    }
+    
+    try {
+        server.listen(port);
+        server.start_accept();
+        running = true;
+        if (sharedIo) {
+            LOG_INFO("Game gateway listening on port %d (shared IO pool)", port);
+            return;
+        }
+        LOG_INFO("Game gateway listening on port %d with %d threads", port, numThreads);
+        
+        // Varios hilos pueden ejecutar el mismo bucle de eventos
+        for (int i = 1; i < numThreads; i++) {
+            workers.emplace_back([this]() {
+                server.run();
+            });
+        }
+        server.run();
+    } catch (const std::exception& e) {
+        LOG_ERROR("Game gateway error: %s", e.what());
+    }
+    
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+}
+
+void GameGateway::stop() {
+    if (!running.exchange(false) || externalTransport) return;
+    
+    try {
+        websocketpp::lib::error_code ec;
+        server.stop_listening(ec);
+        // El io_service compartido lo detiene el IoContextPool
+        if (!sharedIo) {
+            server.stop();
+        }
+        LOG_INFO("Game gateway stopped");
+    } catch (const std::exception& e) {
+        LOG_ERROR("Error stopping game gateway: %s", e.what());
+    }
+}
+
+std::shared_ptr<GameSession> GameGateway::createSession(int matchId, const std::vector<std::string>& allowedIps) {
+    auto session = std::make_shared<GameSession>(matchId, allowedIps, *transport);
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    sessions[matchId] = session;
+    return session;
+}
+
+void GameGateway::removeSession(int matchId) {
+    std::shared_ptr<GameSession> session;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = sessions.find(matchId);
+        if (it == sessions.end()) {
+            return;
+        }
+        session = it->second;
+        sessions.erase(it);
+    }
+    
+    // Las conexiones se desasocian en onClose
+    session->closeAll("Match ended");
+}
+
+std::shared_ptr<GameSession> GameGateway::getSession(int matchId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = sessions.find(matchId);
+    return it != sessions.end() ? it->second : nullptr;
+}
+
+size_t GameGateway::getSessionCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sessions.size();
+}
+
+size_t GameGateway::getConnectionCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return connectionSessions.size();
+}
+
+json GameGateway::getQueueStats() {
+    std::vector<std::shared_ptr<GameSession>> current;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& pair : sessions) {
+            current.push_back(pair.second);
+        }
+    }
+
+    json connections = json::array();
+    for (auto& session : current) {
+        for (auto& connection : session->getQueueStats()) {
+            connections.push_back(connection);
+        }
+    }
+    return connections;
+}
+
+void GameGateway::onClose(connection_hdl hdl) {
+    onTransportClose(hdl);
+}
+
+void GameGateway::onTransportClose(connection_hdl hdl) {
+    std::shared_ptr<GameSession> session;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = connectionSessions.find(hdl);
+        if (it == connectionSessions.end()) {
+            return;
+        }
+        session = it->second;
+        connectionSessions.erase(it);
+    }
+    // Los mapas de la sesión comparan el puntero de la conexión: se mantiene
+    // viva hasta que su strand procese el cierre (el transporte puede
+    // liberarla antes, y el jugador no constaría como desconectado)
+    std::shared_ptr<void> connection = hdl.lock();
+    session->post([session, hdl, connection]() {
+        session->handleClose(hdl);
+    });
+}
+
+void GameGateway::onMessage(connection_hdl hdl, GameSession::WebSocketServer::message_ptr msg) {
+    onTransportMessage(hdl, msg->get_payload(), msg->get_opcode() == websocketpp::frame::opcode::binary);
+}
+
+void GameGateway::onTransportMessage(connection_hdl hdl, const std::string& payload, bool binary) {
+    LatencyTrace trace;
+    trace.stamp(LatencyTrace::RECEIVED);
+    try {
+        // Parsear el mensaje (JSON o binario)
+        json data = GameSession::parsePayload(payload, binary);
+        trace.stamp(LatencyTrace::PARSED);
+        
+        std::shared_ptr<GameSession> session;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = connectionSessions.find(hdl);
+            if (it != connectionSessions.end()) {
+                session = it->second;
+            }
+        }
+        
+        // Conexión nueva: enrutar por el matchId del mensaje de identificación
+        if (!session) {
+            auto typeField = data.find("type");
+            auto matchField = data.find("matchId");
+            std::string type = typeField != data.end() && typeField->is_string() ? typeField->get<std::string>() : "";
+            if ((type != "identify" && type != "connect" && type != "spectate") ||
+                matchField == data.end() || !matchField->is_number_integer()) {
+                LOG_DEBUG("Gateway: first message must be identify or spectate with matchId");
+                transport->close(hdl, websocketpp::close::status::policy_violation, "Identify required");
+                return;
+            }
+            
+            int matchId = matchField->get<int>();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = sessions.find(matchId);
+                if (it != sessions.end()) {
+                    session = it->second;
+                }
+            }
+            
+            if (!session) {
+                json response = {
+                    {"type", "error"},
+                    {"message", "Match not found"}
+                };
+                GameSession::send(*transport, hdl, response);
+                transport->close(hdl, websocketpp::close::status::policy_violation, "Match not found");
+                return;
+            }
+            
+            // Los espectadores pueden venir de cualquier IP (handleIdentify
+            // verifica la de los jugadores)
+            if (type != "spectate" && !session->isConnectionAllowed(hdl)) {
+                transport->close(hdl, websocketpp::close::status::policy_violation, "Unauthorized IP");
+                return;
+            }
+            
+            std::lock_guard<std::mutex> lock(mutex);
+            connectionSessions[hdl] = session;
+        }
+        
+        // Los handlers de una misma partida se serializan en su strand
+        auto message = std::make_shared<json>(std::move(data));
+        session->post([session, hdl, message, trace]() {
+            try {
+                session->handleMessage(hdl, *message, trace);
+            } catch (const std::exception& e) {
+                LOG_WARN("Error processing message for match %d: %s", session->getMatchId(), e.what());
+            }
+        });
+    } catch (const std::exception& e) {
+        LOG_WARN("Gateway error processing message: %s", e.what());
+    }
+}
@@ -0,0 +1,1276 @@
+#include "../libs/game_session.hpp"
+#include "../libs/orchestrator.hpp"
+#include "../libs/match.hpp"
+#include "../libs/binary_protocol.hpp"
+#include "../libs/match_ticket.hpp"
+#include "../libs/heartbeat_monitor.hpp"
+#include "src/utils/Log.hpp"
+#include <iostream>
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <algorithm>
+
+// Bytes que se entregan a websocketpp por conexión; el resto espera en la
+// cola de la sesión, donde se pueden combinar los estados
+static const size_t SEND_WINDOW_BYTES = 64 * 1024;
+
+// Reintento del envío de las colas con mensajes pendientes
+static const long FLUSH_INTERVAL_MS = 20;
+
+// Límite de bytes pendientes por conexión y tiempo máximo por encima de él
+struct SendQueueLimits {
+    size_t limitBytes;
+    std::chrono::milliseconds slowClientTimeout;
+};
+
+static const SendQueueLimits& getSendQueueLimits() {
+    static const SendQueueLimits limits = []() {
+        SendQueueLimits result = {1024 * 1024, std::chrono::milliseconds(10000)};
+        const char* limitEnv = std::getenv("SEND_QUEUE_LIMIT_KB");
+        if (limitEnv != nullptr && std::atoi(limitEnv) > 0) {
+            result.limitBytes = static_cast<size_t>(std::atoi(limitEnv)) * 1024;
+        }
+        const char* timeoutEnv = std::getenv("SLOW_CLIENT_TIMEOUT_MS");
+        if (timeoutEnv != nullptr && std::atoi(timeoutEnv) > 0) {
+            result.slowClientTimeout = std::chrono::milliseconds(std::atoi(timeoutEnv));
+        }
+        return result;
+    }();
+    return limits;
+}
+
+static std::atomic<uint64_t> evictionCount(0);
+
+// Espectadores por partida (MAX_SPECTATORS, 0 = desactivado), retardo del
+// flujo público (SPECTATOR_DELAY_MS) y ramas del reparto (SPECTATOR_FANOUT_GROUPS)
+struct SpectatorConfig {
+    size_t maxSpectators;
+    std::chrono::milliseconds delay;
+    size_t groups;
+};
+
+static const SpectatorConfig& getSpectatorConfig() {
+    static const SpectatorConfig config = []() {
+        SpectatorConfig result = {10000, std::chrono::milliseconds(0),
+                                  std::max(1u, std::thread::hardware_concurrency())};
+        const char* maxEnv = std::getenv("MAX_SPECTATORS");
+        if (maxEnv != nullptr && std::atoi(maxEnv) >= 0) {
+            result.maxSpectators = std::atoi(maxEnv);
+        }
+        const char* delayEnv = std::getenv("SPECTATOR_DELAY_MS");
+        if (delayEnv != nullptr && std::atoi(delayEnv) > 0) {
+            result.delay = std::chrono::milliseconds(std::atoi(delayEnv));
+        }
+        const char* groupsEnv = std::getenv("SPECTATOR_FANOUT_GROUPS");
+        if (groupsEnv != nullptr && std::atoi(groupsEnv) > 0) {
+            result.groups = std::atoi(groupsEnv);
+        }
+        return result;
+    }();
+    return config;
+}
+
+GameSession::GameSession(int matchId, const std::vector<std::string>& allowedIps, GameTransport& transport)
+    : transport(transport), strand(transport.getIoService()), matchId(matchId), allowedIps(allowedIps) {
+}
+
+void GameSession::post(std::function<void()> handler) {
+    strand.post(std::move(handler));
+}
+
+bool GameSession::negotiateProtocol(WebSocketServer& server, connection_hdl hdl) {
+    auto con = server.get_con_from_hdl(hdl);
+    for (const auto& protocol : con->get_requested_subprotocols()) {
+        if (protocol == BinaryProtocol::SUBPROTOCOL) {
+            con->select_subprotocol(protocol);
+            break;
+        }
+    }
+    return true;
+}
+
+json GameSession::parseMessage(WebSocketServer::message_ptr msg) {
+    return parsePayload(msg->get_payload(), msg->get_opcode() == websocketpp::frame::opcode::binary);
+}
+
+json GameSession::parsePayload(const std::string& payload, bool binary) {
+    if (binary) {
+        return BinaryProtocol::decode(payload);
+    }
+    return json::parse(payload);
+}
+
+void GameSession::send(GameTransport& transport, connection_hdl hdl, const json& message) {
+    if (transport.isBinary(hdl)) {
+        transport.send(hdl, BinaryProtocol::encode(message), websocketpp::frame::opcode::binary);
+    } else {
+        transport.send(hdl, message.dump(), websocketpp::frame::opcode::text);
+    }
+}
+
+bool GameSession::isConnectionAllowed(connection_hdl hdl) {
+    // Sin restricciones de IP, o el jugador se valida con su ticket (varios
+    // jugadores pueden compartir IP detrás de un NAT)
+    if (allowedIps.empty() || MatchTicket::enabled()) {
+        return true;
+    }
+
+    std::string clientEndpoint;
+    std::string clientIp;
+
+    try {
+        clientEndpoint = transport.getRemoteEndpoint(hdl);
+        //printf("DEBUG: Raw endpoint for match %d: [%s]\n", matchId, clientEndpoint.c_str());
+
+        // Extraer solo la IP (remover puerto)
+        size_t colonPos = clientEndpoint.find_last_of(':');
+        if (colonPos != std::string::npos) {
+            clientIp = clientEndpoint.substr(0, colonPos);
+        } else {
+            clientIp = clientEndpoint;
+        }
+
+        // Limpiar corchetes si es IPv6
+        if (!clientIp.empty() && clientIp[0] == '[') {
+            size_t closeBracket = clientIp.find(']');
+            if (closeBracket != std::string::npos) {
+                clientIp = clientIp.substr(1, closeBracket - 1);
+            }
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("Error extracting client IP for match %d: %s", matchId, e.what());
+        clientIp = "unknown";
+    }
+
+    if (!isIpAllowed(clientIp)) {
+        LOG_WARN("Connection from unauthorized IP: [%s] for match %d", clientIp.c_str(), matchId);
+        return false;
+    }
+    return true;
+}
+
+void GameSession::handleMessage(connection_hdl hdl, const json& data, const LatencyTrace& trace) {
+    // La partida ya está en otro proceso: solo se repite el aviso (con el
+    // token si es uno de los jugadores)
+    if (migrated.load(std::memory_order_acquire)) {
+        int playerId = findPlayer(hdl);
+        if (playerId < 0 && readPlayerId(data) >= 0 && isPlayerAuthorized(hdl, data)) {
+            playerId = readPlayerId(data);
+        }
+        send(transport, hdl, migrationMessage(playerId));
+        return;
+    }
+
+    // Cualquier cliente puede mandar cualquier cosa: sin "type" de texto se
+    // responde con un error y la conexión sigue
+    auto typeField = data.find("type");
+    if (typeField == data.end() || !typeField->is_string()) {
+        send(transport, hdl, {{"type", "error"}, {"message", "Invalid message"}});
+        return;
+    }
+    const std::string& type = typeField->get_ref<const std::string&>();
+
+    if (type == "identify" || type == "connect") {
+        handleIdentify(hdl, data);
+    }
+    else if (type == "playerMessage") {
+        handlePlayerMessage(hdl, data);
+    }
+    else if (type == "action") {
+        handleAction(hdl, data, trace);
+    }
+    else if (type == "ackState" || type == "resync") {
+        handleStateSync(hdl, data);
+    }
+    else if (type == "spectate") {
+        handleSpectate(hdl);
+    }
+    else {
+        LOG_DEBUG("Unknown message type: %s for match %d", type.c_str(), matchId);
+    }
+}
+
+void GameSession::handleIdentify(connection_hdl hdl, const json& data) {
+    int playerId = readPlayerId(data);
+    if (playerId < 0) {
+        send(transport, hdl, {{"type", "error"}, {"message", "Invalid playerId"}});
+        return;
+    }
+
+    // Con espectadores el servidor acepta cualquier IP: solo los jugadores se filtran
+    if (!isPlayerAuthorized(hdl, data)) {
+        if (MatchTicket::enabled()) {
+            // El cliente puede pedir un ticket nuevo al matchmaking (getActiveMatch)
+            send(transport, hdl, {{"type", "error"}, {"message", "Invalid match ticket"}});
+            transport.close(hdl, websocketpp::close::status::policy_violation, "Invalid match ticket");
+        } else {
+            transport.close(hdl, websocketpp::close::status::policy_violation, "Unauthorized IP");
+        }
+        return;
+    }
+
+    // Partida migrada desde otro proceso: el jugador presenta el token que
+    // recibió en el aviso de migración
+    {
+        std::lock_guard<std::mutex> lock(holdMutex);
+        auto token = reconnectTokens.find(playerId);
+        auto presented = data.find("token");
+        if (token != reconnectTokens.end() &&
+            (presented == data.end() || !presented->is_string() || *presented != token->second)) {
+            send(transport, hdl, {{"type", "error"}, {"message", "Invalid reconnect token"}});
+            transport.close(hdl, websocketpp::close::status::policy_violation, "Invalid reconnect token");
+            return;
+        }
+    }
+
+    // Verificar que el jugador pertenece a esta partida antes de registrar
+    // la conexión: un rechazo no deja colas, índices ni heartbeats
+    auto match = Orchestrator::getInstance().getMatchById(matchId);
+    if (match) {
+        auto playerIds = match->getPlayerIds();
+        if (playerIds.first == playerId || playerIds.second == playerId) {
+            // Jugador válido para esta partida
+            int opponentId = (playerIds.first == playerId) ? playerIds.second : playerIds.first;
+            registerPlayer(hdl, playerId);
+            LOG_INFO("Player %d identified/connected to match %d", playerId, matchId);
+
+            json response = {
+                {"type", "matchJoined"},
+                {"matchId", matchId},
+                {"opponentId", opponentId}
+            };
+            send(transport, hdl, response);
+
+            attachOutput();
+            // Un cliente que se reconecta indica el último evento que vio y
+            // recibe solo lo que se perdió
+            auto lastSeq = data.find("lastSeq");
+            uint64_t seenSeq = lastSeq != data.end() && lastSeq->is_number_unsigned() ? lastSeq->get<uint64_t>() : 0;
+            submitOrHold([this, hdl, playerId, seenSeq]() {
+                Orchestrator::getInstance().reconnectPlayer(matchId, playerId);
+                if (Orchestrator::getInstance().requestState(matchId, playerId, seenSeq) == Orchestrator::Submit::THREAD_BUSY) {
+                    // Hilo de la partida saturado: el cliente pide el estado con resync
+                    send(transport, hdl, {{"type", "error"}, {"message", "Server busy, send resync"}});
+                }
+            });
+
+            // Notificar al oponente si está conectado
+            json opponentNotification = {
+                {"type", "opponentConnected"},
+                {"matchId", matchId},
+                {"opponentId", playerId}
+            };
+            sendMessage(opponentId, opponentNotification);
+        } else {
+            // Jugador no autorizado para esta partida
+            json response = {
+                {"type", "error"},
+                {"message", "Unauthorized player for this match"}
+            };
+            send(transport, hdl, response);
+            transport.close(hdl, websocketpp::close::status::policy_violation, "Unauthorized player");
+        }
+    } else {
+        // Partida no encontrada (ya terminó): como en el gateway, se cierra
+        // la conexión para que no quede asociada a esta sesión
+        json response = {
+            {"type", "error"},
+            {"message", "Match not found"}
+        };
+        send(transport, hdl, response);
+        transport.close(hdl, websocketpp::close::status::policy_violation, "Match not found");
+    }
+}
+
+void GameSession::registerPlayer(connection_hdl hdl, int playerId) {
+    bool binary = transport.isBinary(hdl);
+    // Registrar la asociación entre playerId y connection_hdl
+    std::lock_guard<std::mutex> lock(mutex);
+    playerConnections[playerId] = hdl;
+    connectionPlayers[hdl] = playerId;
+
+    // Cola de salida nueva: lo pendiente de una conexión anterior se descarta
+    // (la nueva recibe el estado completo)
+    SendQueue& queue = sendQueues[playerId];
+    HeartbeatMonitor& heartbeats = HeartbeatMonitor::getInstance();
+    heartbeats.unwatch(queue.heartbeatId);
+    queue = SendQueue();
+    queue.hdl = hdl;
+    queue.binary = binary;
+    queue.heartbeatId = heartbeats.watch(shared_from_this(), hdl);
+}
+
+void GameSession::attachOutput() {
+    auto match = Orchestrator::getInstance().getMatchById(matchId);
+    if (!match) {
+        return;
+    }
+    // Los resultados del motor de reglas salen por esta sesión
+    std::weak_ptr<GameSession> weakSelf = shared_from_this();
+    match->setOutput([weakSelf](int targetPlayerId, const json& message) {
+        if (auto self = weakSelf.lock()) {
+            if (targetPlayerId == Match::ALL_PLAYERS) {
+                self->broadcast(message);
+                self->publishToSpectators(message, false);
+            } else if (targetPlayerId == Match::SPECTATORS) {
+                self->publishToSpectators(message, message["type"] == "gameState");
+            } else {
+                self->sendMessage(targetPlayerId, message);
+            }
+        }
+    });
+}
+
+void GameSession::handleSpectate(connection_hdl hdl) {
+    const SpectatorConfig& config = getSpectatorConfig();
+    if (findPlayer(hdl) >= 0) {
+        return;
+    }
+    if (!Orchestrator::getInstance().getMatchById(matchId)) {
+        send(transport, hdl, {{"type", "error"}, {"message", "Match not found"}});
+        transport.close(hdl, websocketpp::close::status::policy_violation, "Match not found");
+        return;
+    }
+
+    bool requestSnapshot;
+    {
+        std::lock_guard<std::mutex> lock(spectatorMutex);
+        if (spectatorGroupOf.count(hdl)) {
+            return;
+        }
+        if (spectatorGroupOf.size() >= config.maxSpectators) {
+            send(transport, hdl, {{"type", "error"}, {"message", "Spectator limit reached"}});
+            transport.close(hdl, websocketpp::close::status::try_again_later, "Spectator limit reached");
+            return;
+        }
+        if (spectatorGroups.empty()) {
+            for (size_t i = 0; i < config.groups; i++) {
+                spectatorGroups.emplace_back(new SpectatorGroup(transport.getIoService()));
+            }
+        }
+
+        // Reparto round-robin entre las ramas
+        size_t index = nextSpectatorGroup++ % spectatorGroups.size();
+        SpectatorGroup* group = spectatorGroups[index].get();
+        Spectator spectator = {hdl, transport.isBinary(hdl)};
+        spectatorGroupOf[hdl] = {index, spectator.binary};
+        group->size++;
+        (spectator.binary ? binarySpectators : textSpectators)++;
+
+        // Se registra en su rama antes de pedir el snapshot: el strand lo
+        // recibe antes que el estado completo y que los deltas posteriores
+        group->strand.post([group, spectator]() {
+            group->pending.push_back(spectator);
+        });
+
+        // Un solo snapshot en vuelo cubre a todos los que se unen mientras tanto
+        requestSnapshot = !spectatorSnapshotRequested;
+        spectatorSnapshotRequested = true;
+    }
+
+    LOG_INFO("Spectator joined match %d", matchId);
+    send(transport, hdl, {
+        {"type", "spectating"},
+        {"matchId", matchId},
+        {"delayMs", config.delay.count()}
+    });
+
+    if (requestSnapshot) {
+        attachOutput();
+        requestSpectatorSnapshot();
+    }
+}
+
+void GameSession::requestSpectatorSnapshot() {
+    // Con el hilo de la partida saturado se reintenta: los espectadores
+    // pendientes no reciben nada hasta el snapshot
+    if (Orchestrator::getInstance().requestState(matchId, Match::SPECTATORS) != Orchestrator::Submit::THREAD_BUSY) {
+        return;
+    }
+    std::weak_ptr<GameSession> weakSelf = shared_from_this();
+    transport.setTimer(FLUSH_INTERVAL_MS, [weakSelf](const websocketpp::lib::error_code& ec) {
+        if (ec) {
+            return;
+        }
+        if (auto self = weakSelf.lock()) {
+            self->requestSpectatorSnapshot();
+        }
+    });
+}
+
+void GameSession::publishToSpectators(const json& message, bool snapshot) {
+    SpectatorFrame frame;
+    frame.snapshot = snapshot;
+    bool text;
+    bool binary;
+    {
+        std::lock_guard<std::mutex> lock(spectatorMutex);
+        if (spectatorGroupOf.empty()) {
+            if (snapshot) {
+                spectatorSnapshotRequested = false;
+            }
+            return;
+        }
+        text = textSpectators > 0;
+        binary = binarySpectators > 0;
+    }
+
+    // Una serialización por codificación para todos los espectadores, fuera del lock
+    if (text) {
+        frame.text = std::make_shared<const std::string>(message.dump());
+    }
+    if (binary) {
+        frame.binary = std::make_shared<const std::string>(BinaryProtocol::encode(message));
+    }
+
+    std::lock_guard<std::mutex> lock(spectatorMutex);
+    if (snapshot) {
+        spectatorSnapshotRequested = false;
+        // Se unió alguien con la otra codificación mientras se serializaba:
+        // el snapshot tiene que llegarle igual (caso raro, se codifica con el lock)
+        if (textSpectators > 0 && !frame.text) {
+            frame.text = std::make_shared<const std::string>(message.dump());
+        }
+        if (binarySpectators > 0 && !frame.binary) {
+            frame.binary = std::make_shared<const std::string>(BinaryProtocol::encode(message));
+        }
+    }
+    queueSpectatorFrame(std::move(frame));
+}
+
+void GameSession::queueSpectatorFrame(SpectatorFrame frame) {
+    const SpectatorConfig& config = getSpectatorConfig();
+    if (config.delay.count() == 0) {
+        dispatchToSpectators(frame);
+        return;
+    }
+
+    // Flujo diferido: todo (también el snapshot de los que se unen y el
+    // cierre) sale con el mismo retardo, en orden. El timer mantiene viva la
+    // sesión: lo que queda del flujo se entrega aunque la partida ya se liberó
+    frame.releaseAt = std::chrono::steady_clock::now() + config.delay;
+    delayedSpectatorFrames.push_back(std::move(frame));
+    if (!spectatorTimerScheduled) {
+        spectatorTimerScheduled = true;
+        auto self = shared_from_this();
+        transport.setTimer(config.delay.count(), [self](const websocketpp::lib::error_code& ec) {
+            if (!ec) {
+                self->releaseSpectatorFrames();
+            }
+        });
+    }
+}
+
+void GameSession::releaseSpectatorFrames() {
+    std::lock_guard<std::mutex> lock(spectatorMutex);
+    spectatorTimerScheduled = false;
+    auto now = std::chrono::steady_clock::now();
+    while (!delayedSpectatorFrames.empty() && delayedSpectatorFrames.front().releaseAt <= now) {
+        dispatchToSpectators(delayedSpectatorFrames.front());
+        delayedSpectatorFrames.pop_front();
+    }
+
+    if (!delayedSpectatorFrames.empty()) {
+        spectatorTimerScheduled = true;
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+            delayedSpectatorFrames.front().releaseAt - now).count();
+        auto self = shared_from_this();
+        transport.setTimer(std::max<long>(wait, 1), [self](const websocketpp::lib::error_code& ec) {
+            if (!ec) {
+                self->releaseSpectatorFrames();
+            }
+        });
+    }
+}
+
+void GameSession::dispatchToSpectators(const SpectatorFrame& frame) {
+    // Cada rama recibe el mismo buffer y envía a sus espectadores en su strand;
+    // el orden de los post (con spectatorMutex) es el orden del flujo. Cada
+    // post mantiene viva la sesión hasta entregar su mensaje
+    auto self = shared_from_this();
+    for (auto& group : spectatorGroups) {
+        if (group->size == 0) {
+            continue;
+        }
+        SpectatorGroup* target = group.get();
+        group->strand.post([self, target, frame]() {
+            self->deliverToGroup(*target, frame);
+        });
+    }
+}
+
+void GameSession::deliverToGroup(SpectatorGroup& group, const SpectatorFrame& frame) {
+    if (!frame.closeReason.empty()) {
+        for (auto* spectators : {&group.pending, &group.active}) {
+            for (auto& spectator : *spectators) {
+                websocketpp::lib::error_code ec;
+                transport.close(spectator.hdl, websocketpp::close::status::going_away, frame.closeReason, ec);
+            }
+            spectators->clear();
+        }
+        return;
+    }
+
+    const SendQueueLimits& limits = getSendQueueLimits();
+    std::vector<connection_hdl> slow;
+
+    auto deliver = [&](const Spectator& spectator) {
+        const Frame& payload = spectator.binary ? frame.binary : frame.text;
+        // Se unió después de serializar este delta (aún espera su snapshot)
+        if (!payload) {
+            return true;
+        }
+        websocketpp::lib::error_code ec;
+        try {
+            // Sin cola propia: un espectador que no lee se cierra en vez de
+            // acumular memoria (al volver recibe el estado completo)
+            if (transport.getBufferedAmount(spectator.hdl) > limits.limitBytes) {
+                slow.push_back(spectator.hdl);
+                return false;
+            }
+            transport.send(spectator.hdl, *payload, spectator.binary ?
+                        websocketpp::frame::opcode::binary : websocketpp::frame::opcode::text, ec);
+        } catch (const std::exception& e) {
+            return false;
+        }
+        return !ec;
+    };
+
+    auto deliverAll = [&](std::vector<Spectator>& spectators) {
+        spectators.erase(std::remove_if(spectators.begin(), spectators.end(),
+            [&](const Spectator& spectator) { return !deliver(spectator); }), spectators.end());
+    };
+
+    if (frame.snapshot) {
+        // Los que esperaban el estado completo pasan a recibir los deltas
+        deliverAll(group.pending);
+        for (auto& spectator : group.pending) {
+            group.active.push_back(spectator);
+        }
+        group.pending.clear();
+    } else {
+        deliverAll(group.active);
+    }
+
+    for (auto& hdl : slow) {
+        evictionCount++;
+        websocketpp::lib::error_code ec;
+        transport.close(hdl, websocketpp::close::status::try_again_later, "Spectator too slow", ec);
+    }
+}
+
+void GameSession::handlePlayerMessage(connection_hdl hdl, const json& data) {
+    // Obtener el playerId de la conexión
+    int playerId = findPlayer(hdl);
+    if (playerId < 0) {
+        LOG_DEBUG("Message from unidentified player for match %d", matchId);
+        return;
+    }
+
+    auto contentField = data.find("content");
+    if (contentField == data.end() || !contentField->is_string()) {
+        sendMessage(playerId, {{"type", "error"}, {"message", "Invalid message content"}});
+        return;
+    }
+    const std::string& content = contentField->get_ref<const std::string&>();
+
+    LOG_DEBUG("Player %d sent message in match %d: %s", playerId, matchId, content.c_str());
+
+    // Reenviar el mensaje a todos los otros jugadores en la partida
+    json messageNotification = {
+        {"type", "playerMessage"},
+        {"fromPlayerId", playerId},
+        {"matchId", matchId},
+        {"content", content}
+    };
+    broadcast(messageNotification, playerId);
+}
+
+void GameSession::handleAction(connection_hdl hdl, const json& data, const LatencyTrace& trace) {
+    int playerId;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = connectionPlayers.find(hdl);
+        if (it == connectionPlayers.end()) {
+            LOG_DEBUG("Action from unidentified player for match %d", matchId);
+            return;
+        }
+        playerId = it->second;
+    }
+
+    // Decodificar aquí (fuera del GameThread) y dejar que el motor de reglas
+    // valide y aplique la acción en el hilo dueño de la partida
+    MatchEngine::Action action;
+    std::string error;
+    if (!Match::decodeAction(data, action, error)) {
+        json response = {
+            {"type", "error"},
+            {"message", error}
+        };
+        sendMessage(playerId, response);
+        return;
+    }
+
+    // Partida en migración: la acción se aplica en el destino. Se encola con
+    // holdMutex tomado: si no, podría llegar al hilo detrás de la extracción
+    // de la partida (holdActions + detachMatch) y perderse allí
+    LatencyTrace actionTrace = trace;
+    actionTrace.matchId = matchId;
+    actionTrace.playerId = playerId;
+    Orchestrator::Submit result;
+    {
+        std::lock_guard<std::mutex> lock(holdMutex);
+        if (holding) {
+            heldActions.emplace_back(playerId, data);
+            return;
+        }
+        result = Orchestrator::getInstance().submitAction(matchId, playerId, action, actionTrace);
+    }
+    if (result != Orchestrator::Submit::QUEUED) {
+        json response = {
+            {"type", "error"},
+            {"message", result == Orchestrator::Submit::THREAD_BUSY ? "Server busy, action dropped" : "Match not found"}
+        };
+        sendMessage(playerId, response);
+    }
+}
+
+void GameSession::handleStateSync(connection_hdl hdl, const json& data) {
+    int playerId = findPlayer(hdl);
+    if (playerId < 0) {
+        return;
+    }
+
+    // ackState: los siguientes estados llegan como delta contra esta versión.
+    // resync: el cliente perdió el hilo y pide el estado completo
+    if (data.value("type", "") == "ackState") {
+        // Sin versión válida no se confirma nada (operator[] sobre el json
+        // const abortaría el proceso)
+        auto version = data.find("version");
+        if (version == data.end() || !version->is_number_unsigned()) {
+            sendMessage(playerId, {{"type", "error"}, {"message", "Invalid version"}});
+            return;
+        }
+        Orchestrator::getInstance().ackState(matchId, playerId, data.value("version", uint64_t{0}));
+    } else {
+        submitOrHold([this, playerId]() {
+            if (Orchestrator::getInstance().requestState(matchId, playerId) == Orchestrator::Submit::THREAD_BUSY) {
+                sendMessage(playerId, {{"type", "error"}, {"message", "Server busy, send resync"}});
+            }
+        });
+    }
+}
+
+void GameSession::holdActions(long releaseAfterMs) {
+    {
+        std::lock_guard<std::mutex> lock(holdMutex);
+        holding = true;
+        holdingRequests = releaseAfterMs <= 0;
+    }
+    if (releaseAfterMs <= 0) {
+        return;
+    }
+    std::weak_ptr<GameSession> weakSelf = shared_from_this();
+    transport.setTimer(releaseAfterMs, [weakSelf](const websocketpp::lib::error_code& ec) {
+        if (ec) {
+            return;
+        }
+        if (auto self = weakSelf.lock()) {
+            self->releaseActions(json::array());
+        }
+    });
+}
+
+json GameSession::takeHeldActions() {
+    json actions = json::array();
+    std::lock_guard<std::mutex> lock(holdMutex);
+    for (auto& held : heldActions) {
+        actions.push_back({held.first, std::move(held.second)});
+    }
+    heldActions.clear();
+    return actions;
+}
+
+void GameSession::releaseActions(const json& forwarded) {
+    // Con holdMutex tomado ninguna acción nueva se adelanta a las retenidas
+    std::lock_guard<std::mutex> lock(holdMutex);
+    auto submit = [this](int playerId, const json& data) {
+        MatchEngine::Action action;
+        std::string error;
+        if (Match::decodeAction(data, action, error) &&
+            Orchestrator::getInstance().submitAction(matchId, playerId, action) == Orchestrator::Submit::THREAD_BUSY) {
+            LOG_WARN("Held action of player %d dropped: match %d thread is busy", playerId, matchId);
+        }
+    };
+    for (const auto& request : heldRequests) {
+        request();
+    }
+    for (const auto& entry : forwarded) {
+        submit(entry.at(0).get<int>(), entry.at(1));
+    }
+    for (const auto& held : heldActions) {
+        submit(held.first, held.second);
+    }
+    if (holding || !forwarded.empty()) {
+        LOG_INFO("Match %d: released %zu held requests, %zu forwarded and %zu held actions",
+                 matchId, heldRequests.size(), forwarded.size(), heldActions.size());
+    }
+    heldRequests.clear();
+    heldActions.clear();
+    holding = false;
+    holdingRequests = false;
+}
+
+void GameSession::submitOrHold(std::function<void()> request) {
+    std::lock_guard<std::mutex> lock(holdMutex);
+    if (holdingRequests) {
+        heldRequests.push_back(std::move(request));
+        return;
+    }
+    request();
+}
+
+void GameSession::redirect(const std::string& serverIp, int serverPort, const json& tokens) {
+    {
+        std::lock_guard<std::mutex> lock(holdMutex);
+        migration = {
+            {"type", "migrate"},
+            {"matchId", matchId},
+            {"serverIp", serverIp},
+            {"serverPort", serverPort}
+        };
+        migrationTokens = tokens;
+    }
+    migrated.store(true, std::memory_order_release);
+
+    std::vector<std::pair<int, connection_hdl>> targets;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& pair : playerConnections) {
+            targets.emplace_back(pair.first, pair.second);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(spectatorMutex);
+        for (const auto& pair : spectatorGroupOf) {
+            targets.emplace_back(-1, pair.first);
+        }
+    }
+
+    // Directo, sin pasar por la cola: lo que quedó pendiente lo recupera el
+    // cliente en el destino con su lastSeq
+    for (auto& target : targets) {
+        try {
+            send(transport, target.second, migrationMessage(target.first));
+        } catch (const std::exception& e) {
+            // Conexión ya cerrada: al reconectarse aquí recibe el aviso
+        }
+    }
+}
+
+void GameSession::setReconnectTokens(const std::unordered_map<int, std::string>& tokens) {
+    std::lock_guard<std::mutex> lock(holdMutex);
+    reconnectTokens = tokens;
+}
+
+json GameSession::migrationMessage(int playerId) {
+    std::lock_guard<std::mutex> lock(holdMutex);
+    if (migration.is_null()) {
+        return nullptr;
+    }
+    json message = migration;
+    std::string key = std::to_string(playerId);
+    if (migrationTokens.contains(key)) {
+        message["token"] = migrationTokens[key];
+    }
+    return message;
+}
+
+int GameSession::findPlayer(connection_hdl hdl) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = connectionPlayers.find(hdl);
+    return it != connectionPlayers.end() ? it->second : -1;
+}
+
+void GameSession::handleClose(connection_hdl hdl) {
+    int playerId;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Buscar el playerId asociado a esta conexión
+        auto it = connectionPlayers.find(hdl);
+        if (it == connectionPlayers.end()) {
+            removeSpectator(hdl);
+            return;
+        }
+        playerId = it->second;
+        // Eliminar la conexión de los mapas
+        playerConnections.erase(playerId);
+        connectionPlayers.erase(it);
+        auto queue = sendQueues.find(playerId);
+        if (queue != sendQueues.end()) {
+            HeartbeatMonitor::getInstance().unwatch(queue->second.heartbeatId);
+            sendQueues.erase(queue);
+        }
+    }
+
+    // Informar al orquestador que el jugador se desconectó
+    submitOrHold([playerId]() {
+        Orchestrator::getInstance().disconnectPlayer(playerId);
+    });
+    LOG_INFO("Player %d disconnected from match %d", playerId, matchId);
+}
+
+void GameSession::sendPing(connection_hdl hdl, const std::string& payload) {
+    // Si la conexión ya se cerró, su handleClose deja de vigilarla
+    websocketpp::lib::error_code ec;
+    transport.ping(hdl, payload, ec);
+}
+
+void GameSession::onHeartbeatTimeout(connection_hdl hdl) {
+    std::weak_ptr<GameSession> weakSelf = shared_from_this();
+    post([weakSelf, hdl]() {
+        auto self = weakSelf.lock();
+        if (!self) {
+            return;
+        }
+        // La partida ve al jugador desconectado ya; el onClose que llegue
+        // después no encuentra la conexión
+        LOG_WARN("Player connection in match %d stopped answering pings", self->matchId);
+        self->handleClose(hdl);
+        websocketpp::lib::error_code ec;
+        self->transport.close(hdl, websocketpp::close::status::going_away, "Heartbeat timeout", ec);
+    });
+}
+
+void GameSession::removeSpectator(connection_hdl hdl) {
+    std::lock_guard<std::mutex> lock(spectatorMutex);
+    auto it = spectatorGroupOf.find(hdl);
+    if (it == spectatorGroupOf.end()) {
+        return;
+    }
+    SpectatorGroup* group = spectatorGroups[it->second.group].get();
+    group->size--;
+    (it->second.binary ? binarySpectators : textSpectators)--;
+    spectatorGroupOf.erase(it);
+
+    // Quitarlo de su rama (si no lo quitó ya un envío fallido)
+    std::weak_ptr<GameSession> weakSelf = shared_from_this();
+    group->strand.post([weakSelf, group, hdl]() {
+        if (!weakSelf.lock()) {
+            return;
+        }
+        auto matches = [&hdl](const Spectator& spectator) {
+            return !spectator.hdl.owner_before(hdl) && !hdl.owner_before(spectator.hdl);
+        };
+        for (auto* list : {&group->pending, &group->active}) {
+            list->erase(std::remove_if(list->begin(), list->end(), matches), list->end());
+        }
+    });
+}
+
+void GameSession::sendMessage(int playerId, const json& message) {
+    bool binary;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = sendQueues.find(playerId);
+        if (it == sendQueues.end()) {
+            return;
+        }
+        binary = it->second.binary;
+    }
+
+    // Serializar fuera del lock
+    Frame payload = std::make_shared<const std::string>(
+        binary ? BinaryProtocol::encode(message) : message.dump());
+    std::string type = message.value("type", "");
+    enqueueFrame(playerId, payload, binary, type == "gameState" || type == "stateDelta");
+}
+
+void GameSession::broadcast(const json& message, int exceptPlayerId) {
+    std::vector<std::pair<int, bool>> targets;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& pair : sendQueues) {
+            if (pair.first != exceptPlayerId) {
+                targets.emplace_back(pair.first, pair.second.binary);
+            }
+        }
+    }
+
+    // Cada codificación se serializa una vez, al encontrar su primer destinatario
+    Frame text;
+    Frame binary;
+    LatencyTrace* trace = LatencyTrace::current();
+    for (const auto& target : targets) {
+        Frame& payload = target.second ? binary : text;
+        if (!payload) {
+            payload = std::make_shared<const std::string>(
+                target.second ? BinaryProtocol::encode(message) : message.dump());
+        }
+        // El primer mensaje de la acción trazada para el rival la acompaña
+        // por la cola de salida hasta que se entrega
+        std::shared_ptr<LatencyTrace> opponentTrace;
+        if (trace != nullptr && target.first != trace->playerId && trace->recorded < LatencyTrace::SERIALIZED) {
+            LatencyMetrics::getInstance().record(*trace, LatencyTrace::SERIALIZED);
+            opponentTrace = std::make_shared<LatencyTrace>(*trace);
+        }
+        enqueueFrame(target.first, payload, target.second, false, std::move(opponentTrace));
+    }
+}
+
+void GameSession::enqueueFrame(int playerId, const Frame& payload, bool binary, bool state,
+                               std::shared_ptr<LatencyTrace> trace) {
+    SendBatch batch;
+    connection_hdl evicted;
+    bool evict = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = sendQueues.find(playerId);
+        // El jugador se desconectó (o volvió con otra codificación) mientras se serializaba
+        if (it == sendQueues.end() || it->second.binary != binary) {
+            return;
+        }
+        SendQueue& queue = it->second;
+
+        // Un estado nuevo deja obsoleto al que todavía no salió: los deltas se
+        // calculan contra la versión que confirmó el cliente, no contra la anterior
+        if (state) {
+            for (auto pending = queue.pending.begin(); pending != queue.pending.end();) {
+                if (pending->state) {
+                    queue.pendingBytes -= pending->payload->size();
+                    pending = queue.pending.erase(pending);
+                    queue.coalesced++;
+                } else {
+                    ++pending;
+                }
+            }
+        }
+
+        queue.pending.push_back({
+            payload, binary ? websocketpp::frame::opcode::binary : websocketpp::frame::opcode::text, state,
+            std::move(trace)
+        });
+        queue.pendingBytes += payload->size();
+
+        if (flushQueue(playerId, queue, batch)) {
+            if (batch.messages.empty() && (!queue.pending.empty() || queue.overLimit)) {
+                scheduleFlush();
+            }
+        } else {
+            evict = true;
+            evicted = queue.hdl;
+            HeartbeatMonitor::getInstance().unwatch(queue.heartbeatId);
+            sendQueues.erase(it);
+        }
+    }
+
+    if (!evict) {
+        deliver(std::move(batch));
+        return;
+    }
+    evictionCount++;
+    LOG_WARN("Player %d evicted from match %d: send queue over limit", playerId, matchId);
+    websocketpp::lib::error_code ec;
+    transport.close(evicted, websocketpp::close::status::try_again_later, "Send queue overflow", ec);
+}
+
+bool GameSession::flushQueue(int playerId, SendQueue& queue, SendBatch& batch) {
+    // Con un lote en camino, quien lo entrega sigue con lo nuevo al terminar
+    if (!queue.sending) {
+        while (!queue.pending.empty() && queue.bufferedBytes < SEND_WINDOW_BYTES) {
+            OutboundMessage& next = queue.pending.front();
+            queue.bufferedBytes += next.payload->size();
+            queue.pendingBytes -= next.payload->size();
+            batch.messages.push_back(std::move(next));
+            queue.pending.pop_front();
+        }
+        if (!batch.messages.empty()) {
+            queue.sending = true;
+            batch.playerId = playerId;
+            batch.hdl = queue.hdl;
+        }
+    }
+
+    const SendQueueLimits& limits = getSendQueueLimits();
+    size_t total = queue.pendingBytes + queue.bufferedBytes;
+    if (total <= limits.limitBytes) {
+        queue.overLimit = false;
+        return true;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (!queue.overLimit) {
+        queue.overLimit = true;
+        queue.overLimitSince = now;
+    }
+    // Muy por encima del límite, o encima durante demasiado tiempo: el cliente
+    // no da abasto. Al reconectarse recibe el estado completo
+    return total <= 2 * limits.limitBytes && now - queue.overLimitSince < limits.slowClientTimeout;
+}
+
+void GameSession::deliver(SendBatch batch) {
+    while (!batch.messages.empty()) {
+        // websocketpp toma sus propios locks: nada de esto con el mutex
+        bool closed = false;
+        size_t buffered = 0;
+        try {
+            for (const OutboundMessage& message : batch.messages) {
+                transport.send(batch.hdl, *message.payload, message.opcode);
+                if (message.trace) {
+                    LatencyMetrics::getInstance().complete(*message.trace);
+                }
+            }
+            buffered = transport.getBufferedAmount(batch.hdl);
+        } catch (const std::exception& e) {
+            closed = true;
+        }
+
+        int playerId = batch.playerId;
+        connection_hdl hdl = batch.hdl;
+        connection_hdl evicted;
+        bool evict = false;
+        batch = SendBatch();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = sendQueues.find(playerId);
+            // La cola ya no es de esta conexión (se cerró o el jugador volvió)
+            if (it == sendQueues.end() || it->second.hdl.owner_before(hdl) || hdl.owner_before(it->second.hdl)) {
+                return;
+            }
+            SendQueue& queue = it->second;
+            queue.sending = false;
+            if (closed) {
+                // Conexión ya cerrada: handleClose quita la cola
+                queue.pending.clear();
+                queue.pendingBytes = 0;
+                return;
+            }
+            queue.bufferedBytes = buffered;
+
+            if (flushQueue(playerId, queue, batch)) {
+                if (batch.messages.empty() && (!queue.pending.empty() || queue.overLimit)) {
+                    scheduleFlush();
+                }
+            } else {
+                evict = true;
+                evicted = queue.hdl;
+                HeartbeatMonitor::getInstance().unwatch(queue.heartbeatId);
+                sendQueues.erase(it);
+            }
+        }
+
+        if (evict) {
+            evictionCount++;
+            LOG_WARN("Player %d evicted from match %d: send queue over limit", playerId, matchId);
+            websocketpp::lib::error_code ec;
+            transport.close(evicted, websocketpp::close::status::try_again_later, "Send queue overflow", ec);
+            return;
+        }
+    }
+}
+
+void GameSession::flushAll() {
+    // Lo que websocketpp ya entregó se lee sin el mutex
+    std::vector<std::pair<int, connection_hdl>> waiting;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        flushScheduled = false;
+        for (const auto& pair : sendQueues) {
+            const SendQueue& queue = pair.second;
+            if (!queue.sending && (!queue.pending.empty() || queue.overLimit)) {
+                waiting.emplace_back(pair.first, queue.hdl);
+            }
+        }
+    }
+    std::vector<std::pair<size_t, bool>> buffered;
+    for (const auto& target : waiting) {
+        try {
+            buffered.emplace_back(transport.getBufferedAmount(target.second), true);
+        } catch (const std::exception& e) {
+            // Conexión cerrándose: handleClose quita la cola
+            buffered.emplace_back(0, false);
+        }
+    }
+
+    std::vector<SendBatch> batches;
+    std::vector<std::pair<int, connection_hdl>> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        bool pending = false;
+        for (size_t i = 0; i < waiting.size(); i++) {
+            auto it = sendQueues.find(waiting[i].first);
+            if (it == sendQueues.end() || it->second.sending || !buffered[i].second ||
+                it->second.hdl.owner_before(waiting[i].second) || waiting[i].second.owner_before(it->second.hdl)) {
+                continue;
+            }
+            SendQueue& queue = it->second;
+            queue.bufferedBytes = buffered[i].first;
+            SendBatch batch;
+            if (!flushQueue(it->first, queue, batch)) {
+                evicted.emplace_back(it->first, queue.hdl);
+                HeartbeatMonitor::getInstance().unwatch(queue.heartbeatId);
+                sendQueues.erase(it);
+                continue;
+            }
+            if (!batch.messages.empty()) {
+                batches.push_back(std::move(batch));
+            } else {
+                pending = pending || !queue.pending.empty() || queue.overLimit;
+            }
+        }
+        if (pending) {
+            scheduleFlush();
+        }
+    }
+
+    for (auto& batch : batches) {
+        deliver(std::move(batch));
+    }
+    for (auto& target : evicted) {
+        evictionCount++;
+        LOG_WARN("Player %d evicted from match %d: send queue over limit", target.first, matchId);
+        websocketpp::lib::error_code ec;
+        transport.close(target.second, websocketpp::close::status::try_again_later, "Send queue overflow", ec);
+    }
+}
+
+void GameSession::scheduleFlush() {
+    if (flushScheduled) {
+        return;
+    }
+    flushScheduled = true;
+    std::weak_ptr<GameSession> weakSelf = shared_from_this();
+    transport.setTimer(FLUSH_INTERVAL_MS, [weakSelf](const websocketpp::lib::error_code& ec) {
+        if (ec) {
+            return;
+        }
+        if (auto self = weakSelf.lock()) {
+            self->flushAll();
+        }
+    });
+}
+
+json GameSession::getQueueStats() {
+    json connections = json::array();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& pair : sendQueues) {
+        SendQueue& queue = pair.second;
+        try {
+            queue.bufferedBytes = transport.getBufferedAmount(queue.hdl);
+        } catch (const std::exception& e) {
+            // Conexión cerrándose: se informa el último valor
+        }
+        connections.push_back({
+            {"matchId", matchId},
+            {"playerId", pair.first},
+            {"queuedMessages", queue.pending.size()},
+            {"queuedBytes", queue.pendingBytes},
+            {"bufferedBytes", queue.bufferedBytes},
+            {"coalesced", queue.coalesced},
+            {"overLimit", queue.overLimit},
+            {"rttMs", HeartbeatMonitor::getInstance().getRttMs(queue.heartbeatId)}
+        });
+    }
+    return connections;
+}
+
+uint64_t GameSession::getEvictionCount() {
+    return evictionCount.load();
+}
+
+bool GameSession::spectatorsEnabled() {
+    return getSpectatorConfig().maxSpectators > 0;
+}
+
+void GameSession::closeAll(const std::string& reason) {
+    std::vector<connection_hdl> connections;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& pair : playerConnections) {
+            connections.push_back(pair.second);
+        }
+    }
+    {
+        // Los espectadores se cierran desde su flujo, detrás de lo que aún no
+        // se les ha entregado (el último delta y gameOver)
+        std::lock_guard<std::mutex> lock(spectatorMutex);
+        if (!spectatorGroupOf.empty()) {
+            SpectatorFrame frame;
+            frame.closeReason = reason;
+            queueSpectatorFrame(std::move(frame));
+        }
+    }
+
+    for (auto& hdl : connections) {
+        websocketpp::lib::error_code ec;
+        transport.close(hdl, websocketpp::close::status::going_away, reason, ec);
+    }
+}
+
+bool GameSession::isPlayerAuthorized(connection_hdl hdl, const json& data) {
+    if (!MatchTicket::enabled()) {
+        return isConnectionAllowed(hdl);
+    }
+    // Un HMAC sobre matchId.playerId.vencimiento: sin consultar la partida
+    auto ticket = data.find("ticket");
+    int playerId = readPlayerId(data);
+    return playerId >= 0 && ticket != data.end() && ticket->is_string() &&
+           MatchTicket::verify(ticket->get<std::string>(), matchId, playerId);
+}
+
+int GameSession::readPlayerId(const json& data) {
+    auto playerId = data.find("playerId");
+    if (playerId == data.end() || !playerId->is_number_integer() || playerId->get<int64_t>() < 0 ||
+        playerId->get<int64_t>() > INT32_MAX) {
+        return -1;
+    }
+    return playerId->get<int>();
+}
+
+bool GameSession::isIpAllowed(const std::string& ip) {
+    if (allowedIps.empty()) {
+        //printf("DEBUG: No IP restrictions for match %d\n", matchId);
+        return true;  // Sin restricciones
+    }
+
+    //printf("DEBUG: Checking IP [%s] against allowed IPs for match %d\n", ip.c_str(), matchId);
+
+    // Normalizar la IP del cliente
+    std::string normalizedClientIp = ip;
+
+    // Manejar IPv6 mapped IPv4 addresses (::ffff:127.0.0.1 -> 127.0.0.1)
+    if (normalizedClientIp.find("::ffff:") == 0) {
+        normalizedClientIp = normalizedClientIp.substr(7); // Remover "::ffff:"
+        //printf("DEBUG: Normalized IPv6 mapped address to [%s]\n", normalizedClientIp.c_str());
+    }
+
+    // Verificar si la IP está en la lista de permitidas
+    for (const auto& allowedIp : allowedIps) {
+        //printf("DEBUG: Comparing [%s] with [%s]\n", normalizedClientIp.c_str(), allowedIp.c_str());
+
+        // Comparación exacta con IP normalizada
+        if (normalizedClientIp == allowedIp) {
+            //printf("DEBUG: Exact match found for IP [%s]\n", normalizedClientIp.c_str());
+            return true;
+        }
+
+        // Manejar casos especiales de localhost
+        if ((allowedIp == "127.0.0.1" || allowedIp == "localhost") &&
+            (normalizedClientIp == "127.0.0.1" || normalizedClientIp == "::1" || normalizedClientIp == "localhost")) {
+            //printf("DEBUG: Localhost match found for IP [%s]\n", normalizedClientIp.c_str());
+            return true;
+        }
+
+        // Si allowedIp es localhost/127.0.0.1 y ip está vacío o es unknown, permitir
+        if ((allowedIp == "127.0.0.1" || allowedIp == "localhost") &&
+            (normalizedClientIp.empty() || normalizedClientIp == "unknown")) {
+            //printf("DEBUG: Local connection assumed for IP [%s]\n", normalizedClientIp.c_str());
+            return true;
+        }
+    }
+
+    //printf("DEBUG: No match found for IP [%s]\n", normalizedClientIp.c_str());
+    return false;
+}
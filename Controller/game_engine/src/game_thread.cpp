@@ -1,17 +1,79 @@
 #include "../libs/game_thread.hpp"
 #include "../libs/orchestrator.hpp"
+#include "src/utils/Log.hpp"
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <chrono>
 
-GameThread::GameThread(int threadId) : threadId(threadId), running(true) {
-    // Variable de entorno MAX_THREADS comentada por ahora
-    // const char* envValue = std::getenv("MAX_THREADS");
-    //int maxThreads = 5; // Valor por defecto
-    //if (envValue != nullptr && std::stoi(envValue) > 0) {
-    //    maxThreads = std::stoi(envValue);
-        //printf("MAX_MATCHES_PER_THREAD=%d\n", maxMatchesPerThread);
-    //}
-    printf("Creating thread %d\n", threadId);
+#ifdef __linux__
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+// Cada cuánto se muestrea el coste de las partidas y se intenta repartir carga
+static const int SAMPLE_INTERVAL_MS = 1000;
+
+// Ranuras de la rueda de plazos: con ticks de 100 ms cubre ~100 s por vuelta
+static const size_t TIMER_WHEEL_SLOTS = 1024;
+
+// Resolución de los plazos de turno/desconexión (TIMER_TICK_MS)
+static std::chrono::milliseconds getTimerTick() {
+    const char* envValue = std::getenv("TIMER_TICK_MS");
+    if (envValue != nullptr && std::atoi(envValue) > 0) {
+        return std::chrono::milliseconds(std::atoi(envValue));
+    }
+    return std::chrono::milliseconds(100);
+}
+
+// Capacidad del buzón de cada hilo (GAME_THREAD_MAILBOX)
+static size_t getMailboxCapacity() {
+    const char* envValue = std::getenv("GAME_THREAD_MAILBOX");
+    if (envValue != nullptr && std::atoi(envValue) > 0) {
+        return std::atoi(envValue);
+    }
+    return 4096;
+}
+
+// Acciones por lote (GAME_THREAD_BATCH)
+static size_t getBatchSize() {
+    const char* envValue = std::getenv("GAME_THREAD_BATCH");
+    if (envValue != nullptr && std::atoi(envValue) > 0) {
+        return std::atoi(envValue);
+    }
+    return 64;
+}
+
+GameThread::GameThread(int threadId)
+    : threadId(threadId), activeMatchCount(0), timers(getTimerTick(), TIMER_WHEEL_SLOTS),
+      mailbox(getMailboxCapacity()), overflowing(false),
+      batchSize(getBatchSize()), idle(false), running(true) {
+    LOG_INFO("Creating thread %d", threadId);
     // Inicia el worker thread
     worker = std::thread(&GameThread::threadLoop, this);
+
+    const char* pinValue = std::getenv("PIN_GAME_THREADS");
+    if (pinValue != nullptr && std::string(pinValue) == "1") {
+        pinToCore();
+    }
+}
+
+void GameThread::pinToCore() {
+#ifdef __linux__
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    int core = (threadId - 1) % cores;
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core, &cpuset);
+    int result = pthread_setaffinity_np(worker.native_handle(), sizeof(cpu_set_t), &cpuset);
+    if (result != 0) {
+        LOG_ERROR("Could not pin thread %d to core %d (error %d)", threadId, core, result);
+    } else {
+        LOG_INFO("Thread %d pinned to core %d", threadId, core);
+    }
+#else
+    LOG_INFO("PIN_GAME_THREADS is only supported on Linux");
+#endif
 }
 
 GameThread::~GameThread() {
@@ -22,106 +84,349 @@ GameThread::~GameThread() {
     }
 }
 
-void GameThread::addMatch(int matchId, int player1Id, int player2Id) {
-    std::lock_guard<std::mutex> lock(mutex);
+void GameThread::enqueue(Action&& action) {
+    // Nunca se espera a que el worker libere espacio: quien encola puede
+    // tener tomado el lock que el worker necesita para avanzar (deadlock)
+    if (!overflowing.load(std::memory_order_acquire) && mailbox.push(std::move(action))) {
+        notifyWorker();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(overflowMutex);
+        overflow.push_back(std::move(action));
+        overflowing.store(true);
+    }
+    notifyWorker();
+}
+
+bool GameThread::offer(Action&& action) {
+    if (action.trace.active()) {
+        action.trace.stamp(LatencyTrace::ENQUEUED);
+    }
+    if (overflowing.load(std::memory_order_acquire) || !mailbox.push(std::move(action))) {
+        return false;
+    }
+    notifyWorker();
+    return true;
+}
+
+void GameThread::notifyWorker() {
+    // Solo el primer productor que encuentra al worker dormido lo despierta
+    if (idle.exchange(false)) {
+        wakeup.notify();
+    }
+}
+
+void GameThread::takeOverflow(std::vector<Action>& actions) {
+    if (!overflowing.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(overflowMutex);
+    for (auto& pending : overflow) {
+        actions.push_back(std::move(pending));
+    }
+    overflow.clear();
+    overflowing.store(false);
+}
+
+void GameThread::addMatch(std::shared_ptr<Match> match) {
+    auto players = match->getPlayerIds();
     // Añade una acción para crear un nuevo match
-    pendingActions.push_back({
-        Action::ADD_MATCH, matchId, player1Id, player2Id, 0
+    enqueue({
+        Action::ADD_MATCH, match->getMatchId(), players.first, players.second, 0, match, nullptr, {}, 0, nullptr, {}
     });
-    
-    // Notifica al thread
-    cv.notify_one();
 }
 
 void GameThread::handlePlayerDisconnect(int matchId, int playerId) {
-    std::lock_guard<std::mutex> lock(mutex);    
     // Añade una acción para la desconexión del jugador
-    pendingActions.push_back({
-        Action::DISCONNECT_PLAYER, matchId, 0, 0, playerId
+    enqueue({
+        Action::DISCONNECT_PLAYER, matchId, 0, 0, playerId, nullptr, nullptr, {}, 0, nullptr, {}
     });
-    // Notifica al thread
-    cv.notify_one();
 }
 
 void GameThread::handlePlayerReconnect(int matchId, int playerId) {
-    std::lock_guard<std::mutex> lock(mutex);    
     // Añade una acción para la reconexión del jugador
-    pendingActions.push_back({
-        Action::RECONNECT_PLAYER, matchId, 0, 0, playerId
+    enqueue({
+        Action::RECONNECT_PLAYER, matchId, 0, 0, playerId, nullptr, nullptr, {}, 0, nullptr, {}
+    });
+}
+
+bool GameThread::handlePlayerAction(int matchId, int playerId, const MatchEngine::Action& gameAction,
+                                    const LatencyTrace& trace) {
+    return offer({
+        Action::PLAYER_ACTION, matchId, 0, 0, playerId, nullptr, nullptr, gameAction, 0, nullptr, trace
+    });
+}
+
+bool GameThread::handleStateRequest(int matchId, int playerId, uint64_t lastSeq) {
+    return offer({
+        Action::SEND_STATE, matchId, 0, 0, playerId, nullptr, nullptr, {}, lastSeq, nullptr, {}
+    });
+}
+
+void GameThread::expectMatch(int matchId) {
+    // Lo llama el propio worker: encolar en su buzón podría no tener sitio
+    // y él es quien lo vacía. Las acciones de la partida que lleguen después
+    // las procesa al volver, ya con la partida esperada
+    pendingAdoption[matchId];
+}
+
+void GameThread::releaseMatch(int matchId, std::shared_ptr<GameThread> target) {
+    enqueue({
+        Action::RELEASE_MATCH, matchId, 0, 0, 0, nullptr, std::move(target), {}, 0, nullptr, {}
+    });
+}
+
+void GameThread::detachMatch(int matchId, std::function<void(std::shared_ptr<Match>)> callback) {
+    enqueue({
+        Action::DETACH_MATCH, matchId, 0, 0, 0, nullptr, nullptr, {}, 0, std::move(callback), {}
     });
-    // Notifica al thread
-    cv.notify_one();
+}
+
+void GameThread::scheduleTimer(int matchId, std::chrono::steady_clock::time_point deadline) {
+    timers.schedule(matchId, deadline);
 }
 
 int GameThread::getActiveMatchCount() const {
-    return matches.size();
+    // matches solo lo toca el worker; este contador es el que se lee desde fuera
+    return activeMatchCount.load();
 }
 
 void GameThread::stop() {
     running = false;
-    cv.notify_all();
+    wakeup.notify();
 }
 
 void GameThread::threadLoop() {
-    while (running) {
-        std::vector<Action> actions; 
-        // acciones pendientes
-        {
-            std::unique_lock<std::mutex> lock(mutex);
-            // Espera por acciones o stop
-            cv.wait(lock, [this] { 
-                return !pendingActions.empty() || !running; 
-            });
-            if (!running && pendingActions.empty()) {
+    std::vector<Action> actions;
+    actions.reserve(batchSize);
+    Action action;
+    auto nextSample = std::chrono::steady_clock::now() + std::chrono::milliseconds(SAMPLE_INTERVAL_MS);
+
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= nextSample) {
+            sampleCosts();
+            nextSample = now + std::chrono::milliseconds(SAMPLE_INTERVAL_MS);
+            // Con los costes al día, pedir partidas a un hilo más cargado
+            if (running) {
+                Orchestrator::getInstance().rebalance(threadId);
+            }
+        }
+        runTimers(now);
+
+        // Saca un lote de acciones del buzón; con el buzón vacío, los
+        // mensajes de control desbordados (van detrás de todo lo del buzón)
+        actions.clear();
+        bool drained = true;
+        while (mailbox.pop(action)) {
+            actions.push_back(std::move(action));
+            if (actions.size() >= batchSize) {
+                drained = false;
                 break;
             }
-            // Mueve las acciones pendientes a copia local
-            actions = std::move(pendingActions);
-            pendingActions.clear();
+        }
+        if (drained) {
+            takeOverflow(actions);
+        }
+
+        if (actions.empty()) {
+            if (!running) {
+                break;
+            }
+            // Anunciar que se va a dormir y revisar el buzón otra vez: un
+            // productor que encoló antes de ver idle=true ya está en la cola
+            idle.store(true);
+            if (overflowing.load()) {
+                idle.store(false);
+                continue;
+            }
+            if (!mailbox.pop(action)) {
+                // Dormir hasta el próximo muestreo o el próximo tick con plazos
+                auto wakeAt = std::min(nextSample, timers.nextTick());
+                auto waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    wakeAt - std::chrono::steady_clock::now()).count();
+                wakeup.wait(static_cast<int>(std::max<long long>(waitMs, 0)));
+                idle.store(false);
+                continue;
+            }
+            idle.store(false);
+            actions.push_back(std::move(action));
         }
         
         // Procesa acciones
-        for (const auto& action : actions) {
-            switch (action.type) {
-                case Action::ADD_MATCH: {
-                    // Crea nuevo match
-                    auto match = std::make_shared<Match>(
-                        action.matchId, action.player1Id, action.player2Id);       
-                    // Añade el match al mapa
-                    matches[action.matchId] = match;
-                    break;
+        for (auto& pending : actions) {
+            processAction(pending);
+        }
+    }
+    LOG_INFO("Thread %d stopped", threadId);
+}
+
+void GameThread::sampleCosts() {
+    for (auto& pair : matches) {
+        pair.second->sampleCost();
+    }
+}
+
+void GameThread::runTimers(std::chrono::steady_clock::time_point now) {
+    if (timers.size() == 0) {
+        return;
+    }
+    expiredTimers.clear();
+    timers.advance(now, expiredTimers);
+    // Un plazo vencido de una partida que ya no está en el hilo se ignora;
+    // la partida revisa sus propios plazos (los reprogramados no vencen aún)
+    for (int matchId : expiredTimers) {
+        auto it = matches.find(matchId);
+        if (it != matches.end() && it->second->onTimer(now)) {
+            finishMatch(it);
+        }
+    }
+}
+
+void GameThread::finishMatch(std::unordered_map<int, std::shared_ptr<Match>>::iterator it) {
+    int matchId = it->first;
+    matches.erase(it);
+    activeMatchCount = matches.size();
+    Orchestrator::getInstance().notifyMatchEnded(matchId);
+}
+
+void GameThread::processAction(Action& action) {
+    // Acciones para una partida que todavía viene desde otro hilo
+    if (action.type == Action::DISCONNECT_PLAYER || action.type == Action::RECONNECT_PLAYER ||
+        action.type == Action::PLAYER_ACTION || action.type == Action::SEND_STATE ||
+        action.type == Action::DETACH_MATCH) {
+        auto pendingIt = pendingAdoption.find(action.matchId);
+        if (pendingIt != pendingAdoption.end()) {
+            pendingIt->second.push_back(std::move(action));
+            return;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    switch (action.type) {
+        case Action::ADD_MATCH: {
+            // Añade al mapa el match creado por el orquestador
+            matches[action.matchId] = action.match;
+            activeMatchCount = matches.size();
+            action.match->attachScheduler(this);
+            break;
+        }
+
+        case Action::RELEASE_MATCH: {
+            // Entregar la partida al hilo destino (o avisar que ya no existe)
+            std::shared_ptr<Match> match;
+            auto it = matches.find(action.matchId);
+            if (it != matches.end()) {
+                match = it->second;
+                match->attachScheduler(nullptr);
+                matches.erase(it);
+                activeMatchCount = matches.size();
+            }
+            action.target->enqueue({
+                Action::ADOPT_MATCH, action.matchId, 0, 0, 0, match, nullptr, {}, 0, nullptr, {}
+            });
+            return;
+        }
+
+        case Action::DETACH_MATCH: {
+            // La partida sigue en otro proceso: sale del hilo sin avisar su fin
+            // (sus plazos vencidos se ignoran al no encontrarla)
+            std::shared_ptr<Match> match;
+            auto it = matches.find(action.matchId);
+            if (it != matches.end()) {
+                match = it->second;
+                match->attachScheduler(nullptr);
+                matches.erase(it);
+                activeMatchCount = matches.size();
+            }
+            action.detached(match);
+            return;
+        }
+
+        case Action::ADOPT_MATCH: {
+            auto pendingIt = pendingAdoption.find(action.matchId);
+            std::vector<Action> buffered;
+            if (pendingIt != pendingAdoption.end()) {
+                buffered = std::move(pendingIt->second);
+                pendingAdoption.erase(pendingIt);
+            }
+            // La partida terminó en el hilo origen antes de soltarla
+            if (!action.match) {
+                return;
+            }
+            matches[action.matchId] = action.match;
+            activeMatchCount = matches.size();
+            action.match->attachScheduler(this);
+            LOG_INFO("Match %d adopted by thread %d", action.matchId, threadId);
+            // Aplicar en orden lo que llegó mientras la partida estaba en tránsito
+            for (auto& pending : buffered) {
+                processAction(pending);
+            }
+            return;
+        }
+        
+        case Action::DISCONNECT_PLAYER: {
+            // Encuentra el match
+            auto it = matches.find(action.matchId);
+            if (it != matches.end()) {
+                // Maneja desconexion
+                bool matchEnded = it->second->handleDisconnect(action.playerId);
+                // Si el match terminó, lo elimina y notifica al orquestador
+                if (matchEnded) {
+                    finishMatch(it);
                 }
-                
-                case Action::DISCONNECT_PLAYER: {
-                    // Find the match
-                    // Encuentra el match
-                    auto it = matches.find(action.matchId);
-                    if (it != matches.end()) {
-                        // Handle the disconnect
-                        // Maneja desconexion
-                        bool matchEnded = it->second->handleDisconnect(action.playerId);
-                        // Si el match terminó, lo elimina y notifica al orquestador
-                        if (matchEnded) {
-                            matches.erase(it);
-                            Orchestrator::getInstance().notifyMatchEnded(action.matchId);
-                        }
-                    }
-                    break;
+            }
+            break;
+        }
+        
+        case Action::PLAYER_ACTION: {
+            auto it = matches.find(action.matchId);
+            if (it != matches.end()) {
+                LatencyMetrics::getInstance().record(action.trace, LatencyTrace::DEQUEUED);
+                // El motor de reglas valida y aplica la acción y avisa a ambos
+                // jugadores (los envíos hechos aquí ven la traza de la acción)
+                LatencyTrace::Scope traceScope(action.trace);
+                bool matchEnded = it->second->applyAction(action.playerId, action.gameAction);
+                if (matchEnded) {
+                    finishMatch(it);
                 }
-                
-                case Action::RECONNECT_PLAYER: {
-                    // Encuentra el match
-                    auto it = matches.find(action.matchId);
-                    if (it != matches.end()) {
-                        // Maneja la reconexión
-                        bool reconnected = it->second->reconnectPlayer(action.playerId);
-                        if (reconnected) {
-                            printf("Player %d successfully reconnected to match %d in thread %d\n", action.playerId, action.matchId, threadId);
-                        }}
-                    break;
+            }
+            break;
+        }
+
+        case Action::SEND_STATE: {
+            auto it = matches.find(action.matchId);
+            if (it != matches.end()) {
+                // Con lastSeq el cliente conserva su estado: solo recibe lo que se perdió
+                if (action.lastSeq > 0) {
+                    it->second->resumePlayer(action.playerId, action.lastSeq);
+                } else {
+                    it->second->sendState(action.playerId);
                 }
             }
+            break;
         }
+        
+        case Action::RECONNECT_PLAYER: {
+            // Encuentra el match
+            auto it = matches.find(action.matchId);
+            if (it != matches.end()) {
+                // Maneja la reconexión
+                bool reconnected = it->second->reconnectPlayer(action.playerId);
+                if (reconnected) {
+                    LOG_INFO("Player %d successfully reconnected to match %d in thread %d", action.playerId, action.matchId, threadId);
+                }
+            }
+            break;
+        }
+    }
+
+    // Atribuir el tiempo de proceso a la partida para el reparto de carga
+    auto it = matches.find(action.matchId);
+    if (it != matches.end()) {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        it->second->addBusyTime(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
     }
-    printf("Thread %d stopped\n", threadId);
 }
@@ -0,0 +1,55 @@
+#include "../libs/game_transport.hpp"
+#include "../libs/binary_protocol.hpp"
+#include <stdexcept>
+
+void GameTransport::send(connection_hdl hdl, const std::string& payload, websocketpp::frame::opcode::value opcode) {
+    websocketpp::lib::error_code ec;
+    send(hdl, payload, opcode, ec);
+    if (ec) {
+        throw std::runtime_error("Send failed: " + ec.message());
+    }
+}
+
+void GameTransport::close(connection_hdl hdl, websocketpp::close::status::value code, const std::string& reason) {
+    websocketpp::lib::error_code ec;
+    close(hdl, code, reason, ec);
+    if (ec) {
+        throw std::runtime_error("Close failed: " + ec.message());
+    }
+}
+
+websocketpp::lib::asio::io_service& WebSocketTransport::getIoService() {
+    return server.get_io_service();
+}
+
+void WebSocketTransport::send(connection_hdl hdl, const std::string& payload,
+                              websocketpp::frame::opcode::value opcode, websocketpp::lib::error_code& ec) {
+    server.send(hdl, payload, opcode, ec);
+}
+
+void WebSocketTransport::close(connection_hdl hdl, websocketpp::close::status::value code,
+                               const std::string& reason, websocketpp::lib::error_code& ec) {
+    server.close(hdl, code, reason, ec);
+}
+
+void WebSocketTransport::ping(connection_hdl hdl, const std::string& payload, websocketpp::lib::error_code& ec) {
+    // Sin pong timeout handler websocketpp no arma un timer por ping: el
+    // plazo lo lleva HeartbeatMonitor
+    server.ping(hdl, payload, ec);
+}
+
+size_t WebSocketTransport::getBufferedAmount(connection_hdl hdl) {
+    return server.get_con_from_hdl(hdl)->get_buffered_amount();
+}
+
+std::string WebSocketTransport::getRemoteEndpoint(connection_hdl hdl) {
+    return server.get_con_from_hdl(hdl)->get_remote_endpoint();
+}
+
+bool WebSocketTransport::isBinary(connection_hdl hdl) {
+    return server.get_con_from_hdl(hdl)->get_subprotocol() == BinaryProtocol::SUBPROTOCOL;
+}
+
+void WebSocketTransport::setTimer(long ms, TimerHandler handler) {
+    server.set_timer(ms, handler);
+}
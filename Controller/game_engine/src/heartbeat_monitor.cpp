@@ -0,0 +1,278 @@
+#include "../libs/heartbeat_monitor.hpp"
+#include "../libs/game_session.hpp"
+#include "src/utils/Log.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+
+// Resolución de los plazos y tamaño de la rueda (51 s por vuelta)
+static const long TICK_MS = 50;
+static const size_t WHEEL_SLOTS = 1024;
+
+// Intervalo mínimo entre pings aunque el RTT sea muy bajo
+static const long MIN_INTERVAL_MS = 1000;
+
+// Plazos seguidos sin pong antes de dar la conexión por muerta
+static const int MAX_MISSED = 2;
+
+static long readEnvMs(const char* name, long defaultValue) {
+    const char* value = std::getenv(name);
+    if (value == nullptr) {
+        return defaultValue;
+    }
+    try {
+        long parsed = std::stol(value);
+        return parsed >= 0 ? parsed : defaultValue;
+    } catch (const std::exception&) {
+        return defaultValue;
+    }
+}
+
+HeartbeatMonitor::HeartbeatMonitor()
+    : maxInterval(readEnvMs("HEARTBEAT_INTERVAL_MS", 5000)),
+      minTimeout(readEnvMs("HEARTBEAT_MIN_TIMEOUT_MS", 500)),
+      maxTimeout(readEnvMs("HEARTBEAT_MAX_TIMEOUT_MS", 10000)),
+      wheel(std::chrono::milliseconds(TICK_MS), WHEEL_SLOTS),
+      wakeAt(Clock::time_point::max()),
+      running(false), pingsSent(0), deadPeers(0) {
+    if (maxTimeout < minTimeout) {
+        maxTimeout = minTimeout;
+    }
+}
+
+HeartbeatMonitor::~HeartbeatMonitor() {
+    stop();
+}
+
+void HeartbeatMonitor::start() {
+    if (maxInterval.count() == 0 || running.exchange(true)) {
+        return;
+    }
+    worker = std::thread(&HeartbeatMonitor::run, this);
+    LOG_INFO("Heartbeats every %ld ms at most, pong timeout %ld-%ld ms",
+             static_cast<long>(maxInterval.count()), static_cast<long>(minTimeout.count()),
+             static_cast<long>(maxTimeout.count()));
+}
+
+void HeartbeatMonitor::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    wakeup.notify();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    peers.clear();
+}
+
+uint32_t HeartbeatMonitor::watch(std::weak_ptr<GameSession> session, connection_hdl hdl) {
+    if (!running) {
+        return 0;
+    }
+    Clock::time_point now = Clock::now();
+    bool wake;
+    uint32_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        id = nextId;
+        // Los ids viajan en la TimerWheel como int
+        nextId = nextId >= static_cast<uint32_t>(INT_MAX) ? 1 : nextId + 1;
+
+        Peer& peer = peers[id];
+        peer.session = std::move(session);
+        peer.hdl = hdl;
+        peer.lastSeen = now;
+        // Primer ping pronto: mide el RTT antes de alargar el intervalo
+        Clock::time_point due = now + std::min(maxInterval, std::chrono::milliseconds(MIN_INTERVAL_MS));
+        schedule(id, peer, due);
+        wake = due < wakeAt;
+    }
+    if (wake) {
+        wakeup.notify();
+    }
+    return id;
+}
+
+void HeartbeatMonitor::unwatch(uint32_t id) {
+    if (id == 0) {
+        return;
+    }
+    // Su entrada en la rueda queda y se ignora al vencer
+    std::lock_guard<std::mutex> lock(mutex);
+    peers.erase(id);
+}
+
+void HeartbeatMonitor::onPong(const std::string& payload) {
+    // "id:seq" (los pongs de clientes que no son de este monitor se ignoran)
+    char* end = nullptr;
+    unsigned long id = std::strtoul(payload.c_str(), &end, 10);
+    if (end == nullptr || *end != ':') {
+        return;
+    }
+    unsigned long seq = std::strtoul(end + 1, nullptr, 10);
+
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = peers.find(static_cast<uint32_t>(id));
+    if (it == peers.end()) {
+        return;
+    }
+    Peer& peer = it->second;
+    if (!peer.awaitingPong || peer.seq != seq) {
+        return;
+    }
+
+    // Estimador del RTO de TCP (RFC 6298): media y variación suavizadas
+    double sampleUs = std::chrono::duration<double, std::micro>(now - peer.pingSentAt).count();
+    if (peer.srttUs == 0) {
+        peer.srttUs = sampleUs;
+        peer.rttvarUs = sampleUs / 2;
+    } else {
+        peer.rttvarUs = 0.75 * peer.rttvarUs + 0.25 * std::fabs(peer.srttUs - sampleUs);
+        peer.srttUs = 0.875 * peer.srttUs + 0.125 * sampleUs;
+    }
+    rtt.record(static_cast<int64_t>(sampleUs * 1000));
+
+    peer.awaitingPong = false;
+    peer.missed = 0;
+    peer.lastSeen = now;
+    schedule(it->first, peer, now + intervalOf(peer));
+}
+
+double HeartbeatMonitor::getRttMs(uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = peers.find(id);
+    if (it == peers.end() || it->second.srttUs == 0) {
+        return -1;
+    }
+    return it->second.srttUs / 1000;
+}
+
+size_t HeartbeatMonitor::getWatchedCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return peers.size();
+}
+
+std::chrono::milliseconds HeartbeatMonitor::timeoutOf(const Peer& peer) const {
+    // Sin medidas todavía, el plazo más largo
+    if (peer.srttUs == 0) {
+        return maxTimeout;
+    }
+    auto timeout = std::chrono::milliseconds(static_cast<long>((peer.srttUs + 4 * peer.rttvarUs) / 1000) + 1);
+    return std::max(minTimeout, std::min(maxTimeout, timeout));
+}
+
+std::chrono::milliseconds HeartbeatMonitor::intervalOf(const Peer& peer) const {
+    // Detectar una conexión muerta tarda a lo sumo intervalo + plazo: con
+    // RTT bajo se pregunta más a menudo, con RTT alto se deja más margen
+    auto interval = 4 * timeoutOf(peer);
+    auto minInterval = std::min(maxInterval, std::chrono::milliseconds(MIN_INTERVAL_MS));
+    return std::max(minInterval, std::min(maxInterval, interval));
+}
+
+void HeartbeatMonitor::schedule(uint32_t id, Peer& peer, Clock::time_point due) {
+    peer.due = due;
+    wheel.schedule(static_cast<int>(id), due);
+}
+
+void HeartbeatMonitor::expire(Clock::time_point now, std::vector<Task>& tasks) {
+    expired.clear();
+    wheel.advance(now, expired);
+    for (int expiredId : expired) {
+        auto it = peers.find(static_cast<uint32_t>(expiredId));
+        // Entrada de una conexión ya cerrada o reprogramada después
+        if (it == peers.end() || it->second.due > now) {
+            continue;
+        }
+        // Sesión ya liberada: nadie va a cerrar esta conexión por nosotros
+        if (it->second.session.expired()) {
+            peers.erase(it);
+            continue;
+        }
+        uint32_t id = it->first;
+        Peer& peer = it->second;
+
+        if (peer.awaitingPong) {
+            peer.missed++;
+            if (peer.missed >= MAX_MISSED) {
+                detection.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - peer.lastSeen).count());
+                deadPeers++;
+                tasks.push_back({peer.session, peer.hdl, std::string()});
+                peers.erase(it);
+                continue;
+            }
+        }
+
+        // Ping nuevo; tras un plazo sin respuesta, el siguiente espera el doble
+        peer.seq++;
+        peer.awaitingPong = true;
+        peer.pingSentAt = now;
+        schedule(id, peer, now + timeoutOf(peer) * (peer.missed + 1));
+        tasks.push_back({peer.session, peer.hdl, std::to_string(id) + ":" + std::to_string(peer.seq)});
+    }
+}
+
+void HeartbeatMonitor::run() {
+    std::vector<Task> tasks;
+    while (running) {
+        tasks.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            expire(Clock::now(), tasks);
+            wakeAt = wheel.nextTick();
+        }
+
+        // Pings y avisos sin el mutex: la sesión toma los suyos
+        for (auto& task : tasks) {
+            auto session = task.session.lock();
+            if (!session) {
+                continue;
+            }
+            if (task.ping.empty()) {
+                session->onHeartbeatTimeout(task.hdl);
+            } else {
+                pingsSent++;
+                session->sendPing(task.hdl, task.ping);
+            }
+        }
+
+        Clock::time_point until;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            until = wakeAt;
+        }
+        if (until == Clock::time_point::max()) {
+            wakeup.wait();
+        } else {
+            auto waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(until - Clock::now()).count();
+            if (waitMs > 0) {
+                wakeup.wait(static_cast<int>(waitMs));
+            }
+        }
+    }
+}
+
+void HeartbeatMonitor::appendPrometheus(std::string& out) {
+    size_t watched;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        watched = peers.size();
+    }
+    out += "# HELP game_heartbeat_rtt_seconds Round-trip time of WebSocket pings to players\n";
+    out += "# TYPE game_heartbeat_rtt_seconds histogram\n";
+    rtt.appendPrometheus(out, "game_heartbeat_rtt_seconds", "source=\"ping\"");
+    out += "# HELP game_heartbeat_detection_seconds Time from a dead connection's last pong to its disconnect\n";
+    out += "# TYPE game_heartbeat_detection_seconds histogram\n";
+    detection.appendPrometheus(out, "game_heartbeat_detection_seconds", "cause=\"pong_timeout\"");
+    out += "# HELP game_heartbeat_connections Player connections watched by heartbeats\n";
+    out += "# TYPE game_heartbeat_connections gauge\n";
+    out += "game_heartbeat_connections " + std::to_string(watched) + "\n";
+    out += "# HELP game_heartbeat_pings_total WebSocket pings sent to players\n";
+    out += "# TYPE game_heartbeat_pings_total counter\n";
+    out += "game_heartbeat_pings_total " + std::to_string(pingsSent.load()) + "\n";
+    out += "# HELP game_heartbeat_dead_total Player connections closed for missing their pongs\n";
+    out += "# TYPE game_heartbeat_dead_total counter\n";
+    out += "game_heartbeat_dead_total " + std::to_string(deadPeers.load()) + "\n";
+}
@@ -0,0 +1,47 @@
+#include "../libs/io_context_pool.hpp"
+#include "src/utils/Log.hpp"
+#include <iostream>
+
+IoContextPool::~IoContextPool() {
+    stop();
+}
+
+void IoContextPool::start(int numThreads) {
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    if (running || numThreads <= 0) {
+        return;
+    }
+    
+    work.reset(new IoService::work(ioService));
+    for (int i = 0; i < numThreads; i++) {
+        workers.emplace_back([this, i]() {
+            try {
+                ioService.run();
+            } catch (const std::exception& e) {
+                LOG_ERROR("IO thread %d error: %s", i, e.what());
+            }
+        });
+    }
+    running = true;
+    LOG_INFO("Shared IO pool started with %d threads", numThreads);
+}
+
+void IoContextPool::stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    if (!running) {
+        return;
+    }
+    
+    work.reset();
+    ioService.stop();
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+    running = false;
+    LOG_INFO("Shared IO pool stopped");
+}
@@ -0,0 +1,162 @@
+#include "../libs/latency_metrics.hpp"
+#include "src/utils/Log.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+LatencyHistogram::LatencyHistogram() : count(0), sumNs(0) {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::record(int64_t nanoseconds) {
+    if (nanoseconds < 0) {
+        nanoseconds = 0;
+    }
+    // Primer bucket cuyo límite cubre la latencia (redondeada hacia arriba)
+    uint64_t us = (static_cast<uint64_t>(nanoseconds) + 999) / 1000;
+    size_t index = 0;
+    while (index < BUCKETS && bucketBoundUs(index) < us) {
+        index++;
+    }
+    buckets[index].fetch_add(1, std::memory_order_relaxed);
+    sumNs.fetch_add(static_cast<uint64_t>(nanoseconds), std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::percentileUs(double quantile) const {
+    uint64_t total = getCount();
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(quantile * total);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen > rank) {
+            return static_cast<double>(bucketBoundUs(i));
+        }
+    }
+    // Por encima del último límite
+    return static_cast<double>(bucketBoundUs(BUCKETS - 1)) * 2;
+}
+
+void LatencyHistogram::appendPrometheus(std::string& out, const std::string& name, const std::string& labels) const {
+    char line[256];
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        cumulative += buckets[i].load(std::memory_order_relaxed);
+        std::snprintf(line, sizeof(line), "%s_bucket{%s,le=\"%.6f\"} %llu\n", name.c_str(), labels.c_str(),
+                      bucketBoundUs(i) / 1e6, static_cast<unsigned long long>(cumulative));
+        out += line;
+    }
+    cumulative += buckets[BUCKETS].load(std::memory_order_relaxed);
+    std::snprintf(line, sizeof(line), "%s_bucket{%s,le=\"+Inf\"} %llu\n", name.c_str(), labels.c_str(),
+                  static_cast<unsigned long long>(cumulative));
+    out += line;
+    std::snprintf(line, sizeof(line), "%s_sum{%s} %.9f\n", name.c_str(), labels.c_str(),
+                  sumNs.load(std::memory_order_relaxed) / 1e9);
+    out += line;
+    std::snprintf(line, sizeof(line), "%s_count{%s} %llu\n", name.c_str(), labels.c_str(),
+                  static_cast<unsigned long long>(cumulative));
+    out += line;
+}
+
+LatencyMetrics::LatencyMetrics() : sampleRate(100), bufferSize(256), completed(0) {
+    const char* rateEnv = std::getenv("TRACE_SAMPLE_RATE");
+    if (rateEnv != nullptr && std::atoi(rateEnv) >= 0) {
+        sampleRate = static_cast<uint64_t>(std::atoi(rateEnv));
+    }
+    const char* bufferEnv = std::getenv("TRACE_BUFFER");
+    if (bufferEnv != nullptr && std::atoi(bufferEnv) > 0) {
+        bufferSize = static_cast<size_t>(std::atoi(bufferEnv));
+    }
+}
+
+const char* LatencyMetrics::stageName(size_t stage) {
+    static const char* const NAMES[LatencyTrace::STAGE_COUNT] = {
+        "receive", "parse", "lookup", "enqueue", "mailbox", "rules", "serialize", "send"
+    };
+    return NAMES[stage];
+}
+
+void LatencyMetrics::record(LatencyTrace& trace, LatencyTrace::Stage stage) {
+    if (!trace.active() || stage <= trace.recorded) {
+        return;
+    }
+    trace.stamp(stage);
+    for (size_t i = trace.recorded + 1; i <= stage; i++) {
+        if (trace.stamps[i] != 0 && trace.stamps[i - 1] != 0) {
+            stages[i].record(trace.stamps[i] - trace.stamps[i - 1]);
+        }
+    }
+    trace.recorded = stage;
+}
+
+void LatencyMetrics::complete(LatencyTrace& trace) {
+    if (!trace.active() || trace.recorded >= LatencyTrace::SENT) {
+        return;
+    }
+    record(trace, LatencyTrace::SENT);
+    int64_t totalNs = trace.stamps[LatencyTrace::SENT] - trace.stamps[LatencyTrace::RECEIVED];
+    total.record(totalNs);
+
+    if (sampleRate == 0 || completed.fetch_add(1, std::memory_order_relaxed) % sampleRate != 0) {
+        return;
+    }
+    json stagesUs = json::object();
+    for (size_t i = LatencyTrace::PARSED; i < LatencyTrace::STAGE_COUNT; i++) {
+        if (trace.stamps[i] != 0 && trace.stamps[i - 1] != 0) {
+            stagesUs[stageName(i)] = (trace.stamps[i] - trace.stamps[i - 1]) / 1000.0;
+        }
+    }
+    json sample = {
+        {"matchId", trace.matchId},
+        {"playerId", trace.playerId},
+        {"totalUs", totalNs / 1000.0},
+        {"stagesUs", stagesUs}
+    };
+    LOG_DEBUG("Action trace: %s", sample.dump().c_str());
+
+    std::lock_guard<std::mutex> lock(tracesMutex);
+    sampledTraces.push_back(std::move(sample));
+    if (sampledTraces.size() > bufferSize) {
+        sampledTraces.pop_front();
+    }
+}
+
+void LatencyMetrics::appendPrometheus(std::string& out) const {
+    out += "# HELP game_action_stage_seconds Latency of each stage of a player action, from WebSocket receive to the opponent's send\n";
+    out += "# TYPE game_action_stage_seconds histogram\n";
+    for (size_t i = LatencyTrace::PARSED; i < LatencyTrace::STAGE_COUNT; i++) {
+        stages[i].appendPrometheus(out, "game_action_stage_seconds", std::string("stage=\"") + stageName(i) + "\"");
+    }
+    out += "# HELP game_action_seconds Latency of a player action, from WebSocket receive to the opponent's send\n";
+    out += "# TYPE game_action_seconds histogram\n";
+    total.appendPrometheus(out, "game_action_seconds", "path=\"opponent\"");
+}
+
+json LatencyMetrics::getSampledTraces() {
+    std::lock_guard<std::mutex> lock(tracesMutex);
+    json traces = json::array();
+    for (const auto& sample : sampledTraces) {
+        traces.push_back(sample);
+    }
+    return traces;
+}
+
+json LatencyMetrics::getSummary() const {
+    json summary = json::object();
+    auto describe = [](const LatencyHistogram& histogram) {
+        return json{
+            {"count", histogram.getCount()},
+            {"p50Us", histogram.percentileUs(0.50)},
+            {"p99Us", histogram.percentileUs(0.99)}
+        };
+    };
+    for (size_t i = LatencyTrace::PARSED; i < LatencyTrace::STAGE_COUNT; i++) {
+        summary[stageName(i)] = describe(stages[i]);
+    }
+    summary["total"] = describe(total);
+    return summary;
+}
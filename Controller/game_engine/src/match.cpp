@@ -1,60 +1,724 @@
 #include "../libs/match.hpp"
+#include "../libs/latency_metrics.hpp"
+#include "src/utils/Log.hpp"
 #include <iostream>
+#include <cstdlib>
+#include <stdexcept>
+#include <algorithm>
 
-Match::Match(int matchId, int player1Id, int player2Id)
+typedef std::chrono::steady_clock Clock;
+
+// Plazos configurables por entorno (0 desactiva el plazo)
+struct MatchTimeouts {
+    std::chrono::milliseconds turn;
+    std::chrono::milliseconds disconnectGrace;
+    int maxMissedTurns;
+};
+
+static int readEnvInt(const char* name, int defaultValue) {
+    const char* envValue = std::getenv(name);
+    if (envValue != nullptr && std::atoi(envValue) >= 0) {
+        return std::atoi(envValue);
+    }
+    return defaultValue;
+}
+
+static const MatchTimeouts& getTimeouts() {
+    static const MatchTimeouts timeouts = {
+        std::chrono::seconds(readEnvInt("TURN_TIMEOUT_SECONDS", 60)),
+        std::chrono::seconds(readEnvInt("DISCONNECT_GRACE_SECONDS", 30)),
+        readEnvInt("MAX_MISSED_TURNS", 3)
+    };
+    return timeouts;
+}
+
+// Versiones de estado que se guardan como base de deltas: un cliente que
+// confirma con más retraso recibe el estado completo
+static const size_t STATE_HISTORY = 16;
+
+// Eventos recientes que se guardan para reconexiones (MATCH_EVENT_BUFFER)
+static size_t getEventBufferSize() {
+    static const size_t size = readEnvInt("MATCH_EVENT_BUFFER", 256);
+    return size;
+}
+
+// Semilla fija por partida derivada de MATCH_SEED y el matchId, para
+// ejecuciones reproducibles (simulación, pruebas). 0 si no está definida:
+// cada partida toma una semilla aleatoria
+static uint32_t getMatchSeed(int matchId) {
+    static const uint32_t base = readEnvInt("MATCH_SEED", 0);
+    if (base == 0) {
+        return 0;
+    }
+    uint64_t x = (static_cast<uint64_t>(base) << 32) ^ static_cast<uint32_t>(matchId);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return static_cast<uint32_t>(x) | 1;
+}
+
+static json cardJson(const MatchEngine::CardView& card) {
+    return json{
+        {"id", card.id},
+        {"name", card.name},
+        {"cost", card.cost},
+        {"attack", card.attack},
+        {"health", card.health},
+        {"legend", card.legend}
+    };
+}
+
+static bool sameCard(const MatchEngine::CardView& a, const MatchEngine::CardView& b) {
+    return a.id == b.id && a.cost == b.cost && a.attack == b.attack &&
+           a.health == b.health && a.legend == b.legend && a.name == b.name;
+}
+
+// Acción del registro del motor como [tipo, asiento, handIndex, fromX, fromY, x, y]
+static json actionJson(const MatchEngine::Action& action) {
+    return json::array({
+        static_cast<int>(action.type), action.seat, action.handIndex,
+        action.fromX, action.fromY, action.x, action.y
+    });
+}
+
+static MatchEngine::Action actionFromJson(const json& entry) {
+    if (!entry.is_array() || entry.size() != 7 || entry[0].get<int>() < 0 || entry[0].get<int>() > 3) {
+        throw std::runtime_error("Invalid action in exported match");
+    }
+    MatchEngine::Action action;
+    action.type = static_cast<MatchEngine::Action::Type>(entry[0].get<int>());
+    action.seat = entry[1].get<uint32_t>();
+    action.handIndex = entry[2].get<uint32_t>();
+    action.fromX = entry[3].get<uint8_t>();
+    action.fromY = entry[4].get<uint8_t>();
+    action.x = entry[5].get<uint8_t>();
+    action.y = entry[6].get<uint8_t>();
+    return action;
+}
+
+Match::Match(int matchId, int player1Id, int player2Id, const std::vector<int>& barajasIds)
     : matchId(matchId), player1Id(player1Id), player2Id(player2Id),
       player1Status(ConnectionStatus::CONNECTED),
       player2Status(ConnectionStatus::CONNECTED),
-      active(true) {
-        printf("Match %d started between players %d and %d\n", matchId, player1Id, player2Id);
-    // sE PUEDE INICIAR EL JUEGO AQUI (SE CONECTARON LOS JUGADORES)
+      active(true), turnDeadline(Clock::time_point::max()), cost(0) {
+    disconnectDeadline[0] = disconnectDeadline[1] = Clock::time_point::max();
+        LOG_INFO("Match %d started between players %d and %d", matchId, player1Id, player2Id);
+    // Inicia el juego con la baraja de cada jugador (mazo 0 si no viene)
+    uint32_t deck1 = barajasIds.size() > 0 && barajasIds[0] >= 0 ? barajasIds[0] : 0;
+    uint32_t deck2 = barajasIds.size() > 1 && barajasIds[1] >= 0 ? barajasIds[1] : 0;
+    uint32_t seed = getMatchSeed(matchId);
+    if (seed != 0) {
+        MatchEngine::Checkpoint start;
+        start.deckSeat0 = deck1;
+        start.deckSeat1 = deck2;
+        start.seed = seed;
+        engine.reset(new MatchEngine(start));
+    } else {
+        engine.reset(new MatchEngine(deck1, deck2));
+    }
+    
+    ackedVersion[0] = 0;
+    ackedVersion[1] = 0;
+    stateHistory.emplace_back(++stateVersion, engine->snapshot());
+}
+
+Match::Match(const json& exported)
+    : matchId(exported.at("matchId").get<int>()),
+      player1Id(exported.at("player1Id").get<int>()),
+      player2Id(exported.at("player2Id").get<int>()),
+      player1Status(ConnectionStatus::CONNECTED),
+      player2Status(ConnectionStatus::CONNECTED),
+      active(true), turnDeadline(Clock::time_point::max()),
+      cost(exported.value("cost", static_cast<uint64_t>(0))) {
+    // El motor se reconstruye repitiendo las acciones con la misma semilla
+    MatchEngine::Checkpoint checkpoint;
+    checkpoint.deckSeat0 = exported.at("decks").at(0).get<uint32_t>();
+    checkpoint.deckSeat1 = exported.at("decks").at(1).get<uint32_t>();
+    checkpoint.seed = exported.at("seed").get<uint32_t>();
+    for (const auto& entry : exported.at("actions")) {
+        checkpoint.actions.push_back(actionFromJson(entry));
+    }
+    engine.reset(new MatchEngine(checkpoint));
+    
+    stateVersion = exported.at("stateVersion").get<uint64_t>();
+    eventSeq = exported.at("eventSeq").get<uint64_t>();
+    for (const auto& event : exported.at("recentEvents")) {
+        recentEvents.push_back(event);
+    }
+    ackedVersion[0] = 0;
+    ackedVersion[1] = 0;
+    stateHistory.emplace_back(stateVersion, engine->snapshot());
+    
+    // Otro decks.json (u otra versión de las reglas) daría otra partida
+    if (stateMessage(SPECTATORS, stateHistory.back().second, stateVersion) != exported.at("check")) {
+        throw std::runtime_error("Imported match " + std::to_string(matchId) + " does not match its exported state");
+    }
+    
+    // Los plazos siguen donde quedaron en el origen (el reloj no corre durante la migración)
+    auto now = Clock::now();
+    auto deadlineFrom = [&now](const json& remainingMs) {
+        int64_t remaining = remainingMs.get<int64_t>();
+        return remaining < 0 ? Clock::time_point::max() : now + std::chrono::milliseconds(remaining);
+    };
+    turnDeadline = deadlineFrom(exported.at("turnRemainingMs"));
+    turnSeat = exported.at("turnSeat").get<uint32_t>();
+    turnNumber = exported.at("turnNumber").get<uint32_t>();
+    
+    // Los jugadores tienen que volver a conectarse a este proceso: quien no
+    // vuelva dentro del plazo de gracia pierde como si se hubiera desconectado
+    for (uint32_t seat = 0; seat < 2; seat++) {
+        missedTurns[seat] = exported.at("missedTurns").at(seat).get<int>();
+        if (!exported.at("connected").at(seat).get<bool>()) {
+            (seat == 0 ? player1Status : player2Status) = ConnectionStatus::DISCONNECTED;
+            disconnectDeadline[seat] = deadlineFrom(exported.at("disconnectRemainingMs").at(seat));
+        } else if (getTimeouts().disconnectGrace.count() > 0) {
+            disconnectDeadline[seat] = now + getTimeouts().disconnectGrace;
+        } else {
+            disconnectDeadline[seat] = Clock::time_point::max();
+        }
+    }
+    
+    LOG_INFO("Match %d imported between players %d and %d (%zu actions replayed)",
+             matchId, player1Id, player2Id, checkpoint.actions.size());
+}
+
+json Match::exportState() const {
+    auto now = Clock::now();
+    auto remainingMs = [&now](Clock::time_point deadline) -> int64_t {
+        if (deadline == Clock::time_point::max()) {
+            return -1;
+        }
+        return std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count());
+    };
+    
+    const MatchEngine::Checkpoint& checkpoint = engine->checkpoint();
+    json actions = json::array();
+    for (const auto& action : checkpoint.actions) {
+        actions.push_back(actionJson(action));
+    }
+    json events = json::array();
+    for (const auto& event : recentEvents) {
+        events.push_back(event);
+    }
+    
+    return json{
+        {"matchId", matchId},
+        {"player1Id", player1Id},
+        {"player2Id", player2Id},
+        {"decks", {checkpoint.deckSeat0, checkpoint.deckSeat1}},
+        {"seed", checkpoint.seed},
+        {"actions", actions},
+        {"stateVersion", stateVersion},
+        {"eventSeq", eventSeq},
+        {"recentEvents", events},
+        {"connected", {player1Status == ConnectionStatus::CONNECTED, player2Status == ConnectionStatus::CONNECTED}},
+        {"disconnectRemainingMs", {remainingMs(disconnectDeadline[0]), remainingMs(disconnectDeadline[1])}},
+        {"turnRemainingMs", remainingMs(turnDeadline)},
+        {"turnSeat", turnSeat},
+        {"turnNumber", turnNumber},
+        {"missedTurns", {missedTurns[0], missedTurns[1]}},
+        {"cost", cost.load()},
+        // Estado público para verificar la reconstrucción en el destino
+        {"check", stateMessage(SPECTATORS, stateHistory.back().second, stateVersion)}
+    };
 }
 
 bool Match::handleDisconnect(int playerId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    if (!active) {
+        return false;
+    }
+    
     if (playerId == player1Id) {
         player1Status = ConnectionStatus::DISCONNECTED;
-        printf("Player %d disconnected from match %d\n", playerId, matchId);
+        LOG_INFO("Player %d disconnected from match %d", playerId, matchId);
     } else if (playerId == player2Id) {
         player2Status = ConnectionStatus::DISCONNECTED;
-        printf("Player %d disconnected from match %d\n", playerId, matchId);
+        LOG_INFO("Player %d disconnected from match %d", playerId, matchId);
     } else {
         // El jugador no está en este match
         return false;
     }
     
-    //
-    // mira si ambos jugadores están desconectados
-    //if (player1Status == ConnectionStatus::DISCONNECTED && player2Status == ConnectionStatus::DISCONNECTED) {
-    //    printf("Match %d ended: both players disconnected\n", matchId);
-    //    active = false;
-    //    return true;  
-    //}
+    // mira si ambos jugadores están desconectados (partida abandonada)
+    if (player1Status == ConnectionStatus::DISCONNECTED && player2Status == ConnectionStatus::DISCONNECTED) {
+        LOG_INFO("Match %d ended: both players disconnected", matchId);
+        active = false;
+        return true;  
+    }
+    
+    // Plazo para volver antes de perder la partida
+    if (getTimeouts().disconnectGrace.count() > 0) {
+        uint32_t seat = playerToSeat(playerId);
+        disconnectDeadline[seat] = Clock::now() + getTimeouts().disconnectGrace;
+        scheduleTimer(disconnectDeadline[seat]);
+    }
     return false;  
 }
 
-void Match::handleAction(int playerId, const std::string& action) {
-    std::lock_guard<std::mutex> lock(mutex);
+bool Match::decodeAction(const json& data, MatchEngine::Action& action, std::string& error) {
+    if (!data.contains("action") || !data["action"].is_string()) {
+        error = "Missing action";
+        return false;
+    }
+    std::string name = data["action"];
+    
+    // Leer una coordenada/índice entero y acotado
+    auto readField = [&](const char* field, int maxValue, int& value) {
+        if (!data.contains(field) || !data[field].is_number_integer()) {
+            error = std::string("Missing field ") + field;
+            return false;
+        }
+        value = data[field];
+        if (value < 0 || value > maxValue) {
+            error = std::string("Invalid field ") + field;
+            return false;
+        }
+        return true;
+    };
+    
+    int handIndex = 0, fromX = 0, fromY = 0, x = 0, y = 0;
+    if (name == "playCard") {
+        if (!readField("handIndex", 255, handIndex) || !readField("x", 255, x) || !readField("y", 255, y)) {
+            return false;
+        }
+        action.type = MatchEngine::Action::Type::PLAY_CARD;
+    } else if (name == "moveCard") {
+        if (!readField("fromX", 255, fromX) || !readField("fromY", 255, fromY) ||
+            !readField("x", 255, x) || !readField("y", 255, y)) {
+            return false;
+        }
+        action.type = MatchEngine::Action::Type::MOVE_CARD;
+    } else if (name == "attack") {
+        if (!readField("fromX", 255, fromX) || !readField("fromY", 255, fromY) ||
+            !readField("targetX", 255, x) || !readField("targetY", 255, y)) {
+            return false;
+        }
+        action.type = MatchEngine::Action::Type::ATTACK;
+    } else if (name == "endTurn") {
+        action.type = MatchEngine::Action::Type::END_TURN;
+    } else {
+        error = "Unknown action " + name;
+        return false;
+    }
+    
+    action.handIndex = handIndex;
+    action.fromX = fromX;
+    action.fromY = fromY;
+    action.x = x;
+    action.y = y;
+    return true;
+}
+
+bool Match::applyAction(int playerId, const MatchEngine::Action& action) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        
+        if (!active) {
+            LOG_DEBUG("Ignoring action from player %d as match %d is no longer active", playerId, matchId);
+            return false;
+        }
+        
+        // Verifica si el jugador es parte de este match
+        if (playerId != player1Id && playerId != player2Id) {
+            LOG_DEBUG("Player %d is not part of match %d", playerId, matchId);
+            return false;
+        }
+        
+        // Mira si el jugador está conectado
+        if ((playerId == player1Id && player1Status == ConnectionStatus::DISCONNECTED) ||
+            (playerId == player2Id && player2Status == ConnectionStatus::DISCONNECTED)) {
+            LOG_DEBUG("Ignoring action from disconnected player %d", playerId);
+            return false;
+        }
+    }
+    
+    MatchEngine::Action seated = action;
+    seated.seat = playerToSeat(playerId);
+    MatchEngine::Result result = engine->apply(seated);
+    LatencyMetrics::recordCurrent(LatencyTrace::APPLIED);
+    
+    static const char* ACTION_NAMES[] = {"playCard", "moveCard", "attack", "endTurn"};
+    json response = {
+        {"type", "actionResult"},
+        {"matchId", matchId},
+        {"fromPlayerId", playerId},
+        {"action", ACTION_NAMES[static_cast<int>(action.type)]},
+        {"accepted", result.accepted}
+    };
+    
+    // Una acción rechazada solo le interesa a quien la hizo
+    if (!result.accepted) {
+        response["error"] = result.error;
+        send(playerId, response);
+        return false;
+    }
+    
+    // El jugador está activo: se reinicia su cuenta de turnos perdidos
+    missedTurns[seated.seat] = 0;
+    
+    MatchEngine::Snapshot snapshot = engine->snapshot();
+    publishEvent(response);
+    broadcastState(snapshot);
+    
+    if (!snapshot.gameOver) {
+        updateTurnTimer(snapshot);
+        return false;
+    }
+    
+    endGame(snapshot.winnerSeat >= 0 ? seatToPlayer(snapshot.winnerSeat) : -1, "legendDestroyed");
+    return true;
+}
+
+void Match::broadcastState(const MatchEngine::Snapshot& snapshot) {
+    stateHistory.emplace_back(++stateVersion, snapshot);
+    if (stateHistory.size() > STATE_HISTORY) {
+        stateHistory.pop_front();
+    }
+    
+    sendStateUpdate(player1Id);
+    sendStateUpdate(player2Id);
+    
+    // Un único delta público (contra la versión anterior) para todos los espectadores
+    if (spectated) {
+        const auto& previous = stateHistory[stateHistory.size() - 2];
+        send(SPECTATORS, deltaMessage(SPECTATORS, previous.second, previous.first, snapshot, stateVersion));
+    }
+}
+
+void Match::sendStateUpdate(int playerId) {
+    const MatchEngine::Snapshot& current = stateHistory.back().second;
+    uint64_t acked = ackedVersion[playerToSeat(playerId)].load();
+    if (acked == stateVersion) {
+        return;  // Ya tiene el estado actual
+    }
+    
+    // Delta contra la versión que confirmó el jugador si aún está guardada
+    for (const auto& entry : stateHistory) {
+        if (entry.first == acked) {
+            send(playerId, deltaMessage(playerId, entry.second, acked, current, stateVersion));
+            return;
+        }
+    }
+    send(playerId, stateMessage(playerId, current, stateVersion));
+}
+
+void Match::publishEvent(json event) {
+    event["seq"] = ++eventSeq;
+    recentEvents.push_back(event);
+    if (recentEvents.size() > getEventBufferSize()) {
+        recentEvents.pop_front();
+    }
+    send(ALL_PLAYERS, event);
+}
+
+void Match::resumePlayer(int playerId, uint64_t lastSeq) {
+    // Los eventos guardados tienen seq consecutivos: el primero que falta está
+    // en una posición fija, y el coste es proporcional a lo que se perdió
+    uint64_t oldestSeq = recentEvents.empty() ? eventSeq + 1 : recentEvents.front()["seq"].get<uint64_t>();
+    if (lastSeq > eventSeq || lastSeq + 1 < oldestSeq) {
+        LOG_INFO("Player %d too far behind in match %d (seq %llu), sending full state",
+                 playerId, matchId, static_cast<unsigned long long>(lastSeq));
+        sendState(playerId);
+        return;
+    }
+    
+    for (size_t i = lastSeq + 1 - oldestSeq; i < recentEvents.size(); i++) {
+        send(playerId, recentEvents[i]);
+    }
+    sendStateUpdate(playerId);
+}
+
+void Match::endGame(int winnerId, const std::string& reason) {
+    json gameOver = {
+        {"type", "gameOver"},
+        {"matchId", matchId},
+        {"winnerId", winnerId >= 0 ? json(winnerId) : json(nullptr)},
+        {"reason", reason}
+    };
+    publishEvent(gameOver);
+    
+    LOG_INFO("Match %d ended: %s", matchId, reason.c_str());
+    active = false;
+}
+
+void Match::attachScheduler(MatchScheduler* newScheduler) {
+    scheduler = newScheduler;
+    if (!scheduler) {
+        return;
+    }
     
+    // Primer dueño: arranca el reloj del primer turno
+    if (turnDeadline == Clock::time_point::max() && getTimeouts().turn.count() > 0) {
+        MatchEngine::Snapshot snapshot = engine->snapshot();
+        turnSeat = snapshot.currentSeat;
+        turnNumber = snapshot.turn;
+        turnDeadline = Clock::now() + getTimeouts().turn;
+    }
+    
+    // Volver a programar los plazos vigentes en la rueda del nuevo dueño
+    scheduleTimer(turnDeadline);
+    scheduleTimer(disconnectDeadline[0]);
+    scheduleTimer(disconnectDeadline[1]);
+}
+
+void Match::scheduleTimer(Clock::time_point deadline) {
+    if (scheduler && deadline != Clock::time_point::max()) {
+        scheduler->scheduleTimer(matchId, deadline);
+    }
+}
+
+void Match::updateTurnTimer(const MatchEngine::Snapshot& snapshot) {
+    if (getTimeouts().turn.count() == 0) {
+        return;
+    }
+    if (snapshot.currentSeat == turnSeat && snapshot.turn == turnNumber) {
+        return;
+    }
+    turnSeat = snapshot.currentSeat;
+    turnNumber = snapshot.turn;
+    turnDeadline = Clock::now() + getTimeouts().turn;
+    scheduleTimer(turnDeadline);
+}
+
+bool Match::onTimer(Clock::time_point now) {
     if (!active) {
-        printf("Ignoring action from player %d as match %d is no longer active\n", playerId, matchId);
+        return false;
+    }
+    
+    // Un jugador desconectado que no volvió a tiempo pierde la partida
+    for (uint32_t seat = 0; seat < 2; seat++) {
+        if (disconnectDeadline[seat] <= now) {
+            disconnectDeadline[seat] = Clock::time_point::max();
+            endGame(seatToPlayer(1 - seat), "disconnect");
+            return true;
+        }
+    }
+    
+    if (turnDeadline > now) {
+        return false;
+    }
+    
+    // Turno agotado: se termina por el jugador
+    int playerId = seatToPlayer(turnSeat);
+    MatchEngine::Action endTurn;
+    endTurn.type = MatchEngine::Action::Type::END_TURN;
+    endTurn.seat = turnSeat;
+    engine->apply(endTurn);
+    
+    json expired = {
+        {"type", "turnExpired"},
+        {"matchId", matchId},
+        {"playerId", playerId}
+    };
+    publishEvent(expired);
+    
+    // Demasiados turnos seguidos sin jugar: se considera abandono
+    if (++missedTurns[turnSeat] >= getTimeouts().maxMissedTurns && getTimeouts().maxMissedTurns > 0) {
+        endGame(seatToPlayer(1 - turnSeat), "inactivity");
+        return true;
+    }
+    
+    MatchEngine::Snapshot snapshot = engine->snapshot();
+    broadcastState(snapshot);
+    turnSeat = snapshot.currentSeat;
+    turnNumber = snapshot.turn;
+    turnDeadline = now + getTimeouts().turn;
+    scheduleTimer(turnDeadline);
+    return false;
+}
+
+void Match::sendState(int playerId) {
+    if (playerId == SPECTATORS) {
+        spectated = true;
+        send(SPECTATORS, stateMessage(SPECTATORS, stateHistory.back().second, stateVersion));
         return;
     }
     
-    // Verifica si el jugador es parte de este match
+    // El cliente pudo perder sus versiones (reconexión): hasta que confirme
+    // este estado completo no se le envían deltas
+    ackedVersion[playerToSeat(playerId)] = 0;
+    send(playerId, stateMessage(playerId, stateHistory.back().second, stateVersion));
+}
+
+void Match::ackState(int playerId, uint64_t version) {
     if (playerId != player1Id && playerId != player2Id) {
-        printf("Player %d is not part of match %d\n", playerId, matchId);
         return;
     }
+    std::atomic<uint64_t>& acked = ackedVersion[playerToSeat(playerId)];
+    uint64_t current = acked.load();
+    while (version > current && !acked.compare_exchange_weak(current, version)) {
+    }
+}
+
+void Match::setOutput(std::function<void(int playerId, const json& message)> newOutput) {
+    std::lock_guard<std::mutex> lock(mutex);
+    output = std::move(newOutput);
+}
+
+void Match::send(int playerId, const json& message) {
+    std::function<void(int, const json&)> currentOutput;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentOutput = output;
+    }
+    if (currentOutput) {
+        currentOutput(playerId, message);
+    }
+}
+
+json Match::stateMessage(int playerId, const MatchEngine::Snapshot& snapshot, uint64_t version) const {
+    // Los espectadores no ven ninguna mano: ambos jugadores van en "players"
+    bool spectator = playerId == SPECTATORS;
+    uint32_t mySeat = spectator ? 2 : playerToSeat(playerId);
+    json you;
+    json opponent;
+    json players = json::array();
+    for (const auto& player : snapshot.players) {
+        json view = {
+            {"playerId", seatToPlayer(player.seat)},
+            {"health", player.health},
+            {"actionsRemaining", player.actionsRemaining},
+            {"deckSize", player.deckSize},
+            {"alive", player.alive}
+        };
+        if (player.seat == mySeat) {
+            json hand = json::array();
+            for (const auto& card : player.hand) {
+                hand.push_back(cardJson(card));
+            }
+            view["hand"] = hand;
+            you = view;
+        } else if (spectator) {
+            view["handSize"] = player.hand.size();
+            players.push_back(view);
+        } else {
+            view["handSize"] = player.hand.size();
+            opponent = view;
+        }
+    }
     
-    // Mira si el jugador está conectado
-    if ((playerId == player1Id && player1Status == ConnectionStatus::DISCONNECTED) ||
-        (playerId == player2Id && player2Status == ConnectionStatus::DISCONNECTED)) {
-        printf("Ignoring action from disconnected player %d\n", playerId);
-        return;
+    json board = json::array();
+    for (const auto& cell : snapshot.board) {
+        board.push_back({
+            {"x", cell.x},
+            {"y", cell.y},
+            {"ownerId", seatToPlayer(cell.owner)},
+            {"card", cardJson(cell.card)}
+        });
     }
-    // Porcesar la accion 
-    printf("Player %d performed action '%s' in match %d\n", playerId, action.c_str(), matchId);
-    // poner verdadera logica de juego aqui**
+    
+    json message = {
+        {"type", "gameState"},
+        {"matchId", matchId},
+        {"version", version},
+        {"seq", eventSeq},
+        {"turn", snapshot.turn},
+        {"currentPlayerId", seatToPlayer(snapshot.currentSeat)},
+        {"phase", snapshot.phase},
+        {"gameOver", snapshot.gameOver},
+        {"board", board}
+    };
+    if (spectator) {
+        message["players"] = players;
+    } else {
+        message["you"] = you;
+        message["opponent"] = opponent;
+    }
+    return message;
+}
+
+json Match::deltaMessage(int playerId, const MatchEngine::Snapshot& base, uint64_t baseVersion,
+                        const MatchEngine::Snapshot& current, uint64_t version) const {
+    bool spectator = playerId == SPECTATORS;
+    uint32_t mySeat = spectator ? 2 : playerToSeat(playerId);
+    json players = json::array();
+    json message = {
+        {"type", "stateDelta"},
+        {"matchId", matchId},
+        {"version", version},
+        {"seq", eventSeq},
+        {"baseVersion", baseVersion},
+        {"turn", current.turn},
+        {"currentPlayerId", seatToPlayer(current.currentSeat)},
+        {"phase", current.phase},
+        {"gameOver", current.gameOver}
+    };
+    
+    // Jugadores: solo los campos que cambiaron
+    for (const auto& player : current.players) {
+        const MatchEngine::PlayerView* before = nullptr;
+        for (const auto& candidate : base.players) {
+            if (candidate.seat == player.seat) {
+                before = &candidate;
+            }
+        }
+        json view = json::object();
+        if (!before || before->health != player.health) view["health"] = player.health;
+        if (!before || before->actionsRemaining != player.actionsRemaining) view["actionsRemaining"] = player.actionsRemaining;
+        if (!before || before->deckSize != player.deckSize) view["deckSize"] = player.deckSize;
+        if (!before || before->alive != player.alive) view["alive"] = player.alive;
+        if (player.seat == mySeat) {
+            bool handChanged = !before || before->hand.size() != player.hand.size();
+            for (size_t i = 0; !handChanged && i < player.hand.size(); i++) {
+                handChanged = !sameCard(before->hand[i], player.hand[i]);
+            }
+            if (handChanged) {
+                json hand = json::array();
+                for (const auto& card : player.hand) {
+                    hand.push_back(cardJson(card));
+                }
+                view["hand"] = hand;
+            }
+        } else if (!before || before->hand.size() != player.hand.size()) {
+            view["handSize"] = player.hand.size();
+        }
+        if (view.empty()) {
+            continue;
+        }
+        if (spectator) {
+            view["playerId"] = seatToPlayer(player.seat);
+            players.push_back(view);
+        } else {
+            message[player.seat == mySeat ? "you" : "opponent"] = view;
+        }
+    }
+    if (!players.empty()) {
+        message["players"] = players;
+    }
+    
+    // Celdas: las que cambiaron o aparecieron, y las que quedaron vacías
+    json cells = json::array();
+    json removed = json::array();
+    std::vector<bool> seen(base.board.size(), false);
+    for (const auto& cell : current.board) {
+        bool changed = true;
+        for (size_t i = 0; i < base.board.size(); i++) {
+            const MatchEngine::CellView& before = base.board[i];
+            if (before.x == cell.x && before.y == cell.y) {
+                seen[i] = true;
+                changed = before.owner != cell.owner || !sameCard(before.card, cell.card);
+                break;
+            }
+        }
+        if (changed) {
+            cells.push_back({
+                {"x", cell.x},
+                {"y", cell.y},
+                {"ownerId", seatToPlayer(cell.owner)},
+                {"card", cardJson(cell.card)}
+            });
+        }
+    }
+    for (size_t i = 0; i < base.board.size(); i++) {
+        if (!seen[i]) {
+            removed.push_back({{"x", base.board[i].x}, {"y", base.board[i].y}});
+        }
+    }
+    if (!cells.empty()) message["cells"] = cells;
+    if (!removed.empty()) message["removed"] = removed;
+    return message;
 }
 
 bool Match::isActive() const {
@@ -73,16 +737,64 @@ std::pair<int, int> Match::getPlayerIds() const {
 bool Match::reconnectPlayer(int playerId) {
     std::lock_guard<std::mutex> lock(mutex);
     
+    // Una partida recién migrada espera que sus jugadores vuelvan aunque
+    // figuren conectados
+    if (playerId == player1Id || playerId == player2Id) {
+        disconnectDeadline[playerToSeat(playerId)] = Clock::time_point::max();
+    }
+    
     if (playerId == player1Id && player1Status == ConnectionStatus::DISCONNECTED) {
         player1Status = ConnectionStatus::CONNECTED;
-        printf("Player %d reconnected to match %d\n", playerId, matchId);
+        LOG_INFO("Player %d reconnected to match %d", playerId, matchId);
         return true;
     } 
     else if (playerId == player2Id && player2Status == ConnectionStatus::DISCONNECTED) {
         player2Status = ConnectionStatus::CONNECTED;
-        printf("Player %d reconnected to match %d\n", playerId, matchId);
+        LOG_INFO("Player %d reconnected to match %d", playerId, matchId);
         return true;
     }
     
     return false; // No se pudo reconectar (no era parte de la partida o ya estaba conectado)
 }
+
+void Match::addBusyTime(uint64_t ns) {
+    busyNs += ns;
+}
+
+void Match::sampleCost() {
+    // EWMA con alfa = 1/4: se adapta en pocos segundos sin saltar con un pico
+    std::lock_guard<std::mutex> lock(costMutex);
+    uint64_t previous = cost.load(std::memory_order_relaxed);
+    updateCost(previous - previous / 4 + busyNs / 4);
+    busyNs = 0;
+}
+
+uint64_t Match::getCost() const {
+    return cost.load(std::memory_order_relaxed);
+}
+
+void Match::setCost(uint64_t newCost) {
+    std::lock_guard<std::mutex> lock(costMutex);
+    updateCost(newCost);
+}
+
+void Match::updateCost(uint64_t newCost) {
+    uint64_t previous = cost.exchange(newCost, std::memory_order_relaxed);
+    if (costAccount) {
+        // Primero se suma: quien lee el total nunca ve un valor por debajo de cero
+        costAccount->total.fetch_add(newCost, std::memory_order_relaxed);
+        costAccount->total.fetch_sub(previous, std::memory_order_relaxed);
+    }
+}
+
+void Match::chargeTo(std::shared_ptr<CostAccount> account) {
+    std::lock_guard<std::mutex> lock(costMutex);
+    uint64_t current = cost.load(std::memory_order_relaxed);
+    if (account) {
+        account->total.fetch_add(current, std::memory_order_relaxed);
+    }
+    if (costAccount) {
+        costAccount->total.fetch_sub(current, std::memory_order_relaxed);
+    }
+    costAccount = std::move(account);
+}
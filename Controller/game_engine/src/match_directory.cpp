@@ -0,0 +1,89 @@
+#include "../libs/match_directory.hpp"
+#include "../libs/match.hpp"
+#include "../libs/game_thread.hpp"
+#include <mutex>
+
+std::shared_ptr<Match> MatchDirectory::find(int matchId) const {
+    const Shard& shard = shardFor(matchId);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    
+    auto it = shard.entries.find(matchId);
+    if (it != shard.entries.end()) {
+        return it->second.match;
+    }
+    return nullptr;
+}
+
+bool MatchDirectory::visit(int matchId, const std::function<void(const Entry&)>& callback) const {
+    const Shard& shard = shardFor(matchId);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    
+    auto it = shard.entries.find(matchId);
+    if (it == shard.entries.end()) {
+        return false;
+    }
+    callback(it->second);
+    return true;
+}
+
+bool MatchDirectory::insert(int matchId, std::shared_ptr<Match> match, std::shared_ptr<GameThread> thread) {
+    Shard& shard = shardFor(matchId);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    
+    bool inserted = shard.entries.emplace(matchId, Entry{std::move(match), std::move(thread)}).second;
+    if (inserted) {
+        count++;
+    }
+    return inserted;
+}
+
+bool MatchDirectory::reassign(int matchId, std::shared_ptr<GameThread> thread,
+                              const std::function<void(const Entry&)>& callback) {
+    Shard& shard = shardFor(matchId);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    
+    auto it = shard.entries.find(matchId);
+    if (it == shard.entries.end()) {
+        return false;
+    }
+    callback(it->second);
+    it->second.thread = std::move(thread);
+    return true;
+}
+
+std::shared_ptr<Match> MatchDirectory::erase(int matchId) {
+    Shard& shard = shardFor(matchId);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    
+    auto it = shard.entries.find(matchId);
+    if (it == shard.entries.end()) {
+        return nullptr;
+    }
+    std::shared_ptr<Match> match = std::move(it->second.match);
+    shard.entries.erase(it);
+    count--;
+    return match;
+}
+
+bool MatchDirectory::contains(int matchId) const {
+    const Shard& shard = shardFor(matchId);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    return shard.entries.find(matchId) != shard.entries.end();
+}
+
+void MatchDirectory::clear() {
+    for (auto& shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        count -= shard.entries.size();
+        shard.entries.clear();
+    }
+}
+
+void MatchDirectory::forEach(const std::function<void(int, const Entry&)>& callback) const {
+    for (const auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        for (const auto& pair : shard.entries) {
+            callback(pair.first, pair.second);
+        }
+    }
+}
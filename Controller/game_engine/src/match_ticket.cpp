@@ -0,0 +1,246 @@
+#include "../libs/match_ticket.hpp"
+#include "src/utils/Log.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+// Vigencia por defecto: cubre una partida larga; al reconectarse el jugador
+// pide uno nuevo al matchmaking (getActiveMatch)
+static const int DEFAULT_TTL_SECONDS = 3600;
+
+static int readEnvInt(const char* name, int defaultValue) {
+    const char* value = std::getenv(name);
+    if (value == nullptr) {
+        return defaultValue;
+    }
+    try {
+        return std::stoi(value);
+    } catch (const std::exception&) {
+        return defaultValue;
+    }
+}
+
+// SHA-256 (FIPS 180-4). Los tickets son cortos: dos o tres bloques por firma
+namespace {
+
+const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+struct Sha256 {
+    uint32_t state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    unsigned char block[64];
+    size_t blockLength = 0;
+    uint64_t totalLength = 0;
+
+    void update(const unsigned char* data, size_t length) {
+        totalLength += length;
+        while (length > 0) {
+            size_t chunk = std::min(length, sizeof(block) - blockLength);
+            std::memcpy(block + blockLength, data, chunk);
+            blockLength += chunk;
+            data += chunk;
+            length -= chunk;
+            if (blockLength == sizeof(block)) {
+                compress();
+                blockLength = 0;
+            }
+        }
+    }
+
+    void update(const std::string& data) {
+        update(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+    }
+
+    void finish(unsigned char digest[32]) {
+        uint64_t bits = totalLength * 8;
+        unsigned char pad = 0x80;
+        update(&pad, 1);
+        pad = 0;
+        while (blockLength != 56) {
+            update(&pad, 1);
+        }
+        unsigned char length[8];
+        for (int i = 0; i < 8; i++) {
+            length[i] = static_cast<unsigned char>(bits >> (56 - 8 * i));
+        }
+        update(length, 8);
+        for (int i = 0; i < 8; i++) {
+            digest[4 * i] = static_cast<unsigned char>(state[i] >> 24);
+            digest[4 * i + 1] = static_cast<unsigned char>(state[i] >> 16);
+            digest[4 * i + 2] = static_cast<unsigned char>(state[i] >> 8);
+            digest[4 * i + 3] = static_cast<unsigned char>(state[i]);
+        }
+    }
+
+    void compress() {
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = (uint32_t(block[4 * i]) << 24) | (uint32_t(block[4 * i + 1]) << 16) |
+                   (uint32_t(block[4 * i + 2]) << 8) | uint32_t(block[4 * i + 3]);
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+            uint32_t ch = (e & f) ^ (~e & g);
+            uint32_t t1 = h + s1 + ch + K[i] + w[i];
+            uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+            uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + maj;
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+};
+
+// Estados SHA-256 tras absorber la clave con ipad y opad: cada firma parte
+// de ellos y no vuelve a procesar la clave
+struct HmacKey {
+    Sha256 inner;
+    Sha256 outer;
+
+    explicit HmacKey(const std::string& key) {
+        unsigned char keyBlock[64] = {0};
+        if (key.size() > sizeof(keyBlock)) {
+            Sha256 hash;
+            hash.update(key);
+            hash.finish(keyBlock);
+        } else {
+            std::memcpy(keyBlock, key.data(), key.size());
+        }
+
+        unsigned char pad[64];
+        for (size_t i = 0; i < sizeof(pad); i++) {
+            pad[i] = keyBlock[i] ^ 0x36;
+        }
+        inner.update(pad, sizeof(pad));
+        for (size_t i = 0; i < sizeof(pad); i++) {
+            pad[i] = keyBlock[i] ^ 0x5c;
+        }
+        outer.update(pad, sizeof(pad));
+    }
+
+    std::string signHex(const std::string& message) const {
+        static const char* HEX = "0123456789abcdef";
+        unsigned char digest[32];
+        Sha256 hash = inner;
+        hash.update(message);
+        hash.finish(digest);
+
+        Sha256 outerHash = outer;
+        outerHash.update(digest, sizeof(digest));
+        outerHash.finish(digest);
+
+        std::string result;
+        result.reserve(64);
+        for (unsigned char byte : digest) {
+            result.push_back(HEX[byte >> 4]);
+            result.push_back(HEX[byte & 0xF]);
+        }
+        return result;
+    }
+};
+
+struct TicketConfig {
+    bool enabled;
+    HmacKey key;
+    int ttlSeconds;
+
+    explicit TicketConfig(const char* secret)
+        : enabled(secret != nullptr && secret[0] != '\0'),
+          key(secret != nullptr ? secret : ""),
+          ttlSeconds(readEnvInt("MATCH_TICKET_TTL_SECONDS", DEFAULT_TTL_SECONDS)) {
+        if (ttlSeconds <= 0) {
+            ttlSeconds = DEFAULT_TTL_SECONDS;
+        }
+        if (enabled && std::strlen(secret) < 32) {
+            LOG_WARN("MATCH_TICKET_SECRET is shorter than 32 characters");
+        }
+    }
+};
+
+const TicketConfig& getTicketConfig() {
+    static const TicketConfig config(std::getenv("MATCH_TICKET_SECRET"));
+    return config;
+}
+
+// Comparación en tiempo constante: no revela cuántos caracteres coinciden
+bool equalsConstantTime(const std::string& a, const std::string& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    unsigned char diff = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        diff |= static_cast<unsigned char>(a[i] ^ b[i]);
+    }
+    return diff == 0;
+}
+
+} // namespace
+
+bool MatchTicket::enabled() {
+    return getTicketConfig().enabled;
+}
+
+std::string MatchTicket::issue(int matchId, int playerId) {
+    const TicketConfig& config = getTicketConfig();
+    long long expiry = static_cast<long long>(std::time(nullptr)) + config.ttlSeconds;
+    std::string payload = std::to_string(matchId) + "." + std::to_string(playerId) + "." + std::to_string(expiry);
+    return payload + "." + config.key.signHex(payload);
+}
+
+bool MatchTicket::verify(const std::string& ticket, int matchId, int playerId) {
+    const TicketConfig& config = getTicketConfig();
+    size_t signatureStart = ticket.find_last_of('.');
+    if (!config.enabled || signatureStart == std::string::npos) {
+        return false;
+    }
+
+    // Los campos se comparan con los esperados antes de calcular la firma
+    std::string prefix = std::to_string(matchId) + "." + std::to_string(playerId) + ".";
+    if (signatureStart <= prefix.size() || ticket.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    long long expiry = 0;
+    for (size_t i = prefix.size(); i < signatureStart; i++) {
+        if (ticket[i] < '0' || ticket[i] > '9' || expiry > 1000000000000LL) {
+            return false;
+        }
+        expiry = expiry * 10 + (ticket[i] - '0');
+    }
+    if (expiry < static_cast<long long>(std::time(nullptr))) {
+        return false;
+    }
+
+    std::string payload = ticket.substr(0, signatureStart);
+    return equalsConstantTime(ticket.substr(signatureStart + 1), config.key.signHex(payload));
+}
+
+std::string MatchTicket::hmacSha256Hex(const std::string& key, const std::string& message) {
+    return HmacKey(key).signHex(message);
+}
@@ -1,17 +1,46 @@
 #include "../libs/matchmaking_handler.hpp"
 #include "../libs/orchestrator.hpp"
 #include "../libs/game_websocket_server.hpp"
+#include "../libs/game_gateway.hpp"
+#include "../libs/io_context_pool.hpp"
+#include "../libs/game_session.hpp"
+#include "../libs/match.hpp"
+#include "src/utils/Log.hpp"
+#include <algorithm>
 #include <thread>
+#include <random>
+#include <stdexcept>
 #include <cstring>  // Para strerror
 #include <cerrno>   // Para errno
+#include <climits>  // Para INT_MAX
 
 // Headers específicos según el sistema operativo
 #ifdef _WIN32
     #pragma comment(lib, "ws2_32.lib")
 #endif
 
-MatchmakingHandler::MatchmakingHandler() : serverSocket(INVALID_SOCKET), baseGamePort(10000), maxGamePort(11000), isRunning(false) {
-    printf("MatchmakingHandler created\n");
+// Si el origen no confirma una migración, el destino deja de retener las
+// acciones de los jugadores pasado este tiempo
+static const long MIGRATION_COMMIT_TIMEOUT_MS = 5000;
+
+// Token de reconexión para un jugador de una partida migrada
+static std::string generateToken() {
+    static const char* HEX = "0123456789abcdef";
+    std::random_device random;
+    std::string token;
+    for (int i = 0; i < 16; i++) {
+        unsigned int byte = random() & 0xFF;
+        token.push_back(HEX[byte >> 4]);
+        token.push_back(HEX[byte & 0xF]);
+    }
+    return token;
+}
+
+MatchmakingHandler::MatchmakingHandler()
+    : matchmakingTransport(std::make_shared<TcpControlTransport>(TcpControlTransport::HTTP)),
+      engineTransport(std::make_shared<TcpControlTransport>(TcpControlTransport::RAW_JSON)),
+      serverSocket(INVALID_SOCKET), baseGamePort(10000), maxGamePort(11000), isRunning(false) {
+    LOG_INFO("MatchmakingHandler created");
     
     // Leer configuración desde variables de entorno
     const char* basePort = std::getenv("BASE_GAME_PORT");
@@ -23,6 +52,66 @@ MatchmakingHandler::MatchmakingHandler() : serverSocket(INVALID_SOCKET), baseGam
     if (maxPort != nullptr && std::stoi(maxPort) > 0) {
         maxGamePort = std::stoi(maxPort);
     }
+    
+    const char* gwPort = std::getenv("GATEWAY_PORT");
+    if (gwPort != nullptr && std::stoi(gwPort) > 0) {
+        gatewayPort = std::stoi(gwPort);
+    }
+    
+    const char* standby = std::getenv("STANDBY_GAME_SERVERS");
+    if (standby != nullptr && std::stoi(standby) > 0) {
+        standbyTarget = std::stoi(standby);
+    }
+    
+    portAllocator.reset(new PortAllocator(baseGamePort, maxGamePort));
+    portAllocator->setProbe([this](int port) {
+        return isPortAvailable(port);
+    });
+    
+    const char* mmIp = std::getenv("MATCHMAKING_IP");
+    if (mmIp != nullptr) {
+        matchmakingIp = mmIp;
+    }
+    
+    const char* mmPort = std::getenv("MATCHMAKING_PORT");
+    if (mmPort != nullptr && std::stoi(mmPort) > 0) {
+        matchmakingPort = std::stoi(mmPort);
+    }
+    
+    const char* drainHost = std::getenv("DRAIN_TARGET_HOST");
+    if (drainHost != nullptr) {
+        drainTargetHost = drainHost;
+    }
+    
+    const char* drainPort = std::getenv("DRAIN_TARGET_PORT");
+    if (drainPort != nullptr && std::stoi(drainPort) > 0) {
+        drainTargetPort = std::stoi(drainPort);
+    }
+    
+    const char* bindIp = std::getenv("CONTROL_BIND_IP");
+    if (bindIp != nullptr && bindIp[0] != '\0') {
+        controlBindIp = bindIp;
+    }
+    
+    const char* targets = std::getenv("MIGRATION_TARGETS");
+    if (targets != nullptr) {
+        std::string list = targets;
+        size_t start = 0;
+        while (start <= list.size()) {
+            size_t end = list.find(',', start);
+            if (end == std::string::npos) {
+                end = list.size();
+            }
+            std::string target = list.substr(start, end - start);
+            if (!target.empty()) {
+                migrationTargets.push_back(target);
+            }
+            start = end + 1;
+        }
+        if (!migrationTargets.empty() && !drainTargetHost.empty() && drainTargetPort > 0) {
+            migrationTargets.push_back(drainTargetHost + ":" + std::to_string(drainTargetPort));
+        }
+    }
 }
 
 MatchmakingHandler::~MatchmakingHandler() {
@@ -36,15 +125,25 @@ void MatchmakingHandler::initialize() {
         return;
     }
     
-    printf("Initializing matchmaking handler\n");
-    printf("Game server port range: %d - %d\n", baseGamePort, maxGamePort);
+    LOG_INFO("Initializing matchmaking handler");
+    if (gatewayPort > 0) {
+        LOG_INFO("Game gateway mode: all matches on port %d", gatewayPort);
+    } else {
+        LOG_INFO("Game server port range: %d - %d", baseGamePort, maxGamePort);
+    }
     
     isRunning = true;
+    cleanupThread = std::thread(&MatchmakingHandler::cleanupLoop, this);
+    
+    if (gatewayPort == 0 && standbyTarget > 0) {
+        LOG_INFO("Keeping %d standby game servers", standbyTarget);
+        standbyThread = std::thread(&MatchmakingHandler::standbyLoop, this);
+    }
 }
 
 void MatchmakingHandler::run(int port) {
     if (!isRunning) {
-        printf("Handler not initialized\n");
+        LOG_WARN("Handler not initialized");
         return;
     }
     
@@ -52,9 +151,9 @@ void MatchmakingHandler::run(int port) {
     serverSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (serverSocket == INVALID_SOCKET) {
 #ifdef _WIN32
-        printf("Error creating matchmaking socket: %d\n", WSAGetLastError());
+        LOG_ERROR("Error creating matchmaking socket: %d", WSAGetLastError());
 #else
-        printf("Error creating matchmaking socket: %s\n", strerror(errno));
+        LOG_ERROR("Error creating matchmaking socket: %s", strerror(errno));
 #endif
         return;
     }
@@ -68,21 +167,25 @@ void MatchmakingHandler::run(int port) {
                    &opt,
 #endif
                    sizeof(opt)) < 0) {
-        printf("Error setting socket options\n");
+        LOG_ERROR("Error setting socket options");
     }
     
     // Configurar dirección del servidor
     sockaddr_in serverAddr;
     serverAddr.sin_family = AF_INET;
     serverAddr.sin_port = htons(port);
-    serverAddr.sin_addr.s_addr = INADDR_ANY;
+    if (inet_pton(AF_INET, controlBindIp.c_str(), &serverAddr.sin_addr) != 1) {
+        LOG_ERROR("Invalid CONTROL_BIND_IP: %s", controlBindIp.c_str());
+        closesocket(serverSocket);
+        return;
+    }
     
     // Bind del socket
     if (bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
 #ifdef _WIN32
-        printf("Matchmaking bind failed: %d\n", WSAGetLastError());
+        LOG_WARN("Matchmaking bind failed: %d", WSAGetLastError());
 #else
-        printf("Matchmaking bind failed: %s\n", strerror(errno));
+        LOG_WARN("Matchmaking bind failed: %s", strerror(errno));
 #endif
         closesocket(serverSocket);
         return;
@@ -91,15 +194,24 @@ void MatchmakingHandler::run(int port) {
     // Empezar a escuchar
     if (listen(serverSocket, SOMAXCONN) == SOCKET_ERROR) {
 #ifdef _WIN32
-        printf("Matchmaking listen failed: %d\n", WSAGetLastError());
+        LOG_WARN("Matchmaking listen failed: %d", WSAGetLastError());
 #else
-        printf("Matchmaking listen failed: %s\n", strerror(errno));
+        LOG_WARN("Matchmaking listen failed: %s", strerror(errno));
 #endif
         closesocket(serverSocket);
         return;
     }
     
-    printf("Matchmaking handler listening on port %d\n", port);
+    LOG_INFO("Matchmaking handler listening on %s:%d", controlBindIp.c_str(), port);
+    if (!ControlAuth::enabled()) {
+        LOG_WARN("CONTROL_SECRET not set: control requests are not authenticated");
+    }
+    
+    // Un proceso nuevo (p. ej. el que reemplaza a uno drenado) vuelve a
+    // habilitar la creación de partidas en el matchmaking
+    if (!draining) {
+        notifyMatchmakingCapacity(gatewayPort > 0 ? INT_MAX : portAllocator->getCapacity() - portAllocator->getUsedCount());
+    }
     
     // Loop principal para aceptar conexiones del matchmaking service
     while (isRunning) {
@@ -114,9 +226,9 @@ void MatchmakingHandler::run(int port) {
         if (clientSocket == INVALID_SOCKET) {
             if (isRunning) {
 #ifdef _WIN32
-                printf("Matchmaking accept failed: %d\n", WSAGetLastError());
+                LOG_WARN("Matchmaking accept failed: %d", WSAGetLastError());
 #else
-                printf("Matchmaking accept failed: %s\n", strerror(errno));
+                LOG_WARN("Matchmaking accept failed: %s", strerror(errno));
 #endif
             }
             continue;
@@ -137,7 +249,7 @@ void MatchmakingHandler::shutdown() {
         return;
     }
     
-    printf("Shutting down matchmaking handler\n");
+    LOG_INFO("Shutting down matchmaking handler");
     
     // Cerrar socket del servidor
     if (serverSocket != INVALID_SOCKET) {
@@ -145,49 +257,131 @@ void MatchmakingHandler::shutdown() {
         serverSocket = INVALID_SOCKET;
     }
     
-    isRunning = false;
+    {
+        std::lock_guard<std::mutex> serversLock(serversMutex);
+        isRunning = false;
+    }
+    cleanupCv.notify_all();
+    standbyCv.notify_all();
+    drainCv.notify_all();
+    if (drainThread.joinable()) {
+        drainThread.join();
+    }
+    if (cleanupThread.joinable()) {
+        cleanupThread.join();
+    }
+    if (standbyThread.joinable()) {
+        standbyThread.join();
+    }
+    
+    // Detener los servidores en espera
+    std::vector<GameServerInstance> standby;
+    {
+        std::lock_guard<std::mutex> serversLock(serversMutex);
+        standby.swap(standbyServers);
+    }
+    for (auto& instance : standby) {
+        discardGameServer(instance);
+    }
+    
+    // Detener los servidores de partidas que sigan vivos
+    std::vector<int> remaining;
+    {
+        std::lock_guard<std::mutex> serversLock(serversMutex);
+        for (const auto& pair : gameServers) {
+            remaining.push_back(pair.first);
+        }
+    }
+    for (int matchId : remaining) {
+        releaseGameServer(matchId);
+    }
 }
 
 void MatchmakingHandler::handleMatchmakingConnection(SOCKET clientSocket) {
-    char buffer[4096];
+    // Recibir mensaje del matchmaking service (o de otro proceso del motor)
+    std::string message = TcpControlTransport::receiveJson(clientSocket);
+    if (!message.empty()) {
+        json response;
+        try {
+            response = handleControlRequest(json::parse(message));
+        } catch (const std::exception& e) {
+            LOG_ERROR("Invalid matchmaking request: %s", e.what());
+            response = {
+                {"status", "error"},
+                {"message", e.what()}
+            };
+        }
+        TcpControlTransport::sendAll(clientSocket, response.dump());
+    }
+    
+    closesocket(clientSocket);
+}
+
+json MatchmakingHandler::handleControlRequest(const json& request) {
+    // Sin firma válida no se atiende nada (crear, migrar o drenar partidas)
+    std::string authError;
+    if (!ControlAuth::verify(request, authError)) {
+        LOG_WARN("Rejected control request: %s", authError.c_str());
+        return json{
+            {"status", "error"},
+            {"message", authError}
+        };
+    }
     
     try {
-        // Recibir mensaje del matchmaking service
-        int bytesReceived = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
-        if (bytesReceived > 0) {
-            buffer[bytesReceived] = '\0';
-            
-            // Parsear JSON request
-            json request = json::parse(buffer);
-            json response = processMatchmakingRequest(request);
-            
-            // Enviar respuesta
-            std::string responseStr = response.dump();
-            send(clientSocket, responseStr.c_str(), responseStr.length(), 0);
-        }
+        return processMatchmakingRequest(request);
     } catch (const std::exception& e) {
-        printf("Error handling matchmaking request: %s\n", e.what());
-        json errorResponse = {
+        LOG_ERROR("Error handling matchmaking request: %s", e.what());
+        return json{
             {"status", "error"},
             {"message", e.what()}
         };
-        std::string responseStr = errorResponse.dump();
-        send(clientSocket, responseStr.c_str(), responseStr.length(), 0);
     }
-    
-    closesocket(clientSocket);
+}
+
+void MatchmakingHandler::setTransport(std::shared_ptr<ControlTransport> transport) {
+    matchmakingTransport = transport;
+    engineTransport = transport;
 }
 
 json MatchmakingHandler::processMatchmakingRequest(const json& request) {
-    std::string action = request["action"];
+    std::string action = request.at("action");
     
     if (action == "createMatch") {
-        int matchId = request["matchId"];
-        std::vector<int> playerIds = request["playerIds"];
-        std::vector<std::string> playerIps = request["playerIps"];
-        std::vector<int> barajasIds = request["barajasIds"];  // IDs de las barajas
+        if (draining) {
+            return json{
+                {"status", "error"},
+                {"message", "Game engine is draining"},
+                {"capacity", 0}
+            };
+        }
+        int matchId = request.at("matchId");
+        std::vector<int> playerIds = request.at("playerIds");
+        std::vector<std::string> playerIps = request.at("playerIps");
+        std::vector<int> barajasIds = request.at("barajasIds");  // IDs de las barajas
         return createGameServer(matchId, playerIds, playerIps,barajasIds);
     }
+    else if (action == "stats") {
+        return getConnectionStats();
+    }
+    else if (action == "migrateMatch") {
+        return migrateMatch(request.at("matchId"), request.at("targetHost"), request.at("targetPort"));
+    }
+    else if (action == "importMatch") {
+        if (draining) {
+            return json{
+                {"status", "error"},
+                {"message", "Game engine is draining"}
+            };
+        }
+        return importMatch(request);
+    }
+    else if (action == "commitMigration") {
+        return commitMigration(request.at("matchId"), request.value("actions", json::array()));
+    }
+    else if (action == "drain") {
+        return startDrain(request.value("targetHost", ""), request.value("targetPort", 0));
+    }
     else {
         return json{
             {"status", "error"},
@@ -196,54 +390,109 @@ json MatchmakingHandler::processMatchmakingRequest(const json& request) {
     }
 }
 
+json MatchmakingHandler::getConnectionStats() {
+    json connections = json::array();
+    if (gatewayPort > 0) {
+        connections = GameGateway::getInstance().getQueueStats();
+    } else {
+        std::vector<std::shared_ptr<GameWebSocketServer>> servers;
+        {
+            std::lock_guard<std::mutex> lock(serversMutex);
+            for (const auto& pair : gameServers) {
+                servers.push_back(pair.second.server);
+            }
+        }
+        for (auto& server : servers) {
+            for (auto& connection : server->getQueueStats()) {
+                connections.push_back(connection);
+            }
+        }
+    }
+    
+    return json{
+        {"status", "success"},
+        {"connections", connections},
+        {"evictions", GameSession::getEvictionCount()},
+        {"matches", getHostedMatchCount()},
+        {"draining", draining.load()}
+    };
+}
+
 json MatchmakingHandler::createGameServer(int matchId, const std::vector<int>& playerIds, const std::vector<std::string>& playerIps,const std::vector<int>& barajasIds) {
-    printf("Creating game server for match %d\n", matchId);
-    printf("Player IDs: ");
+    std::string ids;
     for (int id : playerIds) {
-        printf("%d ", id);
+        ids += std::to_string(id) + " ";
     }
-    printf("\n");
-    
-    printf("Player IPs: ");
+    std::string ips;
     for (const auto& ip : playerIps) {
-        printf("[%s] ", ip.c_str());
+        ips += "[" + ip + "] ";
     }
-    printf("\n");
+    LOG_INFO("Creating game server for match %d (player IDs: %s, player IPs: %s)", matchId, ids.c_str(), ips.c_str());
     
-    // Encontrar puerto disponible
-    int gamePort = findAvailablePort();
-    if (gamePort == -1) {
+    return hostMatch(matchId, playerIps, [&]() {
+        return Orchestrator::getInstance().createMatchWithId(matchId, playerIds[0], playerIds[1], barajasIds);
+    });
+}
+
+json MatchmakingHandler::hostMatch(int matchId, const std::vector<std::string>& playerIps, const std::function<bool()>& registerMatch) {
+    // Modo gateway: solo se registra la sesión, sin servidor ni puerto propio
+    if (gatewayPort > 0) {
+        if (!registerMatch()) {
+            return json{
+                {"status", "error"},
+                {"message", "Failed to create match in orchestrator"}
+            };
+        }
+        
+        GameGateway::getInstance().createSession(matchId, playerIps);
+        LOG_INFO("Game session created for match %d on gateway port %d", matchId, gatewayPort);
+        
         return json{
-            {"status", "error"},
-            {"message", "No available ports for game server"}
+            {"status", "success"},
+            {"matchId", matchId},
+            {"serverIp", "127.0.0.1"},  // O la IP real del servidor
+            {"serverPort", gatewayPort}
         };
     }
     
+    auto startTime = std::chrono::steady_clock::now();
+    
+    // Usar un servidor en espera si hay; si no, crear uno nuevo
+    GameServerInstance instance;
+    bool fromStandby = takeStandbyServer(instance);
+    if (fromStandby) {
+        instance.server->bindMatch(matchId, playerIps);
+    } else {
+        // Crear nuevo GameWebSocketServer específico para esta partida
+        LOG_DEBUG("Creating GameWebSocketServer for match %d", matchId);
+        
+        if (!launchGameServer(instance, matchId, playerIps)) {//ahora pasar barajas aqui
+            return json{
+                {"status", "error"},
+                {"message", "No available ports for game server"}
+            };
+        }
+    }
+    int gamePort = instance.port;
+    
     // Crear la partida en el orchestrator con el matchId específico
-    if (!Orchestrator::getInstance().createMatchWithId(matchId, playerIds[0], playerIds[1])) {
+    if (!registerMatch()) {
+        discardGameServer(instance);
         return json{
             {"status", "error"},
             {"message", "Failed to create match in orchestrator"}
         };
     }
     
-    // Crear nuevo GameWebSocketServer específico para esta partida
-    printf("Creating GameWebSocketServer with allowed IPs: ");
-    for (const auto& ip : playerIps) {
-        printf("[%s] ", ip.c_str());
+    // Se guarda para liberarlo al terminar la partida
+    {
+        std::lock_guard<std::mutex> lock(serversMutex);
+        gameServers[matchId] = std::move(instance);
     }
-    printf("\n");
-    
-    auto gameServer = std::make_shared<GameWebSocketServer>(matchId, playerIps);//ahora pasar barajas aqui
-    gameServer->initialize();
-    
-    // Iniciar el servidor en un hilo separado
-    std::thread gameThread([gameServer, gamePort]() {
-        gameServer->run(gamePort);
-    });
-    gameThread.detach();
     
-    printf("Game server created for match %d on port %d\n", matchId, gamePort);
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    LOG_INFO("Game server created for match %d on port %d (%s, %.3f ms)",
+             matchId, gamePort, fromStandby ? "standby" : "cold", elapsedMs);
     
     return json{
         {"status", "success"},
@@ -253,13 +502,222 @@ json MatchmakingHandler::createGameServer(int matchId, const std::vector<int>& p
     };
 }
 
-int MatchmakingHandler::findAvailablePort() {
-    for (int port = baseGamePort; port <= maxGamePort; port++) {
-        if (isPortAvailable(port)) {
+std::shared_ptr<GameSession> MatchmakingHandler::findSession(int matchId) {
+    if (gatewayPort > 0) {
+        return GameGateway::getInstance().getSession(matchId);
+    }
+    std::lock_guard<std::mutex> lock(serversMutex);
+    auto it = gameServers.find(matchId);
+    return it != gameServers.end() ? it->second.server->getSession() : nullptr;
+}
+
+json MatchmakingHandler::migrateMatch(int matchId, const std::string& targetHost, int targetPort) {
+    auto startTime = std::chrono::steady_clock::now();
+    
+    if (!isMigrationTargetAllowed(targetHost, targetPort)) {
+        LOG_WARN("Migration of match %d to %s:%d refused: not in MIGRATION_TARGETS", matchId, targetHost.c_str(), targetPort);
+        return json{
+            {"status", "error"},
+            {"message", "Migration target not allowed"}
+        };
+    }
+    
+    auto session = findSession(matchId);
+    if (!session) {
+        return json{
+            {"status", "error"},
+            {"message", "Match not found"}
+        };
+    }
+    
+    // Desde aquí las acciones de los jugadores esperan en la sesión; la
+    // partida sale de su GameThread después de lo que ya tenía encolado
+    session->holdActions();
+    auto match = Orchestrator::getInstance().detachMatch(matchId);
+    if (!match) {
+        session->releaseActions(json::array());
+        return json{
+            {"status", "error"},
+            {"message", "Match not found"}
+        };
+    }
+    
+    json response;
+    try {
+        response = sendControlRequest(targetHost, targetPort, {
+            {"action", "importMatch"},
+            {"match", match->exportState()},
+            {"playerIps", session->getAllowedIps()}
+        });
+    } catch (const std::exception& e) {
+        response = {{"status", "error"}, {"message", e.what()}};
+    }
+    
+    // Antes de redirigir a nadie: la respuesta trae un puerto válido y un
+    // token para cada jugador; si no, la migración falla. Nada de lo que
+    // responda el destino puede lanzar aquí con la partida fuera de su hilo
+    std::string error = "unknown error";
+    int serverPort = 0;
+    json tokens;
+    if (!response.is_object()) {
+        error = "Invalid importMatch response";
+    } else if (response.find("status") == response.end() || response["status"] != "success") {
+        auto message = response.find("message");
+        if (message != response.end() && message->is_string()) {
+            error = message->get<std::string>();
+        }
+    } else {
+        auto port = response.find("serverPort");
+        auto tokenList = response.find("tokens");
+        if (port != response.end() && port->is_number_integer() &&
+            port->get<long long>() > 0 && port->get<long long>() <= 65535) {
+            serverPort = port->get<int>();
+        }
+        if (tokenList != response.end() && tokenList->is_object()) {
+            auto players = match->getPlayerIds();
+            for (int playerId : {players.first, players.second}) {
+                auto token = tokenList->find(std::to_string(playerId));
+                if (token == tokenList->end() || !token->is_string()) {
+                    serverPort = 0;
+                }
+            }
+            tokens = *tokenList;
+        }
+        if (serverPort == 0 || tokens.is_null()) {
+            error = "Invalid importMatch response";
+            serverPort = 0;
+        }
+    }
+    
+    if (serverPort == 0) {
+        // La partida sigue en este proceso con lo que se retuvo
+        Orchestrator::getInstance().attachMatch(match);
+        session->releaseActions(json::array());
+        LOG_WARN("Migration of match %d to %s:%d failed: %s", matchId, targetHost.c_str(), targetPort, error.c_str());
+        return json{
+            {"status", "error"},
+            {"message", "Migration failed: " + error}
+        };
+    }
+    
+    session->redirect(targetHost, serverPort, tokens);
+    
+    // Lo que llegó durante el corte se aplica en el destino antes que las
+    // acciones de los clientes ya reconectados allí
+    try {
+        sendControlRequest(targetHost, targetPort, {
+            {"action", "commitMigration"},
+            {"matchId", matchId},
+            {"actions", session->takeHeldActions()}
+        });
+    } catch (const std::exception& e) {
+        LOG_WARN("Could not commit migration of match %d: %s (target releases actions by timeout)", matchId, e.what());
+    }
+    
+    double pauseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    LOG_INFO("Match %d migrated to %s:%d (pause %.2f ms)", matchId, targetHost.c_str(), serverPort, pauseMs);
+    
+    // Sin avisar fin de partida: sigue en el destino, que avisará al terminar
+    releaseGameServer(matchId);
+    drainCv.notify_all();
+    
+    return json{
+        {"status", "success"},
+        {"matchId", matchId},
+        {"serverIp", targetHost},
+        {"serverPort", serverPort},
+        {"pauseMs", pauseMs}
+    };
+}
+
+json MatchmakingHandler::importMatch(const json& request) {
+    auto startTime = std::chrono::steady_clock::now();
+    
+    // Lanza si el estado no se puede reconstruir (p. ej. otro decks.json)
+    auto match = std::make_shared<Match>(request.at("match"));
+    int matchId = match->getMatchId();
+    std::vector<std::string> playerIps = request.value("playerIps", std::vector<std::string>());
+    
+    json response = hostMatch(matchId, playerIps, [&match]() {
+        return Orchestrator::getInstance().attachMatch(match);
+    });
+    if (response["status"] != "success") {
+        return response;
+    }
+    
+    // Cada jugador vuelve con su token; sus acciones esperan la confirmación del origen
+    std::unordered_map<int, std::string> tokens;
+    json tokenList = json::object();
+    auto players = match->getPlayerIds();
+    for (int playerId : {players.first, players.second}) {
+        tokens[playerId] = generateToken();
+        tokenList[std::to_string(playerId)] = tokens[playerId];
+    }
+    auto session = findSession(matchId);
+    if (session) {
+        session->setReconnectTokens(tokens);
+        session->holdActions(MIGRATION_COMMIT_TIMEOUT_MS);
+    }
+    
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    LOG_INFO("Match %d imported on port %d (%.3f ms)", matchId, response["serverPort"].get<int>(), elapsedMs);
+    
+    response["tokens"] = tokenList;
+    return response;
+}
+
+json MatchmakingHandler::commitMigration(int matchId, const json& actions) {
+    auto session = findSession(matchId);
+    if (!session) {
+        return json{
+            {"status", "error"},
+            {"message", "Match not found"}
+        };
+    }
+    session->releaseActions(actions);
+    return json{
+        {"status", "success"},
+        {"matchId", matchId}
+    };
+}
+
+json MatchmakingHandler::sendControlRequest(const std::string& host, int port, const json& request) {
+    json signedRequest = request;
+    ControlAuth::sign(signedRequest);
+    return engineTransport->request(host, port, signedRequest);
+}
+
+bool MatchmakingHandler::isMigrationTargetAllowed(const std::string& host, int port) const {
+    if (migrationTargets.empty()) {
+        return true;
+    }
+    std::string target = host + ":" + std::to_string(port);
+    return std::find(migrationTargets.begin(), migrationTargets.end(), target) != migrationTargets.end();
+}
+
+int MatchmakingHandler::listenOnAvailablePort(GameWebSocketServer& gameServer) {
+    while (true) {
+        int port = portAllocator->allocate();
+        if (port == -1) {
+            return -1;  // No hay puertos disponibles
+        }
+        
+        websocketpp::lib::error_code ec;
+        if (gameServer.listen(static_cast<uint16_t>(port), ec)) {
             return port;
         }
+        
+        // websocketpp no siempre conserva el error original de bind: solo en este
+        // caso se sondea el puerto para distinguir EADDRINUSE de otros fallos
+        if (!isPortAvailable(port)) {
+            // Otro proceso tiene el puerto: apartarlo y probar el siguiente
+            portAllocator->markInUseExternally(port);
+            continue;
+        }
+        
+        portAllocator->release(port);
+        return -1;
     }
-    return -1;  // No hay puertos disponibles
 }
 
 bool MatchmakingHandler::isPortAvailable(int port) {
@@ -278,3 +736,284 @@ bool MatchmakingHandler::isPortAvailable(int port) {
     
     return available;
 }
+
+void MatchmakingHandler::onMatchEnded(int matchId) {
+    {
+        std::lock_guard<std::mutex> lock(serversMutex);
+        endedMatches.push(matchId);
+        pendingReleases++;
+    }
+    cleanupCv.notify_one();
+}
+
+void MatchmakingHandler::cleanupLoop() {
+    while (true) {
+        int matchId;
+        {
+            std::unique_lock<std::mutex> lock(serversMutex);
+            cleanupCv.wait_for(lock, std::chrono::seconds(1), [this] {
+                return !endedMatches.empty() || !isRunning;
+            });
+            if (endedMatches.empty()) {
+                if (!isRunning) {
+                    break;
+                }
+                matchId = -1;
+            } else {
+                matchId = endedMatches.front();
+                endedMatches.pop();
+            }
+        }
+        
+        sweepRetiringServers();
+        if (matchId == -1) {
+            continue;
+        }
+        
+        releaseGameServer(matchId);
+        notifyMatchmakingMatchEnded(matchId);
+        
+        {
+            std::lock_guard<std::mutex> lock(serversMutex);
+            pendingReleases--;
+        }
+        drainCv.notify_all();
+    }
+}
+
+void MatchmakingHandler::releaseGameServer(int matchId) {
+    if (gatewayPort > 0) {
+        GameGateway::getInstance().removeSession(matchId);
+        LOG_INFO("Game session for match %d released", matchId);
+        return;
+    }
+    
+    GameServerInstance instance;
+    {
+        std::lock_guard<std::mutex> lock(serversMutex);
+        auto it = gameServers.find(matchId);
+        if (it == gameServers.end()) {
+            return;
+        }
+        instance = std::move(it->second);
+        gameServers.erase(it);
+    }
+    
+    discardGameServer(instance);
+    
+    LOG_INFO("Game server for match %d released (port %d)", matchId, instance.port);
+}
+
+void MatchmakingHandler::sweepRetiringServers() {
+    std::vector<std::shared_ptr<GameWebSocketServer>> idle;
+    {
+        std::lock_guard<std::mutex> lock(serversMutex);
+        auto now = std::chrono::steady_clock::now();
+        auto it = retiringServers.begin();
+        while (it != retiringServers.end()) {
+            // Margen para que se ejecuten los handlers de accept cancelados
+            if (now - it->stoppedAt >= std::chrono::seconds(1) && it->server->isIdle()) {
+                idle.push_back(std::move(it->server));
+                it = retiringServers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    
+    for (auto& server : idle) {
+        GameWebSocketServer::retire(std::move(server));
+    }
+}
+
+void MatchmakingHandler::notifyMatchmakingMatchEnded(int matchId) {
+    if (sendToMatchmaking({{"action", "matchEnded"}, {"matchId", matchId}})) {
+        LOG_INFO("Matchmaking notified: match %d ended", matchId);
+    } else {
+        LOG_WARN("Failed to notify matchmaking about end of match %d", matchId);
+    }
+}
+
+void MatchmakingHandler::notifyMatchmakingCapacity(int capacity) {
+    if (sendToMatchmaking({{"action", "engineCapacity"}, {"capacity", capacity}})) {
+        LOG_INFO("Matchmaking notified: engine capacity %d", capacity);
+    } else {
+        LOG_WARN("Failed to notify matchmaking about engine capacity %d", capacity);
+    }
+}
+
+bool MatchmakingHandler::sendToMatchmaking(const json& body) {
+    // Se espera la respuesta para no cerrar antes de que se procese
+    try {
+        matchmakingTransport->request(matchmakingIp, matchmakingPort, body);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_DEBUG("Matchmaking request failed: %s", e.what());
+        return false;
+    }
+}
+
+size_t MatchmakingHandler::getHostedMatchCount() {
+    if (gatewayPort > 0) {
+        return GameGateway::getInstance().getSessionCount();
+    }
+    std::lock_guard<std::mutex> lock(serversMutex);
+    return gameServers.size();
+}
+
+json MatchmakingHandler::startDrain(const std::string& targetHost, int targetPort) {
+    std::string host = targetHost.empty() ? drainTargetHost : targetHost;
+    int port = targetHost.empty() ? drainTargetPort : targetPort;
+    if (!host.empty() && !isMigrationTargetAllowed(host, port)) {
+        return json{
+            {"status", "error"},
+            {"message", "Migration target not allowed"}
+        };
+    }
+    
+    bool wasDraining = draining.exchange(true);
+    if (!wasDraining) {
+        LOG_INFO("Draining game engine: %zu matches hosted%s", getHostedMatchCount(),
+                 host.empty() ? ", waiting for them to end" : "");
+        
+        // El pool en espera ya no hace falta (standbyLoop no lo repone)
+        std::vector<GameServerInstance> standby;
+        {
+            std::lock_guard<std::mutex> lock(serversMutex);
+            standby.swap(standbyServers);
+        }
+        for (auto& instance : standby) {
+            discardGameServer(instance);
+        }
+        
+        notifyMatchmakingCapacity(0);
+        
+        if (!host.empty() && port > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (isRunning && !drainThread.joinable()) {
+                drainThread = std::thread(&MatchmakingHandler::drainLoop, this, host, port);
+            }
+        }
+    }
+    
+    return json{
+        {"status", "success"},
+        {"draining", true},
+        {"matches", getHostedMatchCount()},
+        {"targetHost", host},
+        {"targetPort", port}
+    };
+}
+
+void MatchmakingHandler::drainLoop(std::string targetHost, int targetPort) {
+    for (int matchId : Orchestrator::getInstance().getMatchIds()) {
+        if (!isRunning) {
+            break;
+        }
+        json result = migrateMatch(matchId, targetHost, targetPort);
+        if (result["status"] != "success") {
+            // Se queda aquí hasta que termine
+            LOG_WARN("Drain: match %d stays until it ends (%s)", matchId,
+                     result.value("message", "unknown error").c_str());
+        }
+    }
+}
+
+bool MatchmakingHandler::waitUntilDrained(std::chrono::steady_clock::time_point deadline, const std::function<bool()>& abort) {
+    while (true) {
+        if (getHostedMatchCount() == 0) {
+            std::lock_guard<std::mutex> lock(serversMutex);
+            if (pendingReleases == 0) {
+                return true;
+            }
+        }
+        if (std::chrono::steady_clock::now() >= deadline || (abort && abort())) {
+            return false;
+        }
+        // Las señales no despiertan a la condición: se revisa cada 200 ms
+        std::unique_lock<std::mutex> lock(serversMutex);
+        drainCv.wait_for(lock, std::chrono::milliseconds(200));
+    }
+}
+
+bool MatchmakingHandler::launchGameServer(GameServerInstance& instance, int matchId, const std::vector<std::string>& allowedIps) {
+    auto gameServer = matchId >= 0
+        ? std::make_shared<GameWebSocketServer>(matchId, allowedIps)
+        : std::make_shared<GameWebSocketServer>();
+    gameServer->initialize();
+    
+    // Reservar puerto y escuchar antes de anunciar la partida (sin carrera sondeo/listen)
+    int gamePort = listenOnAvailablePort(*gameServer);
+    if (gamePort == -1) {
+        return false;
+    }
+    
+    instance.server = gameServer;
+    instance.port = gamePort;
+    
+    // Con el io_service compartido el servidor ya atiende conexiones; si no, su
+    // bucle corre en un hilo separado
+    if (!IoContextPool::getInstance().isRunning()) {
+        instance.thread = std::thread([gameServer]() {
+            gameServer->run();
+        });
+    }
+    return true;
+}
+
+void MatchmakingHandler::discardGameServer(GameServerInstance& instance) {
+    if (!instance.server) {
+        return;
+    }
+    
+    // Detener el bucle de eventos y esperar su hilo; stop() cierra el acceptor,
+    // así que el puerto se puede volver a asignar
+    instance.server->stop();
+    if (instance.thread.joinable()) {
+        instance.thread.join();
+    } else {
+        // io_service compartido: se destruye cuando sus conexiones terminen de cerrar
+        std::lock_guard<std::mutex> lock(serversMutex);
+        retiringServers.push_back({instance.server, std::chrono::steady_clock::now()});
+    }
+    instance.server.reset();
+    portAllocator->release(instance.port);
+}
+
+bool MatchmakingHandler::takeStandbyServer(GameServerInstance& instance) {
+    std::lock_guard<std::mutex> lock(serversMutex);
+    if (standbyServers.empty()) {
+        return false;
+    }
+    instance = std::move(standbyServers.back());
+    standbyServers.pop_back();
+    
+    // Reponer el pool en segundo plano
+    standbyCv.notify_one();
+    return true;
+}
+
+void MatchmakingHandler::standbyLoop() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(serversMutex);
+            standbyCv.wait(lock, [this] {
+                return !isRunning || (!draining && static_cast<int>(standbyServers.size()) < standbyTarget);
+            });
+            if (!isRunning) {
+                break;
+            }
+        }
+        
+        GameServerInstance instance;
+        if (!launchGameServer(instance, -1, {})) {
+            // Sin puertos libres: reintentar cuando termine alguna partida
+            std::unique_lock<std::mutex> lock(serversMutex);
+            standbyCv.wait_for(lock, std::chrono::seconds(1), [this] { return !isRunning; });
+            continue;
+        }
+        
+        std::lock_guard<std::mutex> lock(serversMutex);
+        standbyServers.push_back(std::move(instance));
+    }
+}
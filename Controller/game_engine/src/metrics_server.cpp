@@ -0,0 +1,104 @@
+#include "../libs/metrics_server.hpp"
+#include "../libs/latency_metrics.hpp"
+#include "../libs/orchestrator.hpp"
+#include "../libs/game_session.hpp"
+#include "../libs/heartbeat_monitor.hpp"
+#include "../libs/io_context_pool.hpp"
+#include "src/utils/Log.hpp"
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start(uint16_t port) {
+    if (running) return true;
+
+    IoContextPool& pool = IoContextPool::getInstance();
+    sharedIo = pool.isRunning();
+    if (sharedIo) {
+        server.init_asio(&pool.getIoService());
+    } else {
+        server.init_asio();
+    }
+    server.set_http_handler(std::bind(&MetricsServer::onHttp, this, std::placeholders::_1));
+    server.set_validate_handler([](connection_hdl) {
+        return false;
+    });
+    server.clear_access_channels(websocketpp::log::alevel::all);
+    server.clear_error_channels(websocketpp::log::elevel::all);
+    server.set_reuse_addr(true);
+
+    websocketpp::lib::error_code ec;
+    server.listen(port, ec);
+    if (!ec) {
+        server.start_accept(ec);
+    }
+    if (ec) {
+        LOG_WARN("Metrics endpoint cannot listen on port %d: %s", port, ec.message().c_str());
+        return false;
+    }
+    running = true;
+    if (!sharedIo) {
+        worker = std::thread([this]() {
+            server.run();
+        });
+    }
+    LOG_INFO("Metrics endpoint listening on port %d (/metrics)", port);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!running.exchange(false)) return;
+
+    websocketpp::lib::error_code ec;
+    server.stop_listening(ec);
+    // El io_service compartido lo detiene el IoContextPool
+    if (!sharedIo) {
+        server.stop();
+    }
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void MetricsServer::onHttp(connection_hdl hdl) {
+    HttpServer::connection_ptr con = server.get_con_from_hdl(hdl);
+    std::string resource = con->get_resource();
+    // Sin parámetros: los scrapers a veces añaden ?...
+    resource = resource.substr(0, resource.find('?'));
+
+    if (resource == "/metrics") {
+        con->set_status(websocketpp::http::status_code::ok);
+        con->append_header("Content-Type", "text/plain; version=0.0.4");
+        con->set_body(renderPrometheus());
+    } else if (resource == "/metrics/traces") {
+        json body = {
+            {"summary", LatencyMetrics::getInstance().getSummary()},
+            {"traces", LatencyMetrics::getInstance().getSampledTraces()}
+        };
+        con->set_status(websocketpp::http::status_code::ok);
+        con->append_header("Content-Type", "application/json");
+        con->set_body(body.dump());
+    } else {
+        con->set_status(websocketpp::http::status_code::not_found);
+        con->set_body("Not found\n");
+    }
+}
+
+std::string MetricsServer::renderPrometheus() {
+    std::string out;
+    out.reserve(16 * 1024);
+    LatencyMetrics::getInstance().appendPrometheus(out);
+    HeartbeatMonitor::getInstance().appendPrometheus(out);
+
+    out += "# HELP game_matches Matches hosted by this engine\n";
+    out += "# TYPE game_matches gauge\n";
+    out += "game_matches " + std::to_string(Orchestrator::getInstance().getMatchCount()) + "\n";
+    out += "# HELP game_send_queue_evictions_total Connections closed for falling behind their send queue\n";
+    out += "# TYPE game_send_queue_evictions_total counter\n";
+    out += "game_send_queue_evictions_total " + std::to_string(GameSession::getEvictionCount()) + "\n";
+    out += "# HELP game_log_dropped_total Log messages dropped because a thread's log buffer was full\n";
+    out += "# TYPE game_log_dropped_total counter\n";
+    out += "game_log_dropped_total " + std::to_string(Logger::getInstance().getDroppedCount()) + "\n";
+    return out;
+}
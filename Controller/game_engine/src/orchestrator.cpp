@@ -1,15 +1,33 @@
 #include "../libs/orchestrator.hpp"
 #include "../libs/game_thread.hpp"
 #include "../libs/match.hpp"
+#include "src/utils/Log.hpp"
 #include <cstdlib> // Para getenv
+#include <algorithm>
+#include <future>
 
 Orchestrator::Orchestrator() : maxMatchesPerThread(5), isRunning(false) {
-    printf("Orchestrator created\n");
+    LOG_INFO("Orchestrator created");
     const char* envValue = std::getenv("MAX_MATCHES_PER_THREAD");
     if (envValue != nullptr && std::stoi(envValue) > 0) {
         maxMatchesPerThread = std::stoi(envValue);
         //printf("MAX_MATCHES_PER_THREAD=%d\n", maxMatchesPerThread);
     }
+
+    // Como mucho un hilo de juego por núcleo
+    int cores = std::max(1u, std::thread::hardware_concurrency());
+    maxThreads = cores;
+    envValue = std::getenv("MAX_THREADS");
+    if (envValue != nullptr && std::stoi(envValue) > 0) {
+        maxThreads = std::min(std::stoi(envValue), cores);
+    }
+
+    // Por defecto un hilo acepta partidas nuevas hasta ocupar medio núcleo
+    threadBudgetNs = 500ULL * 1000000ULL;
+    envValue = std::getenv("GAME_THREAD_BUDGET_MS");
+    if (envValue != nullptr && std::stoi(envValue) > 0) {
+        threadBudgetNs = std::stoull(envValue) * 1000000ULL;
+    }
 }
 Orchestrator::~Orchestrator() {
     shutdown();
@@ -22,55 +40,62 @@ void Orchestrator::initialize() {
         return;
     }
     
-    printf("Initializing orchestrator\n");
+    LOG_INFO("Initializing orchestrator");
     isRunning = true;
 }
 
 void Orchestrator::shutdown() {
-    std::lock_guard<std::mutex> lock(mutex);
-    
-    if (!isRunning) {
-        return;
-    }
-    
-    printf("Shutting down orchestrator\n");
-    // Detiene threads
-    for (auto& pair : threads) {
-        pair.second->stop();
+    std::unordered_map<int, std::shared_ptr<GameThread>> stoppedThreads;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        
+        if (!isRunning) {
+            return;
+        }
+        
+        LOG_INFO("Shutting down orchestrator");
+        // Detiene threads
+        for (auto& pair : threads) {
+            pair.second->stop();
+        }
+        // borrar todas las estructuras de datos
+        waitingPlayers.clear();
+        matches.clear();
+        threadMatches.clear();
+        stoppedThreads.swap(threads);
+        playerToMatch.clear();
+        
+        isRunning = false;
     }
-    // borrar todas las estructuras de datos
-    waitingPlayers.clear();
-    matches.clear();
-    threads.clear();
-    
-    isRunning = false;
+    // Los threads se destruyen (join) fuera del lock: su worker puede estar
+    // esperando el lock en notifyMatchEnded o rebalance
+    stoppedThreads.clear();
 }
 
 int Orchestrator::connectPlayer(int playerId) {
     std::lock_guard<std::mutex> lock(mutex);
     
     if (!isRunning) {
-        printf("Orchestrator not running, can't connect player\n");
+        LOG_WARN("Orchestrator not running, can't connect player");
         return -1;
     }
     
-    printf("Player %d connected\n", playerId);
+    LOG_INFO("Player %d connected", playerId);
     
     // Primero comprobar si el jugador estaba en una partida existente
-    for (auto& pair : matches) {
-        auto matchId = pair.first;
-        auto match = pair.second;
-        auto players = match->getPlayerIds();
-        
-        if ((players.first == playerId || players.second == playerId) && match->isActive()) {
-            // Buscar el thread que maneja este match
-            for (auto& threadPair : threads) {
-                if (threadPair.second->getActiveMatchCount() > 0) {
-                    threadPair.second->handlePlayerReconnect(matchId, playerId);
-                    //printf("Player %d reconnecting to existing match %d in thread %d\n", playerId, matchId, threadPair.first);
-                    return matchId;  // Devolver el ID de la partida existente
-                }
+    auto playerIt = playerToMatch.find(playerId);
+    if (playerIt != playerToMatch.end()) {
+        int matchId = playerIt->second;
+        bool reconnecting = false;
+        matches.visit(matchId, [&](const MatchDirectory::Entry& entry) {
+            if (entry.match->isActive()) {
+                // Reconectar en el thread que maneja este match
+                entry.thread->handlePlayerReconnect(matchId, playerId);
+                reconnecting = true;
             }
+        });
+        if (reconnecting) {
+            return matchId;  // Devolver el ID de la partida existente
         }
     }
     
@@ -99,7 +124,7 @@ void Orchestrator::disconnectPlayer(int playerId) {
         return;
     }
     
-    printf("Player %d disconnected\n", playerId);
+    LOG_INFO("Player %d disconnected", playerId);
     // ver si el jugador está en la lista de espera
     auto it = std::find(waitingPlayers.begin(), waitingPlayers.end(), playerId);
     if (it != waitingPlayers.end()) {
@@ -107,17 +132,55 @@ void Orchestrator::disconnectPlayer(int playerId) {
         return;
     }
     
-    // ver si el jugador está en un match activo
-    for (auto& pair : matches) {
-        auto matchId = pair.first;
-        auto match = pair.second;
-        auto players = match->getPlayerIds();
-        
-        if (players.first == playerId || players.second == playerId) {
-            // Buscar el thread que maneja este match
-            for (auto& threadPair : threads) {
-                threadPair.second->handlePlayerDisconnect(matchId, playerId);
-            }
+    // ver si el jugador está en un match activo y avisar solo a su thread
+    auto playerIt = playerToMatch.find(playerId);
+    if (playerIt != playerToMatch.end()) {
+        int matchId = playerIt->second;
+        matches.visit(matchId, [&](const MatchDirectory::Entry& entry) {
+            entry.thread->handlePlayerDisconnect(matchId, playerId);
+        });
+    }
+}
+
+void Orchestrator::reconnectPlayer(int matchId, int playerId) {
+    // Sin lock global: solo el shard de la partida
+    matches.visit(matchId, [&](const MatchDirectory::Entry& entry) {
+        entry.thread->handlePlayerReconnect(matchId, playerId);
+    });
+}
+
+void Orchestrator::registerMatch(const std::shared_ptr<Match>& match, int threadId) {
+    int matchId = match->getMatchId();
+    auto players = match->getPlayerIds();
+    
+    // Sin medición todavía, se estima con el coste medio de las partidas actuales
+    uint64_t totalCost = 0;
+    size_t matchCount = 0;
+    for (const auto& pair : threadMatches) {
+        totalCost += pair.second.cost->total.load(std::memory_order_relaxed);
+        matchCount += pair.second.matches.size();
+    }
+    if (matchCount > 0) {
+        match->setCost(totalCost / matchCount);
+    }
+    
+    ThreadMatches& owner = threadMatches[threadId];
+    owner.matches[matchId] = match;
+    match->chargeTo(owner.cost);
+    
+    matches.insert(matchId, match, threads[threadId]);
+    playerToMatch[players.first] = matchId;
+    playerToMatch[players.second] = matchId;
+    threads[threadId]->addMatch(match);
+}
+
+void Orchestrator::unchargeMatch(int matchId) {
+    for (auto& pair : threadMatches) {
+        auto it = pair.second.matches.find(matchId);
+        if (it != pair.second.matches.end()) {
+            it->second->chargeTo(nullptr);
+            pair.second.matches.erase(it);
+            return;
         }
     }
 }
@@ -129,47 +192,303 @@ int Orchestrator::createMatch(int player1Id, int player2Id) {
     
     // Crear match
     auto match = std::make_shared<Match>(matchId, player1Id, player2Id);
-    matches[matchId] = match;
-    threads[threadId]->addMatch(matchId, player1Id, player2Id);
+    registerMatch(match, threadId);
     
     //printf("Created match %d for players %d and %d in thread %d\n", matchId, player1Id, player2Id, threadId);
     return matchId;
 }
 
+std::unordered_map<int, Orchestrator::ThreadLoad> Orchestrator::computeThreadLoads() {
+    std::unordered_map<int, ThreadLoad> loads;
+    for (const auto& pair : threads) {
+        ThreadLoad& threadLoad = loads[pair.first];
+        auto owned = threadMatches.find(pair.first);
+        if (owned != threadMatches.end()) {
+            threadLoad.load = owned->second.cost->total.load(std::memory_order_relaxed);
+            threadLoad.matchCount = static_cast<int>(owned->second.matches.size());
+        }
+    }
+    return loads;
+}
+
 int Orchestrator::findAvailableThread() {
-    // Look for a thread with less than MAX_MATCHES_PER_THREAD matches
-    // buscar un thread que le alcance la partida
-    for (auto& pair : threads) {
-         if (pair.second->getActiveMatchCount() < maxMatchesPerThread) {
-            return pair.first;
-        } 
+    // Buscar el thread menos cargado (por coste medido, no por número de
+    // partidas) que tenga espacio y no haya pasado su presupuesto
+    auto loads = computeThreadLoads();
+    int bestThread = -1;
+    int leastLoadedThread = -1;
+    for (const auto& pair : loads) {
+        const ThreadLoad& threadLoad = pair.second;
+        if (leastLoadedThread == -1 || threadLoad.load < loads[leastLoadedThread].load) {
+            leastLoadedThread = pair.first;
+        }
+        if (threadLoad.matchCount >= maxMatchesPerThread || threadLoad.load >= threadBudgetNs) {
+            continue;
+        }
+        if (bestThread == -1 || threadLoad.load < loads[bestThread].load ||
+            (threadLoad.load == loads[bestThread].load && threadLoad.matchCount < loads[bestThread].matchCount)) {
+            bestThread = pair.first;
+        }
+    }
+    if (bestThread != -1) {
+        return bestThread;
+    }
+    
+    // Crear nuevo thread si no hay disponible y no se llegó al tope
+    if (static_cast<int>(threads.size()) < maxThreads) {
+        int threadId = nextThreadId++;
+        threads[threadId] = std::make_shared<GameThread>(threadId);
+        threadMatches[threadId].cost = std::make_shared<CostAccount>();
+        return threadId;
     }
     
-    // Crear nuevo thread si no hay disponible
-    int threadId = nextThreadId++;
-    threads[threadId] = std::make_shared<GameThread>(threadId);
-    return threadId;
+    // Todos llenos: sobrecargar el menos cargado antes que crear más hilos que núcleos
+    LOG_WARN("All %d game threads are full, overloading thread %d", maxThreads, leastLoadedThread);
+    return leastLoadedThread;
+}
+
+void Orchestrator::rebalance(int threadId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    if (!isRunning || threads.find(threadId) == threads.end()) {
+        return;
+    }
+    
+    auto loads = computeThreadLoads();
+    uint64_t myLoad = loads[threadId].load;
+    
+    // Hilo más cargado con más de una partida
+    int busiestThread = -1;
+    for (const auto& pair : loads) {
+        if (pair.first != threadId && pair.second.matchCount > 1 &&
+            (busiestThread == -1 || pair.second.load > loads[busiestThread].load)) {
+            busiestThread = pair.first;
+        }
+    }
+    if (busiestThread == -1) {
+        return;
+    }
+    
+    // Solo vale la pena mover si la diferencia es apreciable (10% del presupuesto)
+    uint64_t busiestLoad = loads[busiestThread].load;
+    if (busiestLoad <= myLoad || busiestLoad - myLoad < threadBudgetNs / 10) {
+        return;
+    }
+    
+    // La partida más cara que quepa en la mitad de la diferencia: mover una
+    // más grande solo invertiría el desequilibrio
+    uint64_t halfGap = (busiestLoad - myLoad) / 2;
+    int matchToMove = -1;
+    uint64_t matchToMoveCost = 0;
+    ThreadMatches& source = threadMatches[busiestThread];
+    for (const auto& pair : source.matches) {
+        uint64_t cost = pair.second->getCost();
+        if (cost <= halfGap && (matchToMove == -1 || cost > matchToMoveCost)) {
+            matchToMove = pair.first;
+            matchToMoveCost = cost;
+        }
+    }
+    if (matchToMove == -1 || matchToMoveCost == 0) {
+        return;
+    }
+    
+    // Desde aquí las acciones de la partida van al hilo nuevo, que las retiene
+    // hasta que el hilo origen le entregue la partida. Bajo el lock de
+    // escritura del shard, para que ninguna acción quede entre medio. Este
+    // es el worker del hilo destino: expectMatch no pasa por su buzón y
+    // releaseMatch nunca espera a que haya sitio en el del origen
+    auto target = threads[threadId];
+    bool reassigned = matches.reassign(matchToMove, target, [&](const MatchDirectory::Entry& previous) {
+        target->expectMatch(matchToMove);
+        previous.thread->releaseMatch(matchToMove, target);
+    });
+    if (!reassigned) {
+        return;
+    }
+    
+    // El coste pasa al agregado del destino desde ya
+    ThreadMatches& destination = threadMatches[threadId];
+    auto moved = source.matches.find(matchToMove);
+    moved->second->chargeTo(destination.cost);
+    destination.matches[matchToMove] = moved->second;
+    source.matches.erase(moved);
+    
+    LOG_INFO("Moving match %d from thread %d to thread %d (load %llu/%llu us/s)",
+             matchToMove, busiestThread, threadId,
+             (unsigned long long)(busiestLoad / 1000), (unsigned long long)(myLoad / 1000));
 }
 
 void Orchestrator::notifyMatchEnded(int matchId) {
+    std::function<void(int)> callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        
+        // Remover match del directorio y de los índices
+        auto match = matches.erase(matchId);
+        if (!match) {
+            return;
+        }
+        unchargeMatch(matchId);
+        auto players = match->getPlayerIds();
+        for (int playerId : {players.first, players.second}) {
+            // El jugador pudo haber entrado ya a otra partida
+            auto playerIt = playerToMatch.find(playerId);
+            if (playerIt != playerToMatch.end() && playerIt->second == matchId) {
+                playerToMatch.erase(playerIt);
+            }
+        }
+        callback = matchEndedCallback;
+    }
+    
+    LOG_INFO("Match %d removed from orchestrator", matchId);
+    
+    // Avisar fuera del lock para no bloquear al GameThread que nos llamó
+    if (callback) {
+        callback(matchId);
+    }
+}
+
+void Orchestrator::setMatchEndedCallback(std::function<void(int)> callback) {
     std::lock_guard<std::mutex> lock(mutex);
+    matchEndedCallback = std::move(callback);
+}
+
+Orchestrator::Submit Orchestrator::submitAction(int matchId, int playerId, const MatchEngine::Action& action,
+                                                const LatencyTrace& trace) {
+    // Sin el lock del orquestador: el shard garantiza que el hilo dueño no
+    // cambie mientras se encola (con el buzón lleno no se espera)
+    bool queued = false;
+    bool found = matches.visit(matchId, [&](const MatchDirectory::Entry& entry) {
+        LatencyTrace looked = trace;
+        LatencyMetrics::getInstance().record(looked, LatencyTrace::LOOKED_UP);
+        queued = entry.thread->handlePlayerAction(matchId, playerId, action, looked);
+    });
+    if (!found) {
+        return Submit::MATCH_NOT_FOUND;
+    }
+    return queued ? Submit::QUEUED : Submit::THREAD_BUSY;
+}
+
+Orchestrator::Submit Orchestrator::requestState(int matchId, int playerId, uint64_t lastSeq) {
+    bool queued = false;
+    bool found = matches.visit(matchId, [&](const MatchDirectory::Entry& entry) {
+        queued = entry.thread->handleStateRequest(matchId, playerId, lastSeq);
+    });
+    if (!found) {
+        return Submit::MATCH_NOT_FOUND;
+    }
+    return queued ? Submit::QUEUED : Submit::THREAD_BUSY;
+}
+
+bool Orchestrator::ackState(int matchId, int playerId, uint64_t version) {
+    // La confirmación no pasa por el buzón del hilo: la partida la guarda
+    // atómicamente y su hilo la lee al preparar el próximo envío
+    return matches.visit(matchId, [&](const MatchDirectory::Entry& entry) {
+        entry.match->ackState(playerId, version);
+    });
+}
+
+std::shared_ptr<Match> Orchestrator::getMatchById(int matchId) {
+    // Sin el lock del orquestador: solo el lock de lectura de un shard
+    return matches.find(matchId);
+}
+
+std::shared_ptr<Match> Orchestrator::detachMatch(int matchId) {
+    // El hilo dueño suelta la partida al procesar la acción, después de todo
+    // lo que ya tenía encolado
+    auto detached = std::make_shared<std::promise<std::shared_ptr<Match>>>();
+    auto result = detached->get_future();
+    bool found = matches.visit(matchId, [&](const MatchDirectory::Entry& entry) {
+        entry.thread->detachMatch(matchId, [detached](std::shared_ptr<Match> match) {
+            detached->set_value(std::move(match));
+        });
+    });
+    if (!found) {
+        return nullptr;
+    }
+    
+    std::shared_ptr<Match> match = result.get();
+    if (!match) {
+        return nullptr;  // Terminó mientras tanto (su fin ya se notificó)
+    }
     
-    // Remover match del mapa
+    std::lock_guard<std::mutex> lock(mutex);
     matches.erase(matchId);
+    unchargeMatch(matchId);
+    auto players = match->getPlayerIds();
+    for (int playerId : {players.first, players.second}) {
+        auto playerIt = playerToMatch.find(playerId);
+        if (playerIt != playerToMatch.end() && playerIt->second == matchId) {
+            playerToMatch.erase(playerIt);
+        }
+    }
+    LOG_INFO("Match %d detached from orchestrator", matchId);
+    return match;
 }
 
-std::shared_ptr<Match> Orchestrator::getMatchById(int matchId) {
+bool Orchestrator::attachMatch(std::shared_ptr<Match> match) {
     std::lock_guard<std::mutex> lock(mutex);
     
-    auto it = matches.find(matchId);
-    if (it != matches.end()) {
-        return it->second;
+    if (!isRunning || matches.contains(match->getMatchId())) {
+        return false;
+    }
+    
+    // Conserva el coste medido en el origen en vez de la estimación
+    uint64_t cost = match->getCost();
+    int threadId = findAvailableThread();
+    registerMatch(match, threadId);
+    if (cost > 0) {
+        match->setCost(cost);
+    }
+    if (match->getMatchId() >= nextMatchId) {
+        nextMatchId = match->getMatchId() + 1;
     }
     
-    return nullptr;
+    LOG_INFO("Attached match %d in thread %d", match->getMatchId(), threadId);
+    return true;
+}
+
+size_t Orchestrator::getIndexedPlayerCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return playerToMatch.size();
 }
 
-bool Orchestrator::createMatchWithId(int matchId, int player1Id, int player2Id) {
+size_t Orchestrator::getChargedMatchCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+    for (const auto& pair : threadMatches) {
+        count += pair.second.matches.size();
+    }
+    return count;
+}
+
+uint64_t Orchestrator::getChargedCost() {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t total = 0;
+    for (const auto& pair : threadMatches) {
+        total += pair.second.cost->total.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+size_t Orchestrator::getThreadMatchCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+    for (const auto& pair : threads) {
+        count += pair.second->getActiveMatchCount();
+    }
+    return count;
+}
+
+std::vector<int> Orchestrator::getMatchIds() const {
+    std::vector<int> ids;
+    matches.forEach([&ids](int matchId, const MatchDirectory::Entry&) {
+        ids.push_back(matchId);
+    });
+    return ids;
+}
+
+bool Orchestrator::createMatchWithId(int matchId, int player1Id, int player2Id, const std::vector<int>& barajasIds) {
     std::lock_guard<std::mutex> lock(mutex);
     
     if (!isRunning) {
@@ -177,23 +496,22 @@ bool Orchestrator::createMatchWithId(int matchId, int player1Id, int player2Id)
     }
     
     // Verificar que el matchId no exista ya
-    if (matches.find(matchId) != matches.end()) {
-        printf("Match %d already exists\n", matchId);
+    if (matches.contains(matchId)) {
+        LOG_WARN("Match %d already exists", matchId);
         return false;
     }
     
     int threadId = findAvailableThread();
     
-    // Crear match con ID específico
-    auto match = std::make_shared<Match>(matchId, player1Id, player2Id);
-    matches[matchId] = match;
-    threads[threadId]->addMatch(matchId, player1Id, player2Id);
+    // Crear match con ID específico (y las barajas elegidas en el matchmaking)
+    auto match = std::make_shared<Match>(matchId, player1Id, player2Id, barajasIds);
+    registerMatch(match, threadId);
     
     // Actualizar nextMatchId si es necesario
     if (matchId >= nextMatchId) {
         nextMatchId = matchId + 1;
     }
     
-    printf("Created match %d for players %d and %d in thread %d\n", matchId, player1Id, player2Id, threadId);
+    LOG_INFO("Created match %d for players %d and %d in thread %d", matchId, player1Id, player2Id, threadId);
     return true;
 }
@@ -0,0 +1,94 @@
+#include "../libs/port_allocator.hpp"
+#include <algorithm>
+
+PortAllocator::PortAllocator(int basePort, int maxPort)
+    : basePort(basePort), maxPort(std::max(basePort, maxPort)) {
+    int count = this->maxPort - basePort + 1;
+    bitmap.assign((count + 63) / 64, 0);
+    
+    // Marcar como ocupados los bits sobrantes de la última palabra
+    for (int index = count; index < static_cast<int>(bitmap.size() * 64); index++) {
+        setBit(index);
+    }
+}
+
+int PortAllocator::allocate() {
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    int index = findFree();
+    if (index >= 0) {
+        setBit(index);
+        used++;
+        return basePort + index;
+    }
+    
+    // Rango agotado: sondear los puertos que estaban ocupados por otro proceso
+    if (probe) {
+        for (auto it = externalPorts.begin(); it != externalPorts.end(); ++it) {
+            int port = *it;
+            if (probe(port)) {
+                externalPorts.erase(it);
+                used++;
+                return port;
+            }
+        }
+    }
+    return -1;
+}
+
+void PortAllocator::release(int port) {
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    if (port < basePort || port > maxPort) {
+        return;
+    }
+    int index = port - basePort;
+    if (bitmap[index / 64] & (uint64_t(1) << (index % 64))) {
+        clearBit(index);
+        used--;
+        
+        // Reutilizar primero los puertos bajos liberados
+        cursor = std::min(cursor, static_cast<size_t>(index / 64));
+    }
+}
+
+void PortAllocator::markInUseExternally(int port) {
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    // El bit sigue en 1 para que el cursor no lo vuelva a entregar
+    if (port >= basePort && port <= maxPort) {
+        externalPorts.push_back(port);
+        used--;
+    }
+}
+
+void PortAllocator::setProbe(std::function<bool(int)> probe) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->probe = std::move(probe);
+}
+
+int PortAllocator::getUsedCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return used;
+}
+
+int PortAllocator::findFree() {
+    size_t words = bitmap.size();
+    for (size_t i = 0; i < words; i++) {
+        size_t word = (cursor + i) % words;
+        uint64_t freeBits = ~bitmap[word];
+        if (freeBits != 0) {
+            cursor = word;
+            return static_cast<int>(word * 64 + __builtin_ctzll(freeBits));
+        }
+    }
+    return -1;
+}
+
+void PortAllocator::setBit(int index) {
+    bitmap[index / 64] |= uint64_t(1) << (index % 64);
+}
+
+void PortAllocator::clearBit(int index) {
+    bitmap[index / 64] &= ~(uint64_t(1) << (index % 64));
+}
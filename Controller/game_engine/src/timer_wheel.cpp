@@ -0,0 +1,72 @@
+#include "../libs/timer_wheel.hpp"
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick, size_t slotCount)
+    : start(Clock::now()), tickDuration(tick), slots(slotCount), currentTick(0), count(0) {
+}
+
+uint64_t TimerWheel::tickOf(Clock::time_point time) const {
+    if (time <= start) {
+        return 0;
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time - start).count() / tickDuration.count();
+}
+
+void TimerWheel::schedule(int matchId, Clock::time_point deadline) {
+    // Redondear hacia arriba: el plazo nunca vence antes de tiempo
+    uint64_t tick = tickOf(deadline);
+    if (start + tickDuration * tick < deadline) {
+        tick++;
+    }
+    // Un plazo ya pasado vence en el próximo tick procesado
+    if (tick < currentTick) {
+        tick = currentTick;
+    }
+    slots[tick % slots.size()].push_back({matchId, tick});
+    count++;
+}
+
+void TimerWheel::expireSlot(size_t slot, uint64_t limitTick, std::vector<int>& expired) {
+    std::vector<Entry>& entries = slots[slot];
+    size_t kept = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].tick <= limitTick) {
+            expired.push_back(entries[i].matchId);
+            count--;
+        } else {
+            // Vence en una vuelta posterior de la rueda
+            entries[kept++] = entries[i];
+        }
+    }
+    entries.resize(kept);
+}
+
+void TimerWheel::advance(Clock::time_point now, std::vector<int>& expired) {
+    uint64_t targetTick = tickOf(now);
+    if (targetTick < currentTick) {
+        return;
+    }
+
+    if (count == 0) {
+        currentTick = targetTick + 1;
+        return;
+    }
+
+    // Si el hilo estuvo bloqueado más de una vuelta basta recorrer cada slot una vez
+    if (targetTick - currentTick >= slots.size()) {
+        for (size_t slot = 0; slot < slots.size(); slot++) {
+            expireSlot(slot, targetTick, expired);
+        }
+    } else {
+        for (uint64_t tick = currentTick; tick <= targetTick; tick++) {
+            expireSlot(tick % slots.size(), targetTick, expired);
+        }
+    }
+    currentTick = targetTick + 1;
+}
+
+TimerWheel::Clock::time_point TimerWheel::nextTick() const {
+    if (count == 0) {
+        return Clock::time_point::max();
+    }
+    return start + tickDuration * currentTick;
+}
@@ -0,0 +1,68 @@
+#include "../libs/wakeup_event.hpp"
+#include <cstdint>
+#include <cstdio>
+
+#ifdef __linux__
+
+WakeupEvent::WakeupEvent() {
+    fd = eventfd(0, EFD_CLOEXEC);
+    if (fd < 0) {
+        perror("eventfd");
+    }
+}
+
+WakeupEvent::~WakeupEvent() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void WakeupEvent::notify() {
+    uint64_t value = 1;
+    ssize_t written = write(fd, &value, sizeof(value));
+    (void)written;
+}
+
+bool WakeupEvent::wait(int timeoutMs) {
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    
+    if (poll(&pfd, 1, timeoutMs) <= 0) {
+        return false;
+    }
+    
+    // Consumir todos los avisos acumulados
+    uint64_t value;
+    ssize_t bytesRead = read(fd, &value, sizeof(value));
+    return bytesRead == sizeof(value);
+}
+
+#else
+
+WakeupEvent::WakeupEvent() {}
+
+WakeupEvent::~WakeupEvent() {}
+
+void WakeupEvent::notify() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        signaled = true;
+    }
+    cv.notify_one();
+}
+
+bool WakeupEvent::wait(int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (timeoutMs < 0) {
+        cv.wait(lock, [this] { return signaled; });
+    } else {
+        cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return signaled; });
+    }
+    bool wasSignaled = signaled;
+    signaled = false;
+    return wasSignaled;
+}
+
+#endif
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <websocketpp/client.hpp>
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+using websocketpp::connection_hdl;
+
+typedef websocketpp::client<websocketpp::config::asio_client> WebSocketClient;
+
+// Comportamiento de los bots
+struct BotConfig {
+    int thinkMs = 500;        // Pausa media antes de cada jugada (se reparte entre 0.5x y 1.5x)
+    int actionsPerTurn = 3;   // Jugadas por turno antes de endTurn
+    int chatPercent = 5;      // % de jugadas que son un playerMessage
+    bool binary = false;      // Pedir el subprotocolo sd-binary.v1
+};
+
+// Contadores compartidos por todos los bots (los actualizan los hilos de asio)
+struct SwarmStats {
+    std::atomic<uint64_t> messagesSent{0};
+    std::atomic<uint64_t> messagesReceived{0};
+    std::atomic<uint64_t> actionsSent{0};
+    std::atomic<uint64_t> actionsRejected{0};
+    std::atomic<uint64_t> chatsSent{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> connectFailures{0};
+    std::atomic<uint64_t> disconnects{0};
+
+    // Ida y vuelta de cada acción: envío -> su actionResult, en µs
+    void addRtt(uint32_t us);
+    std::vector<uint32_t> takeRtts();
+
+private:
+    std::mutex rttMutex;
+    std::vector<uint32_t> rttUs;
+};
+
+// Un jugador sin interfaz: se identifica en su partida, confirma cada estado
+// (ackState, para recibir deltas como el cliente web) y en su turno juega
+// acciones al azar con una pausa entre ellas hasta pasar el turno.
+// Las acciones inválidas también miden: el motor las rechaza con un actionResult
+class BotClient : public std::enable_shared_from_this<BotClient> {
+public:
+    enum class State { CONNECTING, PLAYING, FINISHED, FAILED };
+
+    BotClient(WebSocketClient& client, const BotConfig& config, SwarmStats& stats,
+              int matchId, int playerId, uint32_t seed);
+
+    // Conectar al servidor de la partida (ws://host:port) e identificarse
+    // (con el ticket que dio el matchmaking, si lo dio)
+    void start(const std::string& host, int port, const std::string& ticket = "");
+
+    // Cerrar la conexión (fin de la prueba)
+    void stop();
+
+    State getState() const { return state.load(); }
+    int getMatchId() const { return matchId; }
+    int getPlayerId() const { return playerId; }
+
+private:
+    void onOpen(connection_hdl hdl);
+    void onMessage(connection_hdl hdl, WebSocketClient::message_ptr msg);
+    void onClose(connection_hdl hdl);
+    void onFail(connection_hdl hdl);
+
+    // Estado completo o delta: confirmar y ver si es nuestro turno
+    void handleState(const json& data);
+    void handleActionResult(const json& data);
+
+    // Programar la próxima jugada si es nuestro turno (con mutex tomado)
+    void scheduleMove();
+    void makeMove();
+
+    void send(const json& message);
+
+    WebSocketClient& client;
+    const BotConfig& config;
+    SwarmStats& stats;
+    int matchId;
+    int playerId;
+    std::string ticket;
+
+    std::mutex mutex;
+    connection_hdl hdl;
+    std::atomic<State> state;
+    std::mt19937 rng;
+
+    int currentPlayerId = -1;
+    size_t handSize = 0;
+    int actionsThisTurn = 0;
+    bool moveScheduled = false;
+    bool actionPending = false;
+    std::chrono::steady_clock::time_point actionSentAt;
+};
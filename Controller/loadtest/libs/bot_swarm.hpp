@@ -0,0 +1,84 @@
+#pragma once
+
+#include "bot_client.hpp"
+#include "matchmaking_client.hpp"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Parámetros de la prueba (variables de entorno, ver README)
+struct SwarmConfig {
+    std::string matchmakingHost = "127.0.0.1";
+    int matchmakingPort = 9001;
+    int matches = 100;          // Partidas simultáneas que se intentan sostener
+    double rampPerSecond = 50;  // Partidas nuevas por segundo como máximo
+    int durationS = 60;         // Duración de la fase sostenida (tras la rampa)
+    int threads = 1;            // Hilos de asio de los bots
+    int playerBase = 1000000;   // Primer playerId (no chocar con jugadores reales)
+    int deckId = 0;
+    int enginePid = 0;          // Proceso del motor a medir (0 = buscar game_orchestrator)
+    BotConfig bot;
+
+    // Leer la configuración de las variables de entorno
+    static SwarmConfig fromEnvironment();
+};
+
+// Enjambre de bots: pide partidas al matchmaking de dos en dos jugadores,
+// conecta un bot por jugador al servidor que le asignan, sube hasta el número
+// de partidas pedido (reponiendo las que terminan) y las sostiene durante la
+// prueba midiendo mensajes, ida y vuelta de las acciones y CPU/RSS del motor
+class BotSwarm {
+public:
+    explicit BotSwarm(const SwarmConfig& config);
+    ~BotSwarm();
+
+    // Ejecutar la prueba completa y escribir el informe (0 = terminó)
+    int run();
+
+private:
+    // Uso de recursos del proceso del motor (Linux: /proc)
+    struct EngineSample {
+        bool valid = false;
+        double cpuSeconds = 0;
+        double rssMb = 0;
+    };
+
+    // Pedir una partida para dos jugadores nuevos y conectar sus bots
+    bool startMatch();
+
+    // Esperar con getActiveMatch a que un jugador en cola tenga partida
+    // (result: respuesta de joinMatch; se sale de la cola si no llega)
+    bool waitForMatch(int playerId, json result, json& matched);
+
+    // Quitar las partidas terminadas o rotas; devuelve las que siguen jugando
+    size_t reapMatches();
+
+    EngineSample sampleEngine() const;
+    static int findEnginePid();
+
+    void report(double holdSeconds, size_t minSustained, double avgSustained,
+                uint64_t messages, const EngineSample& before, const EngineSample& after);
+
+    SwarmConfig config;
+    MatchmakingClient matchmaking;
+    SwarmStats stats;
+
+    WebSocketClient client;
+    std::vector<std::thread> ioThreads;
+
+    struct MatchEntry {
+        std::vector<std::shared_ptr<BotClient>> bots;
+        std::chrono::steady_clock::time_point startedAt;
+    };
+
+    // matchId -> bots de la partida
+    std::map<int, MatchEntry> matches;
+    int nextPlayerId;
+    uint64_t matchesStarted = 0;
+    uint64_t matchesFinished = 0;
+    uint64_t matchesFailed = 0;
+    uint64_t matchmakingFailures = 0;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+
+// Headers específicos según el sistema operativo
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    #define SOCKET int
+    #define INVALID_SOCKET -1
+    #define SOCKET_ERROR -1
+    #define closesocket close
+#endif
+
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Cliente HTTP mínimo del servicio de matchmaking (una petición por conexión,
+// como el cliente web)
+class MatchmakingClient {
+public:
+    MatchmakingClient(const std::string& host, int port) : host(host), port(port) {}
+
+    // POST con el cuerpo JSON; lanza std::runtime_error si no hay respuesta válida
+    json post(const json& body) const;
+
+    // Pedir partida para un jugador: "matched" (con gameServer) o "waiting"
+    json joinMatch(int playerId, int deckId) const;
+
+    // Estado del jugador (para los que quedaron en espera)
+    json getActiveMatch(int playerId) const;
+
+    // Salir de la cola de espera
+    json leaveMatch(int playerId) const;
+
+private:
+    std::string host;
+    int port;
+};
@@ -0,0 +1,27 @@
+#include "libs/bot_swarm.hpp"
+#include "src/utils/Log.hpp"
+#include "src/load_env_file.cpp"
+
+int main() {
+    loadEnvFile();
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        LOG_ERROR("WSAStartup failed");
+        return 1;
+    }
+#endif
+
+    SwarmConfig config = SwarmConfig::fromEnvironment();
+    int result;
+    {
+        BotSwarm swarm(config);
+        result = swarm.run();
+    }
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return result;
+}
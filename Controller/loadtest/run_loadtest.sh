@@ -0,0 +1,38 @@
+#!/bin/bash
+# Prueba de carga en loopback: arranca matchmaking y motor, lanza el
+# enjambre de bots (variables BOT_*, ver README) y detiene ambos al terminar.
+# Requiere compilados matchmaking/build/matchmaking_service y
+# game_engine/game_orchestrator
+
+cd "$(dirname "$0")/.."
+
+# Los puertos de matchmaking (9001) y motor (9002) vienen del .env de cada
+# servicio, que ya apunta a 127.0.0.1. El gateway da un solo puerto para todas
+# las partidas: el rango por partida (10000-11000) no pasa de ~1000
+GATEWAY_PORT=${GATEWAY_PORT:-9003}
+METRICS_PORT=${METRICS_PORT:-9100}
+
+# Dos conexiones por partida en cada lado
+ulimit -n 65536 2>/dev/null || echo "⚠️  No se pudo subir ulimit -n ($(ulimit -n))"
+
+cleanup() {
+    kill $MATCHMAKING_PID $GAME_ENGINE_PID 2>/dev/null
+    wait $MATCHMAKING_PID $GAME_ENGINE_PID 2>/dev/null
+}
+trap cleanup EXIT
+
+echo "Iniciando Matchmaking Service..."
+cd matchmaking
+# Espera a Enter para salir: stdin abierto mientras dure la prueba
+LOG_LEVEL=${LOG_LEVEL:-warn} ./build/matchmaking_service < <(sleep infinity) &
+MATCHMAKING_PID=$!
+cd ..
+
+echo "Iniciando Game Engine (gateway $GATEWAY_PORT)..."
+cd game_engine
+GATEWAY_PORT=$GATEWAY_PORT METRICS_PORT=$METRICS_PORT LOG_LEVEL=${LOG_LEVEL:-warn} ./game_orchestrator &
+GAME_ENGINE_PID=$!
+cd ..
+
+sleep 2
+ENGINE_PID=$GAME_ENGINE_PID ./loadtest/build/bot_swarm
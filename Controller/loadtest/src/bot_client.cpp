@@ -0,0 +1,261 @@
+#include "../libs/bot_client.hpp"
+#include "binary_protocol.hpp"
+#include "src/utils/Log.hpp"
+
+// Tablero del motor de reglas (5 columnas x 7 filas): las jugadas al azar
+// apuntan dentro de él
+static const int BOARD_WIDTH = 5;
+static const int BOARD_HEIGHT = 7;
+
+void SwarmStats::addRtt(uint32_t us) {
+    std::lock_guard<std::mutex> lock(rttMutex);
+    rttUs.push_back(us);
+}
+
+std::vector<uint32_t> SwarmStats::takeRtts() {
+    std::lock_guard<std::mutex> lock(rttMutex);
+    std::vector<uint32_t> result;
+    result.swap(rttUs);
+    return result;
+}
+
+BotClient::BotClient(WebSocketClient& client, const BotConfig& config, SwarmStats& stats,
+                     int matchId, int playerId, uint32_t seed)
+    : client(client), config(config), stats(stats), matchId(matchId), playerId(playerId),
+      state(State::CONNECTING), rng(seed) {
+}
+
+void BotClient::start(const std::string& host, int port, const std::string& ticket) {
+    this->ticket = ticket;
+    websocketpp::lib::error_code ec;
+    WebSocketClient::connection_ptr con = client.get_connection(
+        "ws://" + host + ":" + std::to_string(port), ec);
+    if (ec) {
+        LOG_WARN("Player %d cannot connect to %s:%d: %s", playerId, host.c_str(), port, ec.message().c_str());
+        stats.connectFailures++;
+        state = State::FAILED;
+        return;
+    }
+    if (config.binary) {
+        con->add_subprotocol(BinaryProtocol::SUBPROTOCOL);
+    }
+
+    // La conexión guarda los handlers (y con ellos al bot) hasta que se cierra
+    auto self = shared_from_this();
+    con->set_open_handler([self](connection_hdl hdl) { self->onOpen(hdl); });
+    con->set_message_handler([self](connection_hdl hdl, WebSocketClient::message_ptr msg) {
+        self->onMessage(hdl, msg);
+    });
+    con->set_close_handler([self](connection_hdl hdl) { self->onClose(hdl); });
+    con->set_fail_handler([self](connection_hdl hdl) { self->onFail(hdl); });
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        hdl = con->get_handle();
+    }
+    client.connect(con);
+}
+
+void BotClient::stop() {
+    connection_hdl current;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = hdl;
+    }
+    State previous = state.exchange(State::FINISHED);
+    if (previous == State::FAILED) {
+        state = State::FAILED;
+    }
+    websocketpp::lib::error_code ec;
+    client.close(current, websocketpp::close::status::going_away, "Load test finished", ec);
+}
+
+void BotClient::onOpen(connection_hdl) {
+    json identify = {
+        {"type", "identify"},
+        {"matchId", matchId},
+        {"playerId", playerId}
+    };
+    if (!ticket.empty()) {
+        identify["ticket"] = ticket;
+    }
+    send(identify);
+}
+
+void BotClient::onFail(connection_hdl) {
+    stats.connectFailures++;
+    state = State::FAILED;
+}
+
+void BotClient::onClose(connection_hdl) {
+    // Cierre que no pidió el bot ni llegó tras el fin de la partida
+    State expected = State::PLAYING;
+    if (state.compare_exchange_strong(expected, State::FAILED)) {
+        stats.disconnects++;
+        return;
+    }
+    expected = State::CONNECTING;
+    if (state.compare_exchange_strong(expected, State::FAILED)) {
+        stats.connectFailures++;
+    }
+}
+
+void BotClient::onMessage(connection_hdl connection, WebSocketClient::message_ptr msg) {
+    stats.messagesReceived++;
+    json data;
+    try {
+        data = msg->get_opcode() == websocketpp::frame::opcode::binary
+            ? BinaryProtocol::decode(msg->get_payload())
+            : json::parse(msg->get_payload());
+    } catch (const std::exception&) {
+        stats.errors++;
+        return;
+    }
+
+    std::string type = data.value("type", "");
+    if (type == "matchJoined") {
+        State expected = State::CONNECTING;
+        state.compare_exchange_strong(expected, State::PLAYING);
+    } else if (type == "gameState" || type == "stateDelta") {
+        handleState(data);
+    } else if (type == "actionResult") {
+        handleActionResult(data);
+    } else if (type == "gameOver") {
+        state = State::FINISHED;
+        websocketpp::lib::error_code ec;
+        client.close(connection, websocketpp::close::status::normal, "Game over", ec);
+    } else if (type == "error") {
+        stats.errors++;
+        std::string message = data.value("message", "");
+        LOG_DEBUG("Player %d got error: %s", playerId, message.c_str());
+        // Hilo de la partida saturado: la acción se perdió o falta el estado
+        if (message == "Server busy, action dropped") {
+            std::lock_guard<std::mutex> lock(mutex);
+            actionPending = false;
+            scheduleMove();
+        } else if (message == "Server busy, send resync") {
+            send({{"type", "resync"}});
+        }
+    }
+}
+
+void BotClient::handleState(const json& data) {
+    // Confirmar la versión: el siguiente estado llega como delta
+    if (data.contains("version")) {
+        send({{"type", "ackState"}, {"version", data["version"]}});
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (data.contains("you") && data["you"].contains("hand")) {
+        handSize = data["you"]["hand"].size();
+    }
+    int current = data.value("currentPlayerId", currentPlayerId);
+    if (current == playerId && currentPlayerId != playerId) {
+        actionsThisTurn = 0;
+    }
+    currentPlayerId = current;
+    scheduleMove();
+}
+
+void BotClient::handleActionResult(const json& data) {
+    if (data.value("fromPlayerId", -1) != playerId) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!actionPending) {
+        return;
+    }
+    actionPending = false;
+    auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - actionSentAt).count();
+    stats.addRtt(static_cast<uint32_t>(rtt));
+    if (!data.value("accepted", false)) {
+        stats.actionsRejected++;
+    }
+    scheduleMove();
+}
+
+void BotClient::scheduleMove() {
+    if (state != State::PLAYING || currentPlayerId != playerId || actionPending || moveScheduled) {
+        return;
+    }
+    moveScheduled = true;
+    long delayMs = 0;
+    if (config.thinkMs > 0) {
+        std::uniform_int_distribution<int> think(config.thinkMs / 2, config.thinkMs * 3 / 2);
+        delayMs = think(rng);
+    }
+    auto self = shared_from_this();
+    client.set_timer(delayMs, [self](const websocketpp::lib::error_code& ec) {
+        if (!ec) {
+            self->makeMove();
+        }
+    });
+}
+
+void BotClient::makeMove() {
+    json message;
+    bool chat = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        moveScheduled = false;
+        // El turno pudo pasar mientras se pensaba la jugada
+        if (state != State::PLAYING || currentPlayerId != playerId || actionPending) {
+            return;
+        }
+
+        std::uniform_int_distribution<int> percent(0, 99);
+        std::uniform_int_distribution<int> column(0, BOARD_WIDTH - 1);
+        std::uniform_int_distribution<int> row(0, BOARD_HEIGHT - 1);
+        if (percent(rng) < config.chatPercent) {
+            chat = true;
+            message = {{"type", "playerMessage"}, {"content", "gl hf"}};
+        } else if (actionsThisTurn >= config.actionsPerTurn) {
+            message = {{"type", "action"}, {"action", "endTurn"}};
+        } else {
+            int choice = percent(rng);
+            if (choice < 50 && handSize > 0) {
+                std::uniform_int_distribution<int> card(0, static_cast<int>(handSize) - 1);
+                message = {{"type", "action"}, {"action", "playCard"},
+                           {"handIndex", card(rng)}, {"x", column(rng)}, {"y", row(rng)}};
+            } else if (choice < 75) {
+                message = {{"type", "action"}, {"action", "moveCard"},
+                           {"fromX", column(rng)}, {"fromY", row(rng)}, {"x", column(rng)}, {"y", row(rng)}};
+            } else {
+                message = {{"type", "action"}, {"action", "attack"},
+                           {"fromX", column(rng)}, {"fromY", row(rng)},
+                           {"targetX", column(rng)}, {"targetY", row(rng)}};
+            }
+        }
+        if (!chat) {
+            actionsThisTurn++;
+            actionPending = true;
+            actionSentAt = std::chrono::steady_clock::now();
+        }
+    }
+
+    send(message);
+    if (chat) {
+        stats.chatsSent++;
+        std::lock_guard<std::mutex> lock(mutex);
+        scheduleMove();
+    } else {
+        stats.actionsSent++;
+    }
+}
+
+void BotClient::send(const json& message) {
+    connection_hdl current;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = hdl;
+    }
+    websocketpp::lib::error_code ec;
+    if (config.binary) {
+        client.send(current, BinaryProtocol::encode(message), websocketpp::frame::opcode::binary, ec);
+    } else {
+        client.send(current, message.dump(), websocketpp::frame::opcode::text, ec);
+    }
+    if (!ec) {
+        stats.messagesSent++;
+    }
+}
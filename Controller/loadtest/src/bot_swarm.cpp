@@ -0,0 +1,380 @@
+#include "../libs/bot_swarm.hpp"
+#include "src/utils/Log.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+    #include <dirent.h>
+    #include <unistd.h>
+#endif
+
+// Un bot que no llega a jugar en este tiempo cuenta como fallido
+static const auto CONNECT_TIMEOUT = std::chrono::seconds(10);
+
+// Espera máxima en la cola del matchmaking por un rival
+static const auto MATCHMAKING_TIMEOUT = std::chrono::seconds(5);
+
+SwarmConfig SwarmConfig::fromEnvironment() {
+    SwarmConfig config;
+    config.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    auto readInt = [](const char* name, int& value, int minValue) {
+        const char* env = std::getenv(name);
+        if (env != nullptr && std::atoi(env) >= minValue) {
+            value = std::atoi(env);
+        }
+    };
+
+    const char* host = std::getenv("MATCHMAKING_IP");
+    if (host != nullptr && host[0] != '\0') {
+        config.matchmakingHost = host;
+    }
+    readInt("MATCHMAKING_PORT", config.matchmakingPort, 1);
+    readInt("BOT_MATCHES", config.matches, 1);
+    readInt("BOT_DURATION_S", config.durationS, 1);
+    readInt("BOT_THREADS", config.threads, 1);
+    readInt("BOT_PLAYER_BASE", config.playerBase, 1);
+    readInt("BOT_DECK", config.deckId, 0);
+    readInt("ENGINE_PID", config.enginePid, 1);
+    readInt("BOT_THINK_MS", config.bot.thinkMs, 0);
+    readInt("BOT_ACTIONS_PER_TURN", config.bot.actionsPerTurn, 0);
+    readInt("BOT_CHAT_PERCENT", config.bot.chatPercent, 0);
+
+    const char* ramp = std::getenv("BOT_RAMP_PER_S");
+    if (ramp != nullptr && std::atof(ramp) > 0) {
+        config.rampPerSecond = std::atof(ramp);
+    }
+    const char* binary = std::getenv("BOT_BINARY");
+    config.bot.binary = binary != nullptr && std::string(binary) == "1";
+    return config;
+}
+
+BotSwarm::BotSwarm(const SwarmConfig& config)
+    : config(config), matchmaking(config.matchmakingHost, config.matchmakingPort),
+      nextPlayerId(config.playerBase) {
+    client.clear_access_channels(websocketpp::log::alevel::all);
+    client.clear_error_channels(websocketpp::log::elevel::all);
+    client.init_asio();
+    // run() sigue activo aunque en algún momento no haya conexiones
+    client.start_perpetual();
+}
+
+BotSwarm::~BotSwarm() {
+    client.stop_perpetual();
+    client.stop();
+    for (auto& thread : ioThreads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+bool BotSwarm::waitForMatch(int playerId, json result, json& matched) {
+    auto deadline = std::chrono::steady_clock::now() + MATCHMAKING_TIMEOUT;
+    while (result.value("status", "") != "matched") {
+        if (result.value("status", "") != "waiting" || std::chrono::steady_clock::now() >= deadline) {
+            LOG_WARN("Player %d not matched: %s", playerId, result.dump().c_str());
+            matchmaking.leaveMatch(playerId);
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        result = matchmaking.getActiveMatch(playerId);
+    }
+    matched = result;
+    return true;
+}
+
+bool BotSwarm::startMatch() {
+    // El primero queda en cola y el segundo completa la partida; el primero
+    // la ve con getActiveMatch
+    int players[2] = {nextPlayerId, nextPlayerId + 1};
+    nextPlayerId += 2;
+    json results[2];
+    try {
+        json first = matchmaking.joinMatch(players[0], config.deckId);
+        json second = matchmaking.joinMatch(players[1], config.deckId);
+        if (!waitForMatch(players[1], second, results[1])) {
+            matchmaking.leaveMatch(players[0]);
+            matchmakingFailures++;
+            return false;
+        }
+        if (!waitForMatch(players[0], first, results[0])) {
+            matchmakingFailures++;
+            return false;
+        }
+    } catch (const std::exception& e) {
+        LOG_WARN("Matchmaking request failed: %s", e.what());
+        matchmakingFailures++;
+        return false;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    for (int i = 0; i < 2; i++) {
+        int matchId = results[i]["matchId"];
+        const json& server = results[i]["gameServer"];
+        auto bot = std::make_shared<BotClient>(client, config.bot, stats, matchId, players[i],
+                                               static_cast<uint32_t>(players[i]));
+        MatchEntry& entry = matches[matchId];
+        if (entry.bots.empty()) {
+            entry.startedAt = now;
+            matchesStarted++;
+        }
+        entry.bots.push_back(bot);
+        bot->start(server["ip"].get<std::string>(), server["port"].get<int>(), results[i].value("ticket", ""));
+    }
+    return true;
+}
+
+size_t BotSwarm::reapMatches() {
+    auto now = std::chrono::steady_clock::now();
+    size_t playing = 0;
+    for (auto it = matches.begin(); it != matches.end();) {
+        MatchEntry& entry = it->second;
+        size_t finished = 0;
+        size_t active = 0;
+        bool failed = false;
+        for (auto& bot : entry.bots) {
+            BotClient::State state = bot->getState();
+            finished += state == BotClient::State::FINISHED;
+            active += state == BotClient::State::PLAYING;
+            failed = failed || state == BotClient::State::FAILED;
+        }
+        // Un bot que sigue conectando pasado el plazo no va a jugar
+        bool stuck = active + finished < entry.bots.size() && now - entry.startedAt > CONNECT_TIMEOUT;
+
+        if (finished == entry.bots.size()) {
+            matchesFinished++;
+        } else if (failed || stuck) {
+            matchesFailed++;
+            for (auto& bot : entry.bots) {
+                bot->stop();
+            }
+        } else {
+            if (active == 2) {
+                playing++;
+            }
+            ++it;
+            continue;
+        }
+        it = matches.erase(it);
+    }
+    return playing;
+}
+
+BotSwarm::EngineSample BotSwarm::sampleEngine() const {
+    EngineSample sample;
+#ifdef __linux__
+    if (config.enginePid <= 0) {
+        return sample;
+    }
+    std::string base = "/proc/" + std::to_string(config.enginePid);
+
+    // /proc/<pid>/stat: utime y stime (campos 14 y 15) en ticks del reloj
+    std::ifstream statFile(base + "/stat");
+    std::string stat((std::istreambuf_iterator<char>(statFile)), std::istreambuf_iterator<char>());
+    size_t end = stat.rfind(')');
+    if (end == std::string::npos) {
+        return sample;
+    }
+    std::istringstream fields(stat.substr(end + 2));
+    std::string field;
+    unsigned long long utime = 0, stime = 0;
+    for (int i = 3; i <= 15 && fields >> field; i++) {
+        if (i == 14) utime = std::stoull(field);
+        if (i == 15) stime = std::stoull(field);
+    }
+    sample.cpuSeconds = static_cast<double>(utime + stime) / sysconf(_SC_CLK_TCK);
+
+    std::ifstream statusFile(base + "/status");
+    std::string line;
+    while (std::getline(statusFile, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0) {
+            sample.rssMb = std::atof(line.c_str() + 6) / 1024.0;
+            sample.valid = true;
+        }
+    }
+#endif
+    return sample;
+}
+
+int BotSwarm::findEnginePid() {
+#ifdef __linux__
+    DIR* proc = opendir("/proc");
+    if (proc == nullptr) {
+        return 0;
+    }
+    int found = 0;
+    while (dirent* entry = readdir(proc)) {
+        int pid = std::atoi(entry->d_name);
+        if (pid <= 0) {
+            continue;
+        }
+        std::ifstream comm(std::string("/proc/") + entry->d_name + "/comm");
+        std::string name;
+        if (std::getline(comm, name) && name == "game_orchestrator") {
+            found = pid;
+            break;
+        }
+    }
+    closedir(proc);
+    return found;
+#else
+    return 0;
+#endif
+}
+
+int BotSwarm::run() {
+    if (config.enginePid <= 0) {
+        config.enginePid = findEnginePid();
+    }
+    if (config.enginePid <= 0) {
+        LOG_WARN("Game engine process not found (set ENGINE_PID): CPU/RSS will not be reported");
+    }
+
+    for (int i = 0; i < config.threads; i++) {
+        ioThreads.emplace_back([this]() {
+            client.run();
+        });
+    }
+
+    LOG_INFO("Load test: %d matches, ramp %.1f/s, hold %d s, think %d ms, %d actions/turn, %s protocol",
+             config.matches, config.rampPerSecond, config.durationS, config.bot.thinkMs,
+             config.bot.actionsPerTurn, config.bot.binary ? "binary" : "JSON");
+    EngineSample idle = sampleEngine();
+
+    // Rampa: partidas nuevas al ritmo pedido hasta tener todas jugando. Las
+    // que terminan o fallan se reponen también durante la fase sostenida
+    auto rampStart = std::chrono::steady_clock::now();
+    auto rampLimit = rampStart + std::chrono::seconds(
+        static_cast<long>(config.matches / config.rampPerSecond) * 2 + 30);
+    auto nextStart = rampStart;
+    auto nextProgress = rampStart + std::chrono::seconds(1);
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / config.rampPerSecond));
+    auto topUp = [&](std::chrono::steady_clock::time_point now) {
+        while (matches.size() < static_cast<size_t>(config.matches) && nextStart <= now) {
+            startMatch();
+            nextStart += period;
+        }
+        // Sin acumular arranques atrasados (p. ej. tras una espera del matchmaking)
+        if (nextStart < now - std::chrono::seconds(1)) {
+            nextStart = now;
+        }
+    };
+
+    size_t playing = 0;
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        playing = reapMatches();
+        if (playing >= static_cast<size_t>(config.matches)) {
+            break;
+        }
+        if (now >= rampLimit) {
+            LOG_WARN("Ramp did not reach %d matches (%zu playing), holding anyway", config.matches, playing);
+            break;
+        }
+        topUp(now);
+        if (now >= nextProgress) {
+            LOG_INFO("Ramp: %zu/%d matches playing", playing, config.matches);
+            nextProgress += std::chrono::seconds(1);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Fase sostenida: se mide desde aquí
+    LOG_INFO("Holding %zu matches for %d s", playing, config.durationS);
+    stats.takeRtts();
+    EngineSample before = sampleEngine();
+    uint64_t messagesBefore = stats.messagesSent + stats.messagesReceived;
+    auto holdStart = std::chrono::steady_clock::now();
+    auto holdEnd = holdStart + std::chrono::seconds(config.durationS);
+    size_t minSustained = playing;
+    double sustainedSum = 0;
+    int samples = 0;
+    auto nextSample = holdStart + std::chrono::seconds(1);
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= holdEnd) {
+            break;
+        }
+        playing = reapMatches();
+        topUp(now);
+        if (now >= nextSample) {
+            minSustained = std::min(minSustained, playing);
+            sustainedSum += playing;
+            samples++;
+            nextSample += std::chrono::seconds(1);
+            if (samples % 10 == 0) {
+                LOG_INFO("Hold: %zu matches playing", playing);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    double holdSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - holdStart).count();
+    uint64_t messages = stats.messagesSent + stats.messagesReceived - messagesBefore;
+    EngineSample after = sampleEngine();
+
+    // Cerrar todas las conexiones antes del informe
+    for (auto& pair : matches) {
+        for (auto& bot : pair.second.bots) {
+            bot->stop();
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    if (!after.valid) {
+        after = before;
+    }
+    before.rssMb = idle.valid ? idle.rssMb : before.rssMb;
+    report(holdSeconds, minSustained, samples > 0 ? sustainedSum / samples : playing,
+           messages, before, after);
+    return 0;
+}
+
+void BotSwarm::report(double holdSeconds, size_t minSustained, double avgSustained,
+                      uint64_t messages, const EngineSample& before, const EngineSample& after) {
+    std::vector<uint32_t> rtts = stats.takeRtts();
+    std::sort(rtts.begin(), rtts.end());
+    auto percentileMs = [&rtts](double quantile) {
+        if (rtts.empty()) {
+            return 0.0;
+        }
+        size_t index = std::min(rtts.size() - 1, static_cast<size_t>(quantile * rtts.size()));
+        return rtts[index] / 1000.0;
+    };
+
+    // El informe va después de los logs pendientes
+    Logger::getInstance().flush();
+    std::printf("\n=== Load test report ===\n");
+    std::printf("Matches           target %d, sustained min %zu / avg %.1f over %.0f s\n",
+                config.matches, minSustained, avgSustained, holdSeconds);
+    std::printf("                  started %llu, finished %llu, failed %llu, matchmaking failures %llu\n",
+                static_cast<unsigned long long>(matchesStarted), static_cast<unsigned long long>(matchesFinished),
+                static_cast<unsigned long long>(matchesFailed), static_cast<unsigned long long>(matchmakingFailures));
+    std::printf("Messages          %.0f/s (sent %llu, received %llu in total)\n", messages / holdSeconds,
+                static_cast<unsigned long long>(stats.messagesSent.load()),
+                static_cast<unsigned long long>(stats.messagesReceived.load()));
+    std::printf("Actions           %zu measured, %llu rejected by the rules, %llu chat messages\n", rtts.size(),
+                static_cast<unsigned long long>(stats.actionsRejected.load()),
+                static_cast<unsigned long long>(stats.chatsSent.load()));
+    std::printf("Action RTT        p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+                percentileMs(0.50), percentileMs(0.99), rtts.empty() ? 0.0 : rtts.back() / 1000.0);
+    std::printf("Errors            %llu error messages, %llu connect failures, %llu disconnects\n",
+                static_cast<unsigned long long>(stats.errors.load()),
+                static_cast<unsigned long long>(stats.connectFailures.load()),
+                static_cast<unsigned long long>(stats.disconnects.load()));
+
+    if (!before.valid || avgSustained <= 0) {
+        std::printf("Engine            not measured\n");
+        return;
+    }
+    double cores = (after.cpuSeconds - before.cpuSeconds) / holdSeconds;
+    double perThousand = 1000.0 / avgSustained;
+    std::printf("Engine (pid %d)   CPU %.2f cores, RSS %.1f MB (%.1f MB before the ramp)\n",
+                config.enginePid, cores, after.rssMb, before.rssMb);
+    std::printf("Per 1k matches    CPU %.2f cores, RSS +%.1f MB\n",
+                cores * perThousand, (after.rssMb - before.rssMb) * perThousand);
+}
@@ -0,0 +1,62 @@
+#include "../libs/matchmaking_client.hpp"
+#include <stdexcept>
+
+json MatchmakingClient::post(const json& body) const {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == INVALID_SOCKET) {
+        throw std::runtime_error("Could not create socket");
+    }
+
+    sockaddr_in serverAddr;
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &serverAddr.sin_addr) != 1 ||
+        connect(sock, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
+        closesocket(sock);
+        throw std::runtime_error("Could not connect to matchmaking at " + host + ":" + std::to_string(port));
+    }
+
+    std::string bodyStr = body.dump();
+    std::string request = "POST / HTTP/1.1\r\n"
+                          "Host: " + host + "\r\n"
+                          "Content-Type: application/json\r\n"
+                          "Content-Length: " + std::to_string(bodyStr.length()) + "\r\n"
+                          "Connection: close\r\n"
+                          "\r\n" + bodyStr;
+    size_t sent = 0;
+    while (sent < request.size()) {
+        int result = send(sock, request.c_str() + sent, static_cast<int>(request.size() - sent), 0);
+        if (result == SOCKET_ERROR || result == 0) {
+            closesocket(sock);
+            throw std::runtime_error("Could not send request to matchmaking");
+        }
+        sent += result;
+    }
+
+    // El servicio cierra la conexión después de responder
+    std::string response;
+    char buffer[4096];
+    int received;
+    while ((received = recv(sock, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, received);
+    }
+    closesocket(sock);
+
+    size_t bodyStart = response.find("\r\n\r\n");
+    if (bodyStart == std::string::npos) {
+        throw std::runtime_error("Invalid HTTP response from matchmaking");
+    }
+    return json::parse(response.substr(bodyStart + 4));
+}
+
+json MatchmakingClient::joinMatch(int playerId, int deckId) const {
+    return post({{"action", "joinMatch"}, {"playerId", playerId}, {"BarajaId", deckId}});
+}
+
+json MatchmakingClient::getActiveMatch(int playerId) const {
+    return post({{"action", "getActiveMatch"}, {"playerId", playerId}});
+}
+
+json MatchmakingClient::leaveMatch(int playerId) const {
+    return post({{"action", "leaveMatch"}, {"playerId", playerId}});
+}
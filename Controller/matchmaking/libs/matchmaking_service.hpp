@@ -34,6 +34,8 @@
 #endif
 
 #include <nlohmann/json.hpp>
+#include "control_transport.hpp"
+#include "match_ticket.hpp"
 
 using json = nlohmann::json;
 
@@ -58,7 +60,7 @@ struct WaitingPlayer {
     std::chrono::steady_clock::time_point joinTime;
     
     WaitingPlayer(int id, const std::string& playerIp, int baraja) 
-        : playerId(id), ip(playerIp),barajaId(barajaId), joinTime(std::chrono::steady_clock::now()) {}
+        : playerId(id), ip(playerIp), barajaId(baraja), joinTime(std::chrono::steady_clock::now()) {}
 };
 
 // Estructura para almacenar información de conexión del jugador
@@ -104,6 +106,21 @@ public:
     
     // Notificar que una partida terminó
     void notifyMatchEnded(int matchId);
+    
+    // El game engine anuncia su capacidad (0 = drenando: no crear partidas)
+    void setEngineCapacity(int capacity);
+
+    // Atender una petición ya decodificada (la usan el servidor HTTP y la
+    // simulación en memoria)
+    json processRequest(const json& request, const std::string& clientIp);
+
+    // Sustituir el canal hacia el game engine (por defecto TCP)
+    void setTransport(std::shared_ptr<ControlTransport> transport);
+
+    // Partidas en curso y jugadores registrados (en cola, en partida o con
+    // conexión de avisos); vuelven a cero cuando terminan todas las partidas
+    size_t getActiveMatchCount();
+    size_t getTrackedPlayerCount();
 
 private:
     // Constructor privado para singleton
@@ -112,7 +129,6 @@ private:
 
     // Funciones auxiliares
     void handleClientConnection(SOCKET clientSocket);
-    json processRequest(const json& request, const std::string& clientIp);
     
     // Manejo de peticiones HTTP
     json handleHttpRequest(const std::string& httpRequest, const std::string& clientIp);
@@ -124,6 +140,10 @@ private:
     // Comunicación con game engine via socket
     json sendToGameEngine(const json& message);
     
+    // Añadir a la respuesta el ticket firmado con el que el jugador se
+    // identifica en el game engine (solo con MATCH_TICKET_SECRET)
+    json withTicket(json response, int matchId, int playerId);
+    
     // Notificar a jugadores específicos sobre match encontrado
     void notifyPlayersMatchFound(const std::vector<int>& playerIds, int matchId, 
                                 const std::string& serverIp, int serverPort);
@@ -158,6 +178,11 @@ private:
     // Configuración del game engine
     std::string gameEngineIp = "127.0.0.1";
     int gameEnginePort = 9003;  // Puerto para comunicación con game engine
+    std::shared_ptr<ControlTransport> engineTransport;
+    
+    // El game engine acepta partidas nuevas (false mientras drena; los
+    // jugadores siguen en espera hasta que vuelva a anunciar capacidad)
+    bool engineAccepting = true;
     
     // Configuración
     int playersPerMatch = 2;
@@ -2,13 +2,14 @@
 #include <thread>
 #include <cstdlib>
 #include "libs/matchmaking_service.hpp"
+#include "src/utils/Log.hpp"
 #include "src/load_env_file.cpp"
 
 using namespace std;
 
 int main() {
     loadEnvFile();
-    printf("Starting Matchmaking Service\n");
+    LOG_INFO("Starting Matchmaking Service");
     
     // Inicializar el servicio de matchmaking
     MatchmakingService::getInstance().initialize();
@@ -26,7 +27,7 @@ int main() {
     });
     
     // Esperar a que el usuario presione una tecla para finalizar
-    printf("Press Enter to stop the matchmaking service...\n");
+    LOG_INFO("Press Enter to stop the matchmaking service...");
     cin.get();
     
     // Limpiar
@@ -37,6 +38,6 @@ int main() {
         serviceThread.join();
     }
     
-    printf("Matchmaking service stopped\n");
+    LOG_INFO("Matchmaking service stopped");
     return 0;
 }
@@ -1,4 +1,5 @@
 #include "../libs/matchmaking_service.hpp"
+#include "src/utils/Log.hpp"
 #include <thread>
 #include <chrono>
 #include <sstream>
@@ -10,15 +11,17 @@
     #pragma comment(lib, "ws2_32.lib")
 #endif
 
-MatchmakingService::MatchmakingService() : serverSocket(INVALID_SOCKET), isRunning(false) {
-    printf("MatchmakingService created\n");
+MatchmakingService::MatchmakingService()
+    : serverSocket(INVALID_SOCKET), isRunning(false),
+      engineTransport(std::make_shared<TcpControlTransport>(TcpControlTransport::RAW_JSON)) {
+    LOG_INFO("MatchmakingService created");
     
     // Inicializar Winsock solo en Windows
 #ifdef _WIN32
     WSADATA wsaData;
     int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
     if (result != 0) {
-        printf("WSAStartup failed: %d\n", result);
+        LOG_ERROR("WSAStartup failed: %d", result);
         return;
     }
 #endif
@@ -56,20 +59,20 @@ void MatchmakingService::initialize() {
         return;
     }
     
-    printf("Matchmaking service initialized\n");
-    printf("Game Engine: %s:%d\n", gameEngineIp.c_str(), gameEnginePort);
-    printf("Players per match: %d\n", playersPerMatch);
+    LOG_INFO("Matchmaking service initialized");
+    LOG_INFO("Game Engine: %s:%d", gameEngineIp.c_str(), gameEnginePort);
+    LOG_INFO("Players per match: %d", playersPerMatch);
     
     isRunning = true;
 }
 
 void MatchmakingService::run(int port) {
     if (!isRunning) {
-        printf("Service not initialized\n");
+        LOG_WARN("Service not initialized");
         return;
     }
     
-    printf("Starting matchmaking service on port %d\n", port);
+    LOG_INFO("Starting matchmaking service on port %d", port);
     
     
     // Iniciar hilo de verificación de conexiones
@@ -93,7 +96,7 @@ void MatchmakingService::shutdown() {
         return;
     }
     
-    printf("Shutting down matchmaking service\n");
+    LOG_INFO("Shutting down matchmaking service");
     
     // Cerrar socket del servidor
     if (serverSocket != INVALID_SOCKET) {
@@ -115,9 +118,9 @@ void MatchmakingService::startSocketServer(int port) {
     serverSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (serverSocket == INVALID_SOCKET) {
 #ifdef _WIN32
-        printf("Error creating socket: %d\n", WSAGetLastError());
+        LOG_ERROR("Error creating socket: %d", WSAGetLastError());
 #else
-        printf("Error creating socket: %s\n", strerror(errno));
+        LOG_ERROR("Error creating socket: %s", strerror(errno));
 #endif
         return;
     }
@@ -131,7 +134,7 @@ void MatchmakingService::startSocketServer(int port) {
                    &opt,
 #endif
                    sizeof(opt)) < 0) {
-        printf("Error setting socket options\n");
+        LOG_ERROR("Error setting socket options");
     }
     
     // Configurar dirección del servidor
@@ -143,9 +146,9 @@ void MatchmakingService::startSocketServer(int port) {
     // Bind del socket
     if (bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
 #ifdef _WIN32
-        printf("Bind failed: %d\n", WSAGetLastError());
+        LOG_WARN("Bind failed: %d", WSAGetLastError());
 #else
-        printf("Bind failed: %s\n", strerror(errno));
+        LOG_WARN("Bind failed: %s", strerror(errno));
 #endif
         closesocket(serverSocket);
         return;
@@ -154,15 +157,15 @@ void MatchmakingService::startSocketServer(int port) {
     // Empezar a escuchar
     if (listen(serverSocket, SOMAXCONN) == SOCKET_ERROR) {
 #ifdef _WIN32
-        printf("Listen failed: %d\n", WSAGetLastError());
+        LOG_WARN("Listen failed: %d", WSAGetLastError());
 #else
-        printf("Listen failed: %s\n", strerror(errno));
+        LOG_WARN("Listen failed: %s", strerror(errno));
 #endif
         closesocket(serverSocket);
         return;
     }
     
-    printf("Matchmaking server listening on port %d\n", port);
+    LOG_INFO("Matchmaking server listening on port %d", port);
     
     // Loop principal para aceptar conexiones
     while (isRunning) {
@@ -177,9 +180,9 @@ void MatchmakingService::startSocketServer(int port) {
         if (clientSocket == INVALID_SOCKET) {
             if (isRunning) {
 #ifdef _WIN32
-                printf("Accept failed: %d\n", WSAGetLastError());
+                LOG_WARN("Accept failed: %d", WSAGetLastError());
 #else
-                printf("Accept failed: %s\n", strerror(errno));
+                LOG_WARN("Accept failed: %s", strerror(errno));
 #endif
             }
             continue;
@@ -229,7 +232,7 @@ void MatchmakingService::handleClientConnection(SOCKET clientSocket) {
                 sendHttpResponse(clientSocket, response);
             } else {
                 // Rechazar peticiones no HTTP
-                printf("Rejecting non-HTTP request from %s\n", clientIp);
+                LOG_WARN("Rejecting non-HTTP request from %s", clientIp);
                 json errorResponse = {
                     {"status", "error"},
                     {"message", "This service only accepts HTTP requests"}
@@ -238,7 +241,7 @@ void MatchmakingService::handleClientConnection(SOCKET clientSocket) {
             }
         }
     } catch (const std::exception& e) {
-        printf("Error handling client: %s\n", e.what());
+        LOG_ERROR("Error handling client: %s", e.what());
         json errorResponse = {
             {"status", "error"},
             {"message", e.what()}
@@ -274,6 +277,10 @@ json MatchmakingService::processRequest(const json& request, const std::string&
         notifyMatchEnded(matchId);
         return json{{"status", "success"}};
     }
+    else if (action == "engineCapacity") {
+        setEngineCapacity(request["capacity"]);
+        return json{{"status", "success"}};
+    }
     else {
         return json{
             {"status", "error"},
@@ -284,7 +291,7 @@ json MatchmakingService::processRequest(const json& request, const std::string&
 json MatchmakingService:: confirmDeck(int playerId, const std::string& playerIp, int barajaId) {
     std::lock_guard<std::mutex> lock(mutex);
     
-    printf("Player %d requesting to join match from IP %s\n", playerId, playerIp.c_str());
+    LOG_DEBUG("Player %d requesting to join match from IP %s", playerId, playerIp.c_str());
     
     // Verificar si el jugador ya está en una partida activa
     auto playerMatchIt = playerToMatch.find(playerId);
@@ -293,12 +300,12 @@ json MatchmakingService:: confirmDeck(int playerId, const std::string& playerIp,
         auto matchIt = activeMatches.find(matchId);
         if (matchIt != activeMatches.end() && matchIt->second->active) {
             // Reconexión a partida existente
-            return json{
+            return withTicket(json{
                 {"status", "reconnect"},
                 {"matchId", matchId},
                 {"serverIp", matchIt->second->ip},
                 {"serverPort", matchIt->second->port}
-            };
+            }, matchId, playerId);
         }
     }
     
@@ -312,8 +319,8 @@ json MatchmakingService:: confirmDeck(int playerId, const std::string& playerIp,
 }
 json MatchmakingService::joinMatch(int playerId, const std::string& playerIp, int barajaId) {
     std::lock_guard<std::mutex> lock(mutex);
-    printf("Deck %d confirmed for player %d, proceeding with matchmaking\n", barajaId, playerId);
-    printf("Player %d requesting to join match from IP %s\n", playerId, playerIp.c_str());
+    LOG_INFO("Deck %d confirmed for player %d, proceeding with matchmaking", barajaId, playerId);
+    LOG_DEBUG("Player %d requesting to join match from IP %s", playerId, playerIp.c_str());
     
     // Verificar si el jugador ya está en una partida activa
     auto playerMatchIt = playerToMatch.find(playerId);
@@ -322,12 +329,12 @@ json MatchmakingService::joinMatch(int playerId, const std::string& playerIp, in
         auto matchIt = activeMatches.find(matchId);
         if (matchIt != activeMatches.end() && matchIt->second->active) {
             // Reconexión a partida existente
-            return json{
+            return withTicket(json{
                 {"status", "reconnect"},
                 {"matchId", matchId},
                 {"serverIp", matchIt->second->ip},
                 {"serverPort", matchIt->second->port}
-            };
+            }, matchId, playerId);
         }
     }
     
@@ -336,7 +343,8 @@ json MatchmakingService::joinMatch(int playerId, const std::string& playerIp, in
     waitingPlayers.emplace_back(playerId, playerIp,barajaId);
     
     // Verificar si tenemos suficientes jugadores para crear una partida
-    if (waitingPlayers.size() >= static_cast<size_t>(playersPerMatch)) {
+    // (con el game engine drenando se quedan en espera)
+    if (engineAccepting && waitingPlayers.size() >= static_cast<size_t>(playersPerMatch)) {
         // Tomar los jugadores necesarios
         std::vector<int> playerIds;
         std::vector<std::string> playerIps;
@@ -371,7 +379,7 @@ json MatchmakingService::joinMatch(int playerId, const std::string& playerIp, in
             // Notificar a TODOS los jugadores que fueron emparejados (no solo al solicitante)
             notifyPlayersMatchFound(playerIds, matchId, serverIp, serverPort);
             
-            return json{
+            return withTicket(json{
                 {"status", "matched"},
                 {"matchId", matchId},
                 {"gameServer", {
@@ -380,13 +388,18 @@ json MatchmakingService::joinMatch(int playerId, const std::string& playerIp, in
                 }},
                 {"players", playerIds},
                 {"message", "Match found! Connect to game server"}
-            };
+            }, matchId, playerId);
         } else {
             // Error creando el servidor, volver a poner jugadores en espera
             for (int i = 0; i < playersPerMatch; i++) {
                 waitingPlayers.emplace_back(playerIds[i], playerIps[i],barajasIds[i]);
             }
-            return gameResult;
+            if (gameResult.value("capacity", -1) == 0) {
+                // Empezó a drenar antes de que llegara su aviso
+                engineAccepting = false;
+            } else {
+                return gameResult;
+            }
         }
     }
     
@@ -401,7 +414,7 @@ json MatchmakingService::joinMatch(int playerId, const std::string& playerIp, in
 json MatchmakingService::leaveMatch(int playerId) {
     std::lock_guard<std::mutex> lock(mutex);
     
-    printf("Player %d requesting to leave match\n", playerId);
+    LOG_INFO("Player %d requesting to leave match", playerId);
     
     // Remover de la lista de espera
     auto waitingIt = std::find_if(waitingPlayers.begin(), waitingPlayers.end(),
@@ -411,7 +424,7 @@ json MatchmakingService::leaveMatch(int playerId) {
     
     if (waitingIt != waitingPlayers.end()) {
         waitingPlayers.erase(waitingIt);
-        printf("Player %d removed from waiting queue\n", playerId);
+        LOG_INFO("Player %d removed from waiting queue", playerId);
         return json{
             {"status", "success"},
             {"message", "Removed from waiting queue"}
@@ -422,7 +435,7 @@ json MatchmakingService::leaveMatch(int playerId) {
     auto playerMatchIt = playerToMatch.find(playerId);
     if (playerMatchIt != playerToMatch.end()) {
         int matchId = playerMatchIt->second;
-        printf("Player %d was in match %d\n", playerId, matchId);
+        LOG_INFO("Player %d was in match %d", playerId, matchId);
         
         // Remover del mapeo
         playerToMatch.erase(playerId);
@@ -442,6 +455,16 @@ json MatchmakingService::leaveMatch(int playerId) {
     };
 }
 
+size_t MatchmakingService::getActiveMatchCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return activeMatches.size();
+}
+
+size_t MatchmakingService::getTrackedPlayerCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return waitingPlayers.size() + playerToMatch.size() + playerConnections.size();
+}
+
 json MatchmakingService::getActiveMatch(int playerId) {
     std::lock_guard<std::mutex> lock(mutex);
     
@@ -450,8 +473,8 @@ json MatchmakingService::getActiveMatch(int playerId) {
         int matchId = playerMatchIt->second;
         auto matchIt = activeMatches.find(matchId);
         if (matchIt != activeMatches.end() && matchIt->second->active) {
-            printf("Player %d reconnecting to active match %d\n", playerId, matchId);
-            return json{
+            LOG_INFO("Player %d reconnecting to active match %d", playerId, matchId);
+            return withTicket(json{
                 {"status", "matched"},
                 {"matchId", matchId},
                 {"gameServer", {
@@ -461,12 +484,12 @@ json MatchmakingService::getActiveMatch(int playerId) {
                 {"players", matchIt->second->playerIds},
                 {"message", "Reconnecting to existing match"},
                 {"reconnection", true}
-            };
+            }, matchId, playerId);
             
         } else {
             // Match existe pero no está activo, limpiar
             playerToMatch.erase(playerId);
-            printf("Player %d had inactive match %d, cleaned up\n", playerId, matchId);
+            LOG_INFO("Player %d had inactive match %d, cleaned up", playerId, matchId);
         }
     }
     
@@ -491,7 +514,7 @@ json MatchmakingService::getActiveMatch(int playerId) {
 void MatchmakingService::notifyMatchEnded(int matchId) {
     std::lock_guard<std::mutex> lock(mutex);
     
-    printf("Match %d ended\n", matchId);
+    LOG_INFO("Match %d ended", matchId);
     
     auto matchIt = activeMatches.find(matchId);
     if (matchIt != activeMatches.end()) {
@@ -505,6 +528,13 @@ void MatchmakingService::notifyMatchEnded(int matchId) {
     }
 }
 
+void MatchmakingService::setEngineCapacity(int capacity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    engineAccepting = capacity > 0;
+    LOG_INFO("Game engine capacity: %d%s", capacity, engineAccepting ? "" : " (draining, new matches on hold)");
+}
+
 json MatchmakingService::createGameServer(const std::vector<int>& playerIds, const std::vector<std::string>& playerIps,const std::vector<int>& barajasIds) {
     int matchId = nextMatchId++;
     
@@ -516,11 +546,7 @@ json MatchmakingService::createGameServer(const std::vector<int>& playerIds, con
         {"barajasIds", barajasIds},  // Enviar IDs de las barajas
     };
     
-    printf("Creating game server for match %d with players: ", matchId);
-    //for (int pid : playerIds) {
-    //    printf("%d ", pid);
-    //}
-    //printf("\n");
+    LOG_INFO("Creating game server for match %d", matchId);
     
     json response = sendToGameEngine(request);
     
@@ -534,58 +560,20 @@ json MatchmakingService::createGameServer(const std::vector<int>& playerIds, con
 }
 
 json MatchmakingService::sendToGameEngine(const json& message) {
-    SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (sock == INVALID_SOCKET) {
-        return json{
-            {"status", "error"},
-            {"message", "Failed to create socket"}
-        };
-    }
-    
-    sockaddr_in serverAddr;
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(gameEnginePort);
-    inet_pton(AF_INET, gameEngineIp.c_str(), &serverAddr.sin_addr);
-    
-    if (connect(sock, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-        closesocket(sock);
-        return json{
-            {"status", "error"},
-            {"message", "Failed to connect to game engine"}
-        };
-    }
-    
-    // Enviar mensaje
-    std::string messageStr = message.dump();
-    if (send(sock, messageStr.c_str(), messageStr.length(), 0) == SOCKET_ERROR) {
-        closesocket(sock);
+    json request = message;
+    ControlAuth::sign(request);
+    try {
+        return engineTransport->request(gameEngineIp, gameEnginePort, request);
+    } catch (const std::exception& e) {
         return json{
             {"status", "error"},
-            {"message", "Failed to send message"}
+            {"message", e.what()}
         };
     }
-    
-    // Recibir respuesta
-    char buffer[4096];
-    int bytesReceived = recv(sock, buffer, sizeof(buffer) - 1, 0);
-    closesocket(sock);
-    
-    if (bytesReceived > 0) {
-        buffer[bytesReceived] = '\0';
-        try {
-            return json::parse(buffer);
-        } catch (const std::exception& e) {
-            return json{
-                {"status", "error"},
-                {"message", "Invalid response from game engine"}
-            };
-        }
-    }
-    
-    return json{
-        {"status", "error"},
-        {"message", "No response from game engine"}
-    };
+}
+
+void MatchmakingService::setTransport(std::shared_ptr<ControlTransport> transport) {
+    engineTransport = transport;
 }
 
 json MatchmakingService::handleHttpRequest(const std::string& httpRequest, const std::string& clientIp) {
@@ -641,13 +629,21 @@ void MatchmakingService::sendHttpResponse(SOCKET clientSocket, const json& jsonR
     send(clientSocket, responseStr.c_str(), responseStr.length(), 0);
 }
 
+json MatchmakingService::withTicket(json response, int matchId, int playerId) {
+    // Cada jugador recibe solo el suyo: el engine lo valida sin conocer su IP
+    if (MatchTicket::enabled()) {
+        response["ticket"] = MatchTicket::issue(matchId, playerId);
+    }
+    return response;
+}
+
 void MatchmakingService::notifyPlayersMatchFound(const std::vector<int>& playerIds, int matchId, 
                                                 const std::string& serverIp, int serverPort) {
-    printf("Notifying players about match %d: ", matchId);
+    std::string players;
     for (int playerId : playerIds) {
-        printf("%d ", playerId);
+        players += std::to_string(playerId) + " ";
     }
-    printf("\n");
+    LOG_INFO("Notifying players about match %d: %s", matchId, players.c_str());
     
     json matchNotification = {
         {"status", "matched"},
@@ -666,7 +662,7 @@ void MatchmakingService::notifyPlayersMatchFound(const std::vector<int>& playerI
     
     // Almacenar la notificación para que los jugadores la puedan recuperar
     for (int playerId : playerIds) {
-        printf("Player %d has been assigned to match %d\n", playerId, matchId);
+        LOG_INFO("Player %d has been assigned to match %d", playerId, matchId);
     }
 }
 
@@ -689,21 +685,21 @@ bool MatchmakingService::sendMessageToPlayer(int playerId, const json& message)
             int result = send(connIt->second->socket, responseStr.c_str(), responseStr.length(), 0);
             
             if (result == SOCKET_ERROR) {
-                printf("Failed to send message to player %d\n", playerId);
+                LOG_WARN("Failed to send message to player %d", playerId);
                 connIt->second->isConnected = false;
                 return false;
             }
             
-            printf("Message sent to player %d\n", playerId);
+            LOG_DEBUG("Message sent to player %d", playerId);
             return true;
         } catch (const std::exception& e) {
-            printf("Error sending message to player %d: %s\n", playerId, e.what());
+            LOG_ERROR("Error sending message to player %d: %s", playerId, e.what());
             connIt->second->isConnected = false;
             return false;
         }
     }
     
-    printf("Player %d is not connected\n", playerId);
+    LOG_WARN("Player %d is not connected", playerId);
     return false;
 }
 
@@ -725,7 +721,7 @@ void MatchmakingService::checkPlayerConnections() {
             
             if (playerMatchIt != playerToMatch.end()) {
                 int matchId = playerMatchIt->second;
-                printf("Player %d disconnected but has active match %d - ready for reconnection\n", playerId, matchId);
+                LOG_INFO("Player %d disconnected but has active match %d - ready for reconnection", playerId, matchId);
             }
             
             
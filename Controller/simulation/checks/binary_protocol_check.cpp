@@ -0,0 +1,136 @@
+#include "check.hpp"
+#include "binary_protocol.hpp"
+#include "scripted_match.hpp"
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Cada mensaje vuelve igual tras codificar y decodificar
+static void checkRoundTrip(const json& message) {
+    json decoded = BinaryProtocol::decode(BinaryProtocol::encode(message));
+    if (decoded != message) {
+        throw CheckFailure("round trip changed " + message.dump() + " into " + decoded.dump());
+    }
+}
+
+// Un payload mal formado se rechaza con std::runtime_error (nunca otra
+// excepción ni un acceso fuera del buffer)
+static bool rejects(const std::string& payload) {
+    try {
+        BinaryProtocol::decode(payload);
+        return false;
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+}
+
+// Todos los tipos de valor, con claves y strings de las tablas y fuera de ellas
+static CheckRegistrar valueRoundTrip("binary-protocol/round-trip-values", []() {
+    checkRoundTrip(json::object());
+    checkRoundTrip({{"type", "action"}, {"action", "attack"}, {"fromX", 0}, {"fromY", 6},
+                    {"targetX", 4}, {"targetY", 0}});
+    checkRoundTrip({{"type", "playerMessage"}, {"content", "hola, ¿qué tal? ñ \xF0\x9F\x83\x8F"},
+                    {"unknownKey", "unknown value"}, {"", ""}});
+    checkRoundTrip({{"null", nullptr}, {"t", true}, {"f", false}, {"zero", 0}, {"minusOne", -1},
+                    {"int64Min", std::numeric_limits<int64_t>::min()},
+                    {"int64Max", std::numeric_limits<int64_t>::max()},
+                    {"uint64Max", std::numeric_limits<uint64_t>::max()},
+                    {"varintEdge", 127}, {"varintEdge2", 128}, {"negEdge", -128}, {"negEdge2", -129},
+                    {"double", 3.25}, {"negDouble", -1e-300}});
+    checkRoundTrip({{"nested", {{"array", json::array({1, "two", json::array(), json::object(), nullptr})},
+                                {"deep", {{"deeper", {{"deepest", {1, 2, 3}}}}}}}}});
+    checkRoundTrip({{"longString", std::string(100000, 'x')}, {"binary", std::string("a\0b", 3)}});
+
+    // Un objeto de más de 16 niveles no se acepta al decodificar
+    json deep = json::object();
+    for (int level = 0; level < 40; level++) {
+        deep = {{"a", deep}};
+    }
+    CHECK(rejects(BinaryProtocol::encode(deep)));
+
+    // Solo se codifican objetos
+    bool threw = false;
+    try {
+        BinaryProtocol::encode(json::array({1, 2}));
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+});
+
+// Los mensajes que de verdad envía el motor en partidas completas
+static CheckRegistrar matchRoundTrip("binary-protocol/round-trip-match-messages", []() {
+    size_t messages = 0;
+    for (int matchId = 1; matchId <= 50; matchId++) {
+        ScriptedMatch scripted(matchId, static_cast<uint32_t>(matchId));
+        scripted.getMatch().sendState(Match::SPECTATORS);
+        int playerId;
+        MatchEngine::Action action;
+        for (int step = 0; step < 2000 && scripted.chooseAction(playerId, action); step++) {
+            scripted.apply(playerId, action);
+            for (const auto& output : scripted.takeMessages()) {
+                checkRoundTrip(output.second);
+                messages++;
+            }
+        }
+    }
+    CHECK(messages > 1000);
+});
+
+// Cualquier prefijo de un mensaje válido, bytes sueltos cambiados o basura
+// se rechazan sin salirse del buffer
+static CheckRegistrar malformedInput("binary-protocol/malformed-input", []() {
+    ScriptedMatch scripted(1, 1);
+    std::vector<std::string> samples;
+    for (const auto& output : scripted.takeMessages()) {
+        samples.push_back(BinaryProtocol::encode(output.second));
+    }
+    samples.push_back(BinaryProtocol::encode({{"type", "action"}, {"action", "endTurn"}, {"x", -5}, {"d", 1.5}}));
+    CHECK(!samples.empty());
+
+    for (const std::string& payload : samples) {
+        for (size_t length = 0; length < payload.size(); length++) {
+            CHECK(rejects(payload.substr(0, length)));
+        }
+        CHECK(rejects(payload + std::string(1, '\0')));
+    }
+
+    // Mutaciones al azar: o se rechazan o decodifican a un objeto
+    std::mt19937 rng(1);
+    for (int round = 0; round < 20000; round++) {
+        std::string payload = samples[rng() % samples.size()];
+        int flips = 1 + static_cast<int>(rng() % 4);
+        for (int i = 0; i < flips; i++) {
+            payload[rng() % payload.size()] = static_cast<char>(rng());
+        }
+        try {
+            CHECK(BinaryProtocol::decode(payload).is_object());
+        } catch (const std::runtime_error&) {
+        }
+    }
+    for (int round = 0; round < 20000; round++) {
+        std::string payload(rng() % 64, '\0');
+        for (char& byte : payload) {
+            byte = static_cast<char>(rng());
+        }
+        try {
+            CHECK(BinaryProtocol::decode(payload).is_object());
+        } catch (const std::runtime_error&) {
+        }
+    }
+
+    // Casos concretos: longitudes enormes, etiquetas desconocidas, varints sin fin
+    CHECK(rejects(std::string("\x01\x00\xFF\xFF\xFF\xFF\x0F", 7)));           // clave literal de 4 GB
+    CHECK(rejects(std::string("\x01\x01\x05\xFF\xFF\xFF\xFF\x0F", 8)));       // string de 4 GB
+    CHECK(rejects(std::string("\x01\x01\x08\xFF\xFF\xFF\xFF\x0F", 8)));       // array de 2^32 elementos
+    CHECK(rejects(std::string("\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x7F", 10))); // 2^63 campos
+    CHECK(rejects(std::string("\x01\x7F\x00", 3)));                           // etiqueta de clave desconocida
+    CHECK(rejects(std::string("\x01\x01\x06\x7F", 4)));                       // string conocido desconocido
+    CHECK(rejects(std::string("\x01\x01\x0A", 3)));                           // tipo de valor desconocido
+    CHECK(rejects(std::string("\x01\x01\x09\x00\x00", 5)));                   // double truncado
+    CHECK(rejects(std::string("\x01\x01\x04\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x01", 13))); // negativo fuera de rango
+    CHECK(rejects(std::string(1, '\x01') + std::string(11, '\x80')));         // varint de más de 64 bits
+});
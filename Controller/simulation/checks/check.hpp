@@ -0,0 +1,35 @@
+#pragma once
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Comprobaciones de `make check`: cada una es una función que falla lanzando
+// CheckFailure (con CHECK). Se registran solas desde su .cpp con CheckRegistrar
+class CheckFailure : public std::runtime_error {
+public:
+    explicit CheckFailure(const std::string& message) : std::runtime_error(message) {}
+};
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            throw CheckFailure(std::string(__FILE__) + ":" + std::to_string(__LINE__) + \
+                               ": " #condition);                                      \
+        }                                                                             \
+    } while (0)
+
+struct CheckCase {
+    std::string name;
+    std::function<void()> run;
+};
+
+// Todas las comprobaciones enlazadas, en orden de registro
+std::vector<CheckCase>& checkRegistry();
+
+struct CheckRegistrar {
+    CheckRegistrar(const std::string& name, std::function<void()> run) {
+        checkRegistry().push_back({name, std::move(run)});
+    }
+};
@@ -0,0 +1,119 @@
+#include "check.hpp"
+#include "game_thread.hpp"
+#include "mpsc_queue.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Buzón de los GameThread (MpscQueue): varios productores contra un buzón
+// pequeño, siempre lleno. Nada se pierde ni se duplica y cada productor
+// conserva su orden
+static CheckRegistrar mpscStress("mailbox/mpsc-order-under-contention", []() {
+    const int PRODUCERS = 4;
+    const uint32_t PER_PRODUCER = 50000;
+    MpscQueue<uint64_t> queue(64);
+
+    std::atomic<bool> start(false);
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < PRODUCERS; producer++) {
+        producers.emplace_back([&queue, &start, producer]() {
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            for (uint32_t seq = 0; seq < PER_PRODUCER; seq++) {
+                uint64_t value = (static_cast<uint64_t>(producer) << 32) | seq;
+                while (!queue.push(std::move(value))) {
+                    std::this_thread::yield();  // Lleno: el productor reintenta
+                }
+            }
+        });
+    }
+
+    std::vector<uint32_t> next(PRODUCERS, 0);
+    uint64_t received = 0;
+    start.store(true);
+    while (received < static_cast<uint64_t>(PRODUCERS) * PER_PRODUCER) {
+        uint64_t value;
+        if (!queue.pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint32_t producer = static_cast<uint32_t>(value >> 32);
+        uint32_t seq = static_cast<uint32_t>(value);
+        CHECK(producer < static_cast<uint32_t>(PRODUCERS));
+        CHECK(seq == next[producer]);
+        next[producer]++;
+        received++;
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    uint64_t leftover;
+    CHECK(!queue.pop(leftover));
+});
+
+// Con el buzón lleno, las altas de partidas (mensajes de control) nunca
+// esperan ni se pierden; las acciones de los jugadores sí se pueden rechazar
+static CheckRegistrar controlNeverBlocks("mailbox/control-never-blocks-when-full", []() {
+#ifdef _WIN32
+    _putenv_s("GAME_THREAD_MAILBOX", "4");
+#else
+    setenv("GAME_THREAD_MAILBOX", "4", 1);
+#endif
+    auto thread = std::make_shared<GameThread>(1);
+#ifdef _WIN32
+    _putenv_s("GAME_THREAD_MAILBOX", "");
+#else
+    unsetenv("GAME_THREAD_MAILBOX");
+#endif
+
+    const int PRODUCERS = 4;
+    const int MATCHES_PER_PRODUCER = 250;
+    std::atomic<uint64_t> accepted(0);
+    std::atomic<uint64_t> rejected(0);
+    std::atomic<bool> adding(true);
+
+    // Acciones de jugadores en paralelo: llenan el buzón mientras llegan las altas
+    std::thread players([&]() {
+        MatchEngine::Action endTurn;
+        while (adding.load()) {
+            for (int matchId = 1; matchId <= PRODUCERS * MATCHES_PER_PRODUCER; matchId += 7) {
+                if (thread->handlePlayerAction(matchId, 2 * matchId, endTurn)) {
+                    accepted++;
+                } else {
+                    rejected++;
+                }
+            }
+        }
+    });
+
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < PRODUCERS; producer++) {
+        producers.emplace_back([&thread, producer]() {
+            for (int i = 0; i < MATCHES_PER_PRODUCER; i++) {
+                int matchId = producer * MATCHES_PER_PRODUCER + i + 1;
+                thread->addMatch(std::make_shared<Match>(matchId, 2 * matchId, 2 * matchId + 1));
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    adding.store(false);
+    players.join();
+
+    // El worker termina de aplicar lo que quedó en la cola de desborde
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (thread->getActiveMatchCount() < PRODUCERS * MATCHES_PER_PRODUCER &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    CHECK(thread->getActiveMatchCount() == PRODUCERS * MATCHES_PER_PRODUCER);
+    CHECK(accepted.load() + rejected.load() > 0);
+
+    thread->stop();
+});
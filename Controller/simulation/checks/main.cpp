@@ -0,0 +1,118 @@
+#include "check.hpp"
+#include "src/game/MatchEngine.hpp"
+#include "src/utils/Log.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+std::vector<CheckCase>& checkRegistry() {
+    static std::vector<CheckCase> registry;
+    return registry;
+}
+
+// Plazo de cada comprobación: las de concurrencia buscan bloqueos, así que
+// un cuelgue cuenta como fallo en vez de dejar a CI esperando
+static long getCheckTimeoutSeconds() {
+    const char* value = std::getenv("CHECK_TIMEOUT_S");
+    if (value != nullptr && std::atol(value) > 0) {
+        return std::atol(value);
+    }
+    return 120;
+}
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    if (std::getenv("LOG_LEVEL") == nullptr) {
+        _putenv_s("LOG_LEVEL", "error");
+    }
+    if (std::getenv("MATCH_SEED") == nullptr) {
+        _putenv_s("MATCH_SEED", "1");
+    }
+#else
+    setenv("LOG_LEVEL", "error", 0);
+    setenv("MATCH_SEED", "1", 0);
+#endif
+
+    std::string decksFile = "../../SD_GameEngine-main/decks.json";
+    const char* decksEnv = std::getenv("DECKS_FILE");
+    if (decksEnv != nullptr && decksEnv[0] != '\0') {
+        decksFile = decksEnv;
+    }
+    if (!MatchEngine::loadDecks(decksFile)) {
+        std::fprintf(stderr, "Could not load decks from %s\n", decksFile.c_str());
+        return 1;
+    }
+
+    // Sin argumentos se ejecutan todas; con argumentos, las que contienen alguno
+    std::vector<const CheckCase*> selected;
+    for (const CheckCase& check : checkRegistry()) {
+        bool matches = argc < 2;
+        for (int i = 1; i < argc && !matches; i++) {
+            matches = check.name.find(argv[i]) != std::string::npos;
+        }
+        if (matches) {
+            selected.push_back(&check);
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    const CheckCase* running = nullptr;
+    bool done = false;
+    std::thread watchdog([&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        const CheckCase* watched = nullptr;
+        auto deadline = std::chrono::steady_clock::now();
+        while (!done) {
+            if (running != watched) {
+                watched = running;
+                deadline = std::chrono::steady_clock::now() + std::chrono::seconds(getCheckTimeoutSeconds());
+            }
+            if (watched != nullptr && std::chrono::steady_clock::now() >= deadline) {
+                std::printf("TIMEOUT %s (more than %ld s)\n", watched->name.c_str(), getCheckTimeoutSeconds());
+                std::fflush(stdout);
+                std::_Exit(2);
+            }
+            finished.wait_for(lock, std::chrono::milliseconds(100));
+        }
+    });
+
+    int failures = 0;
+    for (const CheckCase* check : selected) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = check;
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::string error;
+        try {
+            check->run();
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (error.empty()) {
+            std::printf("PASS    %-40s %8.1f ms\n", check->name.c_str(), elapsedMs);
+        } else {
+            std::printf("FAIL    %-40s %s\n", check->name.c_str(), error.c_str());
+            failures++;
+        }
+        std::fflush(stdout);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = nullptr;
+        done = true;
+    }
+    finished.notify_all();
+    watchdog.join();
+
+    std::printf("%zu checks, %d failed\n", selected.size(), failures);
+    Logger::getInstance().flush();
+    return failures == 0 ? 0 : 1;
+}
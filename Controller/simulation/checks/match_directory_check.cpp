@@ -0,0 +1,133 @@
+#include "check.hpp"
+#include "game_thread.hpp"
+#include "match.hpp"
+#include "match_directory.hpp"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// MatchDirectory bajo contención: búsquedas, altas/bajas y cambios de hilo
+// dueño a la vez. Las partidas fijas se encuentran siempre con su dueño
+// coherente, y el contador cuadra al terminar
+static CheckRegistrar shardContention("match-directory/lookup-under-contention", []() {
+    const int RESIDENT = 256;        // matchId 1..RESIDENT, no se borran nunca
+    const int CHURN_BASE = 100000;   // Partidas que se crean y terminan sin parar
+    const int CHURN_WRITERS = 2;
+    const int CHURN_PER_WRITER = 512;
+    const int ROUNDS = 40;
+    const int READERS = 4;
+
+    auto threadA = std::make_shared<GameThread>(1);
+    auto threadB = std::make_shared<GameThread>(2);
+
+    MatchDirectory directory;
+    for (int matchId = 1; matchId <= RESIDENT; matchId++) {
+        CHECK(directory.insert(matchId, std::make_shared<Match>(matchId, 2 * matchId, 2 * matchId + 1), threadA));
+    }
+    CHECK(!directory.insert(1, std::make_shared<Match>(1, 2, 3), threadB));
+
+    // Las partidas de la rotación se crean una vez: lo que se mide es el directorio
+    std::vector<std::shared_ptr<Match>> churnMatches;
+    for (int matchId = CHURN_BASE; matchId < CHURN_BASE + CHURN_WRITERS * CHURN_PER_WRITER; matchId++) {
+        churnMatches.push_back(std::make_shared<Match>(matchId, 2 * matchId, 2 * matchId + 1));
+    }
+
+    std::atomic<bool> running(true);
+    std::atomic<uint64_t> errors(0);
+
+    // Lectores: el camino de cada mensaje (find + visit) nunca pierde una
+    // partida fija ni ve una entrada a medias
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < READERS; reader++) {
+        readers.emplace_back([&, reader]() {
+            int matchId = reader + 1;
+            while (running.load()) {
+                auto match = directory.find(matchId);
+                if (!match || match->getMatchId() != matchId) {
+                    errors++;
+                }
+                bool visited = directory.visit(matchId, [&](const MatchDirectory::Entry& entry) {
+                    if (entry.match->getMatchId() != matchId ||
+                        (entry.thread != threadA && entry.thread != threadB)) {
+                        errors++;
+                    }
+                });
+                if (!visited) {
+                    errors++;
+                }
+                // Las de la rotación pueden estar o no, pero si están son ellas
+                int churnId = CHURN_BASE + (matchId % (CHURN_WRITERS * CHURN_PER_WRITER));
+                auto churn = directory.find(churnId);
+                if (churn && churn->getMatchId() != churnId) {
+                    errors++;
+                }
+                matchId = matchId % RESIDENT + 1;
+            }
+        });
+    }
+
+    // Reparto de carga: cada partida fija cambia de hilo un número par de veces
+    // y la callback siempre recibe al dueño anterior
+    std::thread rebalancer([&]() {
+        for (int round = 0; round < 2 * ROUNDS; round++) {
+            auto from = round % 2 == 0 ? threadA : threadB;
+            auto to = round % 2 == 0 ? threadB : threadA;
+            for (int matchId = 1; matchId <= RESIDENT; matchId++) {
+                bool moved = directory.reassign(matchId, to, [&](const MatchDirectory::Entry& previous) {
+                    if (previous.thread != from) {
+                        errors++;
+                    }
+                });
+                if (!moved) {
+                    errors++;
+                }
+            }
+        }
+    });
+
+    std::vector<std::thread> writers;
+    for (int writer = 0; writer < CHURN_WRITERS; writer++) {
+        writers.emplace_back([&, writer]() {
+            int first = CHURN_BASE + writer * CHURN_PER_WRITER;
+            for (int round = 0; round < ROUNDS; round++) {
+                for (int matchId = first; matchId < first + CHURN_PER_WRITER; matchId++) {
+                    if (!directory.insert(matchId, churnMatches[matchId - CHURN_BASE], threadA)) {
+                        errors++;
+                    }
+                }
+                for (int matchId = first; matchId < first + CHURN_PER_WRITER; matchId++) {
+                    auto erased = directory.erase(matchId);
+                    if (!erased || erased->getMatchId() != matchId) {
+                        errors++;
+                    }
+                }
+            }
+        });
+    }
+
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    rebalancer.join();
+    running.store(false);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    CHECK(errors.load() == 0);
+    CHECK(directory.size() == static_cast<size_t>(RESIDENT));
+    size_t visited = 0;
+    directory.forEach([&](int matchId, const MatchDirectory::Entry& entry) {
+        CHECK(matchId >= 1 && matchId <= RESIDENT);
+        CHECK(entry.thread == threadA);
+        visited++;
+    });
+    CHECK(visited == static_cast<size_t>(RESIDENT));
+    CHECK(directory.erase(CHURN_BASE) == nullptr);
+
+    directory.clear();
+    CHECK(directory.size() == 0);
+    threadA->stop();
+    threadB->stop();
+});
@@ -0,0 +1,87 @@
+#include "scripted_match.hpp"
+#include <stdexcept>
+#include <string>
+
+// Tablero de las reglas actuales (como el bot de loadtest)
+static const int BOARD_WIDTH = 5;
+static const int BOARD_HEIGHT = 7;
+
+ScriptedMatch::ScriptedMatch(int matchId, uint32_t seed, int actionsPerTurn)
+    : player1Id(2 * matchId), player2Id(2 * matchId + 1), actionsPerTurn(actionsPerTurn),
+      match(new Match(matchId, 2 * matchId, 2 * matchId + 1)), rng(seed) {
+    match->setOutput([this](int playerId, const json& message) {
+        onOutput(playerId, message);
+    });
+    match->sendState(player1Id);
+    match->sendState(player2Id);
+}
+
+std::vector<std::pair<int, json>> ScriptedMatch::takeMessages() {
+    std::vector<std::pair<int, json>> taken;
+    taken.swap(messages);
+    return taken;
+}
+
+void ScriptedMatch::onOutput(int playerId, const json& message) {
+    messages.emplace_back(playerId, message);
+    const std::string type = message.value("type", "");
+    if (type == "gameState" && (playerId == player1Id || playerId == player2Id)) {
+        lastState[playerId == player1Id ? 0 : 1] = message;
+    } else if (type == "gameOver") {
+        over = true;
+    }
+}
+
+bool ScriptedMatch::chooseAction(int& playerId, MatchEngine::Action& action) {
+    if (over) {
+        return false;
+    }
+    const json& state = lastState[0];
+    playerId = state.at("currentPlayerId").get<int>();
+    if (playerId != turnPlayerId) {
+        turnPlayerId = playerId;
+        actionsThisTurn = 0;
+    }
+    const json& mine = lastState[playerId == player1Id ? 0 : 1];
+
+    json request = {{"action", "endTurn"}};
+    std::vector<const json*> own, rival;
+    for (const auto& cell : mine.at("board")) {
+        (cell.at("ownerId").get<int>() == playerId ? own : rival).push_back(&cell);
+    }
+    size_t handSize = mine.at("you").at("hand").size();
+    std::uniform_int_distribution<int> percent(0, 99);
+    if (actionsThisTurn >= actionsPerTurn) {
+        // endTurn
+    } else if (!own.empty() && !rival.empty() && (percent(rng) < 60 || handSize == 0)) {
+        // Atacar a una carta rival o acercarse un paso hacia ella
+        const json& from = *own[rng() % own.size()];
+        const json& target = *rival[rng() % rival.size()];
+        int fromX = from.at("x"), fromY = from.at("y");
+        int targetX = target.at("x"), targetY = target.at("y");
+        if (rng() % 2) {
+            request = {{"action", "attack"}, {"fromX", fromX}, {"fromY", fromY},
+                       {"targetX", targetX}, {"targetY", targetY}};
+        } else {
+            request = {{"action", "moveCard"}, {"fromX", fromX}, {"fromY", fromY},
+                       {"x", fromX + (targetX > fromX) - (targetX < fromX)},
+                       {"y", fromY + (targetY > fromY) - (targetY < fromY)}};
+        }
+    } else if (handSize > 0) {
+        std::uniform_int_distribution<int> card(0, static_cast<int>(handSize) - 1);
+        std::uniform_int_distribution<int> column(0, BOARD_WIDTH - 1);
+        std::uniform_int_distribution<int> row(0, BOARD_HEIGHT - 1);
+        request = {{"action", "playCard"}, {"handIndex", card(rng)}, {"x", column(rng)}, {"y", row(rng)}};
+    }
+
+    std::string error;
+    if (!Match::decodeAction(request, action, error)) {
+        throw std::runtime_error("ScriptedMatch: " + error);
+    }
+    actionsThisTurn++;
+    return true;
+}
+
+bool ScriptedMatch::apply(int playerId, const MatchEngine::Action& action) {
+    return match->applyAction(playerId, action);
+}
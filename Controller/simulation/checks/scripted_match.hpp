@@ -0,0 +1,47 @@
+#pragma once
+
+#include "match.hpp"
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Partida jugada directamente sobre Match, sin GameThread ni red: las
+// comprobaciones que necesitan mensajes reales del motor (estados, deltas,
+// eventos) la avanzan jugada a jugada. Los jugadores deciden como SimPlayer,
+// sobre el último estado completo que recibieron y con su semilla, así que
+// con MATCH_SEED la partida es siempre la misma. No confirman versiones:
+// cada cambio les llega como gameState completo
+class ScriptedMatch {
+public:
+    ScriptedMatch(int matchId, uint32_t seed, int actionsPerTurn = 4);
+
+    Match& getMatch() { return *match; }
+    int getPlayerId(int seat) const { return seat == 0 ? player1Id : player2Id; }
+
+    // Mensajes que envió la partida (destino, mensaje) desde la última llamada
+    std::vector<std::pair<int, json>> takeMessages();
+
+    // Siguiente jugada del jugador en turno (false si la partida terminó)
+    bool chooseAction(int& playerId, MatchEngine::Action& action);
+
+    // Aplicar una jugada; true si con ella terminó la partida
+    bool apply(int playerId, const MatchEngine::Action& action);
+
+    bool isOver() const { return over; }
+
+private:
+    void onOutput(int playerId, const json& message);
+
+    int player1Id;
+    int player2Id;
+    int actionsPerTurn;
+    std::unique_ptr<Match> match;
+    std::mt19937 rng;
+
+    std::vector<std::pair<int, json>> messages;
+    json lastState[2];          // Último gameState de cada asiento
+    int actionsThisTurn = 0;
+    int turnPlayerId = -1;
+    bool over = false;
+};
@@ -0,0 +1,201 @@
+#include "check.hpp"
+#include "scripted_match.hpp"
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+
+// Cliente que aplica los deltas: guarda cada versión que recibió (el delta
+// puede venir contra una versión confirmada anterior a la última)
+namespace {
+struct DeltaClient {
+    std::map<uint64_t, json> versions;
+    uint64_t latest = 0;
+    uint64_t acked = 0;
+    size_t deltas = 0;
+
+    void receive(const json& message) {
+        const std::string type = message.at("type").get<std::string>();
+        if (type == "gameState") {
+            store(message);
+        } else if (type == "stateDelta") {
+            auto base = versions.find(message.at("baseVersion").get<uint64_t>());
+            CHECK(base != versions.end());
+            store(applyDelta(base->second, message));
+            deltas++;
+        }
+    }
+
+    void store(json state) {
+        state["type"] = "gameState";
+        uint64_t version = state.at("version").get<uint64_t>();
+        CHECK(version >= latest);
+        latest = version;
+        versions[version] = std::move(state);
+    }
+
+    static void merge(json& target, const json& changes) {
+        for (auto it = changes.begin(); it != changes.end(); ++it) {
+            target[it.key()] = it.value();
+        }
+    }
+
+    static json applyDelta(json state, const json& delta) {
+        for (const char* field : {"matchId", "version", "seq", "turn", "currentPlayerId", "phase", "gameOver"}) {
+            state[field] = delta.at(field);
+        }
+        for (const char* side : {"you", "opponent"}) {
+            if (delta.contains(side)) {
+                merge(state.at(side), delta.at(side));
+            }
+        }
+        if (delta.contains("players")) {
+            for (const auto& view : delta.at("players")) {
+                bool found = false;
+                for (auto& player : state.at("players")) {
+                    if (player.at("playerId") == view.at("playerId")) {
+                        merge(player, view);
+                        found = true;
+                    }
+                }
+                CHECK(found);
+            }
+        }
+        json& board = state.at("board");
+        auto sameCell = [](const json& a, const json& b) {
+            return a.at("x") == b.at("x") && a.at("y") == b.at("y");
+        };
+        if (delta.contains("removed")) {
+            for (const auto& cell : delta.at("removed")) {
+                size_t before = board.size();
+                for (size_t i = 0; i < board.size(); i++) {
+                    if (sameCell(board[i], cell)) {
+                        board.erase(i);
+                        break;
+                    }
+                }
+                CHECK(board.size() + 1 == before);
+            }
+        }
+        if (delta.contains("cells")) {
+            for (const auto& cell : delta.at("cells")) {
+                bool replaced = false;
+                for (auto& existing : board) {
+                    if (sameCell(existing, cell)) {
+                        existing = cell;
+                        replaced = true;
+                    }
+                }
+                if (!replaced) {
+                    board.push_back(cell);
+                }
+            }
+        }
+        return state;
+    }
+};
+}
+
+// El orden del tablero no forma parte del estado
+static json normalized(json state) {
+    json& board = state.at("board");
+    std::vector<json> cells(board.begin(), board.end());
+    std::sort(cells.begin(), cells.end(), [](const json& a, const json& b) {
+        return std::make_pair(a.at("x").get<int>(), a.at("y").get<int>()) <
+               std::make_pair(b.at("x").get<int>(), b.at("y").get<int>());
+    });
+    board = cells;
+    return state;
+}
+
+// Dos partidas iguales (misma semilla, mismas jugadas): en una los clientes
+// confirman versiones y reciben deltas, en la otra reciben siempre el estado
+// completo. Tras cada jugada, el estado reconstruido con los deltas es
+// idéntico al completo, para los dos jugadores y para los espectadores
+static CheckRegistrar deltaEquivalence("state-delta/apply-equals-full-state", []() {
+    size_t deltas = 0;
+    size_t compared = 0;
+    std::mt19937 rng(7);
+    for (int matchId = 1; matchId <= 100; matchId++) {
+        ScriptedMatch withDeltas(matchId, static_cast<uint32_t>(matchId));
+        ScriptedMatch reference(matchId, static_cast<uint32_t>(matchId));
+        withDeltas.getMatch().sendState(Match::SPECTATORS);
+
+        // Clientes: asiento 0, asiento 1 y espectador
+        DeltaClient clients[3];
+        const int targets[3] = {withDeltas.getPlayerId(0), withDeltas.getPlayerId(1), Match::SPECTATORS};
+        json expected[3];
+        auto deliver = [&]() {
+            for (const auto& output : withDeltas.takeMessages()) {
+                for (int i = 0; i < 3; i++) {
+                    if (output.first == targets[i]) {
+                        clients[i].receive(output.second);
+                    }
+                }
+            }
+            reference.getMatch().sendState(Match::SPECTATORS);
+            for (const auto& output : reference.takeMessages()) {
+                for (int i = 0; i < 3; i++) {
+                    if (output.first == targets[i] && output.second.at("type") == "gameState") {
+                        expected[i] = output.second;
+                    }
+                }
+            }
+        };
+        deliver();
+
+        int playerId;
+        MatchEngine::Action action;
+        for (int step = 0; step < 2000 && reference.chooseAction(playerId, action); step++) {
+            withDeltas.apply(playerId, action);
+            reference.apply(playerId, action);
+            deliver();
+
+            for (int i = 0; i < 3; i++) {
+                CHECK(!clients[i].versions.empty());
+                json rebuilt = clients[i].versions.rbegin()->second;
+                json full = expected[i];
+                // El estado completo de referencia para espectadores se pide
+                // después de la jugada: puede contar ya su gameOver en "seq"
+                if (targets[i] == Match::SPECTATORS) {
+                    rebuilt.erase("seq");
+                    full.erase("seq");
+                }
+                if (normalized(rebuilt) != normalized(full)) {
+                    throw CheckFailure("match " + std::to_string(matchId) + " step " + std::to_string(step) +
+                                       ": delta state " + rebuilt.dump() + " differs from full state " +
+                                       full.dump());
+                }
+                compared++;
+            }
+
+            // Los jugadores confirman casi siempre la última versión, a veces una
+            // anterior que aún guardan, a veces ninguna; de vez en cuando piden
+            // el estado completo (resync)
+            for (int seat = 0; seat < 2; seat++) {
+                DeltaClient& client = clients[seat];
+                int roll = static_cast<int>(rng() % 100);
+                if (roll < 70) {
+                    client.acked = client.latest;
+                } else if (roll < 85) {
+                    auto it = client.versions.lower_bound(client.acked);
+                    std::advance(it, rng() % std::distance(it, client.versions.end()));
+                    client.acked = it->first;
+                } else if (roll < 98) {
+                    continue;
+                } else {
+                    withDeltas.getMatch().sendState(targets[seat]);
+                    client.acked = 0;
+                    continue;
+                }
+                withDeltas.getMatch().ackState(targets[seat], client.acked);
+            }
+            deliver();
+        }
+        for (const DeltaClient& client : clients) {
+            deltas += client.deltas;
+        }
+    }
+    CHECK(compared > 1000);
+    CHECK(deltas > compared / 3);
+});
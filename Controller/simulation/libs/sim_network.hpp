@@ -0,0 +1,163 @@
+#pragma once
+
+#include "control_transport.hpp"
+#include "game_transport.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+// Condiciones de la red simulada (SIM_LATENCY_MS, SIM_JITTER_MS,
+// SIM_LOSS_PERCENT, SIM_RTO_MS, SIM_CONTROL_LATENCY_MS)
+struct SimLinkConfig {
+    std::chrono::microseconds latency{0};         // Retardo de un sentido
+    std::chrono::microseconds jitter{0};          // Retardo extra, uniforme entre 0 y jitter
+    int lossPercent = 0;                          // % de mensajes perdidos en el primer intento
+    std::chrono::microseconds rto{200000};        // Lo que tarda en reenviarse un mensaje perdido
+    std::chrono::microseconds controlLatency{0};  // Ida y vuelta de una petición de control
+
+    static SimLinkConfig fromEnvironment();
+};
+
+// Canal de control en memoria: cada "puerto" es un handler que atiende la
+// petición en el hilo de quien la envía, como el socket bloqueante que
+// sustituye. Las pérdidas se ven como en TCP: la petición llega más tarde
+class SimControlNetwork : public ControlTransport {
+public:
+    typedef std::function<json(const json&)> Handler;
+
+    explicit SimControlNetwork(const SimLinkConfig& config);
+
+    // Atender las peticiones dirigidas a port (cualquier host)
+    void listen(int port, Handler handler);
+
+    json request(const std::string& host, int port, const json& body) override;
+
+    uint64_t getRequestCount() const { return requests.load(); }
+
+private:
+    const SimLinkConfig& config;
+    std::unordered_map<int, Handler> handlers;
+    std::mutex rngMutex;
+    std::mt19937 rng;
+    std::atomic<uint64_t> requests{0};
+};
+
+// Un sentido de una conexión: cola FIFO con un único timer armado para el
+// primer mensaje. Los mensajes salen en orden aunque el jitter o una pérdida
+// retrasen a uno (el siguiente espera, como en TCP)
+class SimLink : public std::enable_shared_from_this<SimLink> {
+public:
+    typedef std::function<void()> Delivery;
+
+    SimLink(websocketpp::lib::asio::io_service& io, const SimLinkConfig& config, uint32_t seed);
+
+    // Entregar delivery tras el retardo de la red (bytes cuenta como pendiente hasta entonces)
+    void push(size_t bytes, Delivery delivery);
+
+    size_t getQueuedBytes();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Pending {
+        Clock::time_point at;
+        size_t bytes;
+        Delivery delivery;
+    };
+
+    // Con el mutex tomado y la cola no vacía
+    void arm();
+    void fire();
+
+    websocketpp::lib::asio::io_service& io;
+    const SimLinkConfig& config;
+    std::mt19937 rng;
+    std::mutex mutex;
+    std::deque<Pending> queue;
+    size_t queuedBytes = 0;
+    bool armed = false;
+    Clock::time_point last;
+    websocketpp::lib::asio::steady_timer timer;
+};
+
+// Extremo cliente de una conexión simulada
+class SimClient {
+public:
+    virtual ~SimClient() {}
+    virtual void onMessage(const std::string& payload, bool binary) = 0;
+    virtual void onClose() = 0;
+};
+
+// Conexiones de juego en memoria, vistas desde el servidor como un
+// GameTransport (lo que usan GameGateway y GameSession)
+class SimGameTransport : public GameTransport {
+public:
+    typedef std::function<void(connection_hdl, const std::string&, bool)> MessageHandler;
+    typedef std::function<void(connection_hdl)> CloseHandler;
+    typedef std::function<void(connection_hdl, const std::string&)> PongHandler;
+
+    SimGameTransport(websocketpp::lib::asio::io_service& io, const SimLinkConfig& config);
+
+    // Eventos que llegan al servidor (GameGateway::onTransportMessage/onTransportClose
+    // y los pongs para HeartbeatMonitor)
+    void setServerHandlers(MessageHandler onMessage, CloseHandler onClose, PongHandler onPong = nullptr);
+
+    // Abrir una conexión; devuelve el handle que usa el cliente para enviar
+    connection_hdl connect(std::shared_ptr<SimClient> client, bool binary);
+
+    // Cliente -> servidor
+    void clientSend(connection_hdl hdl, const std::string& payload);
+    void clientClose(connection_hdl hdl);
+
+    using GameTransport::send;
+    using GameTransport::close;
+
+    // Servidor -> cliente
+    websocketpp::lib::asio::io_service& getIoService() override;
+    void send(connection_hdl hdl, const std::string& payload,
+              websocketpp::frame::opcode::value opcode, websocketpp::lib::error_code& ec) override;
+    void close(connection_hdl hdl, websocketpp::close::status::value code,
+               const std::string& reason, websocketpp::lib::error_code& ec) override;
+    void ping(connection_hdl hdl, const std::string& payload, websocketpp::lib::error_code& ec) override;
+    size_t getBufferedAmount(connection_hdl hdl) override;
+    std::string getRemoteEndpoint(connection_hdl hdl) override;
+    bool isBinary(connection_hdl hdl) override;
+    void setTimer(long ms, TimerHandler handler) override;
+
+    uint64_t getMessageCount() const { return messages.load(); }
+    size_t getOpenConnections();
+
+private:
+    struct Connection {
+        uint32_t id;
+        bool binary;
+        std::shared_ptr<SimClient> client;
+        std::shared_ptr<SimLink> up;    // Cliente -> servidor
+        std::shared_ptr<SimLink> down;  // Servidor -> cliente
+        std::atomic<bool> closing{false};
+    };
+
+    std::shared_ptr<Connection> find(connection_hdl hdl);
+
+    // Cierre pedido por cualquiera de los extremos: el aviso viaja por los
+    // dos sentidos detrás de lo ya enviado
+    void startClose(const std::shared_ptr<Connection>& connection);
+
+    websocketpp::lib::asio::io_service& io;
+    const SimLinkConfig& config;
+    MessageHandler onServerMessage;
+    CloseHandler onServerClose;
+    PongHandler onServerPong;
+
+    std::mutex mutex;
+    std::unordered_map<uint32_t, std::shared_ptr<Connection>> connections;
+    uint32_t nextConnectionId = 1;
+    std::atomic<uint64_t> messages{0};
+};
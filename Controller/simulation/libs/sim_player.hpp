@@ -0,0 +1,135 @@
+#pragma once
+
+#include "sim_network.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Comportamiento de los jugadores simulados
+struct SimPlayerConfig {
+    int actionsPerTurn = 4;   // Jugadas por turno antes de endTurn
+    bool binary = false;      // Usar el subprotocolo sd-binary.v1
+};
+
+// Contadores compartidos por todos los jugadores
+struct SimStats {
+    std::atomic<uint64_t> actionsSent{0};
+    std::atomic<uint64_t> actionsRejected{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> disconnects{0};
+    std::atomic<uint64_t> lateJoins{0};   // Se identificó cuando su partida ya había terminado
+    std::atomic<uint64_t> busyRetries{0}; // Peticiones repetidas tras un "Server busy"
+    std::atomic<uint64_t> abandons{0};    // Jugadores que cerraron su conexión a media partida
+
+    // Espectadores (SIM_SPECTATORS)
+    std::atomic<uint64_t> spectatorMessages{0};
+    std::atomic<uint64_t> spectatorsLate{0};    // Llegaron con la partida ya terminada
+    std::atomic<uint64_t> streamErrors{0};      // Flujo público fuera de orden, con manos o cortado
+    std::atomic<int> spectatorsWatching{0};     // Conectados y sin terminar
+
+    // Ida y vuelta de cada acción: envío -> su actionResult, en µs
+    void addRtt(uint32_t us);
+    std::vector<uint32_t> takeRtts();
+
+    // Versión final que vio cada espectador que llegó al final de su partida
+    void addSpectatorResult(int matchId, uint64_t version);
+    std::vector<std::pair<int, uint64_t>> takeSpectatorResults();
+
+private:
+    std::mutex resultsMutex;
+    std::vector<uint32_t> rttUs;
+    std::vector<std::pair<int, uint64_t>> spectatorResults;
+};
+
+// Resultado de una partida visto por uno de sus jugadores
+struct MatchOutcome {
+    int matchId;
+    int winnerId;       // -1 = empate
+    uint64_t version;   // Versión del último estado (una por acción aceptada)
+    int turn;
+    std::string reason;
+};
+
+// Jugador sin interfaz sobre una conexión simulada. Juega sin pausas y
+// siempre sobre el último estado: ataca o se acerca a las cartas rivales y
+// si no puede, juega una carta de la mano. Sus decisiones solo dependen del
+// estado recibido y de su semilla, así que con MATCH_SEED cada partida se
+// juega igual sea cual sea la latencia de la red simulada.
+// No confirma estados (ackState): recibe siempre el estado completo.
+// La partida empieza sin esperar a los dos jugadores: el segundo puede
+// llegar cuando ya terminó (el motor responde "Match not found" o cierra
+// la conexión antes de gameOver). Si el hilo de la partida está saturado
+// ("Server busy") repite la misma acción, o pide el estado con resync
+class SimPlayer : public SimClient, public std::enable_shared_from_this<SimPlayer> {
+public:
+    typedef std::function<void(const MatchOutcome&)> OutcomeHandler;
+
+    // onOutcome se llama una vez por partida: el primero de los dos jugadores
+    // (comparten reported) que recibe gameOver
+    SimPlayer(SimGameTransport& transport, const SimPlayerConfig& config, SimStats& stats,
+              int matchId, int playerId, uint32_t seed, OutcomeHandler onOutcome,
+              std::shared_ptr<std::atomic<bool>> reported);
+
+    // Conectar e identificarse en la partida (con el ticket del matchmaking
+    // si MATCH_TICKET_SECRET está definida)
+    void start(const std::string& ticket = "");
+
+    // Abandonar la partida (cerrar la conexión sin volver) al llegar su turno
+    // con al menos actions acciones aceptadas. Llamar antes de start()
+    void leaveAfter(int actions) { leaveAfterActions = actions; }
+
+    // Los eventos de una conexión llegan de uno en uno (ver SimLink)
+    void onMessage(const std::string& payload, bool binary) override;
+    void onClose() override;
+
+private:
+    struct Cell {
+        int x, y;
+        int ownerId;
+    };
+
+    void handleState(const json& data);
+    void handleActionResult(const json& data);
+    void handleGameOver(const json& data);
+
+    // Jugar si es nuestro turno y no hay nada pendiente
+    void maybeAct();
+    json chooseAction();
+
+    void send(const json& message);
+
+    SimGameTransport& transport;
+    const SimPlayerConfig& config;
+    SimStats& stats;
+    int matchId;
+    int playerId;
+    std::mt19937 rng;
+    OutcomeHandler onOutcome;
+    std::shared_ptr<std::atomic<bool>> reported;
+
+    connection_hdl hdl;
+    bool joined = false;
+    bool finished = false;
+
+    // Último estado recibido
+    uint64_t version = 0;
+    int turn = 0;
+    int currentPlayerId = -1;
+    size_t handSize = 0;
+    std::vector<Cell> board;
+
+    int actionsThisTurn = 0;
+    int actionsAccepted = 0;
+    int leaveAfterActions = 0;    // 0 = juega hasta el final
+    bool actionPending = false;   // Acción enviada sin actionResult
+    json lastAction;              // Se repite tal cual si el motor la descarta
+    bool awaitingState = false;   // Acción aceptada: se juega sobre el estado que la sigue
+    std::chrono::steady_clock::time_point actionSentAt;
+};
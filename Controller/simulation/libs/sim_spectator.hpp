@@ -0,0 +1,40 @@
+#pragma once
+
+#include "sim_player.hpp"
+
+// Espectador simulado: mira una partida con "spectate" y comprueba el flujo
+// público mientras llega. Recibe un único gameState y después deltas contra
+// la versión anterior, sin manos, con los eventos en orden de seq. Al final
+// de la partida apunta la última versión que vio, que debe coincidir con la
+// de los jugadores y con la de los demás espectadores (ver Simulation::report).
+// Si llega cuando la partida ya terminó cuenta como tardío, no como error
+class SimSpectator : public SimClient, public std::enable_shared_from_this<SimSpectator> {
+public:
+    SimSpectator(SimGameTransport& transport, SimStats& stats, int matchId, bool binary);
+
+    void start();
+
+    void onMessage(const std::string& payload, bool binary) override;
+    void onClose() override;
+
+private:
+    // Estado público: ambos jugadores en "players", sin "you" ni manos
+    bool isPublic(const json& data) const;
+
+    void handleEvent(const json& data);
+    void finish();
+    void fail(const char* reason);
+
+    SimGameTransport& transport;
+    SimStats& stats;
+    int matchId;
+    bool binary;
+
+    connection_hdl hdl;
+    bool watching = false;     // Recibió "spectating"
+    bool hasSnapshot = false;  // Recibió el estado completo
+    bool finished = false;
+    uint64_t version = 0;
+    uint64_t lastSeq = 0;
+    bool gameOver = false;     // Según el último estado
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "sim_network.hpp"
+#include "sim_player.hpp"
+#include "sim_spectator.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Parámetros de una ejecución (variables de entorno SIM_*, ver README)
+struct SimulationConfig {
+    int matches = 100000;        // Partidas a jugar de principio a fin
+    int concurrent = 2000;       // Partidas en curso a la vez como máximo
+    int threads = 1;             // Hilos del IoContextPool
+    uint32_t seed = 1;           // Semilla de barajas, jugadores y motor (MATCH_SEED)
+    int timeoutS = 600;          // Plazo para que terminen todas las partidas
+    int spectators = 0;          // Espectadores por partida (mitad texto, mitad binario)
+    int abandonPercent = 0;      // % de partidas que abandona su primer jugador
+    int migratePercent = 0;      // % de partidas que se intentan migrar a un destino que las rechaza
+    SimLinkConfig link;
+    SimPlayerConfig player;
+
+    static SimulationConfig fromEnvironment();
+};
+
+// Sistema completo en un proceso: MatchmakingService, MatchmakingHandler,
+// Orchestrator, GameThreads y GameGateway, con los sockets sustituidos por
+// SimControlNetwork y SimGameTransport. Un hilo encola jugadores en el
+// matchmaking en orden (emparejamiento reproducible), los SimPlayer juegan
+// cada partida y se espera a que el motor avise al matchmaking del fin de
+// todas. El resumen incluye una huella de los resultados: con la misma
+// semilla debe coincidir entre ejecuciones, hilos y condiciones de red
+class Simulation {
+public:
+    explicit Simulation(const SimulationConfig& config);
+
+    // Ejecutar y escribir el informe; 0 si todas las partidas terminaron bien
+    int run();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // Variables de entorno que leen los singletons al construirse
+    void configureEnvironment();
+
+    // Arrancar el motor y el matchmaking sobre la red simulada
+    void setUp();
+
+    // Encolar los jugadores manteniendo como mucho concurrent partidas en curso
+    void drive();
+
+    // Esperar a que terminen todas las partidas (false si vence el plazo)
+    bool waitForMatches(Clock::time_point deadline);
+
+    // Esperar a que los espectadores terminen de recibir su flujo
+    bool waitForSpectators(Clock::time_point deadline);
+
+    // Hilo que pide al motor migrar las partidas elegidas (migrateMatch por
+    // su canal de control) a un destino que valida la partida exportada y la
+    // rechaza: la partida vuelve a su hilo y sigue sin cambiar de resultado
+    void migrateLoop();
+    json importMatchAndRefuse(const json& request);
+    void stopMigrations();
+
+    // Partidas, conexiones y registros que siguen vivos en el motor y el
+    // matchmaking; todos deben volver a cero cuando terminan las partidas
+    typedef std::vector<std::pair<std::string, size_t>> Leftovers;
+    Leftovers collectLeftovers();
+
+    // Esperar a que se libere todo (la liberación es asíncrona: hilo de
+    // limpieza del handler, cierres en vuelo). Devuelve lo que queda al final
+    Leftovers waitForCleanup(Clock::time_point deadline);
+
+    void onOutcome(const MatchOutcome& outcome);
+    void onMatchEnded();
+
+    int report(double seconds, bool completed, const Leftovers& leftovers);
+
+    // Detener el motor como game_engine/main.cpp y comprobar que no queda
+    // ningún hilo suyo; 0 si se pararon todos
+    int shutDown();
+
+    SimulationConfig config;
+    std::shared_ptr<SimControlNetwork> controlNetwork;
+    std::shared_ptr<SimGameTransport> gameTransport;
+    SimStats stats;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    int matchesStarted = 0;
+    int matchesEnded = 0;         // Avisos matchEnded recibidos por el matchmaking
+    int joinFailures = 0;
+    int threadsBefore = -1;       // Hilos del proceso antes de arrancar (-1 = desconocido)
+
+    // Migraciones (SIM_MIGRATE_PERCENT)
+    std::mutex migrateMutex;
+    std::condition_variable migrateCv;
+    std::deque<int> pendingMigrations;
+    bool migrationsClosed = false;
+    std::thread migrator;
+    int migrationsRequested = 0;
+    int migrationsReturned = 0;    // El destino la rechazó y siguió aquí
+    int migrationsLate = 0;        // La partida ya había terminado
+    int migrationsUnexpected = 0;  // Cualquier otra respuesta
+    std::atomic<int> importsChecked{0};
+    std::atomic<int> importErrors{0};  // El estado exportado no reconstruye la partida
+    std::vector<MatchOutcome> outcomes;
+};
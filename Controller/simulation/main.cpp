@@ -0,0 +1,17 @@
+#include "libs/simulation.hpp"
+#include <cstdlib>
+
+int main() {
+    // Con 100k partidas los INFO del motor dominarían el tiempo de ejecución
+#ifdef _WIN32
+    if (std::getenv("LOG_LEVEL") == nullptr) {
+        _putenv_s("LOG_LEVEL", "warn");
+    }
+#else
+    setenv("LOG_LEVEL", "warn", 0);
+#endif
+
+    SimulationConfig config = SimulationConfig::fromEnvironment();
+    Simulation simulation(config);
+    return simulation.run();
+}
@@ -0,0 +1,288 @@
+#include "../libs/sim_network.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+static int readEnvInt(const char* name, int defaultValue) {
+    const char* envValue = std::getenv(name);
+    if (envValue != nullptr && std::atoi(envValue) >= 0) {
+        return std::atoi(envValue);
+    }
+    return defaultValue;
+}
+
+SimLinkConfig SimLinkConfig::fromEnvironment() {
+    SimLinkConfig config;
+    config.latency = std::chrono::milliseconds(readEnvInt("SIM_LATENCY_MS", 0));
+    config.jitter = std::chrono::milliseconds(readEnvInt("SIM_JITTER_MS", 0));
+    config.lossPercent = std::min(readEnvInt("SIM_LOSS_PERCENT", 0), 100);
+    config.rto = std::chrono::milliseconds(readEnvInt("SIM_RTO_MS", 200));
+    config.controlLatency = std::chrono::milliseconds(readEnvInt("SIM_CONTROL_LATENCY_MS", 0));
+    return config;
+}
+
+// Retardo de un mensaje: latencia + jitter, más un RTO por cada intento perdido
+static std::chrono::microseconds linkDelay(const SimLinkConfig& config, std::mt19937& rng) {
+    std::chrono::microseconds delay = config.latency;
+    if (config.jitter.count() > 0) {
+        std::uniform_int_distribution<long> jitter(0, config.jitter.count());
+        delay += std::chrono::microseconds(jitter(rng));
+    }
+    if (config.lossPercent > 0) {
+        // Cada reintento puede volver a perderse (con 100% se cuenta uno solo)
+        std::uniform_int_distribution<int> percent(0, 99);
+        int maxRetries = config.lossPercent >= 100 ? 1 : 8;
+        for (int retries = 0; retries < maxRetries && percent(rng) < config.lossPercent; retries++) {
+            delay += config.rto;
+        }
+    }
+    return delay;
+}
+
+SimControlNetwork::SimControlNetwork(const SimLinkConfig& config)
+    : config(config), rng(0x5eed) {
+}
+
+void SimControlNetwork::listen(int port, Handler handler) {
+    handlers[port] = std::move(handler);
+}
+
+json SimControlNetwork::request(const std::string& host, int port, const json& body) {
+    auto it = handlers.find(port);
+    if (it == handlers.end()) {
+        throw std::runtime_error("Could not connect to " + host + ":" + std::to_string(port));
+    }
+    requests++;
+
+    // Pérdidas y latencia bloquean a quien envía, como un socket bloqueante
+    std::chrono::microseconds delay = config.controlLatency;
+    if (config.lossPercent > 0) {
+        std::lock_guard<std::mutex> lock(rngMutex);
+        SimLinkConfig lossOnly;
+        lossOnly.lossPercent = config.lossPercent;
+        lossOnly.rto = config.rto;
+        delay += linkDelay(lossOnly, rng);
+    }
+    if (delay.count() > 0) {
+        std::this_thread::sleep_for(delay);
+    }
+
+    // Se serializa y se parsea como en el socket real
+    json response = it->second(json::parse(body.dump()));
+    return json::parse(response.dump());
+}
+
+SimLink::SimLink(websocketpp::lib::asio::io_service& io, const SimLinkConfig& config, uint32_t seed)
+    : io(io), config(config), rng(seed), last(Clock::now()), timer(io) {
+}
+
+void SimLink::push(size_t bytes, Delivery delivery) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point at = Clock::now() + linkDelay(config, rng);
+    // Un mensaje no adelanta a los anteriores del mismo sentido
+    if (at < last) {
+        at = last;
+    }
+    last = at;
+    queue.push_back({at, bytes, std::move(delivery)});
+    queuedBytes += bytes;
+    if (!armed) {
+        armed = true;
+        arm();
+    }
+}
+
+size_t SimLink::getQueuedBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queuedBytes;
+}
+
+void SimLink::arm() {
+    auto self = shared_from_this();
+    if (queue.front().at <= Clock::now()) {
+        io.post([self]() { self->fire(); });
+        return;
+    }
+    timer.expires_at(queue.front().at);
+    timer.async_wait([self](const boost::system::error_code&) { self->fire(); });
+}
+
+void SimLink::fire() {
+    // Solo hay un fire() en curso por sentido: los mensajes se entregan en orden
+    std::vector<Delivery> due;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Clock::time_point now = Clock::now();
+        while (!queue.empty() && queue.front().at <= now) {
+            queuedBytes -= queue.front().bytes;
+            due.push_back(std::move(queue.front().delivery));
+            queue.pop_front();
+        }
+    }
+
+    for (auto& delivery : due) {
+        delivery();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (queue.empty()) {
+        armed = false;
+    } else {
+        arm();
+    }
+}
+
+SimGameTransport::SimGameTransport(websocketpp::lib::asio::io_service& io, const SimLinkConfig& config)
+    : io(io), config(config) {
+}
+
+void SimGameTransport::setServerHandlers(MessageHandler onMessage, CloseHandler onClose, PongHandler onPong) {
+    onServerMessage = std::move(onMessage);
+    onServerClose = std::move(onClose);
+    onServerPong = std::move(onPong);
+}
+
+connection_hdl SimGameTransport::connect(std::shared_ptr<SimClient> client, bool binary) {
+    auto connection = std::make_shared<Connection>();
+    connection->binary = binary;
+    connection->client = std::move(client);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        connection->id = nextConnectionId++;
+        connections[connection->id] = connection;
+    }
+    // La semilla de cada sentido depende solo del id: las mismas condiciones
+    // de red en cada ejecución (el resultado de las partidas no depende de ellas)
+    connection->up = std::make_shared<SimLink>(io, config, connection->id * 2);
+    connection->down = std::make_shared<SimLink>(io, config, connection->id * 2 + 1);
+    return connection;
+}
+
+std::shared_ptr<SimGameTransport::Connection> SimGameTransport::find(connection_hdl hdl) {
+    return std::static_pointer_cast<Connection>(hdl.lock());
+}
+
+void SimGameTransport::clientSend(connection_hdl hdl, const std::string& payload) {
+    auto connection = find(hdl);
+    if (!connection || connection->closing) {
+        return;
+    }
+    messages++;
+    connection->up->push(payload.size(), [this, hdl, payload, connection]() {
+        onServerMessage(hdl, payload, connection->binary);
+    });
+}
+
+void SimGameTransport::clientClose(connection_hdl hdl) {
+    auto connection = find(hdl);
+    if (connection) {
+        startClose(connection);
+    }
+}
+
+void SimGameTransport::startClose(const std::shared_ptr<Connection>& connection) {
+    if (connection->closing.exchange(true)) {
+        return;
+    }
+    connection_hdl hdl = connection;
+    connection->down->push(0, [connection]() {
+        connection->client->onClose();
+    });
+    connection->up->push(0, [this, hdl, connection]() {
+        onServerClose(hdl);
+        std::lock_guard<std::mutex> lock(mutex);
+        connections.erase(connection->id);
+    });
+}
+
+websocketpp::lib::asio::io_service& SimGameTransport::getIoService() {
+    return io;
+}
+
+void SimGameTransport::send(connection_hdl hdl, const std::string& payload,
+                            websocketpp::frame::opcode::value opcode, websocketpp::lib::error_code& ec) {
+    auto connection = find(hdl);
+    if (!connection) {
+        ec = websocketpp::error::make_error_code(websocketpp::error::bad_connection);
+        return;
+    }
+    if (connection->closing) {
+        ec = websocketpp::error::make_error_code(websocketpp::error::invalid_state);
+        return;
+    }
+    ec = websocketpp::lib::error_code();
+    messages++;
+    bool binary = opcode == websocketpp::frame::opcode::binary;
+    connection->down->push(payload.size(), [connection, payload, binary]() {
+        connection->client->onMessage(payload, binary);
+    });
+}
+
+void SimGameTransport::close(connection_hdl hdl, websocketpp::close::status::value,
+                             const std::string&, websocketpp::lib::error_code& ec) {
+    auto connection = find(hdl);
+    if (!connection) {
+        ec = websocketpp::error::make_error_code(websocketpp::error::bad_connection);
+        return;
+    }
+    ec = websocketpp::lib::error_code();
+    startClose(connection);
+}
+
+void SimGameTransport::ping(connection_hdl hdl, const std::string& payload, websocketpp::lib::error_code& ec) {
+    auto connection = find(hdl);
+    if (!connection || connection->closing) {
+        ec = websocketpp::error::make_error_code(websocketpp::error::invalid_state);
+        return;
+    }
+    ec = websocketpp::lib::error_code();
+    // El cliente contesta solo, como un navegador: el pong vuelve por el
+    // otro sentido detrás de lo que el cliente ya había enviado
+    connection->down->push(payload.size(), [this, hdl, payload, connection]() {
+        if (connection->closing) {
+            return;
+        }
+        connection->up->push(payload.size(), [this, hdl, payload]() {
+            if (onServerPong) {
+                onServerPong(hdl, payload);
+            }
+        });
+    });
+}
+
+size_t SimGameTransport::getBufferedAmount(connection_hdl hdl) {
+    auto connection = find(hdl);
+    if (!connection) {
+        throw std::runtime_error("Bad connection");
+    }
+    return connection->down->getQueuedBytes();
+}
+
+std::string SimGameTransport::getRemoteEndpoint(connection_hdl hdl) {
+    auto connection = find(hdl);
+    if (!connection) {
+        throw std::runtime_error("Bad connection");
+    }
+    // Todos los jugadores simulados comparten IP; el puerto distingue la conexión
+    return "127.0.0.1:" + std::to_string(20000 + connection->id % 40000);
+}
+
+bool SimGameTransport::isBinary(connection_hdl hdl) {
+    auto connection = find(hdl);
+    return connection && connection->binary;
+}
+
+void SimGameTransport::setTimer(long ms, TimerHandler handler) {
+    auto timer = std::make_shared<websocketpp::lib::asio::steady_timer>(io, std::chrono::milliseconds(ms));
+    timer->async_wait([timer, handler](const boost::system::error_code& error) {
+        handler(error ? websocketpp::error::make_error_code(websocketpp::error::operation_canceled)
+                      : websocketpp::lib::error_code());
+    });
+}
+
+size_t SimGameTransport::getOpenConnections() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return connections.size();
+}
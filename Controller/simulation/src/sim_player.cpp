@@ -0,0 +1,225 @@
+#include "../libs/sim_player.hpp"
+#include "binary_protocol.hpp"
+#include "src/utils/Log.hpp"
+
+// Tablero del motor de reglas (5 columnas x 7 filas)
+static const int BOARD_WIDTH = 5;
+static const int BOARD_HEIGHT = 7;
+
+void SimStats::addRtt(uint32_t us) {
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    rttUs.push_back(us);
+}
+
+std::vector<uint32_t> SimStats::takeRtts() {
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    std::vector<uint32_t> result;
+    result.swap(rttUs);
+    return result;
+}
+
+void SimStats::addSpectatorResult(int matchId, uint64_t version) {
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    spectatorResults.emplace_back(matchId, version);
+}
+
+std::vector<std::pair<int, uint64_t>> SimStats::takeSpectatorResults() {
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    std::vector<std::pair<int, uint64_t>> result;
+    result.swap(spectatorResults);
+    return result;
+}
+
+SimPlayer::SimPlayer(SimGameTransport& transport, const SimPlayerConfig& config, SimStats& stats,
+                     int matchId, int playerId, uint32_t seed, OutcomeHandler onOutcome,
+                     std::shared_ptr<std::atomic<bool>> reported)
+    : transport(transport), config(config), stats(stats), matchId(matchId), playerId(playerId),
+      rng(seed), onOutcome(std::move(onOutcome)), reported(std::move(reported)) {
+}
+
+void SimPlayer::start(const std::string& ticket) {
+    hdl = transport.connect(shared_from_this(), config.binary);
+    json identify = {
+        {"type", "identify"},
+        {"matchId", matchId},
+        {"playerId", playerId}
+    };
+    if (!ticket.empty()) {
+        identify["ticket"] = ticket;
+    }
+    send(identify);
+}
+
+void SimPlayer::onMessage(const std::string& payload, bool binary) {
+    json data;
+    try {
+        data = binary ? BinaryProtocol::decode(payload) : json::parse(payload);
+    } catch (const std::exception&) {
+        stats.errors++;
+        return;
+    }
+
+    std::string type = data.value("type", "");
+    if (type == "matchJoined") {
+        joined = true;
+    } else if (type == "gameState") {
+        handleState(data);
+    } else if (type == "actionResult") {
+        handleActionResult(data);
+    } else if (type == "gameOver") {
+        handleGameOver(data);
+    } else if (type == "error") {
+        // Llegó tarde: la partida ya terminó y el otro jugador informa del resultado
+        if (!joined && data.value("message", "") == "Match not found") {
+            finished = true;
+            stats.lateJoins++;
+            return;
+        }
+        // Buzón del hilo de la partida lleno: nada cambió, se repite lo mismo
+        std::string message = data.value("message", "");
+        if (message == "Server busy, action dropped" && actionPending) {
+            stats.busyRetries++;
+            send(lastAction);
+            return;
+        }
+        if (message == "Server busy, send resync") {
+            stats.busyRetries++;
+            send({{"type", "resync"}});
+            return;
+        }
+        stats.errors++;
+        LOG_DEBUG("Player %d got error: %s", playerId, message.c_str());
+    }
+}
+
+void SimPlayer::onClose() {
+    // El servidor cierra las conexiones al liberar la partida
+    if (finished) {
+        return;
+    }
+    finished = true;
+    // Se unió a una partida que ya había terminado y el otro jugador ya informó
+    if (reported->load()) {
+        stats.lateJoins++;
+    } else {
+        stats.disconnects++;
+    }
+}
+
+void SimPlayer::handleState(const json& data) {
+    // Al identificarse puede llegar repetido un estado ya recibido
+    uint64_t stateVersion = data.value("version", static_cast<uint64_t>(0));
+    if (stateVersion <= version) {
+        return;
+    }
+    version = stateVersion;
+    turn = data.value("turn", turn);
+
+    if (data.contains("you") && data["you"].contains("hand")) {
+        handSize = data["you"]["hand"].size();
+    }
+    board.clear();
+    for (const auto& cell : data.value("board", json::array())) {
+        board.push_back({cell.value("x", 0), cell.value("y", 0), cell.value("ownerId", -1)});
+    }
+
+    int current = data.value("currentPlayerId", currentPlayerId);
+    if (current == playerId && currentPlayerId != playerId) {
+        actionsThisTurn = 0;
+    }
+    currentPlayerId = current;
+    awaitingState = false;
+    // El estado de la jugada final llega antes que gameOver: no responder a él
+    if (data.value("gameOver", false)) {
+        return;
+    }
+    maybeAct();
+}
+
+void SimPlayer::handleActionResult(const json& data) {
+    if (data.value("fromPlayerId", -1) != playerId || !actionPending) {
+        return;
+    }
+    actionPending = false;
+    auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - actionSentAt).count();
+    stats.addRtt(static_cast<uint32_t>(rtt));
+
+    if (data.value("accepted", false)) {
+        actionsAccepted++;
+        awaitingState = true;
+    } else {
+        stats.actionsRejected++;
+        maybeAct();
+    }
+}
+
+void SimPlayer::handleGameOver(const json& data) {
+    if (finished) {
+        return;
+    }
+    finished = true;
+    if (!reported->exchange(true)) {
+        const json& winner = data["winnerId"];
+        onOutcome({matchId, winner.is_number() ? winner.get<int>() : -1, version, turn,
+                   data.value("reason", "")});
+    }
+}
+
+void SimPlayer::maybeAct() {
+    if (finished || currentPlayerId != playerId || actionPending || awaitingState) {
+        return;
+    }
+    // El rival gana por desconexión cuando vence DISCONNECT_GRACE_SECONDS
+    if (leaveAfterActions > 0 && actionsAccepted >= leaveAfterActions) {
+        finished = true;
+        stats.abandons++;
+        transport.clientClose(hdl);
+        return;
+    }
+    lastAction = chooseAction();
+    actionsThisTurn++;
+    actionPending = true;
+    actionSentAt = std::chrono::steady_clock::now();
+    stats.actionsSent++;
+    send(lastAction);
+}
+
+json SimPlayer::chooseAction() {
+    if (actionsThisTurn >= config.actionsPerTurn) {
+        return {{"type", "action"}, {"action", "endTurn"}};
+    }
+
+    std::vector<const Cell*> mine, theirs;
+    for (const auto& cell : board) {
+        (cell.ownerId == playerId ? mine : theirs).push_back(&cell);
+    }
+
+    std::uniform_int_distribution<int> percent(0, 99);
+    if (!mine.empty() && !theirs.empty() && (percent(rng) < 60 || handSize == 0)) {
+        // Atacar a una carta rival o acercarse un paso hacia ella
+        const Cell& from = *mine[rng() % mine.size()];
+        const Cell& target = *theirs[rng() % theirs.size()];
+        if (rng() % 2) {
+            return {{"type", "action"}, {"action", "attack"},
+                    {"fromX", from.x}, {"fromY", from.y}, {"targetX", target.x}, {"targetY", target.y}};
+        }
+        int x = from.x + (target.x > from.x) - (target.x < from.x);
+        int y = from.y + (target.y > from.y) - (target.y < from.y);
+        return {{"type", "action"}, {"action", "moveCard"},
+                {"fromX", from.x}, {"fromY", from.y}, {"x", x}, {"y", y}};
+    }
+
+    if (handSize > 0) {
+        std::uniform_int_distribution<int> card(0, static_cast<int>(handSize) - 1);
+        std::uniform_int_distribution<int> column(0, BOARD_WIDTH - 1);
+        std::uniform_int_distribution<int> row(0, BOARD_HEIGHT - 1);
+        return {{"type", "action"}, {"action", "playCard"},
+                {"handIndex", card(rng)}, {"x", column(rng)}, {"y", row(rng)}};
+    }
+    return {{"type", "action"}, {"action", "endTurn"}};
+}
+
+void SimPlayer::send(const json& message) {
+    transport.clientSend(hdl, config.binary ? BinaryProtocol::encode(message) : message.dump());
+}
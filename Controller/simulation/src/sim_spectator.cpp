@@ -0,0 +1,130 @@
+#include "../libs/sim_spectator.hpp"
+#include "binary_protocol.hpp"
+#include "src/utils/Log.hpp"
+
+SimSpectator::SimSpectator(SimGameTransport& transport, SimStats& stats, int matchId, bool binary)
+    : transport(transport), stats(stats), matchId(matchId), binary(binary) {
+}
+
+void SimSpectator::start() {
+    stats.spectatorsWatching++;
+    hdl = transport.connect(shared_from_this(), binary);
+    json spectate = {{"type", "spectate"}, {"matchId", matchId}};
+    transport.clientSend(hdl, binary ? BinaryProtocol::encode(spectate) : spectate.dump());
+}
+
+void SimSpectator::onMessage(const std::string& payload, bool isBinary) {
+    if (finished) {
+        return;
+    }
+    json data;
+    try {
+        data = isBinary ? BinaryProtocol::decode(payload) : json::parse(payload);
+    } catch (const std::exception&) {
+        fail("unparseable message");
+        return;
+    }
+    stats.spectatorMessages++;
+
+    std::string type = data.value("type", "");
+    if (type == "spectating") {
+        watching = true;
+    } else if (type == "gameState") {
+        if (hasSnapshot || !watching) {
+            fail("unexpected gameState");
+            return;
+        }
+        if (!isPublic(data)) {
+            fail("gameState with a hand");
+            return;
+        }
+        hasSnapshot = true;
+        version = data.value("version", static_cast<uint64_t>(0));
+        lastSeq = data.value("seq", static_cast<uint64_t>(0));
+        gameOver = data.value("gameOver", false);
+    } else if (type == "stateDelta") {
+        // Un delta por cambio, siempre contra la versión anterior
+        if (!hasSnapshot || data.value("baseVersion", static_cast<uint64_t>(0)) != version) {
+            fail("stateDelta out of order");
+            return;
+        }
+        if (!isPublic(data)) {
+            fail("stateDelta with a hand");
+            return;
+        }
+        version = data.value("version", static_cast<uint64_t>(0));
+        gameOver = data.value("gameOver", false);
+    } else if (type == "error") {
+        // La partida terminó antes de que se uniera
+        if (!hasSnapshot && data.value("message", "") == "Match not found") {
+            stats.spectatorsLate++;
+            finish();
+            return;
+        }
+        fail("error message");
+    } else if (data.contains("seq")) {
+        handleEvent(data);
+    }
+}
+
+void SimSpectator::handleEvent(const json& data) {
+    // Los eventos anteriores al estado completo ya están incluidos en él
+    uint64_t seq = data.value("seq", static_cast<uint64_t>(0));
+    if (!hasSnapshot || seq <= lastSeq) {
+        fail("event out of order");
+        return;
+    }
+    lastSeq = seq;
+    if (data.value("type", "") == "gameOver") {
+        stats.addSpectatorResult(matchId, version);
+        finish();
+    }
+}
+
+void SimSpectator::onClose() {
+    if (finished) {
+        return;
+    }
+    // Al liberar la partida se cierran todas sus conexiones. Un espectador
+    // que ya la vio terminar (en su estado completo) o que ni siquiera llegó
+    // a recibirlo no ha perdido nada del flujo
+    if (!hasSnapshot) {
+        stats.spectatorsLate++;
+    } else if (gameOver) {
+        stats.addSpectatorResult(matchId, version);
+    } else {
+        fail("closed before gameOver");
+        return;
+    }
+    finish();
+}
+
+bool SimSpectator::isPublic(const json& data) const {
+    if (data.contains("you") || data.contains("opponent")) {
+        return false;
+    }
+    auto players = data.find("players");
+    if (players == data.end()) {
+        return true;
+    }
+    for (const auto& player : *players) {
+        if (player.contains("hand")) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SimSpectator::finish() {
+    if (finished) {
+        return;
+    }
+    finished = true;
+    stats.spectatorsWatching--;
+}
+
+void SimSpectator::fail(const char* reason) {
+    LOG_WARN("Spectator of match %d: %s", matchId, reason);
+    stats.streamErrors++;
+    finish();
+}
@@ -0,0 +1,536 @@
+#include "../libs/simulation.hpp"
+#include "orchestrator.hpp"
+#include "matchmaking_handler.hpp"
+#include "game_gateway.hpp"
+#include "io_context_pool.hpp"
+#include "heartbeat_monitor.hpp"
+#include "matchmaking_service.hpp"
+#include "match.hpp"
+#include "src/game/MatchEngine.hpp"
+#include "src/utils/Log.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+
+// Puertos "lógicos" de la red simulada (no se abre ningún socket)
+static const char* DEFAULT_MATCHMAKING_PORT = "9001";
+static const char* DEFAULT_ENGINE_PORT = "9002";
+static const int MIGRATION_TARGET_PORT = 9004;
+
+static int readEnvInt(const char* name, int defaultValue) {
+    const char* envValue = std::getenv(name);
+    if (envValue != nullptr && std::atoi(envValue) >= 0) {
+        return std::atoi(envValue);
+    }
+    return defaultValue;
+}
+
+// Valor por defecto de una variable de entorno (overwrite: sustituirla aunque exista)
+static void setEnv(const char* name, const std::string& value, bool overwrite) {
+    if (!overwrite && std::getenv(name) != nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    _putenv_s(name, value.c_str());
+#else
+    setenv(name, value.c_str(), 1);
+#endif
+}
+
+// Semilla de un jugador: depende solo de la semilla global y su id
+static uint32_t playerSeed(uint32_t seed, int playerId) {
+    uint64_t x = (static_cast<uint64_t>(seed) << 32) ^ static_cast<uint32_t>(playerId);
+    x ^= x >> 31;
+    x *= 0x9e3779b97f4a7c15ULL;
+    x ^= x >> 29;
+    return static_cast<uint32_t>(x);
+}
+
+// Hilos del proceso (-1 si el sistema no lo permite saber)
+static int countThreads() {
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 8, "Threads:") == 0) {
+            return std::atoi(line.c_str() + 8);
+        }
+    }
+#endif
+    return -1;
+}
+
+SimulationConfig SimulationConfig::fromEnvironment() {
+    SimulationConfig config;
+    config.threads = std::max(1u, std::thread::hardware_concurrency());
+    config.matches = std::max(readEnvInt("SIM_MATCHES", config.matches), 1);
+    config.concurrent = std::max(readEnvInt("SIM_CONCURRENT", config.concurrent), 1);
+    config.threads = std::max(readEnvInt("SIM_THREADS", config.threads), 1);
+    config.seed = std::max(readEnvInt("SIM_SEED", config.seed), 1);
+    config.timeoutS = std::max(readEnvInt("SIM_TIMEOUT_S", config.timeoutS), 1);
+    config.spectators = readEnvInt("SIM_SPECTATORS", config.spectators);
+    config.abandonPercent = std::min(readEnvInt("SIM_ABANDON_PERCENT", config.abandonPercent), 100);
+    config.migratePercent = std::min(readEnvInt("SIM_MIGRATE_PERCENT", config.migratePercent), 100);
+    config.link = SimLinkConfig::fromEnvironment();
+    config.player.actionsPerTurn = std::max(readEnvInt("SIM_ACTIONS_PER_TURN", config.player.actionsPerTurn), 1);
+    config.player.binary = readEnvInt("SIM_BINARY", 0) != 0;
+    return config;
+}
+
+Simulation::Simulation(const SimulationConfig& config) : config(config) {
+}
+
+void Simulation::configureEnvironment() {
+    // Solo el modo gateway funciona sin sockets: todas las partidas en la
+    // misma "conexión" de escucha
+    const char* gateway = std::getenv("GATEWAY_PORT");
+    if (gateway == nullptr || std::atoi(gateway) <= 0) {
+        setEnv("GATEWAY_PORT", "9003", true);
+    }
+    setEnv("MATCHMAKING_PORT", DEFAULT_MATCHMAKING_PORT, false);
+    setEnv("GAME_ENGINE_PORT", DEFAULT_ENGINE_PORT, false);
+    setEnv("MATCH_SEED", std::to_string(config.seed), false);
+
+    // Sin plazos de turno: una partida lenta por la red no debe cambiar de resultado
+    setEnv("TURN_TIMEOUT_SECONDS", "0", false);
+
+    // Todas las partidas en curso caben en los hilos de juego sin avisos de sobrecarga
+    setEnv("MAX_MATCHES_PER_THREAD", std::to_string(config.concurrent), false);
+
+    // Las partidas abandonadas terminan por desconexión sin esperar 30 s
+    if (config.abandonPercent > 0) {
+        setEnv("DISCONNECT_GRACE_SECONDS", "1", false);
+    }
+}
+
+void Simulation::setUp() {
+    IoContextPool::getInstance().start(config.threads);
+    HeartbeatMonitor::getInstance().start();
+    IoContextPool::IoService& io = IoContextPool::getInstance().getIoService();
+
+    std::string decksFile = "../../SD_GameEngine-main/decks.json";
+    const char* decksEnv = std::getenv("DECKS_FILE");
+    if (decksEnv != nullptr && decksEnv[0] != '\0') {
+        decksFile = decksEnv;
+    }
+    if (!MatchEngine::loadDecks(decksFile)) {
+        LOG_WARN("Could not load decks from %s", decksFile.c_str());
+    }
+
+    controlNetwork = std::make_shared<SimControlNetwork>(config.link);
+    gameTransport = std::make_shared<SimGameTransport>(io, config.link);
+
+    // Motor: como en game_engine/main.cpp, con el canal de control y el
+    // gateway sobre la red simulada
+    Orchestrator::getInstance().initialize();
+    MatchmakingHandler& handler = MatchmakingHandler::getInstance();
+    handler.setTransport(controlNetwork);
+    handler.initialize();
+    Orchestrator::getInstance().setMatchEndedCallback([](int matchId) {
+        MatchmakingHandler::getInstance().onMatchEnded(matchId);
+    });
+
+    GameGateway& gateway = GameGateway::getInstance();
+    gameTransport->setServerHandlers(
+        [&gateway](connection_hdl hdl, const std::string& payload, bool binary) {
+            gateway.onTransportMessage(hdl, payload, binary);
+        },
+        [&gateway](connection_hdl hdl) {
+            gateway.onTransportClose(hdl);
+        },
+        [](connection_hdl, const std::string& payload) {
+            HeartbeatMonitor::getInstance().onPong(payload);
+        });
+    gateway.initialize(gameTransport);
+    gateway.run(handler.getGatewayPort(), 0);
+
+    // Matchmaking
+    MatchmakingService& service = MatchmakingService::getInstance();
+    service.setTransport(controlNetwork);
+    service.initialize();
+
+    controlNetwork->listen(readEnvInt("MATCHMAKING_PORT", 0), [this, &service](const json& request) {
+        json response = service.processRequest(request, "127.0.0.1");
+        if (request.value("action", "") == "matchEnded") {
+            onMatchEnded();
+        }
+        return response;
+    });
+    controlNetwork->listen(readEnvInt("GAME_ENGINE_PORT", 0), [&handler](const json& request) {
+        return handler.handleControlRequest(request);
+    });
+
+    if (config.migratePercent > 0) {
+        controlNetwork->listen(MIGRATION_TARGET_PORT, [this](const json& request) {
+            return importMatchAndRefuse(request);
+        });
+        migrator = std::thread(&Simulation::migrateLoop, this);
+    }
+}
+
+void Simulation::drive() {
+    int matchmakingPort = readEnvInt("MATCHMAKING_PORT", 0);
+    size_t deckCount = std::max<size_t>(MatchEngine::getDeckCount(), 1);
+
+    for (int i = 0; i < config.matches; i++) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] {
+                return matchesStarted - matchesEnded < config.concurrent;
+            });
+        }
+
+        // Dos jugadores seguidos forman siempre la misma partida
+        int playerIds[2] = {2 * i + 1, 2 * i + 2};
+        json result;
+        for (int playerId : playerIds) {
+            json request = {
+                {"action", "joinMatch"},
+                {"playerId", playerId},
+                {"BarajaId", static_cast<int>(playerSeed(config.seed, playerId) % deckCount)}
+            };
+            try {
+                result = controlNetwork->request("127.0.0.1", matchmakingPort, request);
+            } catch (const std::exception& e) {
+                result = {{"status", "error"}, {"message", e.what()}};
+            }
+        }
+
+        if (result.value("status", "") != "matched") {
+            LOG_WARN("Players %d and %d not matched: %s", playerIds[0], playerIds[1], result.dump().c_str());
+            for (int playerId : playerIds) {
+                controlNetwork->request("127.0.0.1", matchmakingPort, {{"action", "leaveMatch"}, {"playerId", playerId}});
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            joinFailures++;
+            continue;
+        }
+
+        int matchId = result["matchId"];
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            matchesStarted++;
+        }
+
+        // Con tickets, el primero recoge el suyo como un cliente real: la
+        // respuesta de joinMatch solo trae el del segundo
+        std::string tickets[2] = {"", result.value("ticket", "")};
+        if (!tickets[1].empty()) {
+            json active = controlNetwork->request("127.0.0.1", matchmakingPort,
+                                                  {{"action", "getActiveMatch"}, {"playerId", playerIds[0]}});
+            tickets[0] = active.value("ticket", "");
+        }
+
+        auto reported = std::make_shared<std::atomic<bool>>(false);
+        auto report = [this](const MatchOutcome& outcome) { onOutcome(outcome); };
+        // Las partidas abandonadas se eligen con la semilla: la huella no cambia entre ejecuciones
+        bool abandoned = playerSeed(config.seed, -matchId) % 100 < static_cast<uint32_t>(config.abandonPercent);
+        for (int i = 0; i < 2; i++) {
+            auto player = std::make_shared<SimPlayer>(*gameTransport, config.player, stats, matchId, playerIds[i],
+                                                      playerSeed(config.seed, playerIds[i]), report, reported);
+            if (abandoned && i == 0) {
+                player->leaveAfter(1);
+            }
+            player->start(tickets[i]);
+        }
+
+        // Con otra semilla que los abandonos, para que se combinen
+        if (playerSeed(config.seed + 1, -matchId) % 100 < static_cast<uint32_t>(config.migratePercent)) {
+            std::lock_guard<std::mutex> lock(migrateMutex);
+            pendingMigrations.push_back(matchId);
+            migrateCv.notify_one();
+        }
+
+        // Los espectadores se unen a la vez que los jugadores (si la partida
+        // termina antes, cuentan como tardíos)
+        for (int i = 0; i < config.spectators; i++) {
+            auto spectator = std::make_shared<SimSpectator>(*gameTransport, stats, matchId, i % 2 == 1);
+            spectator->start();
+        }
+    }
+}
+
+void Simulation::onOutcome(const MatchOutcome& outcome) {
+    std::lock_guard<std::mutex> lock(mutex);
+    outcomes.push_back(outcome);
+    cv.notify_all();
+}
+
+void Simulation::onMatchEnded() {
+    std::lock_guard<std::mutex> lock(mutex);
+    matchesEnded++;
+    cv.notify_all();
+}
+
+bool Simulation::waitForMatches(Clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return cv.wait_until(lock, deadline, [this] {
+        return matchesEnded >= matchesStarted && static_cast<int>(outcomes.size()) >= matchesStarted;
+    });
+}
+
+bool Simulation::waitForSpectators(Clock::time_point deadline) {
+    while (stats.spectatorsWatching.load() > 0) {
+        if (Clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+void Simulation::migrateLoop() {
+    int enginePort = readEnvInt("GAME_ENGINE_PORT", 0);
+    while (true) {
+        int matchId;
+        {
+            std::unique_lock<std::mutex> lock(migrateMutex);
+            migrateCv.wait(lock, [this] { return migrationsClosed || !pendingMigrations.empty(); });
+            if (pendingMigrations.empty()) {
+                return;
+            }
+            matchId = pendingMigrations.front();
+            pendingMigrations.pop_front();
+        }
+
+        json request = {
+            {"action", "migrateMatch"},
+            {"matchId", matchId},
+            {"targetHost", "127.0.0.1"},
+            {"targetPort", MIGRATION_TARGET_PORT}
+        };
+        ControlAuth::sign(request);
+        json response;
+        try {
+            response = controlNetwork->request("127.0.0.1", enginePort, request);
+        } catch (const std::exception& e) {
+            response = {{"status", "error"}, {"message", e.what()}};
+        }
+
+        std::string message = response.value("message", "");
+        std::lock_guard<std::mutex> lock(migrateMutex);
+        migrationsRequested++;
+        if (message.compare(0, 17, "Migration failed:") == 0) {
+            migrationsReturned++;
+        } else if (message == "Match not found") {
+            migrationsLate++;
+        } else {
+            LOG_WARN("Unexpected migrateMatch response for match %d: %s", matchId, response.dump().c_str());
+            migrationsUnexpected++;
+        }
+    }
+}
+
+json Simulation::importMatchAndRefuse(const json& request) {
+    std::string authError;
+    if (!ControlAuth::verify(request, authError)) {
+        importErrors++;
+        return {{"status", "error"}, {"message", authError}};
+    }
+    // El estado exportado tiene que reconstruir la misma partida (Match lo
+    // compara con el estado público que trae); después se rechaza
+    try {
+        Match imported(request.at("match"));
+        importsChecked++;
+    } catch (const std::exception& e) {
+        LOG_WARN("Exported match does not import: %s", e.what());
+        importErrors++;
+    }
+    return {{"status", "error"}, {"message", "Simulated target refuses imports"}};
+}
+
+void Simulation::stopMigrations() {
+    if (!migrator.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(migrateMutex);
+        migrationsClosed = true;
+    }
+    migrateCv.notify_one();
+    migrator.join();
+}
+
+Simulation::Leftovers Simulation::collectLeftovers() {
+    return {
+        {"engine matches", Orchestrator::getInstance().getMatchCount()},
+        {"indexed players", Orchestrator::getInstance().getIndexedPlayerCount()},
+        {"charged matches", Orchestrator::getInstance().getChargedMatchCount()},
+        {"charged cost", static_cast<size_t>(Orchestrator::getInstance().getChargedCost())},
+        {"thread matches", Orchestrator::getInstance().getThreadMatchCount()},
+        {"hosted matches", MatchmakingHandler::getInstance().getHostedMatchCount()},
+        {"gateway connections", GameGateway::getInstance().getConnectionCount()},
+        {"heartbeat watches", HeartbeatMonitor::getInstance().getWatchedCount()},
+        {"open connections", gameTransport->getOpenConnections()},
+        {"matchmaking matches", MatchmakingService::getInstance().getActiveMatchCount()},
+        {"matchmaking players", MatchmakingService::getInstance().getTrackedPlayerCount()}
+    };
+}
+
+Simulation::Leftovers Simulation::waitForCleanup(Clock::time_point deadline) {
+    while (true) {
+        Leftovers leftovers = collectLeftovers();
+        bool clean = std::all_of(leftovers.begin(), leftovers.end(),
+                                 [](const Leftovers::value_type& entry) { return entry.second == 0; });
+        if (clean || Clock::now() >= deadline) {
+            return leftovers;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+int Simulation::run() {
+    configureEnvironment();
+    // El hilo del logger es del proceso (se detiene en atexit): se arranca antes de contar
+    Logger::getInstance();
+    threadsBefore = countThreads();
+    setUp();
+
+    LOG_WARN("Simulating %d matches (%d at a time, %d threads, seed %u, latency %ld ms, jitter %ld ms, loss %d%%)",
+             config.matches, config.concurrent, config.threads, config.seed,
+             static_cast<long>(config.link.latency.count() / 1000), static_cast<long>(config.link.jitter.count() / 1000),
+             config.link.lossPercent);
+
+    Clock::time_point start = Clock::now();
+    drive();
+    Clock::time_point deadline = start + std::chrono::seconds(config.timeoutS);
+    bool completed = waitForMatches(deadline) && waitForSpectators(deadline);
+    stopMigrations();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    Leftovers leftovers = waitForCleanup(Clock::now() + std::chrono::seconds(10));
+    int result = report(seconds, completed, leftovers);
+    return shutDown() == 0 ? result : 1;
+}
+
+int Simulation::shutDown() {
+    Orchestrator::getInstance().shutdown();
+    MatchmakingHandler::getInstance().shutdown();
+    HeartbeatMonitor::getInstance().stop();
+    GameGateway::getInstance().stop();
+    IoContextPool::getInstance().stop();
+
+    // Hilos de juego, del pool, del heartbeat y del handler: todos unidos
+    int threadsAfter = countThreads();
+    if (threadsBefore < 0 || threadsAfter < 0) {
+        return 0;
+    }
+    std::printf("Shutdown          %d threads left running (%d before start, %d after stop)\n",
+                threadsAfter - threadsBefore, threadsBefore, threadsAfter);
+    std::fflush(stdout);
+    return threadsAfter == threadsBefore ? 0 : 1;
+}
+
+int Simulation::report(double seconds, bool completed, const Leftovers& leftovers) {
+    std::vector<MatchOutcome> results;
+    int started, ended, failures;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        results = outcomes;
+        started = matchesStarted;
+        ended = matchesEnded;
+        failures = joinFailures;
+    }
+
+    // Huella de los resultados: independiente del orden en que terminaron
+    std::sort(results.begin(), results.end(), [](const MatchOutcome& a, const MatchOutcome& b) {
+        return a.matchId < b.matchId;
+    });
+    uint64_t digest = 0xcbf29ce484222325ULL;
+    int unusualEndings = 0;
+    int disconnectEndings = 0;
+    uint64_t acceptedActions = 0;
+    for (const auto& outcome : results) {
+        std::string line = std::to_string(outcome.matchId) + ":" + std::to_string(outcome.winnerId) + ":" +
+                           std::to_string(outcome.version) + ":" + std::to_string(outcome.turn) + ";";
+        for (unsigned char c : line) {
+            digest = (digest ^ c) * 0x100000001b3ULL;
+        }
+        if (outcome.reason == "disconnect") {
+            disconnectEndings++;
+        } else if (outcome.reason != "legendDestroyed") {
+            unusualEndings++;
+        }
+        // La primera versión es el estado inicial
+        acceptedActions += outcome.version > 0 ? outcome.version - 1 : 0;
+    }
+
+    std::vector<uint32_t> rtts = stats.takeRtts();
+    std::sort(rtts.begin(), rtts.end());
+    auto percentileMs = [&rtts](double quantile) {
+        if (rtts.empty()) {
+            return 0.0;
+        }
+        size_t index = std::min(rtts.size() - 1, static_cast<size_t>(quantile * rtts.size()));
+        return rtts[index] / 1000.0;
+    };
+
+    std::printf("\n=== Simulation report ===\n");
+    std::printf("Matches           %d started, %d ended, %zu results, %d not matched%s\n",
+                started, ended, results.size(), failures, completed ? "" : " (TIMED OUT)");
+    std::printf("Wall time         %.2f s (%.0f matches/s)\n", seconds, seconds > 0 ? ended / seconds : 0.0);
+    std::printf("Messages          %llu game, %llu control\n",
+                static_cast<unsigned long long>(gameTransport->getMessageCount()),
+                static_cast<unsigned long long>(controlNetwork->getRequestCount()));
+    std::printf("Actions           %llu sent, %llu accepted, %llu rejected by the rules\n",
+                static_cast<unsigned long long>(stats.actionsSent.load()),
+                static_cast<unsigned long long>(acceptedActions),
+                static_cast<unsigned long long>(stats.actionsRejected.load()));
+    std::printf("Action RTT        p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+                percentileMs(0.50), percentileMs(0.99), rtts.empty() ? 0.0 : rtts.back() / 1000.0);
+    std::printf("Errors            %llu error messages, %llu disconnects, %d matches not ended by a legend\n",
+                static_cast<unsigned long long>(stats.errors.load()),
+                static_cast<unsigned long long>(stats.disconnects.load()), unusualEndings);
+    // Cada abandono termina su partida por desconexión, y ninguna otra
+    if (config.abandonPercent > 0) {
+        std::printf("Abandons          %llu players left, %d matches ended by disconnect\n",
+                    static_cast<unsigned long long>(stats.abandons.load()), disconnectEndings);
+    }
+    std::printf("Late joins        %llu players identified after their match ended\n",
+                static_cast<unsigned long long>(stats.lateJoins.load()));
+    std::printf("Busy retries      %llu requests repeated after the match thread was busy\n",
+                static_cast<unsigned long long>(stats.busyRetries.load()));
+    // Cada espectador que llegó al final vio la misma última versión que los jugadores
+    uint64_t spectatorMismatches = 0;
+    std::vector<std::pair<int, uint64_t>> spectatorResults = stats.takeSpectatorResults();
+    for (const auto& result : spectatorResults) {
+        auto outcome = std::lower_bound(results.begin(), results.end(), result.first,
+                                        [](const MatchOutcome& a, int matchId) { return a.matchId < matchId; });
+        if (outcome == results.end() || outcome->matchId != result.first || outcome->version != result.second) {
+            spectatorMismatches++;
+        }
+    }
+    if (config.spectators > 0) {
+        std::printf("Spectators        %zu watched to the end, %llu late, %llu messages, %llu stream errors, %llu final version mismatches\n",
+                    spectatorResults.size(), static_cast<unsigned long long>(stats.spectatorsLate.load()),
+                    static_cast<unsigned long long>(stats.spectatorMessages.load()),
+                    static_cast<unsigned long long>(stats.streamErrors.load()),
+                    static_cast<unsigned long long>(spectatorMismatches));
+    }
+    bool migrationsOk = true;
+    if (config.migratePercent > 0) {
+        std::lock_guard<std::mutex> lock(migrateMutex);
+        std::printf("Migrations        %d requested, %d returned after the target refused, %d after the match ended, %d unexpected, %d imports checked, %d import errors\n",
+                    migrationsRequested, migrationsReturned, migrationsLate, migrationsUnexpected,
+                    importsChecked.load(), importErrors.load());
+        migrationsOk = migrationsUnexpected == 0 && importErrors == 0 && importsChecked == migrationsReturned;
+    }
+    std::string leftoverLine;
+    size_t leftoverTotal = 0;
+    for (const auto& entry : leftovers) {
+        leftoverLine += (leftoverLine.empty() ? "" : ", ") + std::to_string(entry.second) + " " + entry.first;
+        leftoverTotal += entry.second;
+    }
+    std::printf("Leftovers         %s\n", leftoverLine.c_str());
+    std::printf("Result digest     %016llx (seed %u)\n", static_cast<unsigned long long>(digest), config.seed);
+    std::fflush(stdout);
+
+    bool ok = completed && failures == 0 && stats.disconnects == 0 &&
+              static_cast<int>(results.size()) == config.matches &&
+              stats.streamErrors == 0 && spectatorMismatches == 0 &&
+              unusualEndings == 0 && disconnectEndings == static_cast<int>(stats.abandons.load()) &&
+              leftoverTotal == 0 && migrationsOk;
+    return ok ? 0 : 1;
+}
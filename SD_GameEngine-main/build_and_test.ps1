@@ -19,7 +19,8 @@ $sources = @(
     "src/cards/CardLoader.cpp",
     "src/game/GameState.cpp",
     "src/effects/EffectDispatch.cpp",
-    "src/lex/EffectLexer.cpp"
+    "src/lex/EffectLexer.cpp",
+    "src/utils/Log.cpp"
 )
 
 $target = "test_card_loading.exe"
@@ -1,6 +1,6 @@
 #include "CardLoader.hpp"
 #include <fstream>
-#include <print>
+#include "../utils/Log.hpp"
 #include <stdexcept>
 #include "../../libs/json.hpp"
 #include "../effects/EffectDispatch.hpp"
@@ -34,14 +34,14 @@ std::vector<CardLoader::DeckConfig> CardLoader::loadDecksFromFile(const std::str
             decks.push_back(parseDeck(deckJson));
         }
         
-        std::println("Successfully loaded {} decks from {}", decks.size(), filename);
+        LOG_INFO("Successfully loaded %zu decks from %s", decks.size(), filename.c_str());
     }
     catch (const nlohmann::json::exception& e) {
-        std::println("JSON parsing error: {}", e.what());
+        LOG_ERROR("JSON parsing error: %s", e.what());
         throw;
     }
     catch (const std::exception& e) {
-        std::println("Error loading decks: {}", e.what());
+        LOG_ERROR("Error loading decks: %s", e.what());
         throw;
     }
     
@@ -170,7 +170,7 @@ std::vector<CardPtr> CardLoader::createCardsFromConfig(const DeckConfig& deckCon
             card = spell;
         }
         else {
-            std::println("Unknown card type: {}", cardConfig.type);
+            LOG_WARN("Unknown card type: %s", cardConfig.type.c_str());
             continue;
         }
         
@@ -195,7 +195,7 @@ EffectPtr CardLoader::createEffectFromConfig(const EffectConfig& config, CardPtr
     if (creator) {
         return creator(config, source, owner);
     } else {
-        std::println("Unknown effect type: {}", config.type);
+        LOG_WARN("Unknown effect type: %s", config.type.c_str());
         return nullptr;
     }
 }
@@ -1,5 +1,5 @@
 #include "GameState.hpp"
-#include <print>
+#include "../utils/Log.hpp"
 #include <stdexcept>
 #include <chrono>
 #include <thread>
@@ -49,20 +49,21 @@ void GameState::setPlayerDeck(PlayerId id, std::vector<CardPtr> deck) {
         // Shuffle the deck using fast RNG
         shuffleContainer(player->deck);
     } else {
-        std::println("Player {} not found!", id);
+        LOG_WARN("Player %u not found!", id);
     }
 }
 
 void GameState::startGame() {
+    // Place legends on their spawn positions (antes de robar: si la leyenda
+    // llegaba a la mano, el jugador empezaba sin leyenda y la partida terminaba)
+    placeLegends();
+    
     // Draw initial hands and reset actions
     for (auto& player : players) {
         drawCard(player, 5); // Draw 5 cards for each player
         player.actionsRemaining = player.maxActionsPerTurn;
     }
     
-    // Place legends on their spawn positions
-    placeLegends();
-    
     phase = GamePhase::PLAY;
     currentPlayer = 0; // First player starts
 }
@@ -99,12 +100,12 @@ void GameState::returnCardToDeck(PlayerId playerId, CardPtr card) {
     // Barajar el mazo para que la carta aparezca en una posición aleatoria
     shuffleContainer(player->deck);
     
-    std::println("Card {} returned to {}'s deck and shuffled", card->getName(), player->name);
+    LOG_DEBUG("Card %s returned to %s's deck and shuffled", card->getName().c_str(), player->name.c_str());
 }
 
 void GameState::endTurn(PlayerId playerId) {
     if (playerId != currentPlayer) {
-        std::println("Not your turn!");
+        LOG_DEBUG("Not your turn!");
         return;
     }
     
@@ -132,13 +133,13 @@ void GameState::endTurn(PlayerId playerId) {
 
 bool GameState::processAction(const GameAction& action) {
     if (action.playerId != currentPlayer) {
-        std::println("Not your turn!");
+        LOG_DEBUG("Not your turn!");
         return false;
     }
     
     // Check if player has actions remaining (except for END_TURN)
     if (action.type != GameAction::ActionType::END_TURN && !hasActionsRemaining(action.playerId)) {
-        std::println("No actions remaining! Use END_TURN to end your turn.");
+        LOG_DEBUG("No actions remaining! Use END_TURN to end your turn.");
         return false;
     }
     
@@ -178,14 +179,14 @@ void GameState::playCard(PlayerId playerId, CardPtr card, uint8_t x, uint8_t y)
     // Use simple player lookup
     Player* player = findPlayer(playerId);
     if (!player) {
-        std::println("Player {} not found!", playerId);
+        LOG_WARN("Player %u not found!", playerId);
         return;
     }
     
     // Check if player has the card in hand (optimized for small hand size)
     size_t cardIndex = player->findCardIndex(card);
     if (cardIndex == SIZE_MAX) {
-        std::println("Card not in player's hand!");
+        LOG_DEBUG("Card not in player's hand!");
         return;
     }
     
@@ -197,7 +198,7 @@ void GameState::playCard(PlayerId playerId, CardPtr card, uint8_t x, uint8_t y)
         // For units: place on the map
         MapCell* cell = map.at(x, y);
         if (!cell || cell->card.has_value()) {
-            std::println("Invalid target position for unit!");
+            LOG_DEBUG("Invalid target position for unit!");
             // Return card to hand if placement failed
             player->hand.insert(player->hand.begin() + cardIndex, card);
             return;
@@ -206,11 +207,11 @@ void GameState::playCard(PlayerId playerId, CardPtr card, uint8_t x, uint8_t y)
         // Set owner and place the unit on the map
         card->setOwner(playerId);
         cell->card = card;
-        std::println("Unit {} played at position ({}, {})", card->getName(), x, y);
+        LOG_DEBUG("Unit %s played at position (%d, %d)", card->getName().c_str(), x, y);
         
     } else if (auto spell = std::dynamic_pointer_cast<Spell>(card)) {
         // For spells: cast immediately and return to deck
-        std::println("Spell {} cast", card->getName());
+        LOG_DEBUG("Spell %s cast", card->getName().c_str());
         
         // Process the spell's effects immediately
         for (const auto& effect : card->getEffects()) {
@@ -221,7 +222,7 @@ void GameState::playCard(PlayerId playerId, CardPtr card, uint8_t x, uint8_t y)
         returnCardToDeck(playerId, card);
         
     } else {
-        std::println("Unknown card type for {}", card->getName());
+        LOG_WARN("Unknown card type for %s", card->getName().c_str());
         // Return card to hand if unknown type
         player->hand.insert(player->hand.begin() + cardIndex, card);
         return;
@@ -256,14 +257,14 @@ bool GameState::moveCard(PlayerId playerId, CardPtr card, uint8_t x, uint8_t y)
     }
     
     if (fromX == 255) {
-        std::println("Card {} not found on map!", card->getName());
+        LOG_DEBUG("Card %s not found on map!", card->getName().c_str());
         return false;
     }
     
     // Validate movement
     if (!canMoveCard(playerId, card, fromX, fromY, x, y)) {
-        std::println("Cannot move card {} from ({}, {}) to ({}, {})", 
-                     card->getName(), fromX, fromY, x, y);
+        LOG_DEBUG("Cannot move card %s from (%d, %d) to (%d, %d)", 
+                  card->getName().c_str(), fromX, fromY, x, y);
         return false;
     }
     
@@ -275,15 +276,15 @@ bool GameState::moveCard(PlayerId playerId, CardPtr card, uint8_t x, uint8_t y)
     fromCell->card.reset();
     // Consume action after successful move
     consumeAction(playerId);
-    std::println("Moved card {} from ({}, {}) to ({}, {})", 
-                 card->getName(), fromX, fromY, x, y);
+    LOG_DEBUG("Moved card %s from (%d, %d) to (%d, %d)", 
+              card->getName().c_str(), fromX, fromY, x, y);
     return true;
 }
 
 bool GameState::attackWithCard(PlayerId playerId, CardPtr card, uint8_t targetX, uint8_t targetY) {
     // Validate attack using improved validation
     if (!canAttack(playerId, card, targetX, targetY)) {
-        std::println("Invalid attack by player {} with card {}", playerId, card ? card->getName() : "null");
+        LOG_DEBUG("Invalid attack by player %u with card %s", playerId, card ? card->getName().c_str() : "null");
         return false;
     }
     
@@ -292,8 +293,8 @@ bool GameState::attackWithCard(PlayerId playerId, CardPtr card, uint8_t targetX,
     CardPtr target = targetCell->card.value();
     
     // Simple combat: destroy target (placeholder - you'd want actual stats)
-    std::println("Player {} attacks with {} targeting {} at position ({}, {})", 
-                 playerId, card->getName(), target->getName(), targetX, targetY);
+    LOG_DEBUG("Player %u attacks with %s targeting %s at position (%d, %d)", 
+              playerId, card->getName().c_str(), target->getName().c_str(), targetX, targetY);
     
     // Destroy the target card
     destroyCard(target);
@@ -384,7 +385,7 @@ void GameState::dealDamage(PlayerId targetPlayer, uint8_t damage) {
         } else {
             player->health -= damage;
         }
-        std::println("Player {} takes {} damage, health now: {}", targetPlayer, damage, player->health);
+        LOG_DEBUG("Player %u takes %d damage, health now: %d", targetPlayer, damage, player->health);
     }
 }
 
@@ -403,8 +404,8 @@ void GameState::destroyCard(CardPtr card) {
                     if (auto legend = std::dynamic_pointer_cast<Legend>(card)) {
                         if (owner->legend == legend) {
                             owner->legend = nullptr;
-                            std::println("¡Leyenda {} destruida! Jugador {} eliminado!", 
-                                       legend->getName(), owner->id);
+                            LOG_INFO("¡Leyenda %s destruida! Jugador %u eliminado!", 
+                                     legend->getName().c_str(), owner->id);
                             
                             // Las leyendas destruidas NO regresan al mazo (son únicas)
                             owner->discard.push_back(card);
@@ -415,7 +416,7 @@ void GameState::destroyCard(CardPtr card) {
                     }
                 }
                 cell->card.reset();
-                std::println("Card {} destroyed", card->getName());
+                LOG_DEBUG("Card %s destroyed", card->getName().c_str());
                 
                 // Verificar estado después de destruir una carta
                 checkLegendStatus();
@@ -591,22 +592,22 @@ void GameState::placeLegends() {
         // Buscar leyenda en el deck del jugador
         auto legend = findLegendInDeck(player.deck);
         if (!legend) {
-            std::println("¡Advertencia! Jugador {} no tiene leyenda en su deck", player.id);
+            LOG_WARN("Jugador %u no tiene leyenda en su deck", player.id);
             continue;
         }
         
         // Obtener posición de spawn para este jugador
         auto [spawnX, spawnY] = map.getSpawnPosition(player.id);
         if (spawnX == 255) {
-            std::println("¡Error! No hay posición de spawn para jugador {}", player.id);
+            LOG_ERROR("No hay posición de spawn para jugador %u", player.id);
             continue;
         }
         
         // Verificar que la posición de spawn esté libre
         MapCell* spawnCell = map.at(spawnX, spawnY);
         if (!spawnCell || spawnCell->card.has_value()) {
-            std::println("¡Error! Posición de spawn ({}, {}) ocupada para jugador {}", 
-                       spawnX, spawnY, player.id);
+            LOG_ERROR("Posición de spawn (%d, %d) ocupada para jugador %u", 
+                      spawnX, spawnY, player.id);
             continue;
         }
         
@@ -617,8 +618,8 @@ void GameState::placeLegends() {
         // Guardar referencia a la leyenda del jugador
         player.legend = legend;
         
-        std::println("Leyenda {} colocada en spawn ({}, {}) para jugador {}", 
-                   legend->getName(), spawnX, spawnY, player.id);
+        LOG_DEBUG("Leyenda %s colocada en spawn (%d, %d) para jugador %u", 
+                  legend->getName().c_str(), spawnX, spawnY, player.id);
     }
 }
 
@@ -637,10 +638,10 @@ void GameState::checkLegendStatus() {
     if (isGameOver()) {
         auto winner = getWinner();
         if (winner.has_value()) {
-            std::println("¡Juego terminado! Ganador: Team {}", 
-                       static_cast<int>(winner.value()));
+            LOG_INFO("¡Juego terminado! Ganador: Team %d", 
+                     static_cast<int>(winner.value()));
         } else {
-            std::println("¡Juego terminado en empate!");
+            LOG_INFO("¡Juego terminado en empate!");
         }
         phase = GamePhase::END;
     }
@@ -152,6 +152,11 @@ public:
     static void setSeed(uint32_t seed) { seedRng(seed); }
     static uint32_t getRandom() { return fastRand(); }
     
+    // Estado crudo del RNG del hilo: MatchEngine guarda el suyo por partida
+    // para que la partida sea reproducible a partir de sus acciones
+    static uint32_t getRngState() { return rng_state; }
+    static void setRngState(uint32_t state) { rng_state = state; }
+    
     // Game state validation and win conditions
     bool isGameOver() const;
     std::optional<Team> getWinner() const;
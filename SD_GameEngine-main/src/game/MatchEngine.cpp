@@ -0,0 +1,204 @@
+#include "MatchEngine.hpp"
+#include "GameState.hpp"
+#include "../cards/CardLoader.hpp"
+#include <mutex>
+#include "../utils/Log.hpp"
+
+namespace {
+    // Mazos compartidos por todas las partidas del proceso
+    std::mutex decksMutex;
+    std::vector<CardLoader::DeckConfig> deckConfigs;
+
+    MatchEngine::CardView viewCard(const CardPtr& card) {
+        MatchEngine::CardView view;
+        view.id = card->getId();
+        view.name = card->getName();
+        view.cost = card->getCost();
+        if (auto unit = std::dynamic_pointer_cast<Unit>(card)) {
+            view.attack = unit->getAttack();
+            view.health = unit->getHealth();
+            view.legend = unit->isLegend();
+        }
+        return view;
+    }
+}
+
+bool MatchEngine::loadDecks(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(decksMutex);
+    try {
+        deckConfigs = CardLoader::loadDecksFromFile(filename);
+    } catch (const std::exception& e) {
+        LOG_ERROR("MatchEngine: could not load decks from %s: %s", filename.c_str(), e.what());
+        return false;
+    }
+    return !deckConfigs.empty();
+}
+
+size_t MatchEngine::getDeckCount() {
+    std::lock_guard<std::mutex> lock(decksMutex);
+    return deckConfigs.size();
+}
+
+MatchEngine::MatchEngine(uint32_t deckSeat0, uint32_t deckSeat1) {
+    log.deckSeat0 = deckSeat0;
+    log.deckSeat1 = deckSeat1;
+    // La semilla sale del RNG del hilo; desde aquí la partida usa el suyo
+    log.seed = GameState::getRandom();
+    start();
+}
+
+MatchEngine::MatchEngine(const Checkpoint& checkpoint) {
+    log.deckSeat0 = checkpoint.deckSeat0;
+    log.deckSeat1 = checkpoint.deckSeat1;
+    log.seed = checkpoint.seed;
+    start();
+    log.actions.reserve(checkpoint.actions.size());
+    for (const auto& action : checkpoint.actions) {
+        apply(action);
+    }
+}
+
+void MatchEngine::start() {
+    uint32_t threadRng = GameState::getRngState();
+    GameState::setRngState(log.seed);
+    state = std::make_unique<GameState>();
+    state->addPlayer(0, Team::TEAM_A, "Player 0");
+    state->addPlayer(1, Team::TEAM_B, "Player 1");
+
+    {
+        std::lock_guard<std::mutex> lock(decksMutex);
+        if (!deckConfigs.empty()) {
+            uint32_t decks[2] = {log.deckSeat0, log.deckSeat1};
+            for (uint32_t seat = 0; seat < 2; ++seat) {
+                uint32_t deckIndex = decks[seat] < deckConfigs.size() ? decks[seat] : 0;
+                state->setPlayerDeck(seat, CardLoader::createCardsFromConfig(deckConfigs[deckIndex], seat));
+            }
+        } else {
+            LOG_WARN("MatchEngine: no decks loaded, players start with empty decks");
+        }
+    }
+
+    state->startGame();
+    rngState = GameState::getRngState();
+    GameState::setRngState(threadRng);
+}
+
+MatchEngine::~MatchEngine() = default;
+
+MatchEngine::Result MatchEngine::apply(const Action& action) {
+    Result result;
+
+    if (state->getPhase() == GamePhase::END) {
+        result.error = "Game is over";
+        return result;
+    }
+    if (action.seat != state->getCurrentPlayer()) {
+        result.error = "Not your turn";
+        return result;
+    }
+
+    GameAction gameAction;
+    gameAction.playerId = action.seat;
+
+    switch (action.type) {
+        case Action::Type::PLAY_CARD: {
+            const Player& player = state->getPlayer(action.seat);
+            if (action.handIndex >= player.hand.size()) {
+                result.error = "Invalid hand index";
+                return result;
+            }
+            if (!state->isValidPosition(action.x, action.y) || !state->isPositionEmpty(action.x, action.y)) {
+                result.error = "Invalid target position";
+                return result;
+            }
+            gameAction.type = GameAction::ActionType::PLAY_CARD;
+            gameAction.card = player.hand[action.handIndex];
+            gameAction.x = action.x;
+            gameAction.y = action.y;
+            break;
+        }
+        case Action::Type::MOVE_CARD:
+        case Action::Type::ATTACK: {
+            const MapCell* cell = state->getMap().at(action.fromX, action.fromY);
+            if (!cell || !cell->card.has_value()) {
+                result.error = "No card at source position";
+                return result;
+            }
+            if (cell->card.value()->getOwner() != action.seat) {
+                result.error = "Card not owned by player";
+                return result;
+            }
+            gameAction.card = cell->card.value();
+            if (action.type == Action::Type::MOVE_CARD) {
+                gameAction.type = GameAction::ActionType::MOVE_CARD;
+                gameAction.x = action.x;
+                gameAction.y = action.y;
+            } else {
+                gameAction.type = GameAction::ActionType::ATTACK;
+                gameAction.target = std::pair{action.x, action.y};
+            }
+            break;
+        }
+        case Action::Type::END_TURN:
+            gameAction.type = GameAction::ActionType::END_TURN;
+            break;
+    }
+
+    // Solo las acciones que llegan a las reglas cambian el estado (o el RNG)
+    log.actions.push_back(action);
+    uint32_t threadRng = GameState::getRngState();
+    GameState::setRngState(rngState);
+    result.accepted = state->processAction(gameAction);
+    rngState = GameState::getRngState();
+    GameState::setRngState(threadRng);
+    if (!result.accepted) {
+        result.error = "Action rejected";
+    }
+    return result;
+}
+
+MatchEngine::Snapshot MatchEngine::snapshot() const {
+    Snapshot snap;
+    snap.turn = state->getTurnNumber();
+    snap.currentSeat = state->getCurrentPlayer();
+    snap.phase = static_cast<uint8_t>(state->getPhase());
+    snap.gameOver = state->isGameOver();
+    if (auto winner = state->getWinner(); winner.has_value()) {
+        snap.winnerSeat = winner.value() == Team::TEAM_A ? 0 : 1;
+    }
+
+    for (uint32_t seat = 0; seat < 2; ++seat) {
+        const Player& player = state->getPlayer(seat);
+        PlayerView view;
+        view.seat = seat;
+        view.health = player.health;
+        view.actionsRemaining = player.actionsRemaining;
+        view.deckSize = static_cast<uint32_t>(player.deck.size());
+        view.alive = player.isAlive();
+        view.hand.reserve(player.hand.size());
+        for (const auto& card : player.hand) {
+            view.hand.push_back(viewCard(card));
+        }
+        snap.players.push_back(std::move(view));
+    }
+
+    const GameMap& map = state->getMap();
+    for (uint8_t y = 0; y < map.getHeight(); ++y) {
+        for (uint8_t x = 0; x < map.getWidth(); ++x) {
+            const MapCell* cell = map.at(x, y);
+            if (cell && cell->card.has_value()) {
+                CellView view;
+                view.x = x;
+                view.y = y;
+                view.owner = cell->card.value()->getOwner();
+                view.card = viewCard(cell->card.value());
+                snap.board.push_back(std::move(view));
+            }
+        }
+    }
+    return snap;
+}
+
+bool MatchEngine::isGameOver() const {
+    return state->isGameOver();
+}
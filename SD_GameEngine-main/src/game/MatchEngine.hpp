@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class GameState;
+
+// Fachada del motor de reglas para el servidor de partidas (Controller/game_engine).
+// La interfaz solo usa tipos estándar y compila en C++17: el servidor no ve
+// GameState ni los headers C++23 del motor, solo enlaza libsdgameengine.a.
+// Los jugadores se identifican por asiento (0 o 1), igual que en GameState.
+class MatchEngine {
+public:
+    // Acción ya decodificada del mensaje del cliente
+    struct Action {
+        enum class Type : uint8_t {
+            PLAY_CARD,
+            MOVE_CARD,
+            ATTACK,
+            END_TURN
+        } type = Type::END_TURN;
+
+        uint32_t seat = 0;
+        uint32_t handIndex = 0;         // PLAY_CARD: carta de la mano
+        uint8_t fromX = 0, fromY = 0;   // MOVE_CARD / ATTACK: carta en el mapa
+        uint8_t x = 0, y = 0;           // Destino (PLAY_CARD / MOVE_CARD) u objetivo (ATTACK)
+    };
+
+    struct Result {
+        bool accepted = false;
+        std::string error;
+    };
+
+    // Vista del estado para enviar a los clientes
+    struct CardView {
+        uint8_t id = 0;
+        std::string name;
+        uint8_t cost = 0;
+        uint8_t attack = 0, health = 0;     // 0 para hechizos
+        bool legend = false;
+    };
+
+    struct CellView {
+        uint8_t x = 0, y = 0;
+        uint32_t owner = 0;
+        CardView card;
+    };
+
+    struct PlayerView {
+        uint32_t seat = 0;
+        uint8_t health = 0;
+        uint8_t actionsRemaining = 0;
+        uint32_t deckSize = 0;
+        bool alive = false;
+        std::vector<CardView> hand;     // Solo se envía a su dueño
+    };
+
+    struct Snapshot {
+        uint32_t turn = 0;
+        uint32_t currentSeat = 0;
+        uint8_t phase = 0;              // GamePhase
+        bool gameOver = false;
+        int winnerSeat = -1;            // -1: sin ganador (en juego o empate)
+        std::vector<PlayerView> players;
+        std::vector<CellView> board;    // Solo celdas con carta
+    };
+
+    // Lo necesario para reconstruir la partida en otro proceso con el mismo
+    // decks.json: mazos, semilla del RNG y acciones que llegaron a las reglas
+    struct Checkpoint {
+        uint32_t deckSeat0 = 0, deckSeat1 = 0;
+        uint32_t seed = 0;
+        std::vector<Action> actions;
+    };
+
+    // Cargar (una vez por proceso) los mazos disponibles
+    static bool loadDecks(const std::string& filename);
+    static size_t getDeckCount();
+
+    // Nueva partida; los índices de mazo fuera de rango usan el mazo 0
+    MatchEngine(uint32_t deckSeat0, uint32_t deckSeat1);
+
+    // Reconstruir una partida repitiendo sus acciones (el resultado es
+    // idéntico: cada partida usa su propio estado del RNG)
+    explicit MatchEngine(const Checkpoint& checkpoint);
+    ~MatchEngine();
+
+    MatchEngine(const MatchEngine&) = delete;
+    MatchEngine& operator=(const MatchEngine&) = delete;
+
+    // Validar y aplicar una acción
+    Result apply(const Action& action);
+
+    Snapshot snapshot() const;
+    bool isGameOver() const;
+
+    const Checkpoint& checkpoint() const { return log; }
+
+private:
+    void start();
+
+    std::unique_ptr<GameState> state;
+    Checkpoint log;
+    uint32_t rngState = 0;
+};
@@ -0,0 +1,338 @@
+#include "Log.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Buffer circular de un hilo: un productor (el hilo) y un consumidor (quien
+// tenga drainMutex). head y tail en líneas de caché distintas
+class LogRing {
+public:
+    LogRing(size_t slotCount, uint32_t threadIndex)
+        : slots(new LogRecord[slotCount]), mask(slotCount - 1), threadIndex(threadIndex) {}
+
+    // Productor: slot libre (nullptr si está lleno)
+    LogRecord* beginWrite() {
+        uint64_t position = tail.load(std::memory_order_relaxed);
+        if (position - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead > mask) {
+                return nullptr;
+            }
+        }
+        return &slots[position & mask];
+    }
+
+    void commitWrite() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumidor: siguiente registro (nullptr si no hay)
+    const LogRecord* peek() const {
+        uint64_t position = head.load(std::memory_order_relaxed);
+        if (position == tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots[position & mask];
+    }
+
+    void pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    std::unique_ptr<LogRecord[]> slots;
+    const uint64_t mask;
+    const uint32_t threadIndex;
+
+    // El hilo terminó: se elimina cuando quede vacío
+    std::atomic<bool> retired{false};
+    std::atomic<uint64_t> dropped{0};
+
+private:
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) std::atomic<uint64_t> tail{0};
+    uint64_t cachedHead = 0;  // Solo lo usa el productor
+};
+
+struct Logger::State {
+    std::mutex registryMutex;
+    std::vector<std::shared_ptr<LogRing>> rings;
+    uint32_t nextThreadIndex = 1;
+
+    // Un solo consumidor de los buffers a la vez (hilo de fondo o flush())
+    std::mutex drainMutex;
+    std::mutex writeMutex;
+
+    std::mutex flusherMutex;
+    std::condition_variable flusherCv;
+    std::thread flusher;
+    bool running = false;
+
+    size_t ringSlots = 1024;
+    int flushMs = 10;
+    bool json = false;
+};
+
+namespace {
+    // Registro del hilo actual; al terminar el hilo se marca para eliminar
+    struct ThreadRing {
+        std::shared_ptr<LogRing> ring;
+        ~ThreadRing() {
+            if (ring) {
+                ring->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+    thread_local ThreadRing currentRing;
+
+    const char* levelName(LogLevel level) {
+        switch (level) {
+            case LogLevel::Debug: return "DEBUG";
+            case LogLevel::Info: return "INFO";
+            case LogLevel::Warn: return "WARN";
+            case LogLevel::Error: return "ERROR";
+            default: return "OFF";
+        }
+    }
+
+    LogLevel parseLevel(const std::string& name, LogLevel fallback) {
+        if (name == "debug") return LogLevel::Debug;
+        if (name == "info") return LogLevel::Info;
+        if (name == "warn") return LogLevel::Warn;
+        if (name == "error") return LogLevel::Error;
+        if (name == "off") return LogLevel::Off;
+        return fallback;
+    }
+
+    void appendTimestamp(std::string& out, uint64_t timestampNs) {
+        std::time_t seconds = static_cast<std::time_t>(timestampNs / 1000000000ULL);
+        std::tm local;
+#ifdef _WIN32
+        localtime_s(&local, &seconds);
+#else
+        localtime_r(&seconds, &local);
+#endif
+        char buffer[40];
+        size_t length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+        length += std::snprintf(buffer + length, sizeof(buffer) - length, ".%03u",
+                                static_cast<unsigned int>((timestampNs / 1000000ULL) % 1000));
+        out.append(buffer, length);
+    }
+
+    void appendJsonEscaped(std::string& out, const char* text, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            char c = text[i];
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(c));
+                        out += escaped;
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+    }
+
+    // Una línea de salida: "2026-01-01 12:00:00.123 INFO  [t3] mensaje" o JSON
+    void appendLine(std::string& out, const LogRecord& record, uint32_t threadIndex, bool json) {
+        if (!json) {
+            appendTimestamp(out, record.timestampNs);
+            char prefix[32];
+            std::snprintf(prefix, sizeof(prefix), " %-5s [t%u] ", levelName(record.level), threadIndex);
+            out += prefix;
+            record.formatter(record.format, record.args, out);
+            out += '\n';
+            return;
+        }
+        std::string message;
+        record.formatter(record.format, record.args, message);
+        out += "{\"ts\":\"";
+        appendTimestamp(out, record.timestampNs);
+        out += "\",\"level\":\"";
+        out += levelName(record.level);
+        out += "\",\"thread\":";
+        out += std::to_string(threadIndex);
+        out += ",\"msg\":\"";
+        appendJsonEscaped(out, message.data(), message.size());
+        out += "\"}\n";
+    }
+}
+
+Logger::Logger() : minLevel(static_cast<uint8_t>(LogLevel::Info)), async(true), dropped(0), state(new State()) {
+    const char* level = std::getenv("LOG_LEVEL");
+    if (level != nullptr) {
+        setLevel(parseLevel(level, LogLevel::Info));
+    }
+
+    const char* format = std::getenv("LOG_FORMAT");
+    state->json = format != nullptr && std::string(format) == "json";
+
+    // Potencia de dos para indexar con una máscara
+    const char* slots = std::getenv("LOG_RING_SLOTS");
+    if (slots != nullptr && std::atoi(slots) > 0) {
+        size_t requested = static_cast<size_t>(std::atoi(slots));
+        state->ringSlots = 1;
+        while (state->ringSlots < requested) {
+            state->ringSlots <<= 1;
+        }
+    }
+
+    const char* flushMs = std::getenv("LOG_FLUSH_MS");
+    if (flushMs != nullptr && std::atoi(flushMs) > 0) {
+        state->flushMs = std::atoi(flushMs);
+    }
+
+    const char* asyncEnv = std::getenv("LOG_ASYNC");
+    if (asyncEnv != nullptr && std::string(asyncEnv) == "0") {
+        async.store(false);
+        return;
+    }
+
+    state->running = true;
+    state->flusher = std::thread(&Logger::flusherLoop, this);
+    std::atexit([]() {
+        Logger::getInstance().shutdown();
+    });
+}
+
+LogRing* Logger::threadRing() {
+    if (!currentRing.ring) {
+        std::lock_guard<std::mutex> lock(state->registryMutex);
+        currentRing.ring = std::make_shared<LogRing>(state->ringSlots, state->nextThreadIndex++);
+        state->rings.push_back(currentRing.ring);
+    }
+    return currentRing.ring.get();
+}
+
+LogRecord* Logger::beginWrite(LogRing* ring, LogLevel level) {
+    LogRecord* record = ring->beginWrite();
+    if (record == nullptr && level < LogLevel::Warn) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    return record;
+}
+
+void Logger::commitWrite(LogRing* ring) {
+    ring->commitWrite();
+}
+
+void Logger::writeNow(const LogRecord& record) {
+    std::string line;
+    appendLine(line, record, 0, state->json);
+    std::lock_guard<std::mutex> lock(state->writeMutex);
+    std::fwrite(line.data(), 1, line.size(), stdout);
+    std::fflush(stdout);
+}
+
+size_t Logger::drain() {
+    std::lock_guard<std::mutex> drainLock(state->drainMutex);
+
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+        std::lock_guard<std::mutex> lock(state->registryMutex);
+        rings = state->rings;
+    }
+
+    // Líneas de todos los hilos ordenadas por hora (dentro de este lote)
+    struct Line {
+        uint64_t timestampNs;
+        std::string text;
+    };
+    std::vector<Line> lines;
+    bool removeRetired = false;
+    for (auto& ring : rings) {
+        bool retired = ring->retired.load(std::memory_order_acquire);
+        while (const LogRecord* record = ring->peek()) {
+            Line line{record->timestampNs, std::string()};
+            appendLine(line.text, *record, ring->threadIndex, state->json);
+            ring->pop();
+            lines.push_back(std::move(line));
+        }
+        uint64_t ringDropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+        if (ringDropped > 0) {
+            LogRecord notice;
+            notice.timestampNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+            notice.level = LogLevel::Warn;
+            notice.format = "%llu log messages dropped (buffer full)";
+            notice.formatter = &formatArgs<unsigned long long>;
+            char* out = notice.args;
+            size_t budget = 0;
+            LogArg<unsigned long long>::write(out, budget, static_cast<unsigned long long>(ringDropped));
+            Line line{notice.timestampNs, std::string()};
+            appendLine(line.text, notice, ring->threadIndex, state->json);
+            lines.push_back(std::move(line));
+        }
+        // retired se leyó antes de vaciarlo: no quedan registros nuevos
+        removeRetired = removeRetired || retired;
+    }
+
+    if (removeRetired) {
+        std::lock_guard<std::mutex> lock(state->registryMutex);
+        state->rings.erase(std::remove_if(state->rings.begin(), state->rings.end(),
+            [](const std::shared_ptr<LogRing>& ring) {
+                return ring->retired.load(std::memory_order_acquire) && ring->peek() == nullptr;
+            }), state->rings.end());
+    }
+
+    if (lines.empty()) {
+        return 0;
+    }
+    std::stable_sort(lines.begin(), lines.end(), [](const Line& a, const Line& b) {
+        return a.timestampNs < b.timestampNs;
+    });
+    std::string output;
+    for (const auto& line : lines) {
+        output += line.text;
+    }
+    std::lock_guard<std::mutex> lock(state->writeMutex);
+    std::fwrite(output.data(), 1, output.size(), stdout);
+    std::fflush(stdout);
+    return lines.size();
+}
+
+void Logger::flusherLoop() {
+    while (true) {
+        size_t written = drain();
+        std::unique_lock<std::mutex> lock(state->flusherMutex);
+        if (!state->running) {
+            break;
+        }
+        // Si el lote vino lleno se sigue enseguida
+        if (written == 0) {
+            state->flusherCv.wait_for(lock, std::chrono::milliseconds(state->flushMs));
+        }
+    }
+}
+
+void Logger::flush() {
+    drain();
+}
+
+void Logger::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(state->flusherMutex);
+        if (!state->running) {
+            return;
+        }
+        state->running = false;
+    }
+    state->flusherCv.notify_all();
+    if (state->flusher.joinable()) {
+        state->flusher.join();
+    }
+    // Lo que llegue después se escribe en el momento
+    async.store(false, std::memory_order_release);
+    drain();
+}
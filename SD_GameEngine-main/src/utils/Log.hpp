@@ -0,0 +1,273 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Logger asíncrono compartido por el motor de reglas y los servicios de
+// Controller (compila en C++17, como MatchEngine.hpp).
+//
+// Cada hilo escribe en su propio buffer circular sin locks: en el hilo que
+// registra solo se copian los argumentos (números tal cual, strings hasta
+// caber en el registro) y un puntero a la función que los formatea. Un hilo
+// de fondo recoge los registros de todos los buffers, los formatea con el
+// formato printf de la llamada y los escribe en stdout por lotes. Si el buffer
+// de un hilo está lleno el mensaje se descarta y se cuenta (nunca bloquea);
+// los WARN y ERROR en ese caso se escriben en el momento.
+//
+// Uso: LOG_INFO("Match %d ended (%s)", matchId, reason.c_str());
+// El formato debe ser un literal (se guarda el puntero) y no lleva '\n'.
+//
+// Configuración: LOG_LEVEL (debug|info|warn|error|off, por defecto info),
+// LOG_FORMAT (text|json), LOG_ASYNC=0 para escribir en el momento,
+// LOG_RING_SLOTS (registros por hilo) y LOG_FLUSH_MS (espera del hilo de fondo).
+// Al compilar, -DLOG_COMPILE_LEVEL=1 elimina los LOG_DEBUG (2: también INFO...).
+
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#endif
+
+// (no en mayúsculas: ERROR es una macro de windows.h)
+enum class LogLevel : uint8_t {
+    Debug = 0,
+    Info = 1,
+    Warn = 2,
+    Error = 3,
+    Off = 4
+};
+
+// Constante: los niveles por debajo de LOG_COMPILE_LEVEL no generan código
+constexpr bool logLevelCompiled(int level) {
+    return level >= LOG_COMPILE_LEVEL;
+}
+
+// Solo para el compilador: con -Wformat (-Werror=format en los makefiles) el
+// literal se compara con los argumentos como en printf. Se usa dentro de
+// sizeof, así que no se llama ni evalúa nada. Los std::string van con c_str()
+#if defined(__GNUC__)
+__attribute__((format(printf, 1, 2)))
+#endif
+inline void logFormatCheck(const char*, ...) {}
+
+#define LOG_AT(level, ...)                                                                  \
+    do {                                                                                    \
+        (void)sizeof((logFormatCheck(__VA_ARGS__), 0));                                     \
+        if (logLevelCompiled(static_cast<int>(level)) && Logger::getInstance().enabled(level)) { \
+            Logger::getInstance().log(level, __VA_ARGS__);                                  \
+        }                                                                                   \
+    } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LogLevel::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LogLevel::Error, __VA_ARGS__)
+
+// Un registro en el buffer de un hilo (tamaño fijo: un slot del buffer)
+struct LogRecord {
+    static const size_t SIZE = 256;
+
+    uint64_t timestampNs;   // system_clock, desde epoch
+    const char* format;
+    void (*formatter)(const char* format, const char* args, std::string& out);
+    LogLevel level;
+
+    static const size_t ARGS_CAPACITY = SIZE - sizeof(uint64_t) - 2 * sizeof(void*) - sizeof(LogLevel);
+    char args[ARGS_CAPACITY];
+};
+
+// Copia binaria de un argumento. Números y punteros se copian tal cual;
+// std::string y const char* se copian (recortados al espacio que quede) y al
+// formatear se pasan como const char* apuntando al registro
+template<typename T, typename = void>
+struct LogArg {
+    static_assert(std::is_arithmetic<T>::value || std::is_pointer<T>::value,
+                  "LOG_*: unsupported argument type");
+    using Decoded = T;
+    static const size_t FIXED_SIZE = sizeof(T);
+
+    static void write(char*& out, size_t&, const T& value) {
+        std::memcpy(out, &value, sizeof(T));
+        out += sizeof(T);
+    }
+    static T read(const char*& in) {
+        T value;
+        std::memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return value;
+    }
+};
+
+struct LogStringArg {
+    using Decoded = const char*;
+    static const size_t FIXED_SIZE = sizeof(uint16_t) + 1;
+
+    // budget: bytes de texto que aún caben en el registro
+    static void writeChars(char*& out, size_t& budget, const char* text, size_t length) {
+        if (length > budget) {
+            length = budget;
+        }
+        budget -= length;
+        uint16_t stored = static_cast<uint16_t>(length);
+        std::memcpy(out, &stored, sizeof(stored));
+        out += sizeof(stored);
+        std::memcpy(out, text, length);
+        out += length;
+        *out++ = '\0';
+    }
+    static const char* read(const char*& in) {
+        uint16_t length;
+        std::memcpy(&length, in, sizeof(length));
+        const char* text = in + sizeof(length);
+        in = text + length + 1;
+        return text;
+    }
+};
+
+template<>
+struct LogArg<std::string> : LogStringArg {
+    static void write(char*& out, size_t& budget, const std::string& value) {
+        writeChars(out, budget, value.data(), value.size());
+    }
+};
+
+template<>
+struct LogArg<const char*> : LogStringArg {
+    static void write(char*& out, size_t& budget, const char* value) {
+        if (value == nullptr) {
+            value = "(null)";
+        }
+        writeChars(out, budget, value, std::strlen(value));
+    }
+};
+
+template<>
+struct LogArg<char*> : LogArg<const char*> {};
+
+class LogRing;
+
+class Logger {
+public:
+    // Nunca se destruye: los singletons que registran en su destructor pueden
+    // hacerlo después de que se vacíen los buffers al salir (se escribe en el momento)
+    static Logger& getInstance() {
+        static Logger* instance = new Logger();
+        return *instance;
+    }
+
+    bool enabled(LogLevel level) const {
+        return static_cast<uint8_t>(level) >= minLevel.load(std::memory_order_relaxed);
+    }
+
+    void setLevel(LogLevel level) {
+        minLevel.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+    }
+
+    template<typename... Args>
+    void log(LogLevel level, const char* format, const Args&... args) {
+        static_assert(fixedSize<std::decay_t<Args>...>() <= LogRecord::ARGS_CAPACITY,
+                      "LOG_*: too many arguments");
+        LogRecord local;
+        LogRing* ring = nullptr;
+        LogRecord* record = &local;
+        if (async.load(std::memory_order_acquire)) {
+            ring = threadRing();
+            LogRecord* slot = beginWrite(ring, level);
+            if (slot != nullptr) {
+                record = slot;
+            } else if (level < LogLevel::Warn) {
+                return;  // Buffer lleno: contado como descartado
+            } else {
+                ring = nullptr;
+            }
+        }
+        record->timestampNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        record->level = level;
+        record->format = format;
+        record->formatter = &formatArgs<std::decay_t<Args>...>;
+        char* out = record->args;
+        size_t budget = LogRecord::ARGS_CAPACITY - fixedSize<std::decay_t<Args>...>();
+        (void)out;
+        (void)budget;
+        (LogArg<std::decay_t<Args>>::write(out, budget, args), ...);
+        if (ring != nullptr) {
+            commitWrite(ring);
+        } else {
+            writeNow(local);
+        }
+    }
+
+    // Escribir todo lo registrado hasta ahora (bloquea hasta terminar)
+    void flush();
+
+    // Vaciar los buffers, parar el hilo de fondo y seguir escribiendo en el momento
+    void shutdown();
+
+    // Mensajes descartados por buffers llenos desde el arranque
+    uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    Logger();
+    ~Logger() = delete;
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    template<typename... Args>
+    static constexpr size_t fixedSize() {
+        return (size_t(0) + ... + LogArg<Args>::FIXED_SIZE);
+    }
+
+    template<typename... Args>
+    static void formatArgs(const char* format, const char* args, std::string& out) {
+        const char* in = args;
+        (void)in;
+        // Inicialización con llaves: los argumentos se leen en orden
+        std::tuple<typename LogArg<Args>::Decoded...> values{LogArg<Args>::read(in)...};
+        appendFormatted(out, format, values, std::index_sequence_for<Args...>());
+    }
+
+    template<typename Tuple, size_t... I>
+    static void appendFormatted(std::string& out, const char* format, const Tuple& values, std::index_sequence<I...>) {
+        // El 0 final sobra (printf ignora argumentos de más) pero evita el
+        // aviso de formato no literal sin argumentos
+        char buffer[512];
+        int length = std::snprintf(buffer, sizeof(buffer), format, std::get<I>(values)..., 0);
+        if (length < 0) {
+            return;
+        }
+        if (static_cast<size_t>(length) < sizeof(buffer)) {
+            out.append(buffer, length);
+            return;
+        }
+        size_t start = out.size();
+        out.resize(start + length + 1);
+        std::snprintf(&out[start], length + 1, format, std::get<I>(values)..., 0);
+        out.resize(start + length);
+    }
+
+    LogRing* threadRing();
+    LogRecord* beginWrite(LogRing* ring, LogLevel level);
+    void commitWrite(LogRing* ring);
+
+    // Formatear y escribir un registro sin pasar por los buffers
+    void writeNow(const LogRecord& record);
+
+    // Recoger los registros de todos los buffers y escribirlos (un solo consumidor)
+    size_t drain();
+
+    void flusherLoop();
+
+    std::atomic<uint8_t> minLevel;
+    std::atomic<bool> async;
+    std::atomic<uint64_t> dropped;
+
+    struct State;
+    std::unique_ptr<State> state;
+};